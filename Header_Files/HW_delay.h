@@ -8,9 +8,12 @@
 #ifndef SRC_HW_DELAY_H_
 #define SRC_HW_DELAY_H_
 
-#include "em_timer.h"
-#include "em_cmu.h"
+#include <stdint.h>
 
+#include "timer_wheel.h"
+#include "sleep_routines.h"
+
+uint32_t timer_delay_async(uint32_t ms_delay, uint32_t event);
 void timer_delay(uint32_t ms_delay);
 
 #endif /* SRC_HW_DELAY_H_ */
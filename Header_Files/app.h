@@ -7,6 +7,7 @@
 /* System include statements */
 #include "stdint.h"
 #include "string.h"
+#include "stdlib.h"
 #include "stdio.h"
 
 /* Silicon Labs include statements */
@@ -24,45 +25,58 @@
 #include "si7021.h"
 #include "ble.h"
 #include "HW_delay.h"
+#include "timer_wheel.h"
+#include "coroutine.h"
+#include "energy.h"
+#include "sampler.h"
+#include "sim_sensor.h"
+#include "cmd.h"
 //***********************************************************************************
 // defined files
 //***********************************************************************************
-#define		PWM_PER					2.7		// PWM period in seconds
-#define		PWM_ACT_PER				0.15	// PWM active period in seconds
+#define		SAMPLE_PER_MS			2700	// Si7021 sample period in ms
+#define		SIM_SAMPLE_PER_MS		1000	// Simulated sensor sample period in ms
+#define		RATE_MIN_MS				100		// "#rate=ms!" limits, near the minimum the Si7021 stays powered
+#define		RATE_MAX_MS				3600000
 #define		TIMER_DELAY				2.0		// 2 second delay (no Magic Numbers)
+#define		BLE_NAME_SAVE_MS		2000	// Time the HM-10 needs after AT+RESET to store its name
 
-// Application scheduled events
-#define		LETIMER0_COMP0_CB		0x00000001	//0b0001
-#define		LETIMER0_COMP1_CB		0x00000002	//0b0010
-#define		LETIMER0_UF_CB			0x00000004	//0b0100
-#define		BOOT_UP_CB				0x00000010	//0b100
+// Application scheduled events (scheduler event IDs)
+#define		TIMER_WHEEL_CB			0		// LETIMER0 COMP1/UF wakeup, serviced by the timer wheel
+#define		LEUART_LOOPBK_CB		1		// Resumes the LEUART loopback test task
+#define		SAMPLER_TASK_CB			2		// Resumes the sensor sampler task
+#define		BOOT_UP_CB				4
 
 // Si7021 scheduled events:
-#define 	SI7021_READ_DONE_CB		0x00000008	//0b1000
+#define 	SENSOR_DONE_CB			3		// A sensor has a fresh reading
+#define		SI7021_TASK_CB			8		// Resumes the Si7021 read task
+#define		SI7021_RES_DONE_CB		9		// Si7021 user register written
+#define		I2C_WATCHDOG_CB			10		// I2C timeouts, bus recovery and retry backoff
 
 // LEUART Addition:
 #define		SYSTEM_BLOCK_EM			EM3
-#define 	BLE_RX_DONE_CB			0x00000020
-#define		BLE_TX_DONE_CB			0x00000040
+#define 	BLE_RX_DONE_CB			5
+#define		BLE_TX_DONE_CB			6
+#define		BLE_TEST_CB				7		// Resumes the BLE AT handshake task
+#define		BLE_LINK_CB				11		// Resumes the BLE transport negotiation task
+#define		BLE_LINK_PROFILE		BLE_PROFILE_DEEP_SLEEP	// BLE_PROFILE_THROUGHPUT for USART0 at up to 115200
+#define		APP_LINE_MAX			50		// BLE buffer room a command, sensor line or reply line waits for, the size of buffer
 #define 	IMPERIAL				true
 #define		METRIC					false
 //***********************************************************************************
 // global variables
 //***********************************************************************************
-char buffer[50];
+char buffer[APP_LINE_MAX];
 
 
 //***********************************************************************************
 // function prototypes
 //***********************************************************************************
 void app_peripheral_setup(void);
-void scheduled_letimer0_comp0_cb(void);
-void scheduled_letimer0_comp1_cb(void);
-void scheduled_letimer0_uf_cb(void);
+void scheduled_boot_up_cb(uint32_t payload);
 
-void scheduled_boot_up_cb(void);
-
-void scheduled_tx_done_cb(void);
-void scheduled_rx_done_cb(void);
-void scheduled_si7021_read_done_cb(void);
+void scheduled_tx_done_cb(uint32_t payload);
+void scheduled_rx_done_cb(uint32_t payload);
+void scheduled_sensor_done_cb(uint32_t payload);
+void scheduled_si7021_res_done_cb(uint32_t payload);
 #endif
@@ -0,0 +1,109 @@
+/*
+ * atomic_ops.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Kay Sho
+ *      Pronouns: (She/They)
+ *
+ *  Lock-free read-modify-write helpers. On the Cortex-M4 they are built on the
+ *  LDREX/STREX exclusive monitor, so an interrupt that lands between the load
+ *  and the store makes the store fail and the loop retry instead of needing
+ *  interrupts masked. Host builds fall back to C11 <stdatomic.h>.
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef ATOMIC_OPS_HG
+#define ATOMIC_OPS_HG
+
+/* System include statements */
+#include <stdint.h>
+
+/* Silicon Labs include statements */
+#include "em_device.h"
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+#define ATOMIC_USE_EXCLUSIVE
+typedef volatile uint32_t	ATOMIC_U32;
+#else
+#include <stdatomic.h>
+typedef _Atomic uint32_t	ATOMIC_U32;
+#endif
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+
+/* Returns the value before the OR */
+static inline uint32_t atomic_fetch_or_u32(ATOMIC_U32 *addr, uint32_t mask){
+#ifdef ATOMIC_USE_EXCLUSIVE
+	uint32_t old;
+	do{
+		old = __LDREXW(addr);
+	} while(__STREXW(old | mask, addr));
+	return old;
+#else
+	return atomic_fetch_or(addr, mask);
+#endif
+}
+
+/* Returns the value before the AND */
+static inline uint32_t atomic_fetch_and_u32(ATOMIC_U32 *addr, uint32_t mask){
+#ifdef ATOMIC_USE_EXCLUSIVE
+	uint32_t old;
+	do{
+		old = __LDREXW(addr);
+	} while(__STREXW(old & mask, addr));
+	return old;
+#else
+	return atomic_fetch_and(addr, mask);
+#endif
+}
+
+/* Returns the value before the add, use a two's complement delta to subtract */
+static inline uint32_t atomic_fetch_add_u32(ATOMIC_U32 *addr, uint32_t delta){
+#ifdef ATOMIC_USE_EXCLUSIVE
+	uint32_t old;
+	do{
+		old = __LDREXW(addr);
+	} while(__STREXW(old + delta, addr));
+	return old;
+#else
+	return atomic_fetch_add(addr, delta);
+#endif
+}
+
+/* Stores [value] and returns what was there, used to fetch-and-clear */
+static inline uint32_t atomic_exchange_u32(ATOMIC_U32 *addr, uint32_t value){
+#ifdef ATOMIC_USE_EXCLUSIVE
+	uint32_t old;
+	do{
+		old = __LDREXW(addr);
+	} while(__STREXW(value, addr));
+	return old;
+#else
+	return atomic_exchange(addr, value);
+#endif
+}
+
+static inline uint32_t atomic_load_u32(ATOMIC_U32 *addr){
+#ifdef ATOMIC_USE_EXCLUSIVE
+	return *addr;
+#else
+	return atomic_load(addr);
+#endif
+}
+
+static inline void atomic_store_u32(ATOMIC_U32 *addr, uint32_t value){
+#ifdef ATOMIC_USE_EXCLUSIVE
+	*addr = value;
+#else
+	atomic_store(addr, value);
+#endif
+}
+
+#endif /* ATOMIC_OPS_HG */
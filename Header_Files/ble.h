@@ -19,6 +19,7 @@
 
 // Driver functions
 #include "leuart.h"
+#include "usart.h"
 #include "gpio.h"
 #include "HW_delay.h"
 
@@ -39,6 +40,24 @@
 #define LEUART0_TX_ENABLE	true
 #define LEUART0_RX_ENABLE	true
 
+// High speed link, USART0 on the LEUART0 pins
+#define HM10_USART			USART0
+#define HM10_USART_DATABITS	usartDatabits8
+#define HM10_USART_PARITY	usartNoParity
+#define HM10_USART_STOPBITS	usartStopbits1
+
+// Link profiles, see ble_link_open()
+#define BLE_PROFILE_DEEP_SLEEP	0				// LEUART0 at 9600, EM2 between messages
+#define BLE_PROFILE_THROUGHPUT	1				// USART0 at up to 115200, EM1 while open
+#define BLE_LINK_RATES			3				// 115200, 57600, 9600
+#define BLE_AT_STR				12
+#define BLE_AT_TIMEOUT_MS		200				// The HM-10 answers an AT command within a few ms
+#define BLE_BAUD_RESET_MS		1000			// HM-10 restart after AT+RESET
+
+// BLE TDD task
+#define BLE_TEST_STEPS		3					// AT, AT+NAME, AT+RESET
+#define BLE_TEST_STR		40
+
 // Circular Buffer addition
 #define CIRC_TEST 			true
 #define CIRC_OPER 			false
@@ -53,8 +72,19 @@ typedef struct {
 		uint32_t 	size;
 		uint32_t 	read_ptr;
 		uint32_t 	write_ptr;
+		uint32_t 	tx_pending;		// Packet the LEUART sends in place, freed once it is done
 } BLE_CIRCULAR_BUF;
 
+// Link counters, see ble_link_stats()
+typedef struct {
+		uint32_t	baudrate;		// Of the link in use
+		bool		usart;			// USART0, else LEUART0
+		uint32_t	messages;		// Sent since ble_link_open()
+		uint32_t	bytes;
+		uint32_t	air_ms;			// ble_circ_pop() to the TX done event, summed
+		uint32_t	max_air_ms;
+} BLE_LINK_STATS;
+
 // Test Circular Buffer Struct
 typedef struct {
 		char 		test_str[CIRC_TEST_SIZE][CSIZE];
@@ -71,8 +101,17 @@ typedef struct {
 //***********************************************************************************
 void ble_open(uint32_t tx_event, uint32_t rx_event);
 void ble_write(char *string);
+uint32_t ble_write_space(void);
+const char *ble_read(uint32_t *len);
+void ble_read_done(void);
+void ble_rx_stats(FRAME_RING_STATS *stats);
+
+void ble_link_open(uint32_t profile, uint32_t task_event, uint32_t done_event);
+void ble_link_task(uint32_t payload);
+void ble_link_stats(BLE_LINK_STATS *stats);
 
-bool ble_test(char *mod_name);
+void ble_test(char *mod_name, uint32_t task_event, uint32_t done_event);
+void ble_test_task(uint32_t payload);
 
 
 void circular_buff_test(void);
@@ -22,6 +22,13 @@
 // GPIO pin setup
 #define STRONG_DRIVE
 
+// Peripheral instances the drivers keep a context and IRQ handler for
+#define I2C0_ENABLED
+//#define I2C1_ENABLED			// Pins and device not on this board
+#define LEUART0_ENABLED
+//#define LEUART1_ENABLED		// Not on the PG12
+#define USART0_ENABLED						// High speed link to the HM-10, see ble_link_open()
+
 // LED 0 pin is
 #define	LED0_PORT				gpioPortF
 #define LED0_PIN				04u
@@ -65,9 +72,10 @@
 
 #define	SI7021_SENSOR_EN_PORT		gpioPortB
 #define	SI7021_SENSOR_EN_PIN		10u
-#define SI7021_SENSOR_EN_DEFAULT 	true
+#define SI7021_SENSOR_EN_DEFAULT 	true // On for the bus reset in i2c_open(), the sampler gates it after that
 #define SI7021_SENSOR_EN_GPIOMODE	gpioModePushPull
 #define SI7021_SENSOR_EN_STRENGTH	gpioDriveStrengthWeakAlternateWeak
+#define SI7021_POWER_GATED			// Sensor and SCL/SDA pull-ups powered only for each sample
 
 // I2C Configuration
 #define		I2C_SCL_ROUTE				I2C_ROUTELOC0_SCLLOC_LOC15
@@ -90,6 +98,10 @@
 #define LEUART0_TX_ROUTE				LEUART_ROUTELOC0_TXLOC_LOC18   	// Route to Loc18
 #define LEUART0_RX_ROUTE				LEUART_ROUTELOC0_RXLOC_LOC18   	// Route to Loc18
 
+// The USART0 locations of the same pins, PD10 and PD11
+#define USART0_TX_ROUTE					USART_ROUTELOC0_TXLOC_LOC18
+#define USART0_RX_ROUTE					USART_ROUTELOC0_RXLOC_LOC18
+
 
 //***********************************************************************************
 // global variables
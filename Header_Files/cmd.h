@@ -0,0 +1,80 @@
+/*
+ * cmd.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Kay Sho
+ *      Pronouns: (She/They)
+ *
+ *  Table of the "#name=arg,arg!" commands the phone sends, found with a
+ *  perfect hash of the name. Plain C with no Silicon Labs headers, so
+ *  Host_Tools/cmd_bench.cpp runs the same code.
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef CMD_HG
+#define CMD_HG
+
+/* System include statements */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define CMD_ARGS_MAX		2			// Comma separated numbers after '='
+#define CMD_ARG_DIGITS		9			// Longest number, fits an int32_t
+#define CMD_SLOT_BITS		5
+#define CMD_SLOTS			(1 << CMD_SLOT_BITS)
+#define CMD_HASH_SEED		2			// Collision free for the app's names, see cmd_bench
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+typedef struct{
+	uint32_t			count;
+	int32_t				value[CMD_ARGS_MAX];
+}CMD_ARGS;
+
+typedef void (*CMD_HANDLER)(const CMD_ARGS *args);
+
+/* One command, the name without the '#', '=' and '!' */
+typedef struct{
+	const char			*name;
+	CMD_HANDLER			handler;
+	uint8_t				min_args;
+	uint8_t				max_args;
+	const char			*usage;				// Sent back when the arguments do not fit
+}CMD;
+
+typedef enum{
+	CMD_OK,
+	CMD_UNKNOWN,						// No such name, or not a command frame
+	CMD_BAD_ARGS						// Not numbers, or too few or too many
+}CMD_STATUS;
+
+typedef struct{
+	uint32_t			ok;
+	uint32_t			unknown;
+	uint32_t			bad_args;
+}CMD_STATS;
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+bool cmd_open(const CMD *table, uint32_t count);
+uint32_t cmd_hash(const char *name, uint32_t len);
+CMD_STATUS cmd_dispatch(const char *frame, uint32_t len, const CMD **cmd);
+void cmd_stats(CMD_STATS *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CMD_HG */
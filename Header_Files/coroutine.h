@@ -0,0 +1,68 @@
+/*
+ * coroutine.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Kay Sho
+ *      Pronouns: (She/They)
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef COROUTINE_HG
+#define COROUTINE_HG
+
+/* System include statements */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Silicon Labs include statements */
+
+
+/* The developer's include statements */
+#include "scheduler.h"
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Stackless coroutines for multi-step driver sequences
+ *
+ * @details
+ *	A task is an ordinary scheduler handler whose body sits between
+ *	CR_BEGIN() and CR_END(). CR_YIELD() returns to the scheduler and records
+ *	the line to resume from, so the next time the task's event is dispatched
+ *	the handler jumps straight back to where it left off. A task starts an
+ *	operation that posts the task's own event on completion and then yields,
+ *	so the main loop keeps dispatching other events and sleeping meanwhile.
+ *
+ * @note
+ *	Locals do not survive a yield, keep anything needed afterwards in a static
+ *	or in the task's context struct. A switch statement cannot span a yield.
+ *
+ ******************************************************************************/
+#define CR_BEGIN(cr)		switch((cr)->line){ case 0:
+#define CR_YIELD(cr)		do{ (cr)->line = __LINE__; return; case __LINE__:; }while(0)
+#define CR_WAIT_UNTIL(cr, cond)	while(!(cond)){ (cr)->line = __LINE__; return; case __LINE__:; }
+#define CR_END(cr)			} (cr)->line = 0
+#define CR_RESET(cr)		((cr)->line = 0)
+#define CR_RUNNING(cr)		((cr)->line != 0)
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+typedef struct{
+	uint16_t				line;				// Resume point, 0 when not started
+}CR_STATE;
+
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+
+
+#endif /* COROUTINE_HG */
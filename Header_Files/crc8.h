@@ -0,0 +1,39 @@
+/*
+ * crc8.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Kay Sho
+ *      Pronouns: (She/They)
+ *
+ *  CRC-8 with polynomial x^8 + x^5 + x^4 + 1 (0x31), initial value 0x00, as
+ *  used by the Si7021 checksum byte. Plain C so the host tools can share it.
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef CRC8_HG
+#define CRC8_HG
+
+/* System include statements */
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define CRC8_INIT				0x00
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+uint8_t crc8(const uint8_t *data, uint32_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRC8_HG */
@@ -0,0 +1,63 @@
+/*
+ * cycle_counter.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Kay Sho
+ *      Pronouns: (She/They)
+ *
+ *  Free-running core cycle timestamps. On the Cortex-M4 this is the DWT
+ *  CYCCNT register, which only counts while the core is clocked, so time spent
+ *  asleep in EM1 and below is not included. Host builds read a virtual clock
+ *  that the test advances with cycle_counter_advance().
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef CYCLE_COUNTER_HG
+#define CYCLE_COUNTER_HG
+
+/* System include statements */
+#include <stdint.h>
+
+/* Silicon Labs include statements */
+#include "em_device.h"
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+#define CYCLE_USE_DWT
+#else
+extern volatile uint32_t cycle_virtual_clock;		// Defined in scheduler.c
+#endif
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+
+/* Starts the counter, safe to call more than once */
+static inline void cycle_counter_open(void){
+#ifdef CYCLE_USE_DWT
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+/* Returns the current cycle count, wraps every 2^32 cycles */
+static inline uint32_t cycle_counter_now(void){
+#ifdef CYCLE_USE_DWT
+	return DWT->CYCCNT;
+#else
+	return cycle_virtual_clock;
+#endif
+}
+
+#ifndef CYCLE_USE_DWT
+/* Host only: moves the virtual clock forward */
+static inline void cycle_counter_advance(uint32_t cycles){
+	cycle_virtual_clock += cycles;
+}
+#endif
+
+#endif /* CYCLE_COUNTER_HG */
@@ -0,0 +1,52 @@
+/*
+ * energy.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Kay Sho
+ *      Pronouns: (She/They)
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef ENERGY_HG
+#define ENERGY_HG
+
+/* System include statements */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Silicon Labs include statements */
+#include "em_core.h"
+#include "em_assert.h"
+
+/* The developer's include statements */
+#include "energy_model.h"
+#include "sleep_routines.h"
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+typedef struct {
+	ENERGY_RESIDENCY		residency;			// Since energy_open()
+	ENERGY_ESTIMATE			estimate;			// From the current model
+} ENERGY_STATS;
+
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void energy_open(void);
+void energy_set_model(const ENERGY_MODEL *model);
+const ENERGY_MODEL *energy_get_model(void);
+void energy_busy_begin(uint32_t load);
+void energy_busy_end(uint32_t load);
+void energy_stats(ENERGY_STATS *stats);
+
+#endif /* ENERGY_HG */
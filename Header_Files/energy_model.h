@@ -0,0 +1,91 @@
+/*
+ * energy_model.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Kay Sho
+ *      Pronouns: (She/They)
+ *
+ *  Current-per-mode model that turns residency times into an average current
+ *  and a battery life. Plain C with no Silicon Labs headers, so the firmware
+ *  and Host_Tools/energy_sim.cpp compute the same numbers.
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef ENERGY_MODEL_HG
+#define ENERGY_MODEL_HG
+
+/* System include statements */
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define ENERGY_MODES			5			// EM0 to EM4, same order as sleep_routines.h
+#define ENERGY_LOAD_I2C			0			// I2C transfer in progress, Si7021 converting
+#define ENERGY_LOAD_LEUART_TX	1			// LEUART shifting out to the HM-10
+#define ENERGY_LOAD_SENSOR		2			// Sensor supply switched on, see SI7021_POWER_GATED
+#define ENERGY_LOADS			3
+
+// EFM32PG12 datasheet typicals at 3.3 V, 19 MHz HFRCO, in nA
+#define ENERGY_EM0_NA			1400000
+#define ENERGY_EM1_NA			700000
+#define ENERGY_EM2_NA			3000		// LFXO and LEUART running
+#define ENERGY_EM3_NA			2100		// ULFRCO and LETIMER running
+#define ENERGY_EM4_NA			100
+#define ENERGY_I2C_NA			150000		// Si7021 conversion plus bus pull-ups
+#define ENERGY_LEUART_TX_NA		10000
+#define ENERGY_SENSOR_NA		60			// Si7021 standby at 25 C, 620 nA at 85 C
+#define ENERGY_BOARD_NA			0			// Always-on draw of parts outside the model
+#define ENERGY_BATTERY_MAH		225			// CR2032
+
+// Datasheet wakeup times back to EM0, in us. The core draws about EM0 current while waking.
+#define ENERGY_EM1_WAKE_US		2
+#define ENERGY_EM2_WAKE_US		11
+#define ENERGY_EM3_WAKE_US		11
+#define ENERGY_EM4_WAKE_US		9000		// Reset out of EM4, never picked by the governor
+
+#define ENERGY_MODEL_DEFAULT	{ \
+		{ENERGY_EM0_NA, ENERGY_EM1_NA, ENERGY_EM2_NA, ENERGY_EM3_NA, ENERGY_EM4_NA}, \
+		{ENERGY_I2C_NA, ENERGY_LEUART_TX_NA, ENERGY_SENSOR_NA}, \
+		ENERGY_BOARD_NA, ENERGY_BATTERY_MAH, \
+		{0, ENERGY_EM1_WAKE_US, ENERGY_EM2_WAKE_US, ENERGY_EM3_WAKE_US, ENERGY_EM4_WAKE_US} }
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+typedef struct {
+	uint32_t				mode_na[ENERGY_MODES];		// MCU current in each energy mode
+	uint32_t				load_na[ENERGY_LOADS];		// Added while the load is busy
+	uint32_t				board_na;					// Added all the time
+	uint32_t				battery_mah;
+	uint32_t				wake_us[ENERGY_MODES];		// Time to get back to EM0 from each mode
+} ENERGY_MODEL;
+
+typedef struct {
+	uint32_t				mode_ms[ENERGY_MODES];		// Time spent in each energy mode
+	uint32_t				load_ms[ENERGY_LOADS];		// Time each load was busy
+} ENERGY_RESIDENCY;
+
+typedef struct {
+	uint32_t				avg_na;						// Average current over the residency window
+	uint32_t				life_hours;					// Battery life at that average
+} ENERGY_ESTIMATE;
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void energy_estimate(const ENERGY_MODEL *model, const ENERGY_RESIDENCY *residency, ENERGY_ESTIMATE *estimate);
+uint32_t energy_cheapest_mode(const ENERGY_MODEL *model, uint32_t deepest, uint32_t sleep_us, const uint32_t *wake_us);
+void energy_wake_us(const ENERGY_MODEL *model, const uint32_t *wake_cycles, uint32_t core_mhz, uint32_t *wake_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ENERGY_MODEL_HG */
@@ -0,0 +1,60 @@
+/*
+ * event_ring.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Kay Sho
+ *      Pronouns: (She/They)
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef EVENT_RING_HG
+#define EVENT_RING_HG
+
+/* System include statements */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Silicon Labs include statements */
+#include "em_device.h"
+#include "em_assert.h"
+
+/* The developer's include statements */
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define EVENT_RING_SIZE		16						// Records per ring, the last is kept for EVENT_RING_LOST, must be a power of 2
+#define EVENT_RING_MASK		(EVENT_RING_SIZE - 1)
+#define EVENT_RING_LOST		0xFFFFFFFF				// Event of the marker a full ring takes its last record for
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+typedef struct {
+	uint32_t				event;				// Scheduler event ID
+	uint32_t				payload;			// Timestamp, byte count or status from the ISR
+	uint32_t				stamp;				// Cycle count when it was posted
+} EVENT_RECORD;
+
+typedef struct {
+	EVENT_RECORD			records[EVENT_RING_SIZE];
+	volatile uint32_t		head;				// Free-running, only written by the producer (ISR)
+	volatile uint32_t		tail;				// Free-running, only written by the consumer (main loop)
+	uint32_t				high_water;			// Most records ever waiting at once
+	uint32_t				overflow;			// Posts that found the ring full
+} EVENT_RING;
+
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void event_ring_init(EVENT_RING *ring);
+bool event_ring_post(EVENT_RING *ring, uint32_t event, uint32_t payload, uint32_t stamp);
+bool event_ring_get(EVENT_RING *ring, EVENT_RECORD *record);
+uint32_t event_ring_count(EVENT_RING *ring);
+
+#endif /* EVENT_RING_HG */
@@ -0,0 +1,72 @@
+/*
+ * frame_ring.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Kay Sho
+ *      Pronouns: (She/They)
+ *
+ *  Ring of received command frames, each kept in one piece with its length
+ *  so the owner can parse it where it lies. One producer, the RX interrupt
+ *  or the LDMA, and one consumer, the task. Plain C with no Silicon Labs
+ *  headers, so Host_Tools/rx_flood.cpp runs the same code.
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef FRAME_RING_HG
+#define FRAME_RING_HG
+
+/* System include statements */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define FRAME_RING_OVERHEAD		2			// Length record and null of each frame
+#define FRAME_RING_WRAP			0xFF		// Length record of the unused end of the buffer
+#define FRAME_RING_FRAME_MAX	254			// Longest frame a length record can hold
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+
+/* Every field but tail is written by the producer only, tail by the consumer */
+typedef struct{
+	char				*buf;
+	uint32_t			size;
+	uint32_t			frame_max;			// Longest frame, not counting the null
+	volatile uint32_t	head;				// Length record of the next frame
+	volatile uint32_t	tail;				// Length record of the oldest frame
+	uint32_t			frames;				// Committed
+	uint32_t			overflow;			// Dropped for being longer than frame_max
+	uint32_t			full;				// Dropped for finding no room
+}FRAME_RING;
+
+typedef struct{
+	uint32_t			frames;
+	uint32_t			overflow;
+	uint32_t			full;
+}FRAME_RING_STATS;
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void frame_ring_init(FRAME_RING *ring, char *buf, uint32_t size, uint32_t frame_max);
+char *frame_ring_reserve(FRAME_RING *ring);
+void frame_ring_commit(FRAME_RING *ring, uint32_t len);
+const char *frame_ring_peek(FRAME_RING *ring, uint32_t *len);
+void frame_ring_release(FRAME_RING *ring);
+void frame_ring_stats(const FRAME_RING *ring, FRAME_RING_STATS *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FRAME_RING_HG */
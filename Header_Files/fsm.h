@@ -0,0 +1,127 @@
+/**
+ * @file fsm.h
+ * @author Kay Sho
+ * @date  10/16/2026
+ * @brief Transition table state machines for the peripheral drivers
+ * @note The author's pronouns: (She/They)
+ *
+ * A driver lists its legal transitions in a const table, one row per state
+ * and one column per interrupt cause, so the table lives in flash. Each entry
+ * is two bytes: the index of the action to run and the next state. Entry 0
+ * of the action list handles every transition the table does not list, so
+ * the ISR does one indexed lookup and one call per cause, with no ladder of
+ * cases that only assert.
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef FSM_HG
+#define FSM_HG
+
+/* System include statements */
+#include <stdint.h>
+
+/* Silicon Labs include statements */
+#include "em_assert.h"
+
+/* The developer's include statements */
+#include "trace.h"
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define FSM_ILLEGAL				0			// Action index of the transitions not in the table
+#define FSM_STAY				0xFF		// Next state: unchanged, or set by the action
+#define FSM_STATES_MAX			15			// States and causes are one nibble of a trace record
+#define FSM_CAUSES_MAX			15
+#define FSM_NO_CAUSE			0x0F		// Traced cause of a state set outside fsm_dispatch()
+#define FSM_TRACE_ILLEGAL		0x0F		// Traced next state of an illegal transition
+
+/* Trace record argument of a transition */
+#define FSM_TRACE_ARG(from, cause, to)	(((from) << 8) | ((cause) << 4) | (to))
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+typedef void (*FSM_ACTION)(void *ctx);
+
+typedef struct{
+	uint8_t					action;				// Index into FSM_TABLE.actions, FSM_ILLEGAL if not listed
+	uint8_t					next;				// State entered before the action runs, or FSM_STAY
+}FSM_TRANSITION;
+
+typedef struct{
+	const FSM_TRANSITION*	transitions;		// [state * causes + cause]
+	const FSM_ACTION*		actions;			// actions[FSM_ILLEGAL] handles the transitions not listed
+	uint8_t					states;
+	uint8_t					causes;
+	uint16_t				trace_id;			// TRACE_x the transitions are recorded under
+}FSM_TABLE;
+
+typedef struct{
+	const FSM_TABLE*		table;
+	uint8_t					state;
+	uint8_t					last_illegal;		// state << 4 | cause of the last illegal transition
+	uint32_t				illegal;			// Illegal transitions since fsm_init()
+}FSM;
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void fsm_init(FSM *fsm, const FSM_TABLE *table, uint32_t state);
+void fsm_nop(void *ctx);
+
+/***************************************************************************//**
+ * @brief
+ *	Runs the transition of the current state for one interrupt cause
+ *
+ * @details
+ *	The next state is entered before the action runs, so an action that
+ *	moves on again, e.g. to CLOSE after the last byte, simply sets it. An
+ *	illegal transition is counted and handed to actions[FSM_ILLEGAL] with
+ *	the state unchanged. Transitions that enter a state, and illegal ones,
+ *	are traced as from, cause, to. Those that stay, such as one per byte,
+ *	are left to the IRQ trace record.
+ *
+ * @note
+ *	Kept inline, it is on every interrupt of the drivers that use it.
+ *
+ * @param[in] ctx
+ *	Handed to the action, the driver's context
+ *
+ ******************************************************************************/
+static inline void fsm_dispatch(FSM *fsm, uint32_t cause, void *ctx){
+	const FSM_TABLE *table = fsm->table;
+	uint32_t from = fsm->state;
+	FSM_TRANSITION t;
+
+	EFM_ASSERT(cause < table->causes);
+	t = table->transitions[from * table->causes + cause];
+	if(t.action == FSM_ILLEGAL){
+		fsm->illegal++;
+		fsm->last_illegal = (from << 4) | cause;
+		TRACE(table->trace_id, FSM_TRACE_ARG(from, cause, FSM_TRACE_ILLEGAL));
+	} else if(t.next != FSM_STAY){
+		fsm->state = t.next;
+		TRACE(table->trace_id, FSM_TRACE_ARG(from, cause, t.next));
+	}
+	table->actions[t.action](ctx);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Enters a state from an action, or from outside the interrupt
+ *
+ * @details
+ *	e.g. when a transfer is queued, or an action picks the next state at
+ *	run time. Traced with FSM_NO_CAUSE.
+ *
+ ******************************************************************************/
+static inline void fsm_set(FSM *fsm, uint32_t state){
+	EFM_ASSERT(state < fsm->table->states);
+	TRACE(fsm->table->trace_id, FSM_TRACE_ARG(fsm->state, FSM_NO_CAUSE, state));
+	fsm->state = state;
+}
+
+#endif /* FSM_HG */
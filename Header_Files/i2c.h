@@ -15,6 +15,7 @@
 
 /* System include statements */
 #include <stdint.h>
+#include <stdbool.h>
 
 /* Silicon Labs include statements */
 #include <em_emu.h>
@@ -28,6 +29,10 @@
 #include "brd_config.h"
 #include "scheduler.h"
 #include "gpio.h"
+#include "energy.h"
+#include "ldma.h"
+#include "timer_wheel.h"
+#include "fsm.h"
 
 //***********************************************************************************
 // defined files
@@ -37,7 +42,18 @@
 #define I2C_WRITE		0
 #define I2C_READ		1
 
-#define RESET_TOGGLE_NUMBER		18
+#define I2C_QUEUE_SIZE			4				// Transfers waiting behind the one on the bus
+#define I2C_FLAG_POLL_READ		0x01			// Re-send the read address while the device NACKs it
+#define I2C_PAYLOAD_NACK		0x80000000		// Set in the completion payload if the device NACKed
+#define I2C_PAYLOAD_ERROR		0x40000000		// Set if the transfer was given up after timeouts or bus errors
+#define I2C_PAYLOAD_FAILED		(I2C_PAYLOAD_NACK | I2C_PAYLOAD_ERROR)
+#define I2C_NO_EVENT			0xFFFFFFFF		// Transfer posts nothing, e.g. the first of a chained pair
+
+#define I2C_TIMEOUT_MS			50				// Longest one transfer may hold the bus, a polled Si7021 RH read takes 23 ms
+#define I2C_RETRY_MAX			3				// Retries after a timeout or bus error
+#define I2C_BACKOFF_MS			2				// Wait before the first retry, doubled for each further one
+#define I2C_RECOVER_STEP_MS		1				// Half an SCL period of the bus recovery
+#define RESET_TOGGLE_NUMBER		18				// SCL edges the recovery sends at most, nine clocks
 
 
 //***********************************************************************************
@@ -64,15 +80,61 @@ typedef struct{
 	uint32_t				sda_pin;			// Pin
 	uint32_t				scl_port;
 	uint32_t				sda_port;
+
+	bool					dma;				// Move data bytes on the LDMA, see i2c_transfer()
+	uint32_t				watchdog_event;		// Scheduler event the driver uses for timeouts, recovery and retries
 }I2C_OPEN_STRUCT;
 
+/***************************************************************************//**
+ * @brief
+ *	One I2C transaction
+ *
+ * @details
+ *	tx_len bytes are written, then, after a repeated start, rx_len bytes are
+ *	read. Either length may be 0, giving a plain write or a plain read. The
+ *	buffers belong to the caller and must stay valid until [event] is posted
+ *	with the number of bytes read (written, for a plain write), or'ed with
+ *	I2C_PAYLOAD_NACK if the device did not acknowledge, or I2C_PAYLOAD_ERROR
+ *	if the bus failed on every retry.
+ *
+ ******************************************************************************/
+typedef struct{
+	uint8_t					dev_addr;			// 7 bit address
+	uint8_t					flags;				// I2C_FLAG_x
+	const uint8_t*			tx;
+	uint8_t					tx_len;
+	uint8_t*				rx;
+	uint8_t					rx_len;
+	uint32_t				event;				// Posted when the transaction ends
+}I2C_TRANSFER;
+
+/***************************************************************************//**
+ * @brief
+ *	Error counters, see i2c_error_stats()
+ *
+ ******************************************************************************/
+typedef struct{
+	uint32_t				nack;				// Transfers that ended on a NACK
+	uint32_t				timeout;			// Transfers that held the bus for I2C_TIMEOUT_MS
+	uint32_t				bus_error;			// Arbitration lost, bus error, or the bus busy at a start
+	uint32_t				unexpected;			// Interrupts the state machine had no transition for
+	uint32_t				recoveries;			// Bus recoveries run
+	uint32_t				stuck;				// Recoveries that found SDA still low after every toggle
+	uint32_t				retries;
+	uint32_t				failed;				// Transfers given up, posted with I2C_PAYLOAD_ERROR
+}I2C_ERROR_STATS;
+
 
 //***********************************************************************************
 // function prototypes
 //***********************************************************************************
 void i2c_open(I2C_TypeDef *i2c, I2C_OPEN_STRUCT *i2c_init);
-void i2c_start(I2C_TypeDef *i2c, uint8_t dev_addr, bool rw_mode, uint8_t reg_addr, uint32_t* sm_data, uint8_t sm_data_len, uint32_t event, bool enable);
-//uint32_t *data
+void i2c_transfer(I2C_TypeDef *i2c, const I2C_TRANSFER *transfer);
+void i2c_write(I2C_TypeDef *i2c, uint8_t dev_addr, const uint8_t *tx, uint8_t tx_len, uint32_t event);
+void i2c_read(I2C_TypeDef *i2c, uint8_t dev_addr, uint8_t *rx, uint8_t rx_len, uint32_t event);
+void i2c_write_read(I2C_TypeDef *i2c, uint8_t dev_addr, const uint8_t *tx, uint8_t tx_len, uint8_t *rx, uint8_t rx_len, uint32_t event);
+void i2c_error_stats(I2C_TypeDef *i2c, I2C_ERROR_STATS *stats);
+void i2c_bus_powered(I2C_TypeDef *i2c, bool powered);
 
 
 #endif /* I2C_HG */
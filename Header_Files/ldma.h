@@ -0,0 +1,67 @@
+/*
+ * ldma.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Kay Sho
+ *      Pronouns: (She/They)
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef LDMA_HG
+#define LDMA_HG
+
+/* System include statements */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Silicon Labs include statements */
+#include "em_ldma.h"
+#include "em_cmu.h"
+#include "em_core.h"
+#include "em_assert.h"
+
+/* The developer's include statements */
+#include "trace.h"
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define LDMA_CHANNELS			8
+
+// Channel owners, one transfer at a time per channel
+#define LDMA_CH_I2C0			0
+#define LDMA_CH_I2C1			1
+#define LDMA_CH_LEUART0_TX		2
+#define LDMA_CH_LEUART0_RX		3
+#define LDMA_CH_USART0_TX		4
+
+#define LDMA_BLOCKS_MAX			2			// Linked blocks of one ldma_m2p_blocks()
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+
+/* Called from LDMA_IRQHandler when a channel's transfer is done, with the arg it was started with */
+typedef void (*LDMA_DONE_CB)(void *arg);
+
+/* One source of a transfer sent from several places, e.g. a message that wraps a ring buffer */
+typedef struct{
+	const void				*src;
+	uint32_t				count;
+}LDMA_BLOCK;
+
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void ldma_open(void);
+void ldma_m2p(uint32_t ch, LDMA_PeripheralSignal_t signal, const void *src, volatile void *dst, uint32_t count, LDMA_DONE_CB done, void *arg);
+void ldma_m2p_blocks(uint32_t ch, LDMA_PeripheralSignal_t signal, const LDMA_BLOCK *block, uint32_t blocks, volatile void *dst, LDMA_DONE_CB done, void *arg);
+void ldma_p2m(uint32_t ch, LDMA_PeripheralSignal_t signal, const volatile void *src, void *dst, uint32_t count, LDMA_DONE_CB done, void *arg);
+void ldma_stop(uint32_t ch);
+uint32_t ldma_remaining(uint32_t ch);
+
+#endif /* LDMA_HG */
@@ -23,6 +23,9 @@
 #define LETIMER_HZ		1000			// Utilizing ULFRCO oscillator for LETIMERs
 #define LETIMER_EM		EM4				// Usuing the ULFRCO, block from entering EM4
 #define LETIMER_CLEAR	0b11111			// clear interrupt flag
+#define LETIMER_TOP		_LETIMER_CNT_MASK	// The whole 16-bit counter, a power of 2 minus 1 so ticks wrap cleanly
+#define LETIMER_EPOCH_SHIFT	16			// log2(LETIMER_TOP + 1), checked in letimer_timebase_open()
+#define LETIMER_MIN_DELTA	2			// COMP1 must be at least this many ticks ahead to be caught
 //***********************************************************************************
 // global variables
 //***********************************************************************************
@@ -45,6 +48,12 @@ typedef struct {
 	uint32_t		uf_cb;				// underflow CallBack
 } APP_LETIMER_PWM_TypeDef ;
 
+typedef struct {
+	bool 			debugRun;			// True = keep LETIMER running will halted
+	uint32_t		comp1_cb;			// comp1 CallBack, fires at the programmed deadline
+	uint32_t		uf_cb;				// underflow CallBack, fires once per epoch
+} APP_LETIMER_TIMEBASE_TypeDef ;
+
 
 //***********************************************************************************
 // function prototypes
@@ -53,4 +62,9 @@ void letimer_pwm_open(LETIMER_TypeDef *letimer, APP_LETIMER_PWM_TypeDef *app_let
 void letimer_start(LETIMER_TypeDef *letimer, bool enable);
 void LETIMER0_IRQHandler(void);
 
+void letimer_timebase_open(LETIMER_TypeDef *letimer, APP_LETIMER_TIMEBASE_TypeDef *app_letimer_timebase_struct);
+uint32_t letimer_ticks(LETIMER_TypeDef *letimer);
+bool letimer_comp1_arm(LETIMER_TypeDef *letimer, uint32_t tick);
+void letimer_comp1_disable(LETIMER_TypeDef *letimer);
+
 #endif
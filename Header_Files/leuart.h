@@ -15,6 +15,11 @@
 #include "sleep_routines.h"
 #include "scheduler.h"
 #include "HW_delay.h"
+#include "coroutine.h"
+#include "energy.h"
+#include "fsm.h"
+#include "ldma.h"
+#include "frame_ring.h"
 
 
 
@@ -26,6 +31,7 @@
 
 #define STARTF_CHAR		(uint8_t) '#'
 #define SIGF_CHAR		(uint8_t) '!'
+#define LEUART_SEGMENTS_MAX	2			// A message that wraps around a ring buffer
 /***************************************************************************//**
  * @addtogroup leuart
  * @{
@@ -54,8 +60,15 @@ typedef struct {
 	bool						tx_en;
 	uint32_t					rx_done_evt;
 	uint32_t					tx_done_evt;
+	bool						dma;				// Characters move on the LDMA, see leuart_send_segments()
 } LEUART_OPEN_STRUCT;
 
+/* Part of a message to transmit, sent in place without being copied */
+typedef struct {
+	const char					*data;
+	uint32_t					len;
+} LEUART_SEGMENT;
+
 /** @} (end addtogroup leuart) */
 
 //***********************************************************************************
@@ -67,10 +80,20 @@ typedef struct {
 // function prototypes
 //***********************************************************************************
 void leuart_open(LEUART_TypeDef *leuart, LEUART_OPEN_STRUCT *leuart_settings);
+void leuart_close(LEUART_TypeDef *leuart);
+#ifdef LEUART0_ENABLED
 void LEUART0_IRQHandler(void);
+#endif
+#ifdef LEUART1_ENABLED
+void LEUART1_IRQHandler(void);
+#endif
 void leuart_start(LEUART_TypeDef *leuart, char *string, uint32_t string_len);
-bool leuart_tx_busy(void);
-bool leuart_rx_busy(void);
+void leuart_send(LEUART_TypeDef *leuart, char *string, uint32_t string_len, uint32_t event);
+void leuart_start_segments(LEUART_TypeDef *leuart, const LEUART_SEGMENT *seg, uint32_t count);
+void leuart_send_segments(LEUART_TypeDef *leuart, const LEUART_SEGMENT *seg, uint32_t count, uint32_t event);
+void leuart_receive(LEUART_TypeDef *leuart, char *buf, uint32_t len, uint32_t event);
+bool leuart_tx_busy(LEUART_TypeDef *leuart);
+bool leuart_rx_busy(LEUART_TypeDef *leuart);
 
 uint32_t leuart_status(LEUART_TypeDef *leuart);
 void leuart_cmd_write(LEUART_TypeDef *leuart, uint32_t cmd_update);
@@ -78,7 +101,10 @@ void leuart_if_reset(LEUART_TypeDef *leuart);
 void leuart_app_transmit_byte(LEUART_TypeDef *leuart, uint8_t data_out);
 uint8_t leuart_app_receive_byte(LEUART_TypeDef *leuart);
 
-void leuart_loopbk_test(LEUART_TypeDef *leuart);
-void received_data(char*string);
+void leuart_loopbk_test(LEUART_TypeDef *leuart, uint32_t task_event, uint32_t done_event);
+void leuart_loopbk_task(uint32_t payload);
+const char *leuart_rx_frame(LEUART_TypeDef *leuart, uint32_t *len);
+void leuart_rx_release(LEUART_TypeDef *leuart);
+void leuart_rx_stats(LEUART_TypeDef *leuart, FRAME_RING_STATS *stats);
 
 #endif
@@ -0,0 +1,68 @@
+/**
+ * @file sampler.h
+ * @author Kay Sho
+ * @date  10/16/2026
+ * @brief Samples several I2C sensors on one bus, each at its own rate
+ * @note The author's pronouns: (She/They)
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef SAMPLER_HG
+#define SAMPLER_HG
+
+/* System include statements */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Silicon Labs include statements */
+#include "em_assert.h"
+#include "em_core.h"
+
+/* The developer's include statements */
+#include "sensor.h"
+#include "i2c.h"
+#include "scheduler.h"
+#include "timer_wheel.h"
+#include "HW_delay.h"
+#include "coroutine.h"
+#include "energy.h"
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define SAMPLER_SENSORS_MAX		4
+#define SAMPLER_PACK_MS			4			// Sensors due this close together share one wake window
+#define SAMPLER_CONV_MARGIN_MS	1			// The timer wheel rounds to whole ticks
+#define SAMPLER_POLL_MS			1			// Retry interval if a result read is NACKed
+#define SAMPLER_POLL_TRIES		5
+#define SAMPLER_INFLIGHT		(I2C_QUEUE_SIZE - 1)	// Transfers queued at once, one queue slot is left for others
+#define SAMPLER_NO_SENSOR		0xFFFFFFFF
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+typedef struct{
+	uint32_t				period_ms;
+	uint32_t				samples;			// Finished, failed ones included
+	uint32_t				failed;
+}SAMPLER_STATS;
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void sampler_open(I2C_TypeDef *i2c, uint32_t task_event, uint32_t done_event);
+uint32_t sampler_add(const SENSOR_DRIVER *driver, void *ctx, uint32_t period_ms);
+void sampler_start(void);
+bool sampler_started(void);
+uint32_t sampler_next_fresh(void);
+void sampler_reading(uint32_t id, SENSOR_READING *reading);
+const char *sampler_name(uint32_t id);
+uint32_t sampler_count(void);
+void sampler_set_period(uint32_t id, uint32_t period_ms);
+bool sampler_sample_now(uint32_t id);
+void sampler_stats(uint32_t id, SAMPLER_STATS *stats);
+void sampler_task(uint32_t payload);
+
+#endif /* SAMPLER_HG */
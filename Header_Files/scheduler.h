@@ -6,6 +6,7 @@
 
 /* System include statements */
 #include <stdint.h>
+#include <stdbool.h>
 
 /* Silicon Labs include statements */
 #include "em_assert.h"
@@ -15,24 +16,89 @@
 
 /* The developer's include statements */
 #include "sleep_routines.h"
+#include "event_ring.h"
+#include "atomic_ops.h"
+#include "cycle_counter.h"
+#include "trace.h"
+#include "brd_config.h"
 
 //***********************************************************************************
 // defined files
 //***********************************************************************************
+#define SCHEDULER_MAX_EVENTS	64		// Number of event IDs (must be a multiple of 32)
+#define SCHEDULER_WORD_BITS		32
+#define SCHEDULER_WORDS			(SCHEDULER_MAX_EVENTS / SCHEDULER_WORD_BITS)
+#define SCHEDULER_MSB			0x80000000	// Event ID 0 of a word sits in the MSB so __CLZ finds it first
 
+// Dispatch priorities, 0 is serviced first
+#define SCHED_PRIO_CRITICAL		0
+#define SCHED_PRIO_HIGH			1
+#define SCHED_PRIO_NORMAL		2
+#define SCHED_PRIO_LOW			3
+#define SCHEDULER_PRIORITIES	4
+
+// Interrupt sources that own an event ring, each ring has one ISR as producer
+#define SCHED_SRC_LETIMER0		0
+#define SCHED_SRC_I2C0			1
+#define SCHED_SRC_LEUART0		2
+#define SCHED_SRC_I2C1			3
+#define SCHED_SRC_LEUART1		4
+#define SCHED_SRC_USART0_RX		5
+#define SCHED_SRC_USART0_TX		6			// A ring per handler, the USART has two
+#if defined(USART0_ENABLED)					// Rings only for the instances brd_config.h enables
+#define SCHEDULER_SOURCES		7
+#elif defined(LEUART1_ENABLED)
+#define SCHEDULER_SOURCES		5
+#elif defined(I2C1_ENABLED)
+#define SCHEDULER_SOURCES		4
+#else
+#define SCHEDULER_SOURCES		3
+#endif
+
+#define SCHEDULER_NO_PAYLOAD	0			// Payload handed to events posted without one
+#define SCHEDULER_PAYLOAD_LOST	0xFFFFFFFF	// Posts of the event were dropped here, their ring was full
+
+// Post-to-dispatch latency and handler execution time histograms
+#define SCHEDULER_STATS_ENABLED
+#define SCHED_STATS_EVENTS		16			// IDs below this get histograms, covers the application's events
+#define SCHED_HIST_BUCKETS		20
+#define SCHED_HIST_SHIFT		6			// Bucket b >= 1 counts 2^(b+6) to 2^(b+7) - 1 cycles, bucket 0 everything below
+#define SCHED_HIST_MAX			0xFFFF		// Buckets saturate instead of wrapping
 
 //***********************************************************************************
 // global variables
 //***********************************************************************************
+typedef void (*SCHEDULER_HANDLER)(uint32_t payload);
+
+typedef struct {
+	SCHEDULER_HANDLER		handler;			// Callback run from the main loop
+	uint8_t					priority;			// SCHED_PRIO_x level of the event
+} SCHEDULER_ENTRY;
+
+typedef struct {
+	uint16_t				latency[SCHED_HIST_BUCKETS];	// Post to handler start, in log2 cycle buckets
+	uint16_t				exec[SCHED_HIST_BUCKETS];		// Handler run time, in log2 cycle buckets
+	uint32_t				latency_max;					// Worst case seen, in cycles
+	uint32_t				exec_max;
+} SCHEDULER_STATS;
 
 
 //***********************************************************************************
 // function prototypes
 //***********************************************************************************
 void scheduler_open(void);
+void scheduler_register(uint32_t event, SCHEDULER_HANDLER handler, uint32_t priority);
+void scheduler_dispatch(void);
+void scheduler_post(uint32_t source, uint32_t event, uint32_t payload);
+void scheduler_flush(uint32_t source);
+void scheduler_ring_stats(uint32_t source, uint32_t *high_water, uint32_t *overflow);
 void add_scheduled_event(uint32_t event);
 void remove_scheduled_event(uint32_t event);
-uint32_t get_scheduled_events(void);
+bool scheduled_event_pending(uint32_t event);
+bool scheduler_events_pending(void);
+const SCHEDULER_STATS *scheduler_stats(uint32_t event);
+void scheduler_stats_reset(void);
+bool scheduler_stats_line(uint32_t *cursor, char *line, uint32_t size);
 
 
 #endif
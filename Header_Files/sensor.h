@@ -0,0 +1,88 @@
+/**
+ * @file sensor.h
+ * @author Kay Sho
+ * @date  10/16/2026
+ * @brief Interface between I2C sensor drivers and the sampler
+ * @note The author's pronouns: (She/They)
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef SENSOR_HG
+#define SENSOR_HG
+
+/* System include statements */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Silicon Labs include statements */
+
+
+/* The developer's include statements */
+#include "i2c.h"
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define SENSOR_CHANNELS			2			// Values one sample can report
+#define SENSOR_XFERS_MAX		2			// I2C transfers per phase of a sample
+
+typedef enum{
+	SENSOR_TEMP,							// Degrees C
+	SENSOR_RH								// % relative humidity
+}SENSOR_QUANTITY;
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	One converted sample
+ *
+ ******************************************************************************/
+typedef struct{
+	bool					ok;					// false if the bus or the device failed, no values
+	uint8_t					count;				// Channels filled in
+	SENSOR_QUANTITY			quantity[SENSOR_CHANNELS];
+	bool					valid[SENSOR_CHANNELS];	// false e.g. on a checksum error
+	float					value[SENSOR_CHANNELS];
+}SENSOR_READING;
+
+/***************************************************************************//**
+ * @brief
+ *	Driver of one kind of I2C sensor
+ *
+ * @details
+ *	A sample has two phases. start() describes the transfers that begin a
+ *	measurement, complete() those that read the result conv_ms() later.
+ *	The sampler puts them on the bus, packed together with the other
+ *	sensors', and fills in each transfer's event. If a complete() transfer
+ *	is NACKed the result is taken to be not ready and complete() is called
+ *	again a little later. convert() turns the raw bytes into values.
+ *
+ *	A sensor whose supply can be switched has a power() function. The
+ *	sampler switches it on power_up_ms before each start() and off as soon
+ *	as the result has been read. Sensors without one stay powered.
+ *
+ * @note
+ *	Every function is called from the sampler task, in the main loop. The
+ *	buffers the transfers point to must live in [ctx] or the driver.
+ *
+ ******************************************************************************/
+typedef struct{
+	const char				*name;
+	uint32_t				(*start)(void *ctx, I2C_TRANSFER *xfer);	// Fills at most SENSOR_XFERS_MAX, returns how many
+	uint32_t				(*conv_ms)(void *ctx);						// Longest time from start() to a result
+	uint32_t				(*complete)(void *ctx, I2C_TRANSFER *xfer);	// Fills at most SENSOR_XFERS_MAX, returns how many
+	void					(*convert)(void *ctx, SENSOR_READING *reading);
+	void					(*power)(void *ctx, bool on);				// NULL if always powered
+	uint32_t				power_up_ms;								// Longest time from power on to start()
+}SENSOR_DRIVER;
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+
+#endif /* SENSOR_HG */
@@ -13,24 +13,60 @@
 
 /* Silicon Labs include statements */
 #include "i2c.h"
+#include "crc8.h"
+#include "coroutine.h"
+#include "HW_delay.h"
+#include "sensor.h"
 
 //***********************************************************************************
 // defined files
 //***********************************************************************************
 #define SI7021_ADDR				0x40
 #define SI7021_TEMP_NO_HOLD		0xF3
+#define SI7021_RH_NO_HOLD		0xF5
+#define SI7021_TEMP_FROM_RH		0xE0		// Temperature measured during the last RH conversion, no checksum
+#define SI7021_WRITE_USER_REG	0xE6
+#define SI7021_READ_USER_REG	0xE7
 #define SI7021_I2C				I2C0
 
 #define SI7021_REF_FREQ						0
 #define SI7021_NUM_BYTES_TEMP_CHECKSUM		6
 #define SI7021_NUM_BYTES_TEMP_NOCHECKSUM	2
+#define SI7021_NUM_BYTES_RH_CHECKSUM		3
+
+// User register RES1 (D7) and RES0 (D0) settings
+#define SI7021_RES_RH12_T14					0		// Power on default
+#define SI7021_RES_RH8_T12					1
+#define SI7021_RES_RH10_T13					2
+#define SI7021_RES_RH11_T11					3
+#define SI7021_RES_SETTINGS					4
+#define SI7021_USER_REG_RES_MASK			0x81
+#define SI7021_USER_REG_RES(res)			((((res) & 2) << 6) | ((res) & 1))
+#define SI7021_USER_REG_DEFAULT				0x3A	// Value after power up, heater off
+
+#define SI7021_CONV_MARGIN_MS				1		// The timer wheel rounds to whole ticks
+#define SI7021_POLL_MS						1		// Retry interval if the read is NACKed
+#define SI7021_POLL_TRIES					5
+#define SI7021_POWER_UP_MS					80		// Datasheet maximum from VDD on to the first command, 18 typical
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+extern const SENSOR_DRIVER si7021_sensor;		// Humidity and temperature for the sampler, ctx unused
+
 //***********************************************************************************
 // function prototypes
 //***********************************************************************************
 
-void si7021_i2c_open(void);
+void si7021_i2c_open(uint32_t task_event, uint32_t bus_event);
 void si7021_read(uint32_t event);
 float si7021_temp_met();
 float si7021_temp_imp();
+void si7021_read_rh_temp(uint32_t event);
+bool si7021_rh_valid(void);
+float si7021_humidity(void);
+bool si7021_read_ok(void);
+void si7021_task(uint32_t payload);
+void si7021_set_resolution(uint32_t temp_bits, uint32_t event);
+uint32_t si7021_resolution(void);
 
 #endif /* SI7021_HG */
@@ -0,0 +1,51 @@
+/**
+ * @file sim_sensor.h
+ * @author Kay Sho
+ * @date  10/16/2026
+ * @brief Simulated I2C temperature sensor for the sampler
+ * @note The author's pronouns: (She/They)
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef SIM_SENSOR_HG
+#define SIM_SENSOR_HG
+
+/* System include statements */
+#include <stdint.h>
+
+/* Silicon Labs include statements */
+
+
+/* The developer's include statements */
+#include "sensor.h"
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define SIM_SENSOR_ADDR			0x48		// Nothing answers here on the board
+#define SIM_SENSOR_MEASURE		0x01		// One-shot conversion command
+#define SIM_SENSOR_CONV_MS		26
+#define SIM_SENSOR_RESULT_BYTES	2			// 12 bit code, left justified, 0.0625 C per LSB
+#define SIM_SENSOR_LSB_C		0.0625f
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+
+/* One simulated device, its address and the bytes of its last result */
+typedef struct{
+	uint8_t					addr;
+	uint8_t					cmd;
+	uint8_t					raw[SIM_SENSOR_RESULT_BYTES];
+}SIM_SENSOR;
+
+extern const SENSOR_DRIVER sim_sensor;		// ctx is a SIM_SENSOR
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void sim_sensor_init(SIM_SENSOR *sensor, uint8_t addr);
+
+#endif /* SIM_SENSOR_HG */
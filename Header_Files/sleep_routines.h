@@ -20,6 +20,9 @@
 #include "em_core.h"
 #include "em_assert.h"
 
+#include "atomic_ops.h"
+#include "trace.h"
+
 //***********************************************************************************
 // defined files
 //***********************************************************************************
@@ -30,6 +33,19 @@
 #define 	EM4							4
 #define 	MAX_EM						5
 
+#define		SLEEP_GOVERNOR_ENABLED				// Comment out to always enter the deepest allowed mode
+#define		SLEEP_NO_DEADLINE			0xFFFFFFFF
+
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+typedef struct {
+	uint32_t				picked[MAX_EM];			// Sleeps entered in each mode
+	uint32_t				shallower;				// Sleeps where a deeper mode was allowed but cost more
+	uint32_t				wake_us[MAX_EM];		// Datasheet wakeup plus the measured restore time
+} SLEEP_GOVERNOR_STATS;
+
 
 //***********************************************************************************
 // function prototypes
@@ -39,5 +55,8 @@ void sleep_block_mode(uint32_t EM);
 void sleep_unblock_mode(uint32_t EM);
 void enter_sleep(void);
 uint32_t current_block_energy_mode(void);
+void sleep_residency(uint32_t *ticks);
+void sleep_residency_reset(void);
+void sleep_governor_stats(SLEEP_GOVERNOR_STATS *stats);
 
 #endif /* SLEEP_ROUTINES_HG */
@@ -0,0 +1,58 @@
+/*
+ * timer_wheel.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Kay Sho
+ *      Pronouns: (She/They)
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef TIMER_WHEEL_HG
+#define TIMER_WHEEL_HG
+
+/* System include statements */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Silicon Labs include statements */
+#include "em_assert.h"
+
+/* The developer's include statements */
+#include "letimer.h"
+#include "scheduler.h"
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define TIMER_WHEEL_LETIMER		LETIMER0
+#define TIMER_WHEEL_TIMERS		16			// Virtual timers that can be armed at once
+#define TIMER_WHEEL_LEVELS		4			// Level n slots are 32^n ticks wide
+#define TIMER_WHEEL_SLOT_BITS	5
+#define TIMER_WHEEL_SLOTS		(1 << TIMER_WHEEL_SLOT_BITS)
+#define TIMER_WHEEL_INVALID		0xFF		// Handle returned when no timer is free
+#define TIMER_WHEEL_NO_EVENT	0xFFFFFFFF	// Event for timers that only wake the core
+
+#define TIMER_MS_TO_TICKS(ms)	((uint32_t)(((uint64_t)(ms) * LETIMER_HZ) / 1000))
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void timer_wheel_open(uint32_t wake_event);
+uint32_t timer_arm(uint32_t ms, uint32_t event);
+uint32_t timer_arm_periodic(uint32_t ms, uint32_t event);
+void timer_cancel(uint32_t handle);
+bool timer_armed(uint32_t handle);
+uint32_t timer_now(void);
+bool timer_next_deadline(uint32_t *deadline);
+uint32_t timer_wheel_wakeups(void);
+void timer_wheel_poll(void);
+
+#endif /* TIMER_WHEEL_HG */
@@ -0,0 +1,98 @@
+/*
+ * trace.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Kay Sho
+ *      Pronouns: (She/They)
+ *
+ *  Always-on binary trace. Each TRACE() reserves a slot with one LDREX/STREX
+ *  add and stores an 8 byte record, so it is safe from any interrupt level
+ *  and costs a handful of cycles. Dump trace_log from the debugger, e.g.
+ *  "dump binary memory trace.bin &trace_log (&trace_log)+1", and convert it
+ *  with Host_Tools/trace_decode.cpp.
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef TRACE_HG
+#define TRACE_HG
+
+/* System include statements */
+#include <stdint.h>
+
+/* Silicon Labs include statements */
+#include "em_device.h"
+
+/* The developer's include statements */
+#include "atomic_ops.h"
+#include "cycle_counter.h"
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define TRACE_ENABLED
+#define TRACE_RECORDS			256			// Must be a power of 2, 8 bytes each
+#define TRACE_MASK				(TRACE_RECORDS - 1)
+#define TRACE_MAGIC				0x45435254	// "TRCE", lets the decoder check a dump
+
+// Record IDs, Host_Tools/trace_decode.cpp must use the same values
+#define TRACE_SCHED_POST		1			// arg: event ID
+#define TRACE_SCHED_BEGIN		2			// arg: event ID, handler starts
+#define TRACE_SCHED_END			3			// arg: event ID, handler returned
+#define TRACE_EM_ENTER			4			// arg: energy mode
+#define TRACE_EM_EXIT			5			// arg: LETIMER ticks spent asleep, the cycle counter stops in sleep
+#define TRACE_IRQ_LETIMER0		6			// arg: low half of IF & IEN
+#define TRACE_IRQ_I2C0			7			// arg: low half of IF & IEN
+#define TRACE_IRQ_LEUART0		8			// arg: low half of IF & IEN
+#define TRACE_I2C_STATE			9			// arg: I2C transition, FSM_TRACE_ARG()
+#define TRACE_LEUART_TX_STATE	10			// arg: LEUART TX transition, FSM_TRACE_ARG()
+#define TRACE_LEUART_RX_STATE	11			// arg: LEUART RX transition, FSM_TRACE_ARG()
+#define TRACE_SLEEP_GOVERNOR	12			// arg: deepest allowed mode << 8 | mode picked
+#define TRACE_IRQ_LDMA			13			// arg: low half of IF & IEN, one bit per channel
+#define TRACE_IRQ_I2C1			14			// arg: low half of IF & IEN
+#define TRACE_IRQ_LEUART1		15			// arg: low half of IF & IEN
+#define TRACE_IRQ_USART0		16			// arg: low half of IF & IEN, RX or TX handler
+#define TRACE_USART_TX_STATE	17			// arg: USART TX transition, FSM_TRACE_ARG()
+#define TRACE_USART_RX_STATE	18			// arg: USART RX transition, FSM_TRACE_ARG()
+
+#ifdef TRACE_ENABLED
+#define TRACE(id, arg)			trace_record((id), (arg))
+#else
+#define TRACE(id, arg)
+#endif
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+typedef struct {
+	uint32_t				stamp;				// Cycle counter
+	uint16_t				id;					// TRACE_x
+	uint16_t				arg;
+} TRACE_RECORD;
+
+typedef struct {
+	uint32_t				magic;				// TRACE_MAGIC once trace_open() has run
+	uint32_t				core_hz;			// Rate of the stamps
+	ATOMIC_U32				head;				// Records ever written, the oldest is head - TRACE_RECORDS
+	uint32_t				size;				// TRACE_RECORDS
+	TRACE_RECORD			records[TRACE_RECORDS];
+} TRACE_LOG;
+
+extern TRACE_LOG trace_log;
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void trace_open(void);
+
+/* Kept inline so a trace point is a fetch-add and three stores */
+static inline void trace_record(uint32_t id, uint32_t arg){
+	TRACE_RECORD *record = &trace_log.records[atomic_fetch_add_u32(&trace_log.head, 1) & TRACE_MASK];
+
+	record->stamp = cycle_counter_now();
+	record->id = id;
+	record->arg = arg;
+}
+
+#endif /* TRACE_HG */
@@ -0,0 +1,81 @@
+/*
+ * usart.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: Kay Sho
+ *      Pronouns: (She/They)
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef USART_HG
+#define USART_HG
+
+/* System include statements */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+/* Silicon Labs include statements */
+#include "em_usart.h"
+#include "em_cmu.h"
+#include "em_core.h"
+#include "em_assert.h"
+
+/* The developer's include statements */
+#include "brd_config.h"
+#include "sleep_routines.h"
+#include "scheduler.h"
+#include "fsm.h"
+#include "ldma.h"
+#include "frame_ring.h"
+#include "trace.h"
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define USART_EM				EM2			// Runs on the HF clock, EM1 is the deepest sleep while open
+
+#define USART_STARTF_CHAR		'#'			// Framing the LEUART does in hardware
+#define USART_SIGF_CHAR			'!'
+#define USART_RX_RING_SIZE		256			// About 25 short commands, or 4 of the longest
+#define USART_RX_FRAME_MAX		49
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+typedef struct{
+	uint32_t					baudrate;
+	USART_Databits_TypeDef		databits;
+	USART_Parity_TypeDef		parity;
+	USART_Stopbits_TypeDef		stopbits;
+	uint32_t					rx_loc;
+	uint32_t					tx_loc;
+	uint32_t					rx_done_evt;		// Posted for each framed command
+	uint32_t					tx_done_evt;		// Posted by usart_start_blocks()
+}USART_OPEN_STRUCT;
+
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void usart_open(USART_TypeDef *usart, USART_OPEN_STRUCT *usart_settings);
+void usart_close(USART_TypeDef *usart);
+void usart_set_baud(USART_TypeDef *usart, uint32_t baudrate);
+#ifdef USART0_ENABLED
+void USART0_RX_IRQHandler(void);
+void USART0_TX_IRQHandler(void);
+#endif
+void usart_start_blocks(USART_TypeDef *usart, const LDMA_BLOCK *block, uint32_t count);
+void usart_send_blocks(USART_TypeDef *usart, const LDMA_BLOCK *block, uint32_t count, uint32_t event);
+void usart_receive(USART_TypeDef *usart, char *buf, uint32_t len, uint32_t event);
+void usart_receive_cancel(USART_TypeDef *usart);
+bool usart_tx_busy(USART_TypeDef *usart);
+bool usart_rx_busy(USART_TypeDef *usart);
+const char *usart_rx_frame(USART_TypeDef *usart, uint32_t *len);
+void usart_rx_release(USART_TypeDef *usart);
+void usart_rx_stats(USART_TypeDef *usart, FRAME_RING_STATS *stats);
+
+#endif /* USART_HG */
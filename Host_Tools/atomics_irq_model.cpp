@@ -0,0 +1,160 @@
+/**
+ * @file atomics_irq_model.cpp
+ * @author Kay Sho
+ * @date  10/16/2026
+ * @brief Interrupt-masked time of event posts and sleep mode blocks, critical
+ * sections against the LDREX/STREX loops of atomic_ops.h
+ * @note The author's pronouns: (She/They)
+ *
+ * Build:	g++ -std=c++17 -O2 -o atomics_irq_model atomics_irq_model.cpp
+ * Use:		atomics_irq_model [core_mhz=19] [irq_hz=1000] [posts_hz=40] [blocks_hz=20]
+ *			[entry=12] [seconds=3600]
+ *
+ * The critical section versions are the baseline add_scheduled_event() and
+ * sleep_block_mode(): CORE_ENTER_CRITICAL(), a load, modify and store of the
+ * pending word or lowest_energy_mode[], CORE_EXIT_CRITICAL(). Interrupts are
+ * masked from the CPSID to the MSR that restores PRIMASK. The atomic versions
+ * mask nothing. An interrupt taken between LDREX and STREX clears the
+ * exclusive monitor, the STREX fails and the loop goes round again.
+ *
+ * Cycle counts are the Cortex-M4 TRM ones for the instructions the compiler
+ * emits at -O2, with no wait states, overridable. Only calls from the main
+ * loop count: interrupt handlers share one priority here, so a call made in
+ * one is never preempted by another.
+ *
+ * Interrupts arrive at random, irq_hz on average. For each version the model
+ * runs seconds of main loop calls at posts_hz and blocks_hz and counts the
+ * interrupts that arrived masked, how long they waited, and the STREX
+ * retries. The exact expectation is printed next to each count.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+namespace {
+
+struct Settings {
+	double core_mhz		= 19;		// HFRCO
+	double irq_hz		= 1000;		// LEUART0 at 9600 baud without the LDMA is ~960/s on its own
+	double posts_hz		= 40;		// add_scheduled_event() and remove_scheduled_event() from main
+	double blocks_hz	= 20;		// sleep_block_mode() and sleep_unblock_mode() from main
+	int entry			= 12;		// Cortex-M4 exception entry, no FP context
+	double seconds		= 3600;
+};
+
+/* Cycles of one call, and of the part interrupts may not split */
+struct Op {
+	const char	*name;
+	int			cycles;				// Whole call, first try
+	int			window;				// Masked (critical) or LDREX to STREX (atomic)
+	bool		masked;
+};
+
+/*
+ * critical post:	MRS 1, CPSID 1 | LDR 2, ORR 1, STR 1, MSR 1 | BX 1 ...
+ * critical block:	MRS 1, CPSID 1 | LDR 2, CMP 1, BGE 1, ADDS 1, STR 1, MSR 1 | ...
+ * atomic post:		LDREX 2, ORR 1, STREX 1 | CMP 1, BNE 1
+ * atomic block:	LDREX 2, ADDS 1, STREX 1 | CMP 1, BNE 1
+ * Address and mask set-up, 4 cycles, is the same in all four.
+ */
+const Op ops[] = {
+	{"post, critical",		4 + 2 + 6,	6,	true},
+	{"block, critical",		4 + 2 + 8,	8,	true},
+	{"post, atomic",		4 + 6,		4,	false},
+	{"block, atomic",		4 + 6,		4,	false},
+};
+
+struct Result {
+	uint64_t	calls		= 0;
+	uint64_t	delayed		= 0;		// Interrupts that arrived masked
+	uint64_t	delay_cyc	= 0;		// Cycles they waited in total
+	int			worst		= 0;
+	uint64_t	retries		= 0;
+	uint64_t	cycles		= 0;		// Main loop cycles spent in the calls
+};
+
+Result run(const Op &op, double calls_hz, const Settings &set, std::mt19937_64 &rng){
+	Result r;
+	double cyc_per_s = set.core_mhz * 1e6;
+	std::exponential_distribution<double> gap(set.irq_hz / cyc_per_s);	// Cycles between interrupts
+	double next_irq = gap(rng);
+	double call_every = cyc_per_s / calls_hz;
+
+	for(double t = call_every / 2; t < set.seconds * cyc_per_s; t += call_every){
+		r.calls++;
+		int spent = 0;
+		for(;;){
+			double start = t + spent + (op.cycles - op.window);
+			while(next_irq < start){
+				next_irq += gap(rng);
+			}
+			spent += op.cycles;
+			if(next_irq >= start + op.window){
+				break;
+			}
+			if(op.masked){
+				int wait = (int)(start + op.window - next_irq) + 1;	// Taken once PRIMASK is restored
+				r.delayed++;
+				r.delay_cyc += wait;
+				if(wait > r.worst) r.worst = wait;
+				while(next_irq < start + op.window){
+					next_irq += gap(rng);
+				}
+				break;
+			}
+			r.retries++;						// The handler ran, the STREX fails, go round
+			spent += set.entry;
+			while(next_irq < start + op.window){
+				next_irq += gap(rng);
+			}
+		}
+		r.cycles += spent;
+	}
+	return r;
+}
+
+bool set_key(const std::string &key, double value, Settings &s){
+	if(key == "core_mhz")	{ s.core_mhz = value; return value > 0; }
+	if(key == "irq_hz")		{ s.irq_hz = value; return value > 0; }
+	if(key == "posts_hz")	{ s.posts_hz = value; return value > 0; }
+	if(key == "blocks_hz")	{ s.blocks_hz = value; return value > 0; }
+	if(key == "entry")		{ s.entry = (int)value; return value >= 0; }
+	if(key == "seconds")	{ s.seconds = value; return value > 0; }
+	return false;
+}
+
+}
+
+int main(int argc, char **argv){
+	Settings set;
+
+	for(int i = 1; i < argc; i++){
+		const char *eq = std::strchr(argv[i], '=');
+		if(!eq || !set_key(std::string(argv[i], eq - argv[i]), std::atof(eq + 1), set)){
+			std::fprintf(stderr, "unknown or bad setting: %s\n", argv[i]);
+			return 2;
+		}
+	}
+
+	std::mt19937_64 rng(2370);
+	double cyc_per_s = set.core_mhz * 1e6;
+	std::printf("%.0f s, %.0f interrupts/s, %.0f posts/s and %.0f blocks/s from main, %.0f MHz\n",
+			set.seconds, set.irq_hz, set.posts_hz, set.blocks_hz, set.core_mhz);
+	std::printf("%-16s %6s %8s %12s %10s %9s %10s %12s\n", "call", "masked", "calls", "irqs delayed",
+			"expected", "worst us", "retries", "expected");
+	for(const Op &op : ops){
+		double hz = op.name[0] == 'p' ? set.posts_hz : set.blocks_hz;
+		Result r = run(op, hz, set, rng);
+		double p_hit = op.window * set.irq_hz / cyc_per_s;	// An interrupt lands in the window
+		double expect = r.calls * p_hit;
+		std::printf("%-16s %6d %8llu %12llu %10.1f %9.2f %10llu %12.1f\n", op.name,
+				op.masked ? op.window : 0, (unsigned long long)r.calls,
+				(unsigned long long)r.delayed, op.masked ? expect : 0.0, r.worst / set.core_mhz,
+				(unsigned long long)r.retries, op.masked ? 0.0 : expect);
+	}
+	return 0;
+}
@@ -0,0 +1,105 @@
+/**
+ * @file ble_link_model.cpp
+ * @author Kay Sho
+ * @date  10/16/2026
+ * @brief Time on air, throughput and average current of the two BLE links,
+ * LEUART0 at 9600 and USART0 at the rates ble_link_open() negotiates
+ * @note The author's pronouns: (She/They)
+ *
+ * Build:	g++ -std=c++17 -O2 -I../Header_Files -o ble_link_model ble_link_model.cpp
+ * Use:		ble_link_model [period_ms=2700] [lines=1]
+ *
+ * Both links send in place on the LDMA and wake the core once per message,
+ * so the difference is the wire and the sleep floor. Time on air is 10 bits
+ * per character at the link's baud rate. The LEUART runs in EM2 and draws
+ * ENERGY_LEUART_TX_NA on top while it sends. The USART needs the HF clock,
+ * EM1 is the floor for the whole period once it is open. Currents come from
+ * Header_Files/energy_model.h, the rest of the board is left out: the
+ * sampler and the HM-10 radio cost the same on both links.
+ *
+ * "lines" sensor lines are sent per sample period of period_ms. The firmware
+ * reports the same time on air, measured, with the "#link!" command.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "energy_model.h"
+
+namespace {
+
+struct Link {
+	const char	*name;
+	double		baud;
+	double		floor_na;			// Between messages
+	double		tx_na;				// Extra while sending
+};
+
+struct Message {
+	const char	*name;
+	const char	*text;
+};
+
+double air_us(const Message &m, const Link &l){
+	return std::strlen(m.text) * 10 * 1e6 / l.baud;
+}
+
+}
+
+int main(int argc, char **argv){
+	double period_ms = 2700;			// SAMPLE_PER_MS
+	double lines = 1;
+
+	for(int i = 1; i < argc; i++){
+		if(!std::strncmp(argv[i], "period_ms=", 10) && std::atof(argv[i] + 10) > 0){
+			period_ms = std::atof(argv[i] + 10);
+		} else if(!std::strncmp(argv[i], "lines=", 6)){
+			lines = std::atof(argv[i] + 6);
+		} else {
+			std::fprintf(stderr, "unknown or bad setting: %s\n", argv[i]);
+			return 2;
+		}
+	}
+
+	std::vector<Link> links = {
+		{"LEUART0",	9600,	ENERGY_EM2_NA,	ENERGY_LEUART_TX_NA},
+		{"USART0",	57600,	ENERGY_EM1_NA,	0},
+		{"USART0",	115200,	ENERGY_EM1_NA,	0},
+	};
+	std::vector<Message> messages = {
+		{"sensor line",			"Si7021 Temp = 23.2 C, RH = 43.8 %\n"},
+		{"command reply",		"\nTemperature converting to F\n"},
+		{"unknown command",		"\nUnknown Command\n"},
+		{"boot banner line",	"\nPlease use She or They to \nrefer to them!\n"},
+	};
+
+	std::printf("time on air per message, us\n%-18s %5s", "message", "chars");
+	for(const Link &l : links){
+		std::printf(" %8s@%-6.0f", l.name, l.baud);
+	}
+	std::printf("\n");
+	for(const Message &m : messages){
+		std::printf("%-18s %5zu", m.name, std::strlen(m.text));
+		for(const Link &l : links){
+			std::printf(" %15.0f", air_us(m, l));
+		}
+		std::printf("\n");
+	}
+
+	// One period: the sensor lines on the wire, the floor the rest of it
+	double period_us = period_ms * 1000;
+	std::printf("\nper %.0f ms period, %.0f sensor line(s)\n", period_ms, lines);
+	std::printf("%-16s %10s %10s %14s %12s\n", "link", "max B/s", "busy %", "avg uA", "life h");
+	for(const Link &l : links){
+		double busy_us = lines * air_us(messages[0], l);
+		double avg_na = l.floor_na + l.tx_na * busy_us / period_us;
+		std::string label = std::string(l.name) + "@" + std::to_string((int)l.baud);
+		std::printf("%-16s %10.0f %10.4f %14.3f %12.0f\n", label.c_str(), l.baud / 10,
+				100 * busy_us / period_us, avg_na / 1000,
+				ENERGY_BATTERY_MAH * 1e6 / avg_na);
+	}
+	return 0;
+}
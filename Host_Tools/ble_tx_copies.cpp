@@ -0,0 +1,147 @@
+/**
+ * @file ble_tx_copies.cpp
+ * @author Kay Sho
+ * @date  10/16/2026
+ * @brief Bytes copied per transmitted byte on the ble_write() to LEUART path,
+ * before and after sending in place from the circular buffer
+ * @note The author's pronouns: (She/They)
+ *
+ * Build:	g++ -std=c++17 -O2 -o ble_tx_copies ble_tx_copies.cpp
+ * Use:		ble_tx_copies [messages=100000]
+ *
+ * Both paths are replayed byte for byte as Source_Files/ble.c and leuart.c
+ * run them, with every store into a RAM buffer counted:
+ *	copy:		ble_circ_push() into cbuf, ble_circ_pop() into pop_str,
+ *			leuart_start() strcpy into tx_out, TXBL reads tx_out
+ *	in place:	ble_circ_push() into cbuf, TXBL reads cbuf through one or
+ *			two LEUART_SEGMENTs
+ * The TXDATA writes are the transmitted bytes, not copies. The message mix
+ * is the app's: sensor lines, command replies and the boot banner. Host time
+ * per transmitted byte is printed as well, it only ranks the two paths.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+constexpr uint32_t CSIZE		= 128;		// Must match ble.h
+
+const char *const messages[] = {
+	"Si7021 Temp = 23.2 C, RH = 43.8 %\n",
+	"Si7021 Temp = 73.9 F, RH = 43.8 %\n",
+	"Si7021 read failed\n",
+	"\nTemperature converting to F\n",
+	"\nrec 0 stuck 0 retry 0 fail 0\n",
+	"\nUnknown Command\n",
+	"\nHello World!\nKay Sho\n",
+	"\nPlease use She or They to \nrefer to them!\n",
+};
+
+struct Ring {
+	char		cbuf[CSIZE];
+	uint32_t	read = 0;
+	uint32_t	write = 0;
+	uint32_t	size = 0;
+};
+
+struct Count {
+	uint64_t	copied = 0;		// Stores into RAM buffers
+	uint64_t	sent = 0;		// TXDATA writes
+	volatile char txdata = 0;
+};
+
+void push(Ring &r, const char *s, Count &c){
+	uint32_t len = std::strlen(s);
+	r.cbuf[r.write] = (char)(len + 1);
+	r.write = (r.write + 1) & (CSIZE - 1);
+	c.copied++;
+	for(uint32_t i = 0; i < len; i++){
+		r.cbuf[r.write] = s[i];
+		r.write = (r.write + 1) & (CSIZE - 1);
+		c.copied++;
+	}
+	r.size += len + 1;
+}
+
+// Before: pop into pop_str, strcpy into tx_out, one TXBL per character
+void send_copy(Ring &r, Count &c){
+	static char pop_str[CSIZE];
+	static char tx_out[CSIZE];				// 50 on the board, a longer message overran it
+	uint32_t len = (uint8_t)r.cbuf[r.read] - 1;
+
+	r.read = (r.read + 1) & (CSIZE - 1);
+	for(uint32_t i = 0; i < len; i++){
+		pop_str[i] = r.cbuf[r.read];
+		r.read = (r.read + 1) & (CSIZE - 1);
+		c.copied++;
+	}
+	pop_str[len] = 0;
+	c.copied++;
+	r.size -= len + 1;
+
+	std::strcpy(tx_out, pop_str);
+	c.copied += len + 1;
+	for(uint32_t i = 0; i < len; i++){
+		c.txdata = tx_out[i];
+		c.sent++;
+	}
+}
+
+// After: up to the end of the ring and the rest from the front
+void send_in_place(Ring &r, Count &c){
+	uint32_t len = (uint8_t)r.cbuf[r.read] - 1;
+	uint32_t start = (r.read + 1) & (CSIZE - 1);
+	struct { const char *data; uint32_t len; } seg[2];
+
+	seg[0] = {&r.cbuf[start], len < CSIZE - start ? len : CSIZE - start};
+	seg[1] = {&r.cbuf[0], len - seg[0].len};
+	for(auto &s : seg){
+		for(uint32_t i = 0; i < s.len; i++){
+			c.txdata = s.data[i];
+			c.sent++;
+		}
+	}
+	r.read = (r.read + len + 1) & (CSIZE - 1);
+	r.size -= len + 1;
+}
+
+template <typename Send>
+void run(const char *name, long n, Send send){
+	Ring ring;
+	Count c;
+	size_t kinds = sizeof(messages) / sizeof(messages[0]);
+
+	auto t0 = std::chrono::steady_clock::now();
+	for(long i = 0; i < n; i++){
+		const char *m = messages[i % kinds];
+		push(ring, m, c);
+		send(ring, c);
+	}
+	auto t1 = std::chrono::steady_clock::now();
+	double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+
+	std::printf("%-9s %.2f bytes copied per byte sent, %.2f ns per byte sent\n",
+			name, (double)c.copied / c.sent, ns / c.sent);
+}
+
+}
+
+int main(int argc, char **argv){
+	long n = 100000;
+
+	for(int i = 1; i < argc; i++){
+		if(!std::strncmp(argv[i], "messages=", 9)){
+			n = std::atol(argv[i] + 9);
+		} else {
+			std::fprintf(stderr, "unknown setting: %s\n", argv[i]);
+			return 2;
+		}
+	}
+	run("copy:", n, send_copy);
+	run("in place:", n, send_in_place);
+	return 0;
+}
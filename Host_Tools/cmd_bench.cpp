@@ -0,0 +1,187 @@
+/**
+ * @file cmd_bench.cpp
+ * @author Kay Sho
+ * @date  10/16/2026
+ * @brief Parse and dispatch time of the BLE commands, cmd.c against the
+ * strcmp chain it replaced
+ * @note The author's pronouns: (She/They)
+ *
+ * Build:	gcc -O2 -I../Header_Files -c ../Source_Files/cmd.c
+ *		g++ -std=c++17 -O2 -I../Header_Files cmd_bench.cpp cmd.o -o cmd_bench
+ * Use:		cmd_bench [rounds=200000]
+ *		cmd_bench seeds [names...]
+ *
+ * The names are app_cmds[] of app.c, keep them in step. cmd_open() has to
+ * find no collision with CMD_HASH_SEED, the bench exits 1 if it does.
+ * "seeds" lists the first seeds that are collision free for the names
+ * given, or for app_cmds[].
+ *
+ * Each command frame, the ones with arguments and a few bad ones too, is
+ * dispatched rounds times to handlers that only count. The chain is the
+ * if-chain app.c had, strcmp per command and strncmp plus atoi for those
+ * with an argument, grown to the same commands. Times are host times, the
+ * ratio and the compares per command are what carry over to the Cortex-M4.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "cmd.h"
+
+namespace {
+
+volatile int32_t sink;						// Keeps the handlers from being optimized out
+uint32_t compares;							// String compares made by the chain
+
+void handler(const CMD_ARGS *args){
+	sink = sink + args->count + (args->count ? args->value[0] : 0);
+}
+
+const CMD cmds[] = {
+	{"tempf",	handler, 0, 0, ""},
+	{"tempc",	handler, 0, 0, ""},
+	{"energy",	handler, 0, 0, ""},
+	{"i2c",		handler, 0, 0, ""},
+	{"res",		handler, 1, 1, ""},
+	{"link",	handler, 0, 0, ""},
+	{"hist",	handler, 0, 0, ""},
+	{"rate",	handler, 1, 2, ""},
+	{"read",	handler, 0, 1, ""},
+	{"stats",	handler, 0, 0, ""},
+};
+constexpr uint32_t CMD_COUNT = sizeof(cmds) / sizeof(cmds[0]);
+
+const char *frames[] = {
+	"#tempf!", "#tempc!", "#energy!", "#i2c!", "#res=12!", "#link!", "#hist!",
+	"#rate=500!", "#rate=1,2000!", "#read!", "#read=0!", "#stats!",
+	"#bogus!", "#rate=abc!",
+};
+
+int cmp(const char *a, const char *b){
+	compares++;
+	return std::strcmp(a, b);
+}
+
+int ncmp(const char *a, const char *b, size_t n){
+	compares++;
+	return std::strncmp(a, b, n);
+}
+
+/* The old if-chain, one compare per command until one matches */
+void chain(const char *s){
+	CMD_ARGS args = {0, {0, 0}};
+
+	if(!cmp(s, "#tempf!")) handler(&args);
+	else if(!cmp(s, "#tempc!")) handler(&args);
+	else if(!cmp(s, "#energy!")) handler(&args);
+	else if(!cmp(s, "#i2c!")) handler(&args);
+	else if(!ncmp(s, "#res=", 5)){ args.count = 1; args.value[0] = std::atoi(s + 5); handler(&args); }
+	else if(!cmp(s, "#link!")) handler(&args);
+	else if(!cmp(s, "#hist!")) handler(&args);
+	else if(!ncmp(s, "#rate=", 6)){
+		const char *comma = std::strchr(s, ',');
+		args.count = comma ? 2 : 1;
+		args.value[0] = std::atoi(s + 6);
+		if(comma) args.value[1] = std::atoi(comma + 1);
+		handler(&args);
+	}
+	else if(!cmp(s, "#read!")) handler(&args);
+	else if(!ncmp(s, "#read=", 6)){ args.count = 1; args.value[0] = std::atoi(s + 6); handler(&args); }
+	else if(!cmp(s, "#stats!")) handler(&args);
+	else sink = sink + 1;
+}
+
+uint32_t hash(const char *name, uint32_t len, uint32_t seed){
+	uint32_t h = seed;
+	for(uint32_t i = 0; i < len; i++){
+		h = (h ^ (uint8_t)name[i]) * 16777619u;
+	}
+	return h >> (32 - CMD_SLOT_BITS);
+}
+
+int seeds(int argc, char **argv){
+	std::vector<const char *> names;
+	for(int i = 2; i < argc; i++){
+		names.push_back(argv[i]);
+	}
+	if(names.empty()){
+		for(const CMD &c : cmds){
+			names.push_back(c.name);
+		}
+	}
+	int found = 0;
+	for(uint32_t seed = 0; found < 8 && seed < 1000000; seed++){
+		uint64_t used = 0;
+		bool ok = true;
+		for(const char *n : names){
+			uint32_t slot = hash(n, std::strlen(n), seed);
+			if(used & (1ull << slot)){
+				ok = false;
+				break;
+			}
+			used |= 1ull << slot;
+		}
+		if(ok){
+			std::printf("%u\n", seed);
+			found++;
+		}
+	}
+	return found ? 0 : 1;
+}
+
+}
+
+int main(int argc, char **argv){
+	uint32_t rounds = 200000;
+
+	if(argc > 1 && !std::strcmp(argv[1], "seeds")){
+		return seeds(argc, argv);
+	}
+	for(int i = 1; i < argc; i++){
+		if(!std::strncmp(argv[i], "rounds=", 7) && std::atoi(argv[i] + 7) > 0){
+			rounds = std::atoi(argv[i] + 7);
+		} else {
+			std::fprintf(stderr, "unknown or bad setting: %s\n", argv[i]);
+			return 2;
+		}
+	}
+	if(!cmd_open(cmds, CMD_COUNT)){
+		std::printf("CMD_HASH_SEED %u collides for these names, try cmd_bench seeds\n", CMD_HASH_SEED);
+		return 1;
+	}
+
+	std::printf("%u commands, seed %u, %u slots, %u rounds\n", CMD_COUNT, CMD_HASH_SEED, CMD_SLOTS, rounds);
+	std::printf("%-15s %8s %10s %9s %10s\n", "frame", "status", "table ns", "chain ns", "chain cmp");
+	double table_sum = 0, chain_sum = 0;
+	for(const char *f : frames){
+		uint32_t len = std::strlen(f);
+		const CMD *cmd;
+		CMD_STATUS status = CMD_OK;
+
+		auto t0 = std::chrono::steady_clock::now();
+		for(uint32_t r = 0; r < rounds; r++){
+			status = cmd_dispatch(f, len, &cmd);
+		}
+		auto t1 = std::chrono::steady_clock::now();
+		compares = 0;
+		for(uint32_t r = 0; r < rounds; r++){
+			chain(f);
+		}
+		auto t2 = std::chrono::steady_clock::now();
+
+		double table_ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / rounds;
+		double chain_ns = std::chrono::duration<double, std::nano>(t2 - t1).count() / rounds;
+		table_sum += table_ns;
+		chain_sum += chain_ns;
+		std::printf("%-15s %8s %10.1f %9.1f %10u\n", f,
+				status == CMD_OK ? "ok" : status == CMD_UNKNOWN ? "unknown" : "bad args",
+				table_ns, chain_ns, compares / rounds);
+	}
+	std::printf("%-15s %8s %10.1f %9.1f\n", "mean", "", table_sum / std::size(frames),
+			chain_sum / std::size(frames));
+	return 0;
+}
@@ -0,0 +1,235 @@
+/**
+ * @file coroutine_bench.cpp
+ * @author Kay Sho
+ * @date  10/17/2026
+ * @brief Switch cost and RAM per task of the stackless coroutines, against a
+ * hand-written state machine and a stackful context switch
+ * @note The author's pronouns: (She/They)
+ *
+ * Build:	g++ -std=c++17 -O2 -o coroutine_bench coroutine_bench.cpp
+ * Use:		coroutine_bench [rounds=2000000] [steps=8] [stack=512]
+ *
+ * The CR_ macros are the ones of Header_Files/coroutine.h, which cannot be
+ * included here without the SDK headers scheduler.h pulls in. Each version
+ * runs a sequence of steps, one step per dispatch, through a function
+ * pointer the way scheduler_run_level() calls a table entry:
+ *	- plain:	a handler with no resume point, the floor
+ *	- coroutine:	CR_BEGIN, a loop of CR_YIELD on a step counter kept in
+ *			the task's context, CR_END, as ble_test_task() is written
+ *	- fsm:		the same sequence as a state enum and a switch, what the
+ *			driver state machines of fsm.h do by hand
+ *	- stackful:	a ucontext thread with its own stack, swapped in and out
+ *			by the dispatch, what an RTOS task would cost
+ * Times are host times. The three stackless versions carry over to the
+ * Cortex-M4 as a ratio, all of them are a load, a compare and a branch or a
+ * jump table. The stackful one does not: glibc's swapcontext() makes a
+ * sigprocmask system call each way. A switch on the M4 saves and restores
+ * r4-r11 and the PSP, about 30 cycles through PendSV, plus s16-s31 once the
+ * task has touched the FPU, so read that row for its RAM.
+ *
+ * RAM is counted for the Cortex-M4, 4 byte pointers: the context the tasks
+ * of the firmware keep across yields, LEUART_LOOPBK_TASK of leuart.c and
+ * BLE_TEST_TASK of ble.c, laid out with uint32_t for their pointers. A
+ * stackful task keeps the same context on its stack and adds the stack.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ucontext.h>
+#include <vector>
+
+namespace {
+
+/* Header_Files/coroutine.h */
+#define CR_BEGIN(cr)		switch((cr)->line){ case 0:
+#define CR_YIELD(cr)		do{ (cr)->line = __LINE__; return; case __LINE__:; }while(0)
+#define CR_END(cr)			} (cr)->line = 0
+
+typedef struct{
+	uint16_t	line;
+}CR_STATE;
+
+/* Target layouts, BLE_TEST_STEPS 3 and BLE_TEST_STR 40 of ble.h */
+struct LOOPBK_TASK_M4 {
+	CR_STATE	cr;
+	uint32_t	leuart;
+	uint32_t	task_evt;
+	uint32_t	done_evt;
+	uint32_t	rx_done_evt;
+	uint32_t	int_flag;
+};
+
+struct BLE_TEST_TASK_M4 {
+	CR_STATE	cr;
+	uint32_t	task_evt;
+	uint32_t	done_evt;
+	uint32_t	step;
+	char		cmd[3][40];
+	char		resp[3][40];
+	char		return_str[40];
+	bool		rx_disabled, rx_en, tx_en;
+};
+
+struct Settings {
+	uint32_t	rounds	= 2000000;
+	uint32_t	steps	= 8;
+	uint32_t	stack	= 512;				// Bytes per stackful task
+};
+
+volatile uint32_t sink;						// Keeps the steps from being optimized out
+uint32_t steps;
+bool finished;								// The sequence ran its last step
+
+void work(uint32_t step){
+	sink = sink + step;
+}
+
+/* plain */
+uint32_t plain_step;
+
+void plain_task(uint32_t payload){
+	work(plain_step + payload);
+	if(++plain_step == steps){
+		plain_step = 0;
+		finished = true;
+	}
+}
+
+/* coroutine */
+struct {
+	CR_STATE	cr;
+	uint32_t	step;
+} cr_task;
+
+void cr_task_run(uint32_t payload){
+	CR_BEGIN(&cr_task.cr);
+	for(cr_task.step = 0; cr_task.step < steps; cr_task.step++){
+		work(cr_task.step + payload);
+		if(cr_task.step + 1 < steps){
+			CR_YIELD(&cr_task.cr);
+		}
+	}
+	finished = true;
+	CR_END(&cr_task.cr);
+}
+
+/* fsm */
+enum FSM_STATE {FSM_IDLE, FSM_STEP};
+struct {
+	FSM_STATE	state;
+	uint32_t	step;
+} fsm_task;
+
+void fsm_task_run(uint32_t payload){
+	switch(fsm_task.state){
+		case FSM_IDLE:
+			fsm_task.step = 0;
+			fsm_task.state = FSM_STEP;
+			/* fall through */
+		case FSM_STEP:
+			work(fsm_task.step + payload);
+			if(++fsm_task.step == steps){
+				fsm_task.state = FSM_IDLE;
+				finished = true;
+			}
+			break;
+	}
+}
+
+/* stackful */
+ucontext_t main_ctx, thread_ctx;
+uint32_t thread_payload;
+
+void thread_body(){
+	for(;;){
+		for(uint32_t step = 0; step < steps; step++){
+			work(step + thread_payload);
+			if(step + 1 == steps){
+				finished = true;
+			}
+			swapcontext(&thread_ctx, &main_ctx);	// Yield
+		}
+	}
+}
+
+void thread_task_run(uint32_t payload){
+	thread_payload = payload;
+	swapcontext(&main_ctx, &thread_ctx);			// Resume
+}
+
+/* rounds sequences of steps dispatches, in ns per dispatch */
+double time_task(void (*volatile handler)(uint32_t), uint32_t rounds){
+	auto t0 = std::chrono::steady_clock::now();
+	for(uint32_t r = 0; r < rounds; r++){
+		finished = false;
+		while(!finished){
+			handler(0);
+		}
+	}
+	auto t1 = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(t1 - t0).count() / ((double)rounds * steps);
+}
+
+bool set_key(const char *arg, Settings &s){
+	const char *eq = std::strchr(arg, '=');
+	if(!eq || std::atoi(eq + 1) <= 0) return false;
+	uint32_t value = std::atoi(eq + 1);
+	size_t len = eq - arg;
+
+	if(!std::strncmp(arg, "rounds", len) && len == 6)	{ s.rounds = value; return true; }
+	if(!std::strncmp(arg, "steps", len) && len == 5)	{ s.steps = value; return true; }
+	if(!std::strncmp(arg, "stack", len) && len == 5)	{ s.stack = value; return value >= 64; }
+	return false;
+}
+
+}
+
+int main(int argc, char **argv){
+	Settings set;
+
+	for(int i = 1; i < argc; i++){
+		if(!set_key(argv[i], set)){
+			std::fprintf(stderr, "unknown or bad setting: %s\n", argv[i]);
+			return 2;
+		}
+	}
+	steps = set.steps;
+
+	std::vector<char> stack(set.stack < 16384 ? 16384 : set.stack);	// Host frames are larger than the M4's
+	getcontext(&thread_ctx);
+	thread_ctx.uc_stack.ss_sp = stack.data();
+	thread_ctx.uc_stack.ss_size = stack.size();
+	thread_ctx.uc_link = nullptr;
+	makecontext(&thread_ctx, thread_body, 0);
+
+	struct {
+		const char	*name;
+		void		(*handler)(uint32_t);
+		uint32_t	resume;				// Bytes of the resume point
+		uint32_t	extra;				// Bytes beyond the context kept across yields
+	} versions[] = {
+		{"plain",		plain_task,			0,	0},
+		{"coroutine",	cr_task_run,		sizeof(CR_STATE),	0},
+		{"fsm",			fsm_task_run,		sizeof(FSM_STATE),	0},		// Takes CR_STATE's place, in its padding
+		{"stackful",	thread_task_run,	0,	set.stack + 9 * 4},		// Stack, saved r4-r11 and PSP
+	};
+
+	std::printf("%u rounds of %u steps, one dispatch per step\n", set.rounds, set.steps);
+	std::printf("%-10s %8s %8s | %7s %9s %9s\n", "version", "ns", "over", "resume", "loopback",
+			"BLE test");
+	double floor = 0;
+	for(const auto &v : versions){
+		double ns = time_task(v.handler, set.rounds);
+		if(v.handler == plain_task){
+			floor = ns;
+			std::printf("%-10s %8.2f %8s | %7s %9s %9s\n", v.name, ns, "", "", "", "");
+			continue;
+		}
+		std::printf("%-10s %8.2f %8.2f | %7u %9u %9u\n", v.name, ns, ns - floor, v.resume,
+				(uint32_t)sizeof(LOOPBK_TASK_M4) + v.extra, (uint32_t)sizeof(BLE_TEST_TASK_M4) + v.extra);
+	}
+	return 0;
+}
@@ -0,0 +1,118 @@
+/**
+ * @file delay_energy.cpp
+ * @author Kay Sho
+ * @date  10/16/2026
+ * @brief Charge and CPU busy time of the firmware's delays, the old TIMER0
+ * spin against timer_delay() sleeping on the timer wheel
+ * @note The author's pronouns: (She/They)
+ *
+ * Build:	gcc -O2 -I../Header_Files -c ../Source_Files/energy_model.c
+ *		g++ -std=c++17 -O2 -I../Header_Files delay_energy.cpp energy_model.o -o delay_energy
+ * Use:		delay_energy [core_mhz=19] [wake_cycles=400] [em0_na=1400000] [em2_na=3000]
+ *
+ * The old timer_delay() polled TIMER0->CNT in EM0 for the whole delay. The new
+ * one arms a wheel timer and sleeps. The core wakes on the COMP1 interrupt at
+ * the deadline, and on the LETIMER underflow once per 65.5 s epoch. Each
+ * wakeup is charged the datasheet wakeup time at EM0 current plus wake_cycles
+ * of interrupt, timer_wheel_poll() and loop code. The sleep mode comes from
+ * energy_cheapest_mode() in Source_Files/energy_model.c, as enter_sleep()
+ * picks it with SLEEP_GOVERNOR_ENABLED, out of the deepest mode the
+ * peripherals still running allow.
+ *
+ * The delays are the callers the firmware had: the LEUART loopback test,
+ * 4 ms per byte of "#loopbk!", and the BLE test's 2000 ms wait. Peripheral
+ * currents are left out, they are the same in both.
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "energy_model.h"
+
+namespace {
+
+struct Settings {
+	double core_mhz		= 19;		// HFRCO
+	double wake_cycles	= 400;		// LETIMER0 handler, timer_wheel_poll(), the timer_delay() loop
+};
+
+struct Delay {
+	const char	*name;
+	double		ms;
+	uint32_t	count;				// Back to back
+	uint32_t	deepest;			// Deepest mode the running peripherals allow
+};
+
+struct Cost {
+	double	busy_us	= 0;			// Core awake
+	double	charge_uc = 0;
+	uint32_t wakes = 0;
+	uint32_t mode = 0;
+};
+
+Cost spin(const Delay &d, const ENERGY_MODEL &m){
+	Cost c;
+	c.busy_us = d.ms * 1000 * d.count;
+	c.charge_uc = m.mode_na[0] * 1e-9 * c.busy_us;
+	return c;
+}
+
+Cost sleep(const Delay &d, const ENERGY_MODEL &m, const Settings &s){
+	Cost c;
+	double us = d.ms * 1000;
+	uint32_t wakes = 1 + (uint32_t)std::floor(d.ms / 65536.0);	// COMP1, and every underflow on the way
+
+	c.mode = energy_cheapest_mode(&m, d.deepest, (uint32_t)(us / wakes), m.wake_us);
+	double awake_us = wakes * (m.wake_us[c.mode] + s.wake_cycles / s.core_mhz);
+	c.busy_us = awake_us * d.count;
+	c.wakes = wakes * d.count;
+	c.charge_uc = (m.mode_na[0] * 1e-9 * awake_us + m.mode_na[c.mode] * 1e-9 * (us - awake_us)) * d.count;
+	return c;
+}
+
+bool set(const std::string &key, double value, Settings &s, ENERGY_MODEL &m){
+	static const char *mode_keys[ENERGY_MODES] = {"em0_na", "em1_na", "em2_na", "em3_na", "em4_na"};
+
+	for(int i = 0; i < ENERGY_MODES; i++){
+		if(key == mode_keys[i]){ m.mode_na[i] = (uint32_t)value; return true; }
+	}
+	if(key == "core_mhz")		{ s.core_mhz = value; return value > 0; }
+	if(key == "wake_cycles")	{ s.wake_cycles = value; return value >= 0; }
+	return false;
+}
+
+}
+
+int main(int argc, char **argv){
+	ENERGY_MODEL model = ENERGY_MODEL_DEFAULT;
+	Settings s;
+
+	for(int i = 1; i < argc; i++){
+		const char *eq = std::strchr(argv[i], '=');
+		if(!eq || !set(std::string(argv[i], eq - argv[i]), std::atof(eq + 1), s, model)){
+			std::fprintf(stderr, "unknown or bad setting: %s\n", argv[i]);
+			return 2;
+		}
+	}
+
+	const Delay delays[] = {
+		{"leuart loopback, per byte",	4,		8,	2},		// LEUART open, EM3 blocked
+		{"BLE test wait",				2000,	1,	2},
+		{"1 ms, nothing else running",	1,		1,	3},
+		{"5 min, nothing else running",	300000,	1,	3},
+	};
+
+	std::printf("%-30s %7s %5s | %10s %10s | %4s %5s %9s %10s %7s\n", "delay", "ms", "times",
+			"spin busy", "spin uC", "mode", "wakes", "busy us", "sleep uC", "saved");
+	for(const Delay &d : delays){
+		Cost a = spin(d, model), b = sleep(d, model, s);
+		std::printf("%-30s %7.0f %5u | %8.0f us %10.3f | EM%u %5u %9.1f %10.3f %6.1f%%\n", d.name, d.ms,
+				d.count, a.busy_us, a.charge_uc, b.mode, b.wakes, b.busy_us, b.charge_uc,
+				100.0 * (1 - b.charge_uc / a.charge_uc));
+	}
+	return 0;
+}
@@ -0,0 +1,147 @@
+/**
+ * @file energy_sim.cpp
+ * @author Kay Sho
+ * @date  10/16/2026
+ * @brief Prints the firmware's energy estimate for any workload and current model,
+ * with and without the sleep governor
+ * @note The author's pronouns: (She/They)
+ *
+ * Build:	gcc -O2 -I../Header_Files -c ../Source_Files/energy_model.c
+ *		g++ -std=c++17 -O2 -I../Header_Files energy_sim.cpp energy_model.o -o energy_sim
+ * Use:		energy_sim [key=value ...]
+ *
+ * The workload is one sample period repeated for an hour. Every key below can
+ * be overridden, e.g. "energy_sim period_ms=10000 em2_na=1800". The estimate
+ * comes from energy_estimate() in Source_Files/energy_model.c, the same code
+ * that answers energy_stats() on the board.
+ *
+ * Each sleep is costed twice: once in the deepest mode the workload allows,
+ * and once in the mode energy_cheapest_mode() picks, as enter_sleep() does
+ * with SLEEP_GOVERNOR_ENABLED. Wakeup time is charged at EM0 current in both.
+ * "gaps" adds short timer-bounded sleeps of gap_us to each period.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "energy_model.h"
+
+namespace {
+
+struct Workload {
+	double period_ms	= 2700;		// SAMPLE_PER_MS
+	double em0_ms		= 0.3;		// Handlers per period
+	double em1_ms		= 0.3;		// I2C transfers, I2C blocks EM2
+	double i2c_ms		= 17.5;		// Si7021 RH+T conversion, slept out in EM2
+	double tx_ms		= 28.1;		// "Temp = 23.4 C, RH = 45.6 %\n" at 9600 baud, sleeps in EM2
+	double sensor_ms	= 104.5;	// Si7021 powered: 80 ms power-up lead, conversion and reads.
+									// period_ms if it is not power gated
+	int sleep_em		= 2;		// Deepest mode the LEUART allows
+	double gaps			= 0;		// Short sleeps per period
+	double gap_us		= 500;
+};
+
+struct Sleep {
+	double	us;
+	double	count;					// Per period
+};
+
+// Residency for one hour when every sleep is entered through pick()
+template <typename Pick>
+ENERGY_RESIDENCY run(const Workload &w, const ENERGY_MODEL &m, Pick pick){
+	double periods = 3600000.0 / w.period_ms;
+	double mode_us[ENERGY_MODES] = {};
+	std::vector<Sleep> sleeps = {
+		{(w.period_ms - w.em0_ms - w.em1_ms) * 1000.0 - w.gaps * w.gap_us, 1},
+		{w.gap_us, w.gaps},
+	};
+
+	mode_us[0] = periods * w.em0_ms * 1000.0;
+	mode_us[1] = periods * w.em1_ms * 1000.0;
+	for(const Sleep &s : sleeps){
+		uint32_t em = pick(s.us);
+		double wake = std::min<double>(m.wake_us[em], s.us);
+		mode_us[0] += periods * s.count * wake;
+		mode_us[em] += periods * s.count * (s.us - wake);
+	}
+
+	ENERGY_RESIDENCY r = {};
+	for(int i = 0; i < ENERGY_MODES; i++){
+		r.mode_ms[i] = (uint32_t)(mode_us[i] / 1000.0);
+	}
+	r.load_ms[ENERGY_LOAD_I2C] = (uint32_t)(periods * w.i2c_ms);
+	r.load_ms[ENERGY_LOAD_LEUART_TX] = (uint32_t)(periods * w.tx_ms);
+	r.load_ms[ENERGY_LOAD_SENSOR] = (uint32_t)(periods * w.sensor_ms);
+	return r;
+}
+
+void print(const char *policy, const ENERGY_MODEL &m, const ENERGY_RESIDENCY &r){
+	ENERGY_ESTIMATE e;
+	energy_estimate(&m, &r, &e);
+
+	std::printf("%s\n", policy);
+	std::printf("  per hour:  EM0 %u ms  EM1 %u ms  EM2 %u ms  EM3 %u ms  I2C %u ms  TX %u ms  sensor %u ms\n",
+			r.mode_ms[0], r.mode_ms[1], r.mode_ms[2], r.mode_ms[3],
+			r.load_ms[ENERGY_LOAD_I2C], r.load_ms[ENERGY_LOAD_LEUART_TX], r.load_ms[ENERGY_LOAD_SENSOR]);
+	std::printf("  average:   %u.%03u uA\n", e.avg_na / 1000, e.avg_na % 1000);
+	std::printf("  battery:   %u h (%.1f days) on %u mAh\n", e.life_hours, e.life_hours / 24.0, m.battery_mah);
+}
+
+bool set(const std::string &key, double value, Workload &w, ENERGY_MODEL &m){
+	static const char *mode_keys[ENERGY_MODES] = {"em0_na", "em1_na", "em2_na", "em3_na", "em4_na"};
+
+	for(int i = 0; i < ENERGY_MODES; i++){
+		if(key == mode_keys[i]){ m.mode_na[i] = (uint32_t)value; return true; }
+	}
+	if(key == "i2c_na")			{ m.load_na[ENERGY_LOAD_I2C] = (uint32_t)value; return true; }
+	if(key == "tx_na")			{ m.load_na[ENERGY_LOAD_LEUART_TX] = (uint32_t)value; return true; }
+	if(key == "sensor_na")		{ m.load_na[ENERGY_LOAD_SENSOR] = (uint32_t)value; return true; }
+	if(key == "board_na")		{ m.board_na = (uint32_t)value; return true; }
+	if(key == "battery_mah")	{ m.battery_mah = (uint32_t)value; return true; }
+	if(key == "period_ms")		{ w.period_ms = value; return true; }
+	if(key == "em0_ms")			{ w.em0_ms = value; return true; }
+	if(key == "em1_ms")			{ w.em1_ms = value; return true; }
+	if(key == "i2c_ms")			{ w.i2c_ms = value; return true; }
+	if(key == "tx_ms")			{ w.tx_ms = value; return true; }
+	if(key == "sensor_ms")		{ w.sensor_ms = value; return value >= 0; }
+	if(key == "gaps")			{ w.gaps = value; return value >= 0; }
+	if(key == "gap_us")			{ w.gap_us = value; return value > 0; }
+	if(key == "sleep_em")		{ w.sleep_em = (int)value; return value >= 1 && value <= 3; }
+	return false;
+}
+
+}
+
+int main(int argc, char **argv){
+	ENERGY_MODEL model = ENERGY_MODEL_DEFAULT;
+	Workload w;
+
+	for(int i = 1; i < argc; i++){
+		const char *eq = std::strchr(argv[i], '=');
+		if(!eq || !set(std::string(argv[i], eq - argv[i]), std::atof(eq + 1), w, model)){
+			std::cerr << "unknown or bad setting: " << argv[i] << "\n";
+			return 2;
+		}
+	}
+	if(w.period_ms * 1000.0 < (w.em0_ms + w.em1_ms) * 1000.0 + w.gaps * w.gap_us){
+		std::cerr << "period_ms is shorter than the awake time\n";
+		return 2;
+	}
+	if(w.sensor_ms > w.period_ms){
+		std::cerr << "sensor_ms is longer than period_ms\n";
+		return 2;
+	}
+
+	uint32_t deepest = (uint32_t)w.sleep_em;
+	print("deepest allowed mode:", model, run(w, model, [&](double){ return deepest; }));
+	print("governor:", model, run(w, model, [&](double us){
+		return energy_cheapest_mode(&model, deepest, (uint32_t)us, model.wake_us);
+	}));
+	return 0;
+}
@@ -0,0 +1,228 @@
+/**
+ * @file event_ring_stress.cpp
+ * @author Kay Sho
+ * @date  10/16/2026
+ * @brief Bursts of posts faster than the main loop drains them, through the
+ * scheduler's source ring and its lost marker
+ * @note The author's pronouns: (She/They)
+ *
+ * Build:	g++ -std=c++17 -O2 -pthread -o event_ring_stress event_ring_stress.cpp
+ * Use:		event_ring_stress [posts=2000000] [work_ns=200] [gap_ns=2000]
+ *
+ * One thread stands in for an interrupt handler calling scheduler_post(), one
+ * for scheduler_dispatch(). The ring follows Source_Files/event_ring.c,
+ * EVENT_RING_SIZE records, head written only by the producer and tail only by
+ * the consumer, a fence where the firmware has __DMB(). A post that finds the
+ * ring full takes the last record for the EVENT_RING_LOST marker and sets the
+ * event's lost bit, as scheduler_post() does. The consumer runs one
+ * SCHEDULER_PAYLOAD_LOST callback at the marker, like scheduler_run_lost().
+ *
+ * The producer posts bursts of half a ring to 4 rings back to back, gap_ns
+ * apart, each payload a sequence number. A burst of a whole ring already
+ * drops its last post, that record is the marker's. The consumer spends work_ns on each
+ * callback. Checked, for every burst size:
+ *	- payloads come out in order, never twice, never torn
+ *	- every post is either delivered or counted as overflow
+ *	- a run of dropped posts is always followed by a lost callback before the
+ *	  next record, so a handler that counts callbacks knows to resynchronise
+ * The pending bit column is what the callbacks were before the ring, one per
+ * run of posts the consumer had not caught up with.
+ *
+ * Exits 1 if any check fails.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <thread>
+
+namespace {
+
+constexpr uint32_t RING_SIZE	= 16;			// EVENT_RING_SIZE
+constexpr uint32_t RING_MASK	= RING_SIZE - 1;
+constexpr uint32_t LOST			= 0xFFFFFFFF;	// EVENT_RING_LOST
+
+struct Record {
+	uint32_t	event;
+	uint32_t	payload;
+	uint32_t	check;							// ~payload, a torn record fails it
+};
+
+struct Ring {
+	Record					records[RING_SIZE];
+	std::atomic<uint32_t>	head{0};
+	std::atomic<uint32_t>	tail{0};
+	uint32_t				high_water = 0;
+	uint32_t				overflow = 0;
+};
+
+struct Settings {
+	uint32_t	posts		= 2000000;
+	uint32_t	work_ns		= 200;
+	uint32_t	gap_ns		= 2000;
+};
+
+struct Result {
+	uint64_t	delivered	= 0;
+	uint64_t	lost_cb		= 0;
+	uint64_t	pending_cb	= 0;
+	uint32_t	overflow	= 0;
+	uint32_t	high_water	= 0;
+	uint64_t	out_of_order = 0;
+	uint64_t	torn		= 0;
+	uint64_t	silent		= 0;			// Gaps in the payloads with no lost callback before them
+};
+
+/* event_ring_post() and the lost bit of scheduler_post(). The bit is set
+ * before the marker is published, an interrupt handler is never caught
+ * halfway by the main loop but this thread can be. */
+bool ring_post(Ring &r, std::atomic<uint32_t> &lost, uint32_t event, uint32_t payload){
+	uint32_t head = r.head.load(std::memory_order_relaxed);
+	uint32_t count = head - r.tail.load(std::memory_order_acquire);
+
+	if(count >= RING_SIZE){
+		r.overflow++;
+		lost.fetch_or(1u << event);
+		return false;
+	}
+	if(count == RING_SIZE - 1){
+		r.overflow++;
+		lost.fetch_or(1u << event);
+		event = LOST;
+		payload = 0;
+	}
+	r.records[head & RING_MASK] = {event, payload, ~payload};
+	std::atomic_thread_fence(std::memory_order_release);
+	r.head.store(head + 1, std::memory_order_relaxed);
+	if(count + 1 > r.high_water){
+		r.high_water = count + 1;
+	}
+	return event != LOST;
+}
+
+/* event_ring_get() */
+bool ring_get(Ring &r, Record &rec){
+	uint32_t tail = r.tail.load(std::memory_order_relaxed);
+
+	if(tail == r.head.load(std::memory_order_relaxed)){
+		return false;
+	}
+	std::atomic_thread_fence(std::memory_order_acquire);
+	rec = r.records[tail & RING_MASK];
+	r.tail.store(tail + 1, std::memory_order_release);
+	return true;
+}
+
+void spin_ns(uint32_t ns){
+	auto end = std::chrono::steady_clock::now() + std::chrono::nanoseconds(ns);
+	while(std::chrono::steady_clock::now() < end);
+}
+
+Result run(const Settings &set, uint32_t burst){
+	Ring ring;
+	std::atomic<uint32_t> lost{0};				// event_lost[] of scheduler.c for this ring
+	std::atomic<uint32_t> pending{0};			// The old pending bit, for the reference column
+	std::atomic<bool> done{false};
+	Result res;
+
+	std::thread producer([&](){
+		for(uint32_t seq = 0; seq < set.posts; seq++){
+			ring_post(ring, lost, 1, seq);
+			pending.fetch_or(1);
+			if(seq % burst == burst - 1){
+				spin_ns(set.gap_ns);
+				std::this_thread::yield();		// Lets the consumer in on a single core
+			}
+		}
+		done.store(true);
+	});
+
+	uint32_t expect = 0;						// Next payload the handler waits for
+	bool resync = false;						// A lost callback came since the last record
+	for(;;){
+		bool finished = done.load();
+		uint32_t count = ring.head.load(std::memory_order_acquire) - ring.tail.load(std::memory_order_relaxed);
+		Record rec;
+
+		if(!count){
+			std::this_thread::yield();
+		}
+		while(count-- && ring_get(ring, rec)){
+			if(rec.event == LOST){
+				if(lost.exchange(0)){
+					resync = true;
+					res.lost_cb++;
+					spin_ns(set.work_ns);
+				}
+				continue;
+			}
+			if(rec.check != ~rec.payload){
+				res.torn++;
+			} else if(rec.payload < expect){
+				res.out_of_order++;
+			} else if(rec.payload > expect && !resync){
+				res.silent++;
+			}
+			expect = rec.payload + 1;
+			resync = false;
+			res.delivered++;
+			spin_ns(set.work_ns);
+		}
+		if(pending.exchange(0)){
+			res.pending_cb++;
+		}
+		if(finished && ring.head.load() == ring.tail.load()){
+			break;
+		}
+	}
+	producer.join();
+
+	if(expect != set.posts && !resync){
+		res.silent++;							// The last posts went missing without a callback
+	}
+	res.overflow = ring.overflow;
+	res.high_water = ring.high_water;
+	return res;
+}
+
+}
+
+int main(int argc, char **argv){
+	Settings set;
+
+	for(int i = 1; i < argc; i++){
+		if(!std::strncmp(argv[i], "posts=", 6) && std::atoi(argv[i] + 6) > 0){
+			set.posts = std::atoi(argv[i] + 6);
+		} else if(!std::strncmp(argv[i], "work_ns=", 8)){
+			set.work_ns = std::atoi(argv[i] + 8);
+		} else if(!std::strncmp(argv[i], "gap_ns=", 7)){
+			set.gap_ns = std::atoi(argv[i] + 7);
+		} else {
+			std::fprintf(stderr, "unknown or bad setting: %s\n", argv[i]);
+			return 2;
+		}
+	}
+
+	std::printf("%u posts, ring %u, %u ns per callback, %u ns between bursts\n",
+			set.posts, RING_SIZE, set.work_ns, set.gap_ns);
+	std::printf("%6s %10s %10s %8s %6s %11s %6s %5s %7s\n", "burst", "delivered", "overflow",
+			"lost cb", "high", "pending bit", "order", "torn", "silent");
+
+	int status = 0;
+	for(uint32_t burst : {RING_SIZE / 2, RING_SIZE, 2 * RING_SIZE, 4 * RING_SIZE}){
+		Result r = run(set, burst);
+		std::printf("%6u %10llu %10u %8llu %6u %11llu %6llu %5llu %7llu\n", burst,
+				(unsigned long long)r.delivered, r.overflow, (unsigned long long)r.lost_cb,
+				r.high_water, (unsigned long long)r.pending_cb, (unsigned long long)r.out_of_order,
+				(unsigned long long)r.torn, (unsigned long long)r.silent);
+		if(r.delivered + r.overflow != set.posts || r.out_of_order || r.torn || r.silent
+				|| (r.overflow && !r.lost_cb) || r.high_water > RING_SIZE){
+			status = 1;
+		}
+	}
+	return status;
+}
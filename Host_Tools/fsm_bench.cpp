@@ -0,0 +1,393 @@
+/**
+ * @file fsm_bench.cpp
+ * @author Kay Sho
+ * @date  10/17/2026
+ * @brief Cycles per I2C interrupt, the transition table of fsm.h against the
+ * switch ladders i2c.c had, with the trace on and off
+ * @note The author's pronouns: (She/They)
+ *
+ * Build:	g++ -std=c++17 -Os -o fsm_bench fsm_bench.cpp
+ * Use:		fsm_bench [rounds=200000] [runs=11]
+ *
+ * fsm.h, i2c.c and trace.h need the SDK headers, so the two drivers are
+ * modelled here with the I2C registers as a plain struct. The ladder follows
+ * i2c_irq() before the tables: one if per flag, then a switch on the state
+ * in i2c_ack(), i2c_nack(), i2c_rxdatav() and i2c_mstop(), every state
+ * change through i2c_set_state() and its TRACE_I2C_STATE record. The table
+ * follows fsm_dispatch() of Header_Files/fsm.h, inlined into the handler as
+ * it is there, and the I2C transitions of i2c_table. Both run the same
+ * actions: write_next, read_begin, the byte reads, finish and next, with the
+ * scheduler post a counter.
+ *
+ * Each round is the Si7021 read the sampler makes: START and the write
+ * address outside the handler, then ACK, ACK, ACK, RXDATAV, RXDATAV, MSTOP.
+ * Every handler call is timed with rdtsc. The printed figure is the median
+ * over runs of the mean cycles per call, x86 cycles, so only the difference
+ * between the rows carries over to the Cortex-M4. An ACK in IDLE is sent
+ * once per run to check both count it as unexpected.
+ *
+ * The trace ring index is a plain increment here. On the target it is an
+ * LDREX/STREX loop of a few cycles, on the host a locked add would swamp the
+ * rest.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <x86intrin.h>
+
+namespace {
+
+/* Interrupt flags and commands of em_i2c.h, values as on the PG12 */
+constexpr uint32_t IF_ACK		= 1 << 6;
+constexpr uint32_t IF_NACK		= 1 << 7;
+constexpr uint32_t IF_RXDATAV	= 1 << 5;
+constexpr uint32_t IF_TXC		= 1 << 3;
+constexpr uint32_t IF_MSTOP		= 1 << 8;
+constexpr uint32_t IF_FAULT		= (1 << 10) | (1 << 9);	// ARBLOST, BUSERR
+constexpr uint32_t CMD_START	= 1 << 0;
+constexpr uint32_t CMD_STOP		= 1 << 1;
+constexpr uint32_t CMD_ACK		= 1 << 2;
+constexpr uint32_t CMD_NACK		= 1 << 3;
+constexpr uint32_t I2C_READ		= 1;
+
+struct Regs {
+	volatile uint32_t	IF, IEN, IFC, CMD, TXDATA, RXDATA;
+};
+
+/* trace.h */
+struct TraceRecord {
+	uint32_t	stamp;
+	uint16_t	id;
+	uint16_t	arg;
+};
+constexpr uint16_t TRACE_IRQ_I2C0	= 1;
+constexpr uint16_t TRACE_I2C_STATE	= 2;
+TraceRecord trace_buf[256];
+uint32_t trace_head;
+
+template <bool TRACE>
+inline void trace(uint16_t id, uint32_t arg){
+	if(TRACE){
+		TraceRecord &r = trace_buf[trace_head++ & 255];
+		r.stamp = (uint32_t)__rdtsc();
+		r.id = id;
+		r.arg = (uint16_t)arg;
+	}
+}
+
+enum State {IDLE, REQUEST_DEVICE, WRITE_DEVICE, WAIT_CONVERSION, READ_DEVICE, CLOSE, STATES};
+enum Cause {CAUSE_ACK, CAUSE_NACK, CAUSE_RXDATAV, CAUSE_TXC, CAUSE_MSTOP, CAUSES};
+
+struct Transfer {
+	uint8_t			dev_addr;
+	const uint8_t	*tx;
+	uint32_t		tx_len;
+	uint8_t			*rx;
+	uint32_t		rx_len;
+};
+
+struct Machine {
+	Regs		*i2c;
+	Transfer	*transfer;
+	uint32_t	sent, received;
+	uint32_t	unexpected;
+	uint32_t	posts;						// add_scheduled_event() and scheduler_post()
+	/* fsm.h */
+	const struct Table	*table;
+	uint8_t		state;
+	uint8_t		last_illegal;
+	uint32_t	illegal;
+};
+
+/* Driver actions, shared by both */
+template <bool TRACE>
+void set_state(Machine *sm, uint32_t state){
+	sm->state = state;
+	trace<TRACE>(TRACE_I2C_STATE, state);
+}
+
+template <bool TRACE>
+__attribute__((noinline)) void finish(Machine *sm){
+	set_state<TRACE>(sm, CLOSE);
+	sm->i2c->CMD = CMD_STOP;
+	sm->posts++;
+}
+
+template <bool TRACE>
+__attribute__((noinline)) void next(Machine *sm){
+	set_state<TRACE>(sm, IDLE);
+	sm->posts++;
+}
+
+template <bool TRACE>
+__attribute__((noinline)) void fault(Machine *sm){
+	sm->unexpected++;
+	sm->i2c->CMD = CMD_STOP;
+	set_state<TRACE>(sm, IDLE);
+}
+
+template <bool TRACE>
+void read_begin(Machine *sm){
+	set_state<TRACE>(sm, WAIT_CONVERSION);
+	sm->i2c->CMD = CMD_START;
+	sm->i2c->TXDATA = (sm->transfer->dev_addr << 1) | I2C_READ;
+}
+
+template <bool TRACE>
+__attribute__((noinline)) void write_next(Machine *sm){
+	if(sm->sent < sm->transfer->tx_len){
+		sm->i2c->TXDATA = sm->transfer->tx[sm->sent++];
+	} else if(sm->transfer->rx_len){
+		read_begin<TRACE>(sm);
+	} else {
+		finish<TRACE>(sm);
+	}
+}
+
+template <bool TRACE>
+__attribute__((noinline)) void read_byte(Machine *sm){
+	sm->transfer->rx[sm->received++] = sm->i2c->RXDATA;
+	if(sm->received < sm->transfer->rx_len){
+		sm->i2c->CMD = CMD_ACK;
+	} else {
+		sm->i2c->CMD = CMD_NACK;
+		finish<TRACE>(sm);
+	}
+}
+
+/* The switch ladders */
+template <bool TRACE>
+void ladder_ack(Machine *sm){
+	switch(sm->state){
+		case REQUEST_DEVICE:	set_state<TRACE>(sm, WRITE_DEVICE); write_next<TRACE>(sm); break;
+		case WRITE_DEVICE:		write_next<TRACE>(sm); break;
+		case WAIT_CONVERSION:	set_state<TRACE>(sm, READ_DEVICE); break;
+		case IDLE:
+		case READ_DEVICE:
+		case CLOSE:
+		default:				fault<TRACE>(sm); break;
+	}
+}
+
+template <bool TRACE>
+void ladder_nack(Machine *sm){
+	switch(sm->state){
+		case REQUEST_DEVICE:
+		case WRITE_DEVICE:
+		case WAIT_CONVERSION:	finish<TRACE>(sm); break;
+		case IDLE:
+		case READ_DEVICE:
+		case CLOSE:
+		default:				fault<TRACE>(sm); break;
+	}
+}
+
+template <bool TRACE>
+void ladder_rxdatav(Machine *sm){
+	switch(sm->state){
+		case WAIT_CONVERSION:	set_state<TRACE>(sm, READ_DEVICE);
+								/* fall through */
+		case READ_DEVICE:		read_byte<TRACE>(sm); break;
+		case IDLE:
+		case REQUEST_DEVICE:
+		case WRITE_DEVICE:
+		case CLOSE:
+		default:				fault<TRACE>(sm); break;
+	}
+}
+
+template <bool TRACE>
+void ladder_mstop(Machine *sm){
+	switch(sm->state){
+		case CLOSE:				next<TRACE>(sm); break;
+		case IDLE:
+		case REQUEST_DEVICE:
+		case WRITE_DEVICE:
+		case WAIT_CONVERSION:
+		case READ_DEVICE:
+		default:				fault<TRACE>(sm); break;
+	}
+}
+
+template <bool TRACE>
+__attribute__((noinline)) void ladder_irq(Machine *sm){
+	uint32_t int_flag = sm->i2c->IF & sm->i2c->IEN;
+	sm->i2c->IFC = int_flag;
+	trace<TRACE>(TRACE_IRQ_I2C0, int_flag);
+
+	if(int_flag & IF_FAULT)		{fault<TRACE>(sm); return;}
+	if(int_flag & IF_ACK)		{ladder_ack<TRACE>(sm);}
+	if(int_flag & IF_NACK)		{ladder_nack<TRACE>(sm);}
+	if(int_flag & IF_RXDATAV)	{ladder_rxdatav<TRACE>(sm);}
+	if(int_flag & IF_MSTOP)		{ladder_mstop<TRACE>(sm);}
+}
+
+/* fsm.h */
+constexpr uint8_t FSM_ILLEGAL	= 0;
+constexpr uint8_t FSM_STAY		= 0xFF;
+constexpr uint32_t FSM_TRACE_ILLEGAL = 0x0F;
+typedef void (*Action)(void *ctx);
+
+struct Transition {
+	uint8_t		action;
+	uint8_t		next;
+};
+
+struct Table {
+	const Transition	*transitions;
+	const Action		*actions;
+	uint8_t				states;
+	uint8_t				causes;
+	uint16_t			trace_id;
+};
+
+template <bool TRACE>
+inline void fsm_dispatch(Machine *fsm, uint32_t cause, void *ctx){
+	const Table *table = fsm->table;
+	uint32_t from = fsm->state;
+	Transition t = table->transitions[from * table->causes + cause];
+
+	if(t.action == FSM_ILLEGAL){
+		fsm->illegal++;
+		fsm->last_illegal = (from << 4) | cause;
+		trace<TRACE>(table->trace_id, (from << 8) | (cause << 4) | FSM_TRACE_ILLEGAL);
+	} else if(t.next != FSM_STAY){
+		fsm->state = t.next;
+		trace<TRACE>(table->trace_id, (from << 8) | (cause << 4) | t.next);
+	}
+	table->actions[t.action](ctx);
+}
+
+/* Actions of i2c_table, set_state() inside them is fsm_set() there */
+template <bool TRACE> void act_unexpected(void *ctx){ fault<TRACE>((Machine *)ctx); }
+template <bool TRACE> void act_write(void *ctx){ write_next<TRACE>((Machine *)ctx); }
+template <bool TRACE> void act_nacked(void *ctx){ finish<TRACE>((Machine *)ctx); }
+template <bool TRACE> void act_read(void *ctx){ read_byte<TRACE>((Machine *)ctx); }
+template <bool TRACE> void act_next(void *ctx){ next<TRACE>((Machine *)ctx); }
+void act_nop(void *){}
+
+enum {A_ILLEGAL, A_WRITE, A_NACKED, A_READ, A_NEXT, A_NOP, ACTIONS};
+
+template <bool TRACE>
+const Action table_actions[ACTIONS] = {act_unexpected<TRACE>, act_write<TRACE>, act_nacked<TRACE>,
+		act_read<TRACE>, act_next<TRACE>, act_nop};
+
+#define T(a, n)		{a, n}
+#define X			{A_ILLEGAL, FSM_STAY}
+const Transition transitions[STATES * CAUSES] = {
+	/*					ACK								NACK					RXDATAV						TXC	MSTOP */
+	/* IDLE */			X,								X,						X,							X,	X,
+	/* REQUEST */		T(A_WRITE, WRITE_DEVICE),		T(A_NACKED, FSM_STAY),	X,							X,	X,
+	/* WRITE */			T(A_WRITE, FSM_STAY),			T(A_NACKED, FSM_STAY),	X,							X,	X,
+	/* WAIT */			T(A_NOP, READ_DEVICE),			T(A_NACKED, FSM_STAY),	T(A_READ, READ_DEVICE),		X,	X,
+	/* READ */			X,								X,						T(A_READ, FSM_STAY),		X,	X,
+	/* CLOSE */			X,								X,						X,							X,	T(A_NEXT, FSM_STAY),
+};
+#undef T
+#undef X
+
+template <bool TRACE>
+const Table table = {transitions, table_actions<TRACE>, STATES, CAUSES, TRACE_I2C_STATE};
+
+template <bool TRACE>
+__attribute__((noinline)) void table_irq(Machine *sm){
+	uint32_t int_flag = sm->i2c->IF & sm->i2c->IEN;
+	sm->i2c->IFC = int_flag;
+	trace<TRACE>(TRACE_IRQ_I2C0, int_flag);
+
+	if(int_flag & IF_FAULT)		{fault<TRACE>(sm); return;}
+	if(int_flag & IF_ACK)		{fsm_dispatch<TRACE>(sm, CAUSE_ACK, sm);}
+	if(int_flag & IF_NACK)		{fsm_dispatch<TRACE>(sm, CAUSE_NACK, sm);}
+	if(int_flag & IF_RXDATAV)	{fsm_dispatch<TRACE>(sm, CAUSE_RXDATAV, sm);}
+	if(int_flag & IF_TXC)		{fsm_dispatch<TRACE>(sm, CAUSE_TXC, sm);}
+	if(int_flag & IF_MSTOP)		{fsm_dispatch<TRACE>(sm, CAUSE_MSTOP, sm);}
+}
+
+struct Result {
+	double		cycles;					// Median of the runs' means, per handler call
+	uint32_t	unexpected;				// Per run, 1 expected
+	bool		completed;				// Every transfer read both bytes and went back to IDLE
+};
+
+template <bool TRACE>
+Result run(void (*irq)(Machine *), const Table *tbl, uint32_t rounds, uint32_t runs){
+	static const uint8_t cmd = 0xE5;
+	static uint8_t rx[2];
+	static const uint32_t sequence[] = {IF_ACK, IF_ACK, IF_ACK, IF_RXDATAV, IF_RXDATAV, IF_MSTOP};
+	Regs regs = {};
+	Transfer transfer = {0x40, &cmd, 1, rx, 2};
+	Machine sm = {};
+	std::vector<double> means;
+	Result res = {0, 0, true};
+
+	regs.IEN = IF_ACK | IF_NACK | IF_RXDATAV | IF_MSTOP | IF_FAULT;
+	sm.i2c = &regs;
+	sm.transfer = &transfer;
+	sm.table = tbl;
+	for(uint32_t r = 0; r < runs; r++){
+		uint64_t cycles = 0, calls = 0;
+		sm.unexpected = 0;
+		sm.state = IDLE;
+		regs.IF = IF_ACK;
+		irq(&sm);								// Unexpected, recovered to IDLE
+		res.unexpected = sm.unexpected;
+		for(uint32_t k = 0; k < rounds; k++){
+			sm.sent = sm.received = 0;
+			set_state<TRACE>(&sm, REQUEST_DEVICE);		// i2c_begin()
+			regs.CMD = CMD_START;
+			regs.TXDATA = transfer.dev_addr << 1;
+			for(uint32_t flag : sequence){
+				regs.IF = flag;
+				regs.RXDATA = k;
+				uint64_t a = __rdtsc();
+				irq(&sm);
+				cycles += __rdtsc() - a;
+				calls++;
+			}
+			if(sm.state != IDLE || sm.received != 2) res.completed = false;
+		}
+		means.push_back((double)cycles / calls);
+	}
+	std::sort(means.begin(), means.end());
+	res.cycles = means[means.size() / 2];
+	return res;
+}
+
+}
+
+int main(int argc, char **argv){
+	uint32_t rounds = 200000;
+	uint32_t runs = 11;
+
+	for(int i = 1; i < argc; i++){
+		if(!std::strncmp(argv[i], "rounds=", 7) && std::atoi(argv[i] + 7) > 0){
+			rounds = std::atoi(argv[i] + 7);
+		} else if(!std::strncmp(argv[i], "runs=", 5) && std::atoi(argv[i] + 5) > 0){
+			runs = std::atoi(argv[i] + 5);
+		} else {
+			std::fprintf(stderr, "unknown or bad setting: %s\n", argv[i]);
+			return 2;
+		}
+	}
+
+	std::printf("%u runs of %u Si7021 reads, 6 interrupts each, median of the runs\n", runs, rounds);
+	std::printf("%-10s %8s %8s %8s %11s\n", "trace", "ladder", "table", "diff", "unexpected");
+	int status = 0;
+	for(bool on : {true, false}){
+		Result l = on ? run<true>(ladder_irq<true>, nullptr, rounds, runs)
+				: run<false>(ladder_irq<false>, nullptr, rounds, runs);
+		Result t = on ? run<true>(table_irq<true>, &table<true>, rounds, runs)
+				: run<false>(table_irq<false>, &table<false>, rounds, runs);
+		std::printf("%-10s %8.1f %8.1f %+8.1f %5u %5u\n", on ? "on" : "off", l.cycles, t.cycles,
+				t.cycles - l.cycles, l.unexpected, t.unexpected);
+		if(!l.completed || !t.completed || l.unexpected != 1 || t.unexpected != 1){
+			std::printf("transfers did not complete or the ACK in IDLE was missed\n");
+			status = 1;
+		}
+	}
+	return status;
+}
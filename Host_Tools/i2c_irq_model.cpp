@@ -0,0 +1,114 @@
+/**
+ * @file i2c_irq_model.cpp
+ * @author Kay Sho
+ * @date  10/16/2026
+ * @brief Interrupts and CPU time per I2C transfer, byte interrupts against LDMA
+ * @note The author's pronouns: (She/They)
+ *
+ * Build:	g++ -std=c++17 -O2 -o i2c_irq_model i2c_irq_model.cpp
+ * Use:		i2c_irq_model [core_mhz=19] [entry=24] [i2c_isr=70] [ldma_isr=50] [ldma_setup=90]
+ *
+ * Interrupts follow the rules of Source_Files/i2c.c:
+ *	bytes:	one ACK for each address and tx byte, one RXDATAV per rx byte, MSTOP
+ *	LDMA:	one TXC for all tx bytes, the LDMA done plus one RXDATAV for reads of
+ *		2 bytes or more, a single RXDATAV for 1 byte reads, MSTOP
+ * The counts match the firmware run against the SDK stubs. CPU time is an
+ * estimate, with cycle costs for interrupt entry and exit, each handler body,
+ * and starting an LDMA transfer, all overridable.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Costs {
+	double core_mhz		= 19;		// HFRCO
+	int entry			= 24;		// Cortex-M4 exception entry and return, no FP context
+	int i2c_isr			= 70;		// I2C0_IRQHandler and one state handler
+	int ldma_isr		= 50;		// LDMA_IRQHandler and i2c_dma_rx_done()
+	int ldma_setup		= 90;		// ldma_m2p() or ldma_p2m() from the I2C handler
+};
+
+struct Shape {
+	const char	*name;
+	int			tx;
+	int			rx;
+	int			count;				// Per Si7021 sample
+};
+
+struct Cost {
+	int		irqs = 0;
+	int		cycles = 0;
+};
+
+Cost bytes_mode(const Shape &s, const Costs &c){
+	Cost r;
+	int i2c = 1;										// MSTOP
+	if(s.tx || !s.rx) i2c += 1 + s.tx;					// Write address and tx ACKs
+	if(s.rx) i2c += 1 + s.rx;							// Read address ACK, RXDATAV
+	r.irqs = i2c;
+	r.cycles = i2c * (c.entry + c.i2c_isr);
+	return r;
+}
+
+Cost dma_mode(const Shape &s, const Costs &c){
+	Cost r;
+	int i2c = 1, ldma = 0, setups = 0;					// MSTOP
+	if(s.tx){ i2c++; setups++; }						// TXC
+	else if(!s.rx) i2c++;								// Address only, its ACK
+	if(s.rx >= 2){ ldma++; i2c++; setups++; }			// LDMA done, last RXDATAV
+	else if(s.rx == 1) i2c++;
+	r.irqs = i2c + ldma;
+	r.cycles = i2c * (c.entry + c.i2c_isr) + ldma * (c.entry + c.ldma_isr) + setups * c.ldma_setup;
+	return r;
+}
+
+bool set(const std::string &key, int value, Costs &c){
+	if(key == "core_mhz")	{ c.core_mhz = value; return value > 0; }
+	if(key == "entry")		{ c.entry = value; return true; }
+	if(key == "i2c_isr")	{ c.i2c_isr = value; return true; }
+	if(key == "ldma_isr")	{ c.ldma_isr = value; return true; }
+	if(key == "ldma_setup")	{ c.ldma_setup = value; return true; }
+	return false;
+}
+
+}
+
+int main(int argc, char **argv){
+	Costs c;
+	for(int i = 1; i < argc; i++){
+		const char *eq = std::strchr(argv[i], '=');
+		if(!eq || !set(std::string(argv[i], eq - argv[i]), std::atoi(eq + 1), c)){
+			std::fprintf(stderr, "unknown or bad setting: %s\n", argv[i]);
+			return 2;
+		}
+	}
+
+	std::vector<Shape> shapes = {
+		{"Si7021 measure command",		1, 0,  1},
+		{"Si7021 RH + checksum",		0, 3,  1},
+		{"Si7021 0xE0 write-read",		1, 2,  1},
+		{"Si7021 user register read",	1, 1,  0},
+		{"16 byte register dump",		1, 16, 0},
+		{"32 byte block write",			32, 0, 0},
+	};
+
+	std::printf("%-28s %6s %6s %10s %10s\n", "transfer", "bytes", "dma", "bytes us", "dma us");
+	Cost sample_b, sample_d;
+	for(const Shape &s : shapes){
+		Cost b = bytes_mode(s, c), d = dma_mode(s, c);
+		std::printf("%-28s %6d %6d %10.2f %10.2f\n", s.name, b.irqs, d.irqs,
+				b.cycles / c.core_mhz, d.cycles / c.core_mhz);
+		sample_b.irqs += s.count * b.irqs;
+		sample_b.cycles += s.count * b.cycles;
+		sample_d.irqs += s.count * d.irqs;
+		sample_d.cycles += s.count * d.cycles;
+	}
+	std::printf("%-28s %6d %6d %10.2f %10.2f\n", "per Si7021 RH+T sample", sample_b.irqs, sample_d.irqs,
+			sample_b.cycles / c.core_mhz, sample_d.cycles / c.core_mhz);
+	return 0;
+}
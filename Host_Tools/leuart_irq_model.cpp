@@ -0,0 +1,135 @@
+/**
+ * @file leuart_irq_model.cpp
+ * @author Kay Sho
+ * @date  10/16/2026
+ * @brief Core wakeups and EM2 residency per BLE message on LEUART0, character
+ * interrupts against LDMA
+ * @note The author's pronouns: (She/They)
+ *
+ * Build:	g++ -std=c++17 -O2 -o leuart_irq_model leuart_irq_model.cpp
+ * Use:		leuart_irq_model [baud=9600] [core_mhz=19] [entry=24] [leuart_isr=60]
+ *			[ldma_setup=90] [wake_us=10] [dma_wake_us=10] [period_ms=2700]
+ *
+ * Interrupts follow the rules of Source_Files/leuart.c:
+ *	bytes:	TX, one TXBL per character and TXC. RX, STARTF and one RXDATAV per
+ *		character of the frame, SIGF comes with the last one.
+ *	LDMA:	TX, TXC only. RX, SIGF only. The TX transfer is started from the
+ *		handler that sends the message, the next RX transfer from SIGF.
+ * The counts match the firmware run against the SDK stubs.
+ *
+ * The LDMA does not keep the chip in EM2 for free: each TXBL or RXDATAV
+ * request still leaves EM2 for dma_wake_us to restart the HF clocks, with the
+ * core asleep. Those exits are counted apart from the core wakeups. EM2
+ * residency is the share of a window not spent out of EM2, over the
+ * message's own time on the wire and over one sample period with one sensor
+ * line sent.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Costs {
+	double baud			= 9600;		// HM10_BAUDRATE, 10 bits per character
+	double core_mhz		= 19;		// HFRCO
+	int entry			= 24;		// Cortex-M4 exception entry and return, no FP context
+	int leuart_isr		= 60;		// LEUART0_IRQHandler and one action
+	int ldma_setup		= 90;		// ldma_m2p_blocks() or ldma_p2m()
+	double wake_us		= 10;		// EM2 to EM0 and back, core running
+	double dma_wake_us	= 10;		// EM2 exit for one LDMA request, core asleep
+	double period_ms	= 2700;		// SAMPLE_PER_MS
+};
+
+struct Message {
+	const char	*name;
+	const char	*text;
+	bool		rx;
+};
+
+struct Cost {
+	int		wakes = 0;				// Core wakeups
+	int		dma_exits = 0;			// EM2 exits for the LDMA alone
+	double	out_us = 0;				// Time out of EM2
+};
+
+Cost bytes_mode(const Message &m, const Costs &c){
+	Cost r;
+	int n = std::strlen(m.text);
+
+	r.wakes = n + 1;								// TXBL each and TXC, or STARTF and RXDATAV each
+	r.out_us = r.wakes * (c.wake_us + (c.entry + c.leuart_isr) / c.core_mhz);
+	return r;
+}
+
+Cost dma_mode(const Message &m, const Costs &c){
+	Cost r;
+	int n = std::strlen(m.text);
+
+	r.wakes = 1;									// TXC, or SIGF
+	r.dma_exits = n;
+	r.out_us = c.wake_us + (c.entry + c.leuart_isr + c.ldma_setup) / c.core_mhz
+			+ r.dma_exits * c.dma_wake_us;
+	return r;
+}
+
+double air_us(const Message &m, const Costs &c){
+	return std::strlen(m.text) * 10 * 1e6 / c.baud;
+}
+
+bool set(const std::string &key, double value, Costs &c){
+	if(key == "baud")			{ c.baud = value; return value > 0; }
+	if(key == "core_mhz")		{ c.core_mhz = value; return value > 0; }
+	if(key == "entry")			{ c.entry = value; return true; }
+	if(key == "leuart_isr")		{ c.leuart_isr = value; return true; }
+	if(key == "ldma_setup")		{ c.ldma_setup = value; return true; }
+	if(key == "wake_us")		{ c.wake_us = value; return true; }
+	if(key == "dma_wake_us")	{ c.dma_wake_us = value; return true; }
+	if(key == "period_ms")		{ c.period_ms = value; return value > 0; }
+	return false;
+}
+
+}
+
+int main(int argc, char **argv){
+	Costs c;
+	for(int i = 1; i < argc; i++){
+		const char *eq = std::strchr(argv[i], '=');
+		if(!eq || !set(std::string(argv[i], eq - argv[i]), std::atof(eq + 1), c)){
+			std::fprintf(stderr, "unknown or bad setting: %s\n", argv[i]);
+			return 2;
+		}
+	}
+
+	std::vector<Message> messages = {
+		{"sensor line",			"Si7021 Temp = 23.2 C, RH = 43.8 %\n",	false},
+		{"command reply",		"\nTemperature converting to F\n",		false},
+		{"unknown command",		"\nUnknown Command\n",					false},
+		{"boot banner line",	"\nPlease use She or They to \nrefer to them!\n", false},
+		{"#tempf!",				"#tempf!",								true},
+		{"#energy!",			"#energy!",								true},
+		{"#res=12!",			"#res=12!",								true},
+	};
+
+	std::printf("%-20s %5s %12s %10s %19s\n", "message", "chars", "wakes b/dma", "LDMA exits", "EM2 on wire b/dma");
+	for(const Message &m : messages){
+		Cost b = bytes_mode(m, c), d = dma_mode(m, c);
+		double air = air_us(m, c);
+		std::printf("%-3s %-16s %5zu %6d %5d %10d %9.2f%% %8.2f%%\n", m.rx ? "rx" : "tx", m.name,
+				std::strlen(m.text), b.wakes, d.wakes, d.dma_exits,
+				100 * (1 - b.out_us / air), 100 * (1 - d.out_us / air));
+	}
+
+	// One sensor line per sample period, nothing else on the LEUART
+	Cost b = bytes_mode(messages[0], c), d = dma_mode(messages[0], c);
+	double period_us = c.period_ms * 1000;
+	std::printf("per %.0f ms period: core wakes %d / %d, EM2 residency %.4f%% / %.4f%%, "
+			"core awake %.1f / %.1f us\n", c.period_ms, b.wakes, d.wakes,
+			100 * (1 - b.out_us / period_us), 100 * (1 - d.out_us / period_us),
+			b.wakes * (c.entry + c.leuart_isr) / c.core_mhz,
+			(c.entry + c.leuart_isr + c.ldma_setup) / c.core_mhz);
+	return 0;
+}
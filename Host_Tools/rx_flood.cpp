@@ -0,0 +1,277 @@
+/**
+ * @file rx_flood.cpp
+ * @author Kay Sho
+ * @date  10/16/2026
+ * @brief Back to back commands at line rate into the old single receive
+ * buffer and into the frame ring the LEUART and USART drivers now use
+ * @note The author's pronouns: (She/They)
+ *
+ * Build:	gcc -O2 -I../Header_Files -c ../Source_Files/frame_ring.c
+ *		g++ -std=c++17 -O2 -I../Header_Files rx_flood.cpp frame_ring.o -o rx_flood
+ * Use:		rx_flood [frames=20000] [latency_us=300] [stall_ms=40] [every_ms=500]
+ *
+ * Commands of 1 to 20 characters, and now and then one longer than the
+ * drivers keep, arrive with 0 to 3 idle characters between them, at 10 bits
+ * per character. The task reads what arrived latency_us after the signal
+ * frame, except during a stall of stall_ms every every_ms, standing in for
+ * the scheduler running something long.
+ *
+ * The old driver received into one buffer, restarted at every start frame,
+ * and the coalesced rx done event read it once. A command that was not read
+ * before the next start frame is lost or read half overwritten, and nothing
+ * counts it. The ring reserves room at the start frame and commits at the
+ * signal frame, with the sizes of leuart.c and usart.h. Every command has
+ * to come out intact and in order, or be counted as overflow or full.
+ *
+ * Exits 1 if the ring loses a command without counting it.
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "frame_ring.h"
+
+namespace {
+
+constexpr uint32_t RING_SIZE	= 256;		// LEUART_RX_RING_SIZE, USART_RX_RING_SIZE
+constexpr uint32_t FRAME_MAX	= 49;		// LEUART_RX_FRAME_MAX, USART_RX_FRAME_MAX
+constexpr uint32_t OLD_BUF		= 64;		// The old RXbuf
+
+struct Settings {
+	uint32_t	frames		= 20000;
+	double		latency_us	= 300;
+	double		stall_ms	= 40;
+	double		every_ms	= 500;
+};
+
+struct Result {
+	uint32_t	intact		= 0;
+	uint32_t	corrupt		= 0;		// Reads that were not a command that was sent
+	uint32_t	lost		= 0;		// Not read intact and not counted
+	uint32_t	overflow	= 0;
+	uint32_t	full		= 0;
+};
+
+struct Stream {
+	std::vector<std::string>	text;		// "#...!" as sent
+	std::vector<bool>			too_long;
+};
+
+Stream make_stream(uint32_t frames){
+	Stream s;
+	uint32_t seed = 2370;
+	for(uint32_t k = 0; k < frames; k++){
+		seed = seed * 1103515245u + 12345u;
+		uint32_t len = 1 + (seed >> 16) % 20;
+		bool too_long = (k % 97) == 41;
+		if(too_long){
+			len = FRAME_MAX + 10;
+		}
+		std::string t = "#";
+		for(uint32_t i = 0; i < len; i++){
+			t += (char)('a' + (k + i) % 26);
+		}
+		s.text.push_back(t + "!");
+		s.too_long.push_back(too_long);
+	}
+	return s;
+}
+
+/* Commands short enough to keep */
+uint32_t framed(const Stream &s){
+	uint32_t n = 0;
+	for(bool l : s.too_long){
+		n += !l;
+	}
+	return n;
+}
+
+/* The consumer can run at [t_us] */
+bool stalled(double t_us, const Settings &set){
+	double period_us = set.every_ms * 1000;
+	return set.stall_ms > 0 && period_us > 0 && std::fmod(t_us, period_us) < set.stall_ms * 1000;
+}
+
+/* Walks the characters on the wire, calling the receiver at each one and the consumer once due */
+template <typename Rx, typename Read>
+void run(const Stream &s, double baud, const Settings &set, Rx rx, Read read){
+	double char_us = 10 * 1e6 / baud;
+	double t = 0;
+	double due = -1;					// Signal frame time plus latency, -1 nothing pending
+	uint32_t seed = 12;
+
+	for(size_t k = 0; k < s.text.size(); k++){
+		seed = seed * 1103515245u + 12345u;
+		uint32_t idle = (seed >> 16) % 4;
+		for(uint32_t i = 0; i < idle + s.text[k].size(); i++){
+			t += char_us;
+			if(due >= 0 && t >= due && !stalled(t, set)){
+				read();
+				due = -1;
+			}
+			if(i >= idle && rx(k, s.text[k][i - idle]) && due < 0){
+				due = t + set.latency_us;
+			}
+		}
+	}
+	read();
+}
+
+Result old_buffer(const Stream &s, double baud, const Settings &set){
+	Result r;
+	char buf[OLD_BUF + 1] = {0};
+	uint32_t idx = 0;
+	bool overflow = false;
+	size_t next = 0;				// Oldest command not yet read or dropped
+
+	auto rx = [&](size_t, char c){
+		if(c == '#'){
+			idx = 0;
+			overflow = false;
+		}
+		if(idx < FRAME_MAX){
+			buf[idx++] = c;
+		} else {
+			overflow = true;
+		}
+		if(c != '!'){
+			return false;
+		}
+		if(overflow){
+			r.overflow++;
+			return false;
+		}
+		buf[idx] = 0;
+		return true;
+	};
+	auto read = [&](){
+		size_t k = next;
+		while(k < s.text.size() && s.text[k] != buf){
+			k++;
+		}
+		if(k == s.text.size()){
+			r.corrupt++;
+			return;
+		}
+		r.intact++;
+		next = k + 1;
+	};
+	run(s, baud, set, rx, read);
+	r.lost = framed(s) - r.intact;
+	return r;
+}
+
+Result ring(const Stream &s, double baud, const Settings &set){
+	Result r;
+	static char storage[RING_SIZE];
+	static char discard[FRAME_MAX + 1];
+	FRAME_RING ring;
+	char *frame = nullptr;
+	bool in_ring = false;
+	uint32_t idx = 0;
+	bool overflow = false;
+	size_t next = 0;
+
+	frame_ring_init(&ring, storage, RING_SIZE, FRAME_MAX);
+	auto rx = [&](size_t, char c){
+		if(c == '#'){
+			frame = frame_ring_reserve(&ring);
+			in_ring = frame != nullptr;
+			if(!in_ring){
+				frame = discard;
+			}
+			idx = 0;
+			overflow = false;
+		}
+		if(idx < FRAME_MAX){
+			frame[idx++] = c;
+		} else {
+			overflow = true;
+		}
+		if(c != '!'){
+			return false;
+		}
+		if(overflow){
+			ring.overflow++;
+			return false;
+		}
+		if(!in_ring){
+			ring.full++;
+			return false;
+		}
+		frame_ring_commit(&ring, idx);
+		return true;
+	};
+	auto read = [&](){
+		const char *f;
+		uint32_t len;
+		while((f = frame_ring_peek(&ring, &len)) != nullptr){
+			size_t k = next;
+			while(k < s.text.size() && (s.too_long[k] || s.text[k] != f)){
+				k++;
+			}
+			if(k == s.text.size() || len != std::strlen(f)){
+				r.corrupt++;
+			} else {
+				r.intact++;
+				next = k + 1;
+			}
+			frame_ring_release(&ring);
+		}
+	};
+	run(s, baud, set, rx, read);
+
+	FRAME_RING_STATS stats;
+	frame_ring_stats(&ring, &stats);
+	r.overflow = stats.overflow;
+	r.full = stats.full;
+	r.lost = framed(s) - r.intact - r.full;
+	return r;
+}
+
+}
+
+int main(int argc, char **argv){
+	Settings set;
+
+	for(int i = 1; i < argc; i++){
+		if(!std::strncmp(argv[i], "frames=", 7) && std::atoi(argv[i] + 7) > 0){
+			set.frames = std::atoi(argv[i] + 7);
+		} else if(!std::strncmp(argv[i], "latency_us=", 11)){
+			set.latency_us = std::atof(argv[i] + 11);
+		} else if(!std::strncmp(argv[i], "stall_ms=", 9)){
+			set.stall_ms = std::atof(argv[i] + 9);
+		} else if(!std::strncmp(argv[i], "every_ms=", 9)){
+			set.every_ms = std::atof(argv[i] + 9);
+		} else {
+			std::fprintf(stderr, "unknown or bad setting: %s\n", argv[i]);
+			return 2;
+		}
+	}
+
+	Stream s = make_stream(set.frames);
+	uint32_t too_long = set.frames - framed(s);
+	std::printf("%u commands, %u too long, latency %.0f us, %.0f ms stall every %.0f ms\n",
+			set.frames, too_long, set.latency_us, set.stall_ms, set.every_ms);
+	std::printf("%-8s %-7s %8s %8s %9s %8s %8s\n", "baud", "rx", "intact", "corrupt",
+			"overflow", "full", "lost");
+
+	int status = 0;
+	for(double baud : {9600.0, 57600.0, 115200.0}){
+		Result o = old_buffer(s, baud, set);
+		Result n = ring(s, baud, set);
+		std::printf("%-8.0f %-7s %8u %8u %9u %8u %8u\n", baud, "buffer", o.intact, o.corrupt,
+				o.overflow, o.full, o.lost);
+		std::printf("%-8.0f %-7s %8u %8u %9u %8u %8u\n", baud, "ring", n.intact, n.corrupt,
+				n.overflow, n.full, n.lost);
+		if(n.corrupt || n.lost || n.overflow != too_long){
+			status = 1;
+		}
+	}
+	return status;
+}
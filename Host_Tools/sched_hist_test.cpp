@@ -0,0 +1,230 @@
+/**
+ * @file sched_hist_test.cpp
+ * @author Kay Sho
+ * @date  10/17/2026
+ * @brief Bucket placement, saturation and the text dump of the scheduler's
+ * latency and execution time histograms
+ * @note The author's pronouns: (She/They)
+ *
+ * Build:	g++ -std=c++17 -O2 -o sched_hist_test sched_hist_test.cpp
+ * Use:		sched_hist_test [samples=1000000] [seed=1]
+ *
+ * hist_add() and stats_line() follow scheduler_hist_add() and
+ * scheduler_stats_line() of Source_Files/scheduler.c, which needs the SDK
+ * headers to build, keep them in step. The constants are the ones of
+ * scheduler.h. Checked:
+ *	- every power of two edge, one below and one above, lands in the bucket
+ *	  scheduler.h documents, worked out here with a shift loop, not __CLZ
+ *	- random samples across the whole 32 bit range give the same histogram
+ *	  as that reference
+ *	- a bucket stops at SCHED_HIST_MAX and never wraps to 0
+ *	- the dump, at the smallest line size allowed, the BLE string size and a
+ *	  large one, gives back every non-empty bucket exactly once, in order,
+ *	  every line newline ended and shorter than its size, histograms that do
+ *	  not fit carried on the next line under the same E<id> l|x tag
+ *
+ * Exits 1 if any check fails.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <random>
+#include <string>
+
+namespace {
+
+constexpr uint32_t STATS_EVENTS	= 16;		// SCHED_STATS_EVENTS
+constexpr uint32_t BUCKETS		= 20;		// SCHED_HIST_BUCKETS
+constexpr uint32_t SHIFT		= 6;		// SCHED_HIST_SHIFT
+constexpr uint32_t HIST_MAX		= 0xFFFF;	// SCHED_HIST_MAX
+
+struct Stats {
+	uint16_t	latency[BUCKETS];
+	uint16_t	exec[BUCKETS];
+};
+
+Stats event_stats[STATS_EVENTS];
+uint32_t failures;
+
+void fail(const char *what, uint32_t a, uint32_t b){
+	if(failures++ < 10){
+		std::printf("FAIL %s: %u %u\n", what, a, b);
+	}
+}
+
+/* scheduler_hist_add() */
+void hist_add(uint16_t *hist, uint32_t cycles){
+	uint32_t bucket = 31 - __builtin_clz(cycles | 1);
+
+	bucket = bucket > SHIFT ? bucket - SHIFT : 0;
+	if(bucket >= BUCKETS) bucket = BUCKETS - 1;
+	if(hist[bucket] < HIST_MAX) hist[bucket]++;
+}
+
+/* scheduler.h: bucket b >= 1 counts 2^(b+6) to 2^(b+7) - 1, bucket 0 below
+ * that, the last bucket everything above */
+uint32_t reference_bucket(uint32_t cycles){
+	uint32_t b = 0;
+	while(b < BUCKETS - 1 && cycles >= (1u << (b + SHIFT + 1))){
+		b++;
+	}
+	return b;
+}
+
+/* scheduler_stats_line() */
+bool stats_line(uint32_t *cursor, char *line, uint32_t size){
+	while(*cursor < STATS_EVENTS * 2 * BUCKETS){
+		uint32_t row = *cursor / BUCKETS;
+		uint32_t bucket = *cursor % BUCKETS;
+		uint32_t event = row / 2;
+		bool exec = row % 2;
+		const uint16_t *hist = exec ? event_stats[event].exec : event_stats[event].latency;
+		uint32_t len = snprintf(line, size, "E%u %c", (unsigned)event, exec ? 'x' : 'l');
+		bool any = false;
+
+		for(; bucket < BUCKETS; bucket++){
+			char pair[16];
+			uint32_t n;
+			if(!hist[bucket]) continue;
+			n = snprintf(pair, sizeof(pair), " %u:%u", (unsigned)bucket, (unsigned)hist[bucket]);
+			if(len + n + 2 > size) break;
+			memcpy(&line[len], pair, n);
+			len += n;
+			any = true;
+		}
+		*cursor = (bucket < BUCKETS) ? row * BUCKETS + bucket : (row + 1) * BUCKETS;
+		if(any){
+			line[len++] = '\n';
+			line[len] = 0;
+			return true;
+		}
+	}
+	return false;
+}
+
+void check_edges(){
+	uint16_t hist[BUCKETS];
+
+	for(uint32_t bit = 0; bit < 32; bit++){
+		for(uint32_t cycles : {(1u << bit) - 1, 1u << bit, (1u << bit) + 1}){
+			std::memset(hist, 0, sizeof(hist));
+			hist_add(hist, cycles);
+			uint32_t want = reference_bucket(cycles);
+			if(hist[want] != 1) fail("edge bucket", cycles, want);
+		}
+	}
+	std::memset(hist, 0, sizeof(hist));
+	hist_add(hist, 0xFFFFFFFF);
+	if(hist[BUCKETS - 1] != 1) fail("top bucket", 0xFFFFFFFF, BUCKETS - 1);
+}
+
+void check_random(uint32_t samples, std::mt19937 &rng){
+	uint16_t hist[BUCKETS] = {};
+	uint32_t want[BUCKETS] = {};
+
+	for(uint32_t i = 0; i < samples; i++){
+		uint32_t cycles = rng() >> (rng() % 32);	// Spread over every bucket
+		hist_add(hist, cycles);
+		want[reference_bucket(cycles)]++;
+	}
+	for(uint32_t b = 0; b < BUCKETS; b++){
+		uint32_t expect = want[b] < HIST_MAX ? want[b] : HIST_MAX;
+		if(hist[b] != expect) fail("random bucket", b, hist[b]);
+	}
+}
+
+void check_saturation(){
+	uint16_t hist[BUCKETS] = {};
+
+	for(uint32_t i = 0; i < HIST_MAX + 1000; i++){
+		hist_add(hist, 200);
+		if(hist[1] == 0) fail("wrapped", i, 0);
+	}
+	if(hist[1] != HIST_MAX) fail("saturation", hist[1], HIST_MAX);
+}
+
+/* Fills event_stats, some rows empty, some buckets near the limit so the
+ * pairs are long, and dumps them back */
+void check_dump(std::mt19937 &rng){
+	for(uint32_t size : {24u, 40u, 256u}){
+		std::memset(event_stats, 0, sizeof(event_stats));
+		for(uint32_t e = 0; e < STATS_EVENTS; e++){
+			for(uint16_t *hist : {event_stats[e].latency, event_stats[e].exec}){
+				if(rng() % 4 == 0) continue;
+				for(uint32_t b = 0; b < BUCKETS; b++){
+					if(rng() % 2) hist[b] = 1 + rng() % HIST_MAX;
+				}
+			}
+		}
+
+		Stats back[STATS_EVENTS] = {};
+		uint32_t cursor = 0, lines = 0;
+		char line[256];
+		uint32_t last_row = 0, last_bucket = 0;
+		bool first = true;
+		std::memset(line, 0x55, sizeof(line));
+		while(stats_line(&cursor, line, size)){
+			lines++;
+			uint32_t len = std::strlen(line);
+			if(len + 1 > size || line[len - 1] != '\n') fail("line length", size, len);
+
+			unsigned event;
+			char kind;
+			int used;
+			if(std::sscanf(line, "E%u %c%n", &event, &kind, &used) != 2 || event >= STATS_EVENTS
+					|| (kind != 'l' && kind != 'x')){
+				fail("line tag", size, lines);
+				continue;
+			}
+			uint16_t *hist = kind == 'x' ? back[event].exec : back[event].latency;
+			uint32_t row = event * 2 + (kind == 'x');
+			const char *p = line + used;
+			unsigned bucket, count;
+			int n;
+			if(std::sscanf(p, " %u:%u%n", &bucket, &count, &n) != 2) fail("empty line", size, lines);
+			while(std::sscanf(p, " %u:%u%n", &bucket, &count, &n) == 2){
+				p += n;
+				if(bucket >= BUCKETS || hist[bucket]) fail("bucket twice", row, bucket);
+				else hist[bucket] = count;
+				if(!first && (row < last_row || (row == last_row && bucket <= last_bucket))){
+					fail("out of order", row, bucket);
+				}
+				last_row = row;
+				last_bucket = bucket;
+				first = false;
+			}
+			if(std::strcmp(p, "\n")) fail("trailing text", size, lines);
+		}
+		if(std::memcmp(back, event_stats, sizeof(back))) fail("dump differs", size, lines);
+		std::printf("dump, line size %3u: %3u lines\n", size, lines);
+	}
+}
+
+}
+
+int main(int argc, char **argv){
+	uint32_t samples = 1000000;
+	uint32_t seed = 1;
+
+	for(int i = 1; i < argc; i++){
+		if(!std::strncmp(argv[i], "samples=", 8) && std::atoi(argv[i] + 8) > 0){
+			samples = std::atoi(argv[i] + 8);
+		} else if(!std::strncmp(argv[i], "seed=", 5)){
+			seed = std::atoi(argv[i] + 5);
+		} else {
+			std::fprintf(stderr, "unknown or bad setting: %s\n", argv[i]);
+			return 2;
+		}
+	}
+
+	std::mt19937 rng(seed);
+	check_edges();
+	check_random(samples, rng);
+	check_saturation();
+	check_dump(rng);
+	std::printf("%u samples, %u failures\n", samples, failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,197 @@
+/**
+ * @file scheduler_bench.cpp
+ * @author Kay Sho
+ * @date  10/16/2026
+ * @brief Cost of one main loop pass through the scheduler, table dispatch
+ * against the if-chain main.c had
+ * @note The author's pronouns: (She/They)
+ *
+ * Build:	g++ -std=c++17 -O2 -o scheduler_bench scheduler_bench.cpp
+ * Use:		scheduler_bench [rounds=2000000]
+ *
+ * The table dispatch follows scheduler_dispatch() and scheduler_run_level()
+ * of Source_Files/scheduler.c: one atomic fetch-and-clear per pending word
+ * and priority, then one __CLZ and one table call per pending event, with
+ * the round-robin start point. The source rings are left out, they cost the
+ * same in both. The chain is the one main.c had: one read of the volatile
+ * pending word and one branch per event that exists, pending or not, and
+ * each handler clearing its own bit.
+ *
+ * Each row posts [pending] events out of [events] registered, spread over
+ * the four priorities, and runs one pass. The pass and the posts are timed
+ * apart, in ns: on the host every table post and snapshot word is a locked
+ * instruction, on the Cortex-M4 an LDREX/STREX pair of a few cycles, and the
+ * chain's posts were made inside a critical section there. Times are host
+ * times, the reads per pass are what carry over to the Cortex-M4.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+
+namespace {
+
+constexpr uint32_t MAX_EVENTS	= 64;			// SCHEDULER_MAX_EVENTS
+constexpr uint32_t WORD_BITS	= 32;
+constexpr uint32_t WORDS		= MAX_EVENTS / WORD_BITS;
+constexpr uint32_t PRIORITIES	= 4;			// SCHEDULER_PRIORITIES
+constexpr uint32_t MSB			= 0x80000000;
+
+volatile uint32_t sink;						// Keeps the handlers from being optimized out
+uint32_t reads;								// Pending word reads made by the pass
+
+struct Entry {
+	void		(*handler)(uint32_t payload);
+	uint8_t		priority;
+};
+
+void handler(uint32_t payload){
+	sink = sink + payload + 1;
+}
+
+/* scheduler.c */
+struct Table {
+	std::atomic<uint32_t>	scheduled[PRIORITIES][WORDS];
+	Entry					table[MAX_EVENTS];
+	uint32_t				rr_next[PRIORITIES];
+
+	void post(uint32_t event){
+		scheduled[table[event].priority][event / WORD_BITS].fetch_or(MSB >> (event % WORD_BITS));
+	}
+
+	void run_level(uint32_t priority, uint32_t *snapshot){
+		uint32_t start = rr_next[priority];
+		uint32_t start_word = start / WORD_BITS;
+		uint32_t head_mask = 0xFFFFFFFF >> (start % WORD_BITS);
+
+		for(uint32_t i = 0; i <= WORDS; i++){
+			uint32_t word = (start_word + i) % WORDS;
+			uint32_t bits = snapshot[word];
+			if(i == 0) bits &= head_mask;
+			else if(i == WORDS) bits &= ~head_mask;
+
+			while(bits){
+				uint32_t bit = __builtin_clz(bits);
+				uint32_t event = word * WORD_BITS + bit;
+				bits &= ~(MSB >> bit);
+				rr_next[priority] = (event + 1) % MAX_EVENTS;
+				table[event].handler(0);
+			}
+		}
+	}
+
+	void clear(){
+		for(uint32_t p = 0; p < PRIORITIES; p++){
+			for(uint32_t w = 0; w < WORDS; w++){
+				scheduled[p][w].store(0, std::memory_order_relaxed);
+			}
+		}
+	}
+
+	void dispatch(){
+		uint32_t snapshot[PRIORITIES][WORDS];
+
+		for(uint32_t p = 0; p < PRIORITIES; p++){
+			for(uint32_t w = 0; w < WORDS; w++){
+				snapshot[p][w] = scheduled[p][w].exchange(0);
+				reads++;
+			}
+		}
+		for(uint32_t p = 0; p < PRIORITIES; p++){
+			run_level(p, snapshot[p]);
+		}
+	}
+};
+
+/* main.c before the table, grown to [events] */
+struct Chain {
+	volatile uint64_t	scheduled;
+	uint32_t			events;
+
+	void post(uint32_t event){
+		scheduled = scheduled | (1ull << event);
+	}
+
+	void clear(){
+		scheduled = 0;
+	}
+
+	void dispatch(){
+		for(uint32_t e = 0; e < events; e++){
+			reads++;
+			if(scheduled & (1ull << e)){
+				scheduled = scheduled & ~(1ull << e);
+				handler(0);
+			}
+		}
+	}
+};
+
+/* Posts alone, cleared without running anything, then posts and a dispatch
+ * pass. The difference is the pass. */
+template <typename S>
+void time_pass(S &s, uint32_t events, uint32_t pending, uint32_t rounds, double *post_ns,
+		double *pass_ns, uint32_t *reads_per_pass){
+	uint32_t stride = events / pending;
+
+	auto t0 = std::chrono::steady_clock::now();
+	for(uint32_t r = 0; r < rounds; r++){
+		for(uint32_t k = 0; k < pending; k++){
+			s.post((k * stride + r) % events);
+		}
+		s.clear();
+	}
+	auto t1 = std::chrono::steady_clock::now();
+	reads = 0;
+	for(uint32_t r = 0; r < rounds; r++){
+		for(uint32_t k = 0; k < pending; k++){
+			s.post((k * stride + r) % events);
+		}
+		s.dispatch();
+	}
+	auto t2 = std::chrono::steady_clock::now();
+	*reads_per_pass = reads / rounds;
+	*post_ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / rounds;
+	*pass_ns = std::chrono::duration<double, std::nano>(t2 - t1).count() / rounds - *post_ns;
+}
+
+}
+
+int main(int argc, char **argv){
+	uint32_t rounds = 2000000;
+
+	for(int i = 1; i < argc; i++){
+		if(!std::strncmp(argv[i], "rounds=", 7) && std::atoi(argv[i] + 7) > 0){
+			rounds = std::atoi(argv[i] + 7);
+		} else {
+			std::fprintf(stderr, "unknown or bad setting: %s\n", argv[i]);
+			return 2;
+		}
+	}
+
+	static Table table;
+	static Chain chain;
+	for(uint32_t e = 0; e < MAX_EVENTS; e++){
+		table.table[e] = {handler, (uint8_t)(e % PRIORITIES)};
+	}
+
+	std::printf("%u rounds, post and one dispatch pass per round\n", rounds);
+	std::printf("%7s %8s | %8s %8s %6s | %8s %8s %6s\n", "events", "pending", "table", "post",
+			"reads", "chain", "post", "reads");
+	for(uint32_t events : {7u, 16u, 32u, 64u}){
+		for(uint32_t pending : {1u, 4u, events}){
+			double table_post, table_pass, chain_post, chain_pass;
+			uint32_t table_reads, chain_reads;
+			chain.events = events;
+			time_pass(table, events, pending, rounds, &table_post, &table_pass, &table_reads);
+			time_pass(chain, events, pending, rounds, &chain_post, &chain_pass, &chain_reads);
+			std::printf("%7u %8u | %8.1f %8.1f %6u | %8.1f %8.1f %6u\n", events, pending,
+					table_pass, table_post, table_reads, chain_pass, chain_post, chain_reads);
+		}
+	}
+	return 0;
+}
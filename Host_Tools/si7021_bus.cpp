@@ -0,0 +1,184 @@
+/**
+ * @file si7021_bus.cpp
+ * @author Kay Sho
+ * @date  10/16/2026
+ * @brief Si7021 model that compares I2C bus time of the Si7021 read strategies
+ * @note The author's pronouns: (She/They)
+ *
+ * Build:	gcc -O2 -I../Header_Files -c ../Source_Files/crc8.c
+ *		g++ -std=c++17 -O2 -I../Header_Files si7021_bus.cpp crc8.o -o si7021_bus
+ * Use:		si7021_bus [max]
+ *
+ * The model answers the same transfers si7021.c queues: a command write, then
+ * a read address that is NACKed until the conversion ends, then the data and
+ * checksum. Bytes are checked with crc8() from Source_Files/crc8.c. Bus time
+ * counts bit times at the driver's 392157 Hz plus a fixed interrupt service
+ * gap per byte, from the first start to the last stop. The driver keeps the
+ * bus between polls, so a polled conversion holds the bus for its full length.
+ * Conversion times are the datasheet typicals, or the maximums with "max".
+ *
+ * The timed strategy is what si7021_task() does: write the command and stop,
+ * sleep in EM2 for the maximum conversion time, then read once. EM1 time is
+ * the time the bus is held, since the I2C driver blocks EM2 while it is busy.
+ * Address phases counts every start, each one an addressed bus transaction.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "crc8.h"
+
+namespace {
+
+constexpr double BIT_US			= 1e6 / 392157;	// I2C_FREQ_FAST_MAX
+constexpr double ISR_US			= 3.0;			// Interrupt entry and exit per byte or poll
+constexpr double BYTE_US		= 9 * BIT_US + ISR_US;	// 8 bits and ACK
+constexpr double START_US		= BIT_US;
+constexpr double STOP_US		= BIT_US;
+
+constexpr uint8_t CMD_RH		= 0xF5;
+constexpr uint8_t CMD_TEMP		= 0xF3;
+constexpr uint8_t CMD_TEMP_FROM_RH = 0xE0;
+
+constexpr double RH_CONV_MAX_MS		= 12;		// SI7021_RH_CONV_MS
+constexpr double TEMP_CONV_MAX_MS	= 11;		// SI7021_TEMP_CONV_MS
+constexpr double CONV_MARGIN_MS		= 1;		// SI7021_CONV_MARGIN_MS
+
+// Reference CRC, bit by bit
+uint8_t crc8_bitwise(const uint8_t *data, int len){
+	uint8_t crc = 0;
+	for(int i = 0; i < len; i++){
+		crc ^= data[i];
+		for(int b = 0; b < 8; b++){
+			crc = crc & 0x80 ? (uint8_t)((crc << 1) ^ 0x31) : (uint8_t)(crc << 1);
+		}
+	}
+	return crc;
+}
+
+class Si7021 {
+public:
+	Si7021(double rh, double temp_c, bool max_times)
+		: rh_(rh), temp_c_(temp_c),
+		  rh_ms_(max_times ? 12.0 : 10.0), temp_ms_(max_times ? 10.8 : 7.0) {}
+
+	// Conversion time for a command, the RH conversion also measures temperature
+	double command(uint8_t cmd){
+		switch(cmd){
+			case CMD_RH:			last_temp_ = temp_code(); return rh_ms_ + temp_ms_;
+			case CMD_TEMP:			last_temp_ = temp_code(); return temp_ms_;
+			case CMD_TEMP_FROM_RH:	return 0;
+		}
+		return 0;
+	}
+
+	// Bytes the read returns after [cmd]
+	std::vector<uint8_t> read(uint8_t cmd) const {
+		uint16_t code = cmd == CMD_RH ? rh_code() : last_temp_;
+		std::vector<uint8_t> out = {(uint8_t)(code >> 8), (uint8_t)code};
+		if(cmd != CMD_TEMP_FROM_RH){
+			out.push_back(crc8_bitwise(out.data(), 2));
+		}
+		return out;
+	}
+
+private:
+	uint16_t rh_code() const { return (uint16_t)std::lround((rh_ + 6) * 65536 / 125) & 0xFFFC; }
+	uint16_t temp_code() const { return (uint16_t)std::lround((temp_c_ + 46.85) * 65536 / 175.72) & 0xFFFC; }
+
+	double rh_, temp_c_, rh_ms_, temp_ms_;
+	uint16_t last_temp_ = 0;
+};
+
+struct Transfer {
+	uint8_t	cmd;
+	int		rx_len;
+	bool	poll;					// I2C_FLAG_POLL_READ
+	bool	timed;					// Stop after the command and sleep out the conversion
+};
+
+struct Result {
+	double	bus_ms = 0;				// Bus held, the core is in EM1 or EM0
+	double	sample_ms = 0;			// First start to the last stop
+	int		bytes = 0;
+	int		starts = 0;				// Address phases
+	bool	crc_ok = true;
+};
+
+// One sample as the driver runs it. Polled transfers chain with repeated
+// starts, a timed one stops after its command and sleeps out the conversion.
+Result run(Si7021 &dev, const std::vector<Transfer> &chain){
+	Result r;
+	double us = 0;					// Bus held
+	double sleep_us = 0;
+
+	for(const Transfer &t : chain){
+		double conversion_us = dev.command(t.cmd) * 1000;
+		us += START_US + 2 * BYTE_US;				// Write address, command
+		r.bytes += 2;
+		r.starts++;
+		if(t.timed){
+			double wait_us = ((t.cmd == CMD_RH ? RH_CONV_MAX_MS : 0) + TEMP_CONV_MAX_MS + CONV_MARGIN_MS) * 1000;
+			us += STOP_US;
+			sleep_us += wait_us;
+			conversion_us = std::max(0.0, conversion_us - wait_us);
+		}
+		double poll_us = START_US + BYTE_US;		// Repeated start, read address
+		int polls = t.poll ? (int)std::ceil(conversion_us / poll_us) : 0;
+		us += (polls + 1) * poll_us;
+		r.starts += polls + 1;
+		r.bytes += polls + 1;
+		std::vector<uint8_t> data = dev.read(t.cmd);
+		data.resize(t.rx_len);
+		us += t.rx_len * BYTE_US;
+		r.bytes += t.rx_len;
+		if(t.rx_len == 3){
+			r.crc_ok &= crc8(data.data(), 2) == data[2];
+		}
+	}
+	us += STOP_US;
+	r.bus_ms = us / 1000;
+	r.sample_ms = (us + sleep_us) / 1000;
+	return r;
+}
+
+}
+
+int main(int argc, char **argv){
+	bool max_times = argc > 1 && !std::strcmp(argv[1], "max");
+
+	// crc8() against the bitwise reference for every 16 bit code, and the Sensirion example
+	for(uint32_t code = 0; code < 0x10000; code++){
+		uint8_t data[2] = {(uint8_t)(code >> 8), (uint8_t)code};
+		if(crc8(data, 2) != crc8_bitwise(data, 2)){
+			std::printf("crc8 mismatch at %04x\n", code);
+			return 1;
+		}
+	}
+	const uint8_t example[2] = {0x68, 0x3A};
+	if(crc8(example, 2) != 0x7C){
+		std::printf("crc8 example mismatch\n");
+		return 1;
+	}
+
+	Si7021 dev(45.6, 23.4, max_times);
+	struct { const char *name; std::vector<Transfer> chain; } cases[] = {
+		{"polled temperature (0xF3)",		{{CMD_TEMP, 2, true, false}}},
+		{"polled separate RH + T",			{{CMD_RH, 3, true, false}, {CMD_TEMP, 2, true, false}}},
+		{"polled combined RH + T",			{{CMD_RH, 3, true, false}, {CMD_TEMP_FROM_RH, 2, false, false}}},
+		{"timed combined RH + T",			{{CMD_RH, 3, true, true}, {CMD_TEMP_FROM_RH, 2, false, false}}},
+	};
+
+	std::printf("%s conversion times, %.2f us per byte\n", max_times ? "maximum" : "typical", BYTE_US);
+	std::printf("%-30s %10s %10s %7s %7s %4s\n", "", "EM1 ms", "sample ms", "starts", "bytes", "crc");
+	for(auto &c : cases){
+		Result r = run(dev, c.chain);
+		std::printf("%-30s %10.3f %10.3f %7d %7d %4s\n", c.name, r.bus_ms, r.sample_ms, r.starts, r.bytes,
+				r.crc_ok ? "ok" : "bad");
+	}
+	return 0;
+}
@@ -0,0 +1,152 @@
+/**
+ * @file sleep_governor_test.cpp
+ * @author Kay Sho
+ * @date  10/17/2026
+ * @brief The measured wakeup cost reaches the sleep governor's wakeup times
+ * and moves its pick
+ * @note The author's pronouns: (She/They)
+ *
+ * Build:	gcc -O2 -I../Header_Files -c ../Source_Files/energy_model.c
+ *		g++ -std=c++17 -O2 -I../Header_Files sleep_governor_test.cpp energy_model.o -o sleep_governor_test
+ * Use:		sleep_governor_test [core_mhz=19] [cycles=380]
+ *
+ * sleep_governor() and sleep_governor_stats() of Source_Files/sleep_routines.c
+ * take their wakeup times from energy_wake_us() and the pick from
+ * energy_cheapest_mode(), both linked here from Source_Files/energy_model.c.
+ * average() follows the running average sleep_enter() keeps in wake_cycles[],
+ * which needs the SDK headers to build, keep it in step. Checked:
+ *	- with no cycles measured, or core_mhz 0, the times are the datasheet ones
+ *	- cycles EM1 to EM3 took to enter and restore add to each mode's time,
+ *	  rounded up to whole microseconds
+ *	- sleep_enter()'s average of a steady cost settles on that cost
+ *	- over every sleep from 1 us to 2 ms the measured times pick a mode no
+ *	  deeper than the datasheet times, and at least one sleep picks a
+ *	  shallower one, the deep mode no longer paying back its wakeup
+ *
+ * Exits 1 if any check fails.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "energy_model.h"
+
+namespace {
+
+constexpr uint32_t WAKE_CYCLES_SHIFT	= 3;		// sleep_routines.c
+constexpr uint32_t DEEPEST				= 3;		// EM3, the deepest the governor is asked for
+
+struct Settings {
+	uint32_t core_mhz	= 19;			// HFRCO
+	uint32_t cycles		= 380;			// Entry and clock restore of EM2/EM3, 20 us at 19 MHz
+};
+
+uint32_t failures;
+
+void fail(const char *what, uint32_t a, uint32_t b){
+	if(failures++ < 10){
+		std::printf("FAIL %s: %u %u\n", what, a, b);
+	}
+}
+
+/* sleep_enter() */
+void average(uint32_t *wake_cycles, uint32_t cycles){
+	if(*wake_cycles == 0){
+		*wake_cycles = cycles;
+	} else {
+		*wake_cycles += (int32_t)(cycles - *wake_cycles) >> WAKE_CYCLES_SHIFT;
+	}
+}
+
+void check_wake_us(const ENERGY_MODEL &m, const Settings &s){
+	uint32_t none[ENERGY_MODES] = {};
+	uint32_t cycles[ENERGY_MODES] = {0, s.cycles / 4, s.cycles, s.cycles, 0};
+	uint32_t wake_us[ENERGY_MODES];
+
+	energy_wake_us(&m, none, s.core_mhz, wake_us);
+	for(uint32_t i = 0; i < ENERGY_MODES; i++){
+		if(wake_us[i] != m.wake_us[i]) fail("no cycles", i, wake_us[i]);
+	}
+	energy_wake_us(&m, cycles, 0, wake_us);
+	for(uint32_t i = 0; i < ENERGY_MODES; i++){
+		if(wake_us[i] != m.wake_us[i]) fail("core_mhz 0", i, wake_us[i]);
+	}
+	energy_wake_us(&m, cycles, s.core_mhz, wake_us);
+	for(uint32_t i = 0; i < ENERGY_MODES; i++){
+		uint32_t want = m.wake_us[i] + (cycles[i] + s.core_mhz - 1) / s.core_mhz;
+		if(wake_us[i] != want) fail("measured", i, wake_us[i]);
+		if(cycles[i] && wake_us[i] <= m.wake_us[i]) fail("did not move", i, wake_us[i]);
+	}
+	std::printf("wake us  datasheet EM1 %u EM2 %u EM3 %u, measured EM1 %u EM2 %u EM3 %u\n",
+			m.wake_us[1], m.wake_us[2], m.wake_us[3], wake_us[1], wake_us[2], wake_us[3]);
+}
+
+void check_average(const Settings &s){
+	uint32_t wake_cycles = 0;
+
+	average(&wake_cycles, s.cycles * 3);		// First sleep after reset, caches cold
+	for(uint32_t i = 0; i < 200; i++){
+		average(&wake_cycles, s.cycles);
+	}
+	if(wake_cycles < s.cycles || wake_cycles > s.cycles + (1u << WAKE_CYCLES_SHIFT)){
+		fail("average", wake_cycles, s.cycles);
+	}
+}
+
+void check_picks(const ENERGY_MODEL &m, const Settings &s){
+	uint32_t none[ENERGY_MODES] = {};
+	uint32_t cycles[ENERGY_MODES] = {0, s.cycles / 4, s.cycles, s.cycles, 0};
+	uint32_t datasheet[ENERGY_MODES], measured[ENERGY_MODES];
+	uint32_t changed = 0, first = 0, last = 0;
+
+	energy_wake_us(&m, none, s.core_mhz, datasheet);
+	energy_wake_us(&m, cycles, s.core_mhz, measured);
+	for(uint32_t sleep_us = 1; sleep_us <= 2000; sleep_us++){
+		uint32_t a = energy_cheapest_mode(&m, DEEPEST, sleep_us, datasheet);
+		uint32_t b = energy_cheapest_mode(&m, DEEPEST, sleep_us, measured);
+		if(b > a) fail("deeper with the measured cost", sleep_us, b);
+		if(b != a){
+			if(!changed) first = sleep_us;
+			last = sleep_us;
+			changed++;
+		}
+	}
+	if(s.cycles >= s.core_mhz && !changed) fail("pick never moved", s.cycles, s.core_mhz);
+	std::printf("%u cycles at %u MHz: %u of 2000 sleeps pick a shallower mode", s.cycles, s.core_mhz, changed);
+	if(changed){
+		std::printf(", %u to %u us", first, last);
+	}
+	std::printf("\n");
+}
+
+bool set_key(const std::string &key, const char *value, Settings &s){
+	int v = std::atoi(value);
+	if(v <= 0) return false;
+	if(key == "core_mhz")	{ s.core_mhz = v; return true; }
+	if(key == "cycles")		{ s.cycles = v; return true; }
+	return false;
+}
+
+}
+
+int main(int argc, char **argv){
+	ENERGY_MODEL model = ENERGY_MODEL_DEFAULT;
+	Settings s;
+
+	for(int i = 1; i < argc; i++){
+		const char *eq = std::strchr(argv[i], '=');
+		if(!eq || !set_key(std::string(argv[i], eq - argv[i]), eq + 1, s)){
+			std::fprintf(stderr, "unknown or bad setting: %s\n", argv[i]);
+			return 2;
+		}
+	}
+
+	check_wake_us(model, s);
+	check_average(s);
+	check_picks(model, s);
+	std::printf("%u failures\n", failures);
+	return failures ? 1 : 0;
+}
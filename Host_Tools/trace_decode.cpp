@@ -0,0 +1,224 @@
+/**
+ * @file trace_decode.cpp
+ * @author Kay Sho
+ * @date  10/16/2026
+ * @brief Converts a trace_log dump into Chrome trace JSON
+ * @note The author's pronouns: (She/They)
+ *
+ * Build:	g++ -std=c++17 -O2 -o trace_decode trace_decode.cpp
+ * Use:		trace_decode trace.bin > trace.json
+ * Open the JSON in ui.perfetto.dev or chrome://tracing.
+ *
+ * The dump is the raw TRACE_LOG structure from trace.h, little endian:
+ * magic, core_hz, head, size, then size records of {stamp, id, arg}.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Must match trace.h
+constexpr uint32_t TRACE_MAGIC				= 0x45435254;
+constexpr uint16_t TRACE_SCHED_POST			= 1;
+constexpr uint16_t TRACE_SCHED_BEGIN		= 2;
+constexpr uint16_t TRACE_SCHED_END			= 3;
+constexpr uint16_t TRACE_EM_ENTER			= 4;
+constexpr uint16_t TRACE_EM_EXIT			= 5;
+constexpr uint16_t TRACE_IRQ_LETIMER0		= 6;
+constexpr uint16_t TRACE_IRQ_I2C0			= 7;
+constexpr uint16_t TRACE_IRQ_LEUART0		= 8;
+constexpr uint16_t TRACE_I2C_STATE			= 9;
+constexpr uint16_t TRACE_LEUART_TX_STATE	= 10;
+constexpr uint16_t TRACE_LEUART_RX_STATE	= 11;
+constexpr uint16_t TRACE_SLEEP_GOVERNOR		= 12;
+constexpr uint16_t TRACE_IRQ_LDMA			= 13;
+constexpr uint16_t TRACE_IRQ_I2C1			= 14;
+constexpr uint16_t TRACE_IRQ_LEUART1		= 15;
+constexpr uint16_t TRACE_IRQ_USART0		= 16;
+constexpr uint16_t TRACE_USART_TX_STATE	= 17;
+constexpr uint16_t TRACE_USART_RX_STATE	= 18;
+
+constexpr uint32_t LETIMER_HZ				= 1000;		// Rate of the TRACE_EM_EXIT argument
+
+// Must match fsm.h and the state and cause enums of i2c.c, leuart.c and usart.c
+constexpr uint32_t FSM_NO_CAUSE				= 0x0F;
+constexpr uint32_t FSM_TRACE_ILLEGAL		= 0x0F;
+
+struct FsmNames {
+	std::vector<std::string>	states;
+	std::vector<std::string>	causes;
+};
+
+const FsmNames I2C_FSM = {
+	{"IDLE", "REQUEST_DEVICE", "WRITE_DEVICE", "WAIT_CONVERSION", "READ_DEVICE", "CLOSE", "RESET", "RECOVER", "BACKOFF"},
+	{"ACK", "NACK", "RXDATAV", "TXC", "MSTOP"}};
+const FsmNames LEUART_TX_FSM = {{"START", "TRANSMIT", "IDLE", "CLOSE"}, {"TXBL", "TXC"}};
+const FsmNames LEUART_RX_FSM = {{"STARTFRAME", "RECEIVE", "SIGFRAME", "RAW"}, {"STARTF", "RXDATAV", "SIGF", "RX_DMA"}};
+const FsmNames USART_TX_FSM = {{"IDLE", "CLOSE"}, {"TXC"}};
+const FsmNames USART_RX_FSM = {{"STARTFRAME", "RECEIVE", "RAW"}, {"RXDATAV"}};
+
+// One Chrome trace thread per kind of record
+enum Track { TRACK_SCHED = 1, TRACK_SLEEP, TRACK_IRQ, TRACK_POST, TRACK_I2C, TRACK_LEUART, TRACK_USART };
+
+struct Record {
+	uint32_t	stamp;
+	uint16_t	id;
+	uint16_t	arg;
+};
+
+uint32_t read_u32(const std::vector<uint8_t> &buf, size_t at){
+	return buf[at] | (buf[at + 1] << 8) | (buf[at + 2] << 16) | ((uint32_t)buf[at + 3] << 24);
+}
+
+uint16_t read_u16(const std::vector<uint8_t> &buf, size_t at){
+	return buf[at] | (buf[at + 1] << 8);
+}
+
+std::string fsm_name(const std::vector<std::string> &names, uint32_t i){
+	return i < names.size() ? names[i] : std::to_string(i);
+}
+
+// FSM_TRACE_ARG(from, cause, to), e.g. "REQUEST_DEVICE -ACK-> WRITE_DEVICE"
+std::string fsm_transition(const FsmNames &fsm, uint16_t arg){
+	uint32_t from = arg >> 8, cause = (arg >> 4) & 0x0F, to = arg & 0x0F;
+	std::string s = fsm_name(fsm.states, from);
+	s += cause == FSM_NO_CAUSE ? " -> " : " -" + fsm_name(fsm.causes, cause) + "-> ";
+	s += to == FSM_TRACE_ILLEGAL && cause != FSM_NO_CAUSE ? "ILLEGAL" : fsm_name(fsm.states, to);
+	return s;
+}
+
+void emit(bool &first, const char *ph, const std::string &name, double us, Track tid, const std::string &args = ""){
+	std::printf("%s\n{\"name\":\"%s\",\"ph\":\"%s\",\"ts\":%.3f,\"pid\":0,\"tid\":%d%s%s}",
+			first ? "" : ",", name.c_str(), ph, us, (int)tid,
+			ph[0] == 'i' ? ",\"s\":\"t\"" : "",
+			args.empty() ? "" : (",\"args\":{" + args + "}").c_str());
+	first = false;
+}
+
+void emit_thread_name(bool &first, Track tid, const char *name){
+	std::printf("%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+			first ? "" : ",", (int)tid, name);
+	first = false;
+}
+
+}
+
+int main(int argc, char **argv){
+	if(argc != 2){
+		std::cerr << "usage: trace_decode <trace.bin>\n";
+		return 2;
+	}
+	std::ifstream in(argv[1], std::ios::binary);
+	std::vector<uint8_t> buf((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	if(buf.size() < 16 || read_u32(buf, 0) != TRACE_MAGIC){
+		std::cerr << "not a trace_log dump\n";
+		return 1;
+	}
+
+	uint32_t core_hz = read_u32(buf, 4);
+	uint32_t head = read_u32(buf, 8);
+	uint32_t size = read_u32(buf, 12);
+	if(core_hz == 0 || size == 0 || (size & (size - 1)) || buf.size() < 16 + (size_t)size * 8){
+		std::cerr << "corrupt trace header\n";
+		return 1;
+	}
+
+	// Oldest record first. The ring only holds the last [size] of [head] records.
+	std::vector<Record> records;
+	uint32_t first_index = head > size ? head - size : 0;
+	for(uint32_t i = first_index; i != head; i++){
+		size_t at = 16 + (size_t)(i & (size - 1)) * 8;
+		records.push_back({read_u32(buf, at), read_u16(buf, at + 4), read_u16(buf, at + 6)});
+	}
+
+	// The cycle counter stops while the core sleeps. Time is rebuilt from the
+	// cycle deltas plus the LETIMER ticks each TRACE_EM_EXIT reports.
+	double us = 0.0;
+	uint32_t last_stamp = records.empty() ? 0 : records.front().stamp;
+	bool first = true;
+
+	std::printf("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	emit_thread_name(first, TRACK_SCHED, "scheduler");
+	emit_thread_name(first, TRACK_SLEEP, "sleep");
+	emit_thread_name(first, TRACK_IRQ, "irq");
+	emit_thread_name(first, TRACK_POST, "posts");
+	emit_thread_name(first, TRACK_I2C, "i2c state");
+	emit_thread_name(first, TRACK_LEUART, "leuart state");
+	emit_thread_name(first, TRACK_USART, "usart state");
+
+	for(const Record &r : records){
+		us += (double)(uint32_t)(r.stamp - last_stamp) * 1e6 / core_hz;
+		last_stamp = r.stamp;
+		std::string arg = std::to_string(r.arg);
+
+		switch(r.id){
+			case TRACE_SCHED_POST:
+				emit(first, "i", "post " + arg, us, TRACK_POST);
+				break;
+			case TRACE_SCHED_BEGIN:
+				emit(first, "B", "event " + arg, us, TRACK_SCHED);
+				break;
+			case TRACE_SCHED_END:
+				emit(first, "E", "event " + arg, us, TRACK_SCHED);
+				break;
+			case TRACE_EM_ENTER:
+				emit(first, "B", "EM" + arg, us, TRACK_SLEEP);
+				break;
+			case TRACE_SLEEP_GOVERNOR:
+				emit(first, "i", "EM" + std::to_string(r.arg >> 8) + " -> EM" + std::to_string(r.arg & 0xFF),
+						us, TRACK_SLEEP);
+				break;
+			case TRACE_EM_EXIT:
+				us += (double)r.arg * 1e6 / LETIMER_HZ;
+				emit(first, "E", "sleep", us, TRACK_SLEEP, "\"ticks\":" + arg);
+				break;
+			case TRACE_IRQ_LETIMER0:
+				emit(first, "i", "LETIMER0", us, TRACK_IRQ, "\"if\":" + arg);
+				break;
+			case TRACE_IRQ_I2C0:
+				emit(first, "i", "I2C0", us, TRACK_IRQ, "\"if\":" + arg);
+				break;
+			case TRACE_IRQ_LEUART0:
+				emit(first, "i", "LEUART0", us, TRACK_IRQ, "\"if\":" + arg);
+				break;
+			case TRACE_IRQ_I2C1:
+				emit(first, "i", "I2C1", us, TRACK_IRQ, "\"if\":" + arg);
+				break;
+			case TRACE_IRQ_LEUART1:
+				emit(first, "i", "LEUART1", us, TRACK_IRQ, "\"if\":" + arg);
+				break;
+			case TRACE_IRQ_USART0:
+				emit(first, "i", "USART0", us, TRACK_IRQ, "\"if\":" + arg);
+				break;
+			case TRACE_IRQ_LDMA:
+				emit(first, "i", "LDMA", us, TRACK_IRQ, "\"if\":" + arg);
+				break;
+			case TRACE_I2C_STATE:
+				emit(first, "i", "i2c " + fsm_transition(I2C_FSM, r.arg), us, TRACK_I2C);
+				break;
+			case TRACE_LEUART_TX_STATE:
+				emit(first, "i", "tx " + fsm_transition(LEUART_TX_FSM, r.arg), us, TRACK_LEUART);
+				break;
+			case TRACE_LEUART_RX_STATE:
+				emit(first, "i", "rx " + fsm_transition(LEUART_RX_FSM, r.arg), us, TRACK_LEUART);
+				break;
+			case TRACE_USART_TX_STATE:
+				emit(first, "i", "tx " + fsm_transition(USART_TX_FSM, r.arg), us, TRACK_USART);
+				break;
+			case TRACE_USART_RX_STATE:
+				emit(first, "i", "rx " + fsm_transition(USART_RX_FSM, r.arg), us, TRACK_USART);
+				break;
+			default:
+				emit(first, "i", "id " + std::to_string(r.id), us, TRACK_IRQ, "\"arg\":" + arg);
+				break;
+		}
+	}
+	std::printf("\n]}\n");
+	return 0;
+}
@@ -31,23 +31,66 @@
 // Global functions
 //***********************************************************************************
 
-void timer_delay(uint32_t ms_delay){
-	uint32_t timer_clk_freq = CMU_ClockFreqGet(cmuClock_HFPER);
-	uint32_t delay_count = ms_delay *(timer_clk_freq/1000) / 1024;
-	CMU_ClockEnable(cmuClock_TIMER0, true);
-
-	TIMER_Init_TypeDef delay_counter_init = TIMER_INIT_DEFAULT;
-		delay_counter_init.oneShot = true;
-		delay_counter_init.enable = false;
-		delay_counter_init.mode = timerModeDown;
-		delay_counter_init.prescale = timerPrescale1024;
-		delay_counter_init.debugRun = false;
-
-	TIMER_Init(TIMER0, &delay_counter_init);
-	TIMER0->CNT = delay_count;
-	TIMER_Enable(TIMER0, true);
-	while (TIMER0->CNT != 00);
-	TIMER_Enable(TIMER0, false);
-	CMU_ClockEnable(cmuClock_TIMER0, false);
+/***************************************************************************//**
+ * @brief
+ *	Starts a delay that completes through the scheduler
+ *
+ * @details
+ *	The delay is a one-shot timer wheel timer, so the core sleeps in whatever
+ *	energy mode the other peripherals allow until [event] is posted.
+ *
+ * @param[in] ms_delay
+ *	Milliseconds to wait
+ *
+ * @param[in] event
+ *	Scheduler event posted when the delay is over
+ *
+ * @return
+ *	Timer handle, can be passed to timer_cancel()
+ *
+ ******************************************************************************/
+uint32_t timer_delay_async(uint32_t ms_delay, uint32_t event){
+	return timer_arm(ms_delay, event);
 }
 
+/***************************************************************************//**
+ * @brief
+ *	Blocks for at least [ms_delay] milliseconds
+ *
+ * @details
+ *	Used to spin on TIMER0 in EM0. It now arms a timer that only wakes the core
+ *	and sleeps between wakeups. Events posted while waiting run once the
+ *	caller returns to the main loop.
+ *
+ *	The timer is checked in the same critical section the core sleeps in, as
+ *	the main loop checks for events. The core only sleeps while the earliest
+ *	wheel deadline is still ahead, so COMP1, or the underflow for a deadline
+ *	in a later epoch, is still to come. An interrupt taken after the check
+ *	stays pending and ends the WFI at once.
+ *
+ * @note
+ *	Main loop only, with interrupts enabled. Inside a critical section the
+ *	LETIMER interrupt can not run and the core would never sleep.
+ *
+ * @param[in] ms_delay
+ *	Milliseconds to wait
+ *
+ ******************************************************************************/
+void timer_delay(uint32_t ms_delay){
+	uint32_t handle = timer_arm(ms_delay + 1, TIMER_WHEEL_NO_EVENT);	// +1, part of the current tick is gone
+	uint32_t deadline;
+	bool waiting = true;
+
+	EFM_ASSERT(handle != TIMER_WHEEL_INVALID);
+
+	while(waiting){
+		CORE_DECLARE_IRQ_STATE;
+		CORE_ENTER_CRITICAL();
+		waiting = timer_armed(handle);
+		if(waiting && timer_next_deadline(&deadline) && (int32_t)(deadline - timer_now()) > 0){
+			enter_sleep();
+		}
+		CORE_EXIT_CRITICAL();
+		timer_wheel_poll();
+	}
+}
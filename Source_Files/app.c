@@ -19,17 +19,60 @@
 // defined files
 //***********************************************************************************
 //#define BLE_TEST_ENABLED
+//#define SIM_SENSOR_ENABLED		// Samples a simulated sensor next to the Si7021
 #define CIRC_BUFF_TEST_ENABLED
+
+/* Writes line [*cursor] of a reply, false once there are no more, as
+ * scheduler_stats_line() */
+typedef bool (*APP_REPLY_LINE)(uint32_t *cursor, char *line, uint32_t size);
 //***********************************************************************************
 // Static / Private Variables
 //***********************************************************************************
-static char receive_str[50];
 static bool setting;
+static uint32_t si7021_id;
+#ifdef SIM_SENSOR_ENABLED
+static SIM_SENSOR sim;
+#endif
+static CR_STATE boot_cr;
+static APP_REPLY_LINE reply_line;			// Reply being sent a line at a time, NULL if none
+static uint32_t reply_cursor;
+static uint32_t app_held;					// Events waiting for room in the BLE buffer, one bit per ID
 //***********************************************************************************
 // Private functions
 //***********************************************************************************
 
-static void app_letimer_pwm_open(float period, float act_period, uint32_t out0_route, uint32_t out1_route);
+static void app_scheduler_register(void);
+static void app_hold(uint32_t event);
+static void app_reply(APP_REPLY_LINE line);
+static void app_reply_next(void);
+static bool app_i2c_line(uint32_t *cursor, char *line, uint32_t size);
+static bool app_link_line(uint32_t *cursor, char *line, uint32_t size);
+static bool app_stats_line(uint32_t *cursor, char *line, uint32_t size);
+static void app_cmd_tempf(const CMD_ARGS *args);
+static void app_cmd_tempc(const CMD_ARGS *args);
+static void app_cmd_energy(const CMD_ARGS *args);
+static void app_cmd_i2c(const CMD_ARGS *args);
+static void app_cmd_res(const CMD_ARGS *args);
+static void app_cmd_link(const CMD_ARGS *args);
+static void app_cmd_hist(const CMD_ARGS *args);
+static void app_cmd_rate(const CMD_ARGS *args);
+static void app_cmd_read(const CMD_ARGS *args);
+static void app_cmd_stats(const CMD_ARGS *args);
+static bool app_sensor_arg(int32_t value, uint32_t *id);
+
+/* Commands from the phone, "#name!" or "#name=a,b!", see cmd.c */
+static const CMD app_cmds[] = {
+	{"tempf",	app_cmd_tempf,	0, 0, "\nUse #tempf!\n"},
+	{"tempc",	app_cmd_tempc,	0, 0, "\nUse #tempc!\n"},
+	{"energy",	app_cmd_energy,	0, 0, "\nUse #energy!\n"},
+	{"i2c",		app_cmd_i2c,	0, 0, "\nUse #i2c!\n"},
+	{"res",		app_cmd_res,	1, 1, "\nUse #res=bits!, 11 to 14\n"},
+	{"link",	app_cmd_link,	0, 0, "\nUse #link!\n"},
+	{"hist",	app_cmd_hist,	0, 0, "\nUse #hist!\n"},
+	{"rate",	app_cmd_rate,	1, 2, "\nUse #rate=ms! or #rate=id,ms!\n"},
+	{"read",	app_cmd_read,	0, 1, "\nUse #read! or #read=id!\n"},
+	{"stats",	app_cmd_stats,	0, 0, "\nUse #stats!\n"},
+};
 
 //***********************************************************************************
 // Global functions
@@ -48,223 +91,516 @@ static void app_letimer_pwm_open(float period, float act_period, uint32_t out0_r
  *
  ******************************************************************************/
 void app_peripheral_setup(void){
+	bool cmds_ok;
+
 	cmu_open();
+	trace_open();
 	gpio_open();
-	app_letimer_pwm_open(PWM_PER, PWM_ACT_PER, PWM_ROUTE_0, PWM_ROUTE_1);
 	scheduler_open();
+	app_scheduler_register();
 	sleep_open();
+	timer_wheel_open(TIMER_WHEEL_CB);
+	energy_open();
 	sleep_block_mode(SYSTEM_BLOCK_EM);
 	add_scheduled_event(BOOT_UP_CB);
-	si7021_i2c_open();
+	si7021_i2c_open(SI7021_TASK_CB, I2C_WATCHDOG_CB);
+	sampler_open(SI7021_I2C, SAMPLER_TASK_CB, SENSOR_DONE_CB);
+	si7021_id = sampler_add(&si7021_sensor, NULL, SAMPLE_PER_MS);
+#ifdef SIM_SENSOR_ENABLED
+	sim_sensor_init(&sim, SIM_SENSOR_ADDR);
+	sampler_add(&sim_sensor, &sim, SIM_SAMPLE_PER_MS);
+#endif
 	ble_open(BLE_TX_DONE_CB, BLE_RX_DONE_CB);
-
+	cmds_ok = cmd_open(app_cmds, sizeof(app_cmds) / sizeof(app_cmds[0]));
+	EFM_ASSERT(cmds_ok);						// Else change CMD_HASH_SEED
 }
 
 /***************************************************************************//**
  * @brief
- * Contains the letimer0 COMP0 callback event
+ * Contains the completion event for Boot up event
  *
  * @details
- *
- * When COMP0 is detected, the following code will run, and the
- * event is removed.
+ * This is where we test the LEUART and the BLE device. The boot event is a
+ * coroutine: each test is started with BOOT_UP_CB as its done event and the
+ * boot sequence resumes from the next line once the test has passed.
  *
  * @note
+ * This is the best place to write whatever you'd like.
  *
- *
+ * @param[in] payload
+ * Unused
  ******************************************************************************/
-void scheduled_letimer0_comp0_cb(void){
-	EFM_ASSERT(false);
-	remove_scheduled_event(LETIMER0_COMP0_CB);
+void scheduled_boot_up_cb(uint32_t payload){
+	(void)payload;
+	CR_BEGIN(&boot_cr);
+	leuart_loopbk_test(HM10_LEUART0, LEUART_LOOPBK_CB, BOOT_UP_CB);
+	CR_YIELD(&boot_cr);
+#ifdef BLE_TEST_ENABLED
+	ble_test("KaySho", BLE_TEST_CB, BOOT_UP_CB);
+	CR_YIELD(&boot_cr);
+	timer_delay_async(BLE_NAME_SAVE_MS, BOOT_UP_CB);
+	CR_YIELD(&boot_cr);
+#endif
+	ble_link_open(BLE_LINK_PROFILE, BLE_LINK_CB, BOOT_UP_CB);
+	CR_YIELD(&boot_cr);
+#ifdef CIRC_BUFF_TEST_ENABLED
+	circular_buff_test();
+#endif
+	ble_write("\nHello World!\nKay Sho\n\0");
+	ble_write("\nPlease use She or They to \nrefer to them!\n\0");
+	ble_write("\nShe would like to thank you \nfor the wonderful course!\n\0");
+	CR_END(&boot_cr);
 }
 
 /***************************************************************************//**
  * @brief
- * Contains the letimer0 COMP1 callback event
+ * Contains the completion event for TX complete event
  *
  * @details
- *
- * When COMP1 is detected, the following code will run, and the
- * event is removed.
+ *	Handles the completion event for the TX data
  *
  * @note
+ *	The first TX completion starts the sensor sampler. While a reply of
+ *	several lines is running, every completion also queues its next line.
+ *	Events held back for room in the BLE buffer are posted again.
  *
- *
+ * @param[in] payload
+ * Number of bytes the LEUART transmitted
  ******************************************************************************/
-void scheduled_letimer0_comp1_cb(void){
-	EFM_ASSERT(false);
-	remove_scheduled_event(LETIMER0_COMP1_CB);
+void scheduled_tx_done_cb(uint32_t payload){
+	(void)payload;
+	uint32_t held = app_held;
+
+	ble_circ_pop(false);
+	if(reply_line != NULL){
+		app_reply_next();
+	}
+	app_held = 0;
+	for(uint32_t event = 0; held; event++, held >>= 1){
+		if(held & 1){
+			add_scheduled_event(event);
+		}
+	}
+	if(!sampler_started()){
+		sampler_start(); //start sampling when TX complete
+	}
 }
+/***************************************************************************//**
+ * @brief scheduled_rx_done_cb()
+ * Contains the completion event for RX complete event
+ *
+ * @details
+ *	Handles every command waiting in the RX ring, oldest first. Each one is
+ *	parsed where it lies, dispatched through app_cmds[] and freed once it
+ *	has been handled, so commands that arrive back to back are all answered.
+ *	A command that has to wait for the sensors answers from their event.
+ *	A command writes one line at most, so each waits for APP_LINE_MAX bytes
+ *	of room in the BLE buffer and for any longer reply to finish. The rest
+ *	stay in the ring until the next TX completion.
+ *
+ * @note
+ *	A later event may find the ring already emptied, that is harmless.
+ * @param[in] payload
+ * Number of bytes in the received frame
+ ******************************************************************************/
+void scheduled_rx_done_cb(uint32_t payload){
+	(void)payload;
+	const char *frame;
+	const CMD *cmd;
+	uint32_t len;
 
+	while((frame = ble_read(&len)) != NULL){
+		if(reply_line != NULL || ble_write_space() < APP_LINE_MAX){
+			app_hold(BLE_RX_DONE_CB);
+			return;
+		}
+		switch(cmd_dispatch(frame, len, &cmd)){
+		case CMD_UNKNOWN:
+			ble_write("\nUnknown Command\n");
+			break;
+		case CMD_BAD_ARGS:
+			snprintf(buffer, sizeof(buffer), "%s", cmd->usage);
+			ble_write(buffer);
+			break;
+		default:
+			break;
+		}
+		ble_read_done();
+	}
+}
 /***************************************************************************//**
  * @brief
- * Contains the letimer0 underflow callback event
+ * Contains the completion event for the sensor sampler.
  *
  * @details
  *
- * When the underflow event is detected, the event is removed and reset, and the
- * rest of the code is run.
+ * Every sensor with a fresh reading is sent as one line: its name, then each
+ * value it reported. The Si7021 temperature is also checked against the
+ * threshold that lights LED1. A humidity with a bad checksum is reported as
+ * a CRC error. Each line waits for APP_LINE_MAX bytes of room in the BLE
+ * buffer, the readings not sent yet stay fresh until the next TX completion.
  *
  * @note
+ * METRIC == false, meaning there is no conversion
+ * IMPERIAL == true, meaning there is conversion from C to F
+ * Currently, Threshold temperature is set to 80.6 F, or 27.0 C.
  *
+ * @param[in] payload
+ * Unused, sampler_next_fresh() tells which sensors have a new reading
+ ******************************************************************************/
+void scheduled_sensor_done_cb(uint32_t payload){
+	(void)payload;
+	SENSOR_READING reading;
+	uint32_t id;
+	int len;
+
+	for(;;){
+		if(ble_write_space() < APP_LINE_MAX){
+			app_hold(SENSOR_DONE_CB);
+			return;
+		}
+		if((id = sampler_next_fresh()) == SAMPLER_NO_SENSOR){
+			return;
+		}
+		sampler_reading(id, &reading);
+		if(!reading.ok){
+			snprintf(buffer, sizeof(buffer), "%s read failed\n", sampler_name(id));
+			ble_write(buffer);
+			continue;
+		}
+		len = snprintf(buffer, sizeof(buffer), "%s", sampler_name(id));
+		for(uint32_t i = 0; i < reading.count; i++){
+			float value = reading.value[i];
+			if(reading.quantity[i] == SENSOR_TEMP){
+				if(id == si7021_id){
+					if(value >= 27.0){GPIO_PinOutSet(LED1_PORT, LED1_PIN);}
+					else{GPIO_PinOutClear(LED1_PORT, LED1_PIN);}
+				}
+				//METRIC CONVERSION
+				if(!setting){
+					len += snprintf(buffer + len, sizeof(buffer) - len, " Temp = %d.%d C", (int)value, (int)(value*10)%10);
+				}
+				//IMPERIAL CONVERSION
+				else {
+					value = value * 1.8 + 32;
+					len += snprintf(buffer + len, sizeof(buffer) - len, " Temp = %d.%d F", (int)value, (int)(value*10)%10);
+				}
+			}
+			//HUMIDITY, dropped if the checksum does not match
+			else if(reading.valid[i]){
+				len += snprintf(buffer + len, sizeof(buffer) - len, ", RH = %d.%d %%", (int)value, (int)(value*10)%10);
+			} else {
+				len += snprintf(buffer + len, sizeof(buffer) - len, ", RH CRC error");
+			}
+		}
+		snprintf(buffer + len, sizeof(buffer) - len, "\n");
+		ble_write(buffer);
+	}
+}
+/***************************************************************************//**
+ * @brief
+ * Contains the completion event for a "#res=NN!" command
  *
+ * @details
+ * Reports the resolution the Si7021 now runs at. It is unchanged if the user
+ * register could not be written. The next sample uses the new conversion time.
+ * Waits for the next TX completion if the BLE buffer has no room.
  *
+ * @param[in] payload
+ * Unused
  ******************************************************************************/
-void scheduled_letimer0_uf_cb(void){
-	EFM_ASSERT(get_scheduled_events() & LETIMER0_UF_CB);
-	remove_scheduled_event(LETIMER0_UF_CB);
-	si7021_read(SI7021_READ_DONE_CB);
+void scheduled_si7021_res_done_cb(uint32_t payload){
+	(void)payload;
+	if(ble_write_space() < APP_LINE_MAX){
+		app_hold(SI7021_RES_DONE_CB);
+		return;
+	}
+	sprintf(buffer, "\nTemp resolution %u bit\n", (unsigned)si7021_resolution());
+	ble_write(buffer);
 }
-
 /***************************************************************************//**
  * @brief
- * Contains the completion event for Boot up event
+ * Registers every application callback with the scheduler
  *
  * @details
- * This is where we test the BLE device
+ * Replaces the if-chain that used to live in main.c. Adding an event is now a
+ * new ID in app.h and one line here.
  *
  * @note
- * This is the best place to write whatever you'd like.
+ * Must run before the peripherals that post these events are opened.
  *
  ******************************************************************************/
-void scheduled_boot_up_cb(void){
-	EFM_ASSERT(get_scheduled_events() & BOOT_UP_CB); // the EFM_ASSERT is NOT an example of TDD
-	remove_scheduled_event(BOOT_UP_CB);
-
-#ifdef BLE_TEST_ENABLED
-	bool test = ble_test("KaySho");
-	EFM_ASSERT(test);
-	timer_delay(2000);
-#endif
-#ifdef CIRC_BUFF_TEST_ENABLED
-	circular_buff_test();
-#endif
-	ble_write("\nHello World!\nKay Sho\n\0");
-	ble_write("\nPlease use She or They to \nrefer to them!\n\0");
-	ble_write("\nShe would like to thank you \nfor the wonderful course!\n\0");
+static void app_scheduler_register(void){
+	scheduler_register(SAMPLER_TASK_CB, sampler_task, SCHED_PRIO_HIGH);
+	scheduler_register(SENSOR_DONE_CB, scheduled_sensor_done_cb, SCHED_PRIO_NORMAL);
+	scheduler_register(SI7021_TASK_CB, si7021_task, SCHED_PRIO_NORMAL);
+	scheduler_register(SI7021_RES_DONE_CB, scheduled_si7021_res_done_cb, SCHED_PRIO_NORMAL);
+	scheduler_register(BLE_RX_DONE_CB, scheduled_rx_done_cb, SCHED_PRIO_NORMAL);
+	scheduler_register(BLE_TX_DONE_CB, scheduled_tx_done_cb, SCHED_PRIO_NORMAL);
+	scheduler_register(BOOT_UP_CB, scheduled_boot_up_cb, SCHED_PRIO_LOW);
+	scheduler_register(LEUART_LOOPBK_CB, leuart_loopbk_task, SCHED_PRIO_LOW);
+	scheduler_register(BLE_TEST_CB, ble_test_task, SCHED_PRIO_LOW);
+	scheduler_register(BLE_LINK_CB, ble_link_task, SCHED_PRIO_LOW);
 }
-
 /***************************************************************************//**
  * @brief
- * Contains the completion event for TX complete event
+ * Posts an event again at the next TX completion
  *
  * @details
- *	Handles the completion event for the TX data
- *
- * @note
- *	We've moved the letimer_start(LETIMER0, true) down here
+ * For callbacks that found less than APP_LINE_MAX bytes of room in the BLE
+ * buffer. Event IDs are below 32.
  *
  ******************************************************************************/
-void scheduled_tx_done_cb(void){
-	EFM_ASSERT(get_scheduled_events()& BLE_TX_DONE_CB);
-	remove_scheduled_event(BLE_TX_DONE_CB);
-	ble_circ_pop(false);
-	letimer_start(LETIMER0, true); //start LETIMER0 when TX complete
+static void app_hold(uint32_t event){
+	EFM_ASSERT(event < 32);
+	app_held |= 1u << event;
 }
 /***************************************************************************//**
- * @brief scheduled_rx_done_cb()
- * Contains the completion event for RX complete event
+ * @brief
+ * Starts a reply of several lines and queues its first
  *
  * @details
- *	Handles the completion event for the RX data event
+ * A reply longer than one line can be longer than the whole BLE buffer, so
+ * it goes out a line per TX completion and the buffer keeps room for the
+ * sensor readings. Commands wait until it is done.
+ *
+ ******************************************************************************/
+static void app_reply(APP_REPLY_LINE line){
+	reply_line = line;
+	reply_cursor = 0;
+	app_reply_next();
+}
+/***************************************************************************//**
+ * @brief
+ * Queues the next line of the running reply, if the BLE buffer has room
+ ******************************************************************************/
+static void app_reply_next(void){
+	if(ble_write_space() < APP_LINE_MAX){
+		return;
+	}
+	if(reply_line(&reply_cursor, buffer, sizeof(buffer))){
+		ble_write(buffer);
+	} else {
+		reply_line = NULL;
+	}
+}
+/***************************************************************************//**
+ * @brief
+ * "#tempf!", reports temperatures in F
  *
  * @note
  *	IMPERIAL is set to true, requiring conversion
  *	METRIC is set to false, meaning no conversion
  *	For more detail on how this is done, see the bottom of the Si7021.c file.
  ******************************************************************************/
-void scheduled_rx_done_cb(void){
-	EFM_ASSERT(get_scheduled_events()& BLE_RX_DONE_CB);
-	remove_scheduled_event(BLE_RX_DONE_CB);
-	received_data(receive_str);
+static void app_cmd_tempf(const CMD_ARGS *args){
+	(void)args;
+	setting = IMPERIAL;
+	ble_write("\nTemperature converting to F\n");
+}
+/***************************************************************************//**
+ * @brief
+ * "#tempc!", reports temperatures in C
+ ******************************************************************************/
+static void app_cmd_tempc(const CMD_ARGS *args){
+	(void)args;
+	setting = METRIC;
+	ble_write("\nTemperature converting to C\n");
+}
+/***************************************************************************//**
+ * @brief
+ * "#energy!", the average current and battery life estimate
+ ******************************************************************************/
+static void app_cmd_energy(const CMD_ARGS *args){
+	(void)args;
+	ENERGY_STATS stats;
+	energy_stats(&stats);
+	sprintf(buffer, "\nAvg %u.%03u uA, life %u h\n", (unsigned)(stats.estimate.avg_na / 1000),
+			(unsigned)(stats.estimate.avg_na % 1000), (unsigned)stats.estimate.life_hours);
+	ble_write(buffer);
+}
+/***************************************************************************//**
+ * @brief
+ * "#i2c!", the error counters of the Si7021 bus
+ ******************************************************************************/
+static void app_cmd_i2c(const CMD_ARGS *args){
+	(void)args;
+	app_reply(app_i2c_line);
+}
+/***************************************************************************//**
+ * @brief
+ * The lines of "#i2c!", see APP_REPLY_LINE
+ ******************************************************************************/
+static bool app_i2c_line(uint32_t *cursor, char *line, uint32_t size){
+	I2C_ERROR_STATS stats;
+	i2c_error_stats(SI7021_I2C, &stats);
 
-	if(!strcmp(receive_str, "#tempf!")){
-		setting = IMPERIAL;
-		ble_write("\nTemperature converting to F\n");
-		return;
+	switch((*cursor)++){
+	case 0:
+		snprintf(line, size, "\nI2C nack %u to %u err %u ux %u\n", (unsigned)stats.nack,
+				(unsigned)stats.timeout, (unsigned)stats.bus_error, (unsigned)stats.unexpected);
+		return true;
+	case 1:
+		snprintf(line, size, "\nrec %u stuck %u retry %u fail %u\n", (unsigned)stats.recoveries,
+				(unsigned)stats.stuck, (unsigned)stats.retries, (unsigned)stats.failed);
+		return true;
+	default:
+		return false;
 	}
-	else if(!strcmp(receive_str, "#tempc!")){
-		setting = METRIC;
-		ble_write("\nTemperature converting to C\n");
+}
+/***************************************************************************//**
+ * @brief
+ * "#res=bits!", the Si7021 temperature resolution
+ *
+ * @details
+ * The user register write goes out on the bus, scheduled_si7021_res_done_cb()
+ * answers once it is done.
+ ******************************************************************************/
+static void app_cmd_res(const CMD_ARGS *args){
+	int32_t bits = args->value[0];
+	if(bits < 11 || bits > 14){
+		ble_write("\nResolution must be 11 to 14 bits\n");
 		return;
 	}
-	else ble_write("\nUnknown Command\n");
+	si7021_set_resolution(bits, SI7021_RES_DONE_CB);
 }
 /***************************************************************************//**
  * @brief
- * Contains the completion event for the Si7021 onboard temperature sensor.
+ * "#link!", which UART carries the BLE link and what it has moved
+ ******************************************************************************/
+static void app_cmd_link(const CMD_ARGS *args){
+	(void)args;
+	app_reply(app_link_line);
+}
+/***************************************************************************//**
+ * @brief
+ * The lines of "#link!", see APP_REPLY_LINE
+ ******************************************************************************/
+static bool app_link_line(uint32_t *cursor, char *line, uint32_t size){
+	BLE_LINK_STATS stats;
+	FRAME_RING_STATS rx;
+	ble_link_stats(&stats);
+	ble_rx_stats(&rx);
+
+	switch((*cursor)++){
+	case 0:
+		snprintf(line, size, "\n%s %u baud, %u msg, %u B\n", stats.usart ? "USART" : "LEUART",
+				(unsigned)stats.baudrate, (unsigned)stats.messages, (unsigned)stats.bytes);
+		return true;
+	case 1:
+		snprintf(line, size, "\nair avg %u us max %u ms, %u B/s\n",
+				(unsigned)(stats.messages ? stats.air_ms * 1000 / stats.messages : 0),
+				(unsigned)stats.max_air_ms, (unsigned)(stats.air_ms ? stats.bytes * 1000 / stats.air_ms : 0));
+		return true;
+	case 2:
+		snprintf(line, size, "\nrx %u cmd, %u long, %u lost\n",
+				(unsigned)rx.frames, (unsigned)rx.overflow, (unsigned)rx.full);
+		return true;
+	default:
+		return false;
+	}
+}
+/***************************************************************************//**
+ * @brief
+ * "#hist!", starts the scheduler histogram dump, one line per TX completion
+ ******************************************************************************/
+static void app_cmd_hist(const CMD_ARGS *args){
+	(void)args;
+	ble_write("\nE<id> l|x bucket:n, 2^(b+6) cyc\n");
+	app_reply(scheduler_stats_line);
+}
+/***************************************************************************//**
+ * @brief
+ * "#rate=ms!" or "#rate=id,ms!", the sample period of the Si7021 or of
+ * sensor [id]
  *
  * @details
- *
- * When the Si7021 finishes reading the temperature, the Si7021 will take the
- * converted temperature and checks whether or not it is high enough to meet condition.
- *
- * @note
- * METRIC == false, meaning there is no conversion
- * IMPERIAL == true, meaning there is conversion from C to F
- * Currently, Threshold temperature is set to 80.6 F, or 27.0 C.
- *
+ * The next sample is due ms after the start of the last one, see
+ * sampler_set_period().
  ******************************************************************************/
-void scheduled_si7021_read_done_cb(void){
-	EFM_ASSERT(get_scheduled_events() & SI7021_READ_DONE_CB);
-	remove_scheduled_event(SI7021_READ_DONE_CB);
-	//METRIC CONVERSION
-	if(!setting){
-		float tempC = si7021_temp_met();
-		if(tempC >= 27.0){GPIO_PinOutSet(LED1_PORT, LED1_PIN);}
-		else{GPIO_PinOutClear(LED1_PORT, LED1_PIN);}
-		sprintf(buffer, "Temp = %d.%d C\n", (int)tempC, (int)(tempC*10)%10);
+static void app_cmd_rate(const CMD_ARGS *args){
+	uint32_t id = si7021_id;
+	int32_t ms = args->value[args->count - 1];
+
+	if(args->count == 2 && !app_sensor_arg(args->value[0], &id)){
+		return;
 	}
-	//IMPERIAL CONVERSION
-	else if(setting){
-		float tempF = si7021_temp_imp();
-		if(tempF >= 80.6){GPIO_PinOutSet(LED1_PORT, LED1_PIN);}
-		else{GPIO_PinOutClear(LED1_PORT, LED1_PIN);}
-		sprintf(buffer, "Temp = %d.%d F\n", (int)tempF, (int)(tempF*10)%10);
+	if(ms < RATE_MIN_MS || ms > RATE_MAX_MS){
+		snprintf(buffer, sizeof(buffer), "\nRate must be %u to %u ms\n", RATE_MIN_MS, RATE_MAX_MS);
+		ble_write(buffer);
+		return;
 	}
+	sampler_set_period(id, ms);
+	snprintf(buffer, sizeof(buffer), "\n%s every %u ms\n", sampler_name(id), (unsigned)ms);
 	ble_write(buffer);
 }
 /***************************************************************************//**
  * @brief
- * Contains the APP LETIMER PWM structs and calls
+ * "#read!" or "#read=id!", samples every sensor or sensor [id] now
  *
  * @details
- * Setting up the pwm struct for interrupts makes things far less complicated
- *
- *
- * @param[in] period
- *	Floating point number that defines the full period that the device's PWM runs on.
- * @param[in] act_period
- *  Floating point number that defines the active period of the device's PWM.
- * @param[in] out0_route
- * 	Unsigned 32-bit integer that defines the output of the route0 pin.
- * @param[in] out0_route
- * 	Unsigned 32-bit integer that defines the output of the route01 pin.
+ * Only starts the samples, scheduled_sensor_done_cb() sends the readings
+ * like any other.
  ******************************************************************************/
-void app_letimer_pwm_open(float period, float act_period, uint32_t out0_route, uint32_t out1_route){
-	// Initializing LETIMER0 for PWM operation by creating the
-	// letimer_pwm_struct and initializing all of its elements
-	APP_LETIMER_PWM_TypeDef app_letimer_pwm_struct;
-
-	// Declaration of the app_letimer_PWM struct elements
-	app_letimer_pwm_struct.debugRun			= false;
-	app_letimer_pwm_struct.enable			= false;
-	app_letimer_pwm_struct.out_pin_0_en 	= false;
-	app_letimer_pwm_struct.out_pin_1_en 	= false;
-	app_letimer_pwm_struct.out_pin_route0 	= out0_route; 	//expects uint32_bit arg; numeral arg
-	app_letimer_pwm_struct.out_pin_route1 	= out1_route;
-	app_letimer_pwm_struct.period 			= period;
-	app_letimer_pwm_struct.active_period 	= act_period;
-
-	app_letimer_pwm_struct.comp0_irq_enable = false;
-	app_letimer_pwm_struct.comp0_cb			= LETIMER0_COMP0_CB;
-	app_letimer_pwm_struct.comp1_irq_enable = false;
-	app_letimer_pwm_struct.comp1_cb			= LETIMER0_COMP1_CB;
-	app_letimer_pwm_struct.uf_irq_enable	= true;
-	app_letimer_pwm_struct.uf_cb			= LETIMER0_UF_CB;
-
-	letimer_pwm_open(LETIMER0, &app_letimer_pwm_struct);
+static void app_cmd_read(const CMD_ARGS *args){
+	uint32_t first = 0;
+	uint32_t last = sampler_count();
 
+	if(args->count){
+		if(!app_sensor_arg(args->value[0], &first)){
+			return;
+		}
+		last = first + 1;
+	}
+	for(uint32_t id = first; id < last; id++){
+		if(!sampler_sample_now(id)){
+			ble_write("\nSampling has not started\n");
+			return;
+		}
+	}
 }
+/***************************************************************************//**
+ * @brief
+ * "#stats!", the period and sample counts of each sensor, and the commands
+ * received
+ ******************************************************************************/
+static void app_cmd_stats(const CMD_ARGS *args){
+	(void)args;
+	app_reply(app_stats_line);
+}
+/***************************************************************************//**
+ * @brief
+ * The lines of "#stats!", one per sensor then the command counts, see
+ * APP_REPLY_LINE
+ ******************************************************************************/
+static bool app_stats_line(uint32_t *cursor, char *line, uint32_t size){
+	SAMPLER_STATS stats;
+	CMD_STATS cmds;
+	uint32_t id = (*cursor)++;
 
-
+	if(id < sampler_count()){
+		sampler_stats(id, &stats);
+		snprintf(line, size, "\n%s %u ms, %u samples %u failed\n", sampler_name(id),
+				(unsigned)stats.period_ms, (unsigned)stats.samples, (unsigned)stats.failed);
+		return true;
+	}
+	if(id == sampler_count()){
+		cmd_stats(&cmds);
+		snprintf(line, size, "\ncmd %u ok, %u unknown, %u bad\n",
+				(unsigned)cmds.ok, (unsigned)cmds.unknown, (unsigned)cmds.bad_args);
+		return true;
+	}
+	return false;
+}
+/***************************************************************************//**
+ * @brief
+ * Checks a sensor ID argument, and answers if there is no such sensor
+ ******************************************************************************/
+static bool app_sensor_arg(int32_t value, uint32_t *id){
+	if(value < 0 || (uint32_t)value >= sampler_count()){
+		ble_write("\nNo such sensor\n");
+		return false;
+	}
+	*id = value;
+	return true;
+}
@@ -0,0 +1,226 @@
+/**
+ * @file cmd.c
+ * @author Kay Sho
+ * @date  10/16/2026
+ * @brief Table driven dispatch of the commands the phone sends
+ * @note The author's pronouns: (She/They)
+ *
+ * A command is "#name!" or "#name=a!" or "#name=a,b!", the arguments decimal
+ * numbers. The name is hashed once with a seeded FNV-1a into CMD_SLOTS
+ * slots. cmd_open() checks that no two names of the table share a slot, so
+ * finding a command is one hash and one string compare however many
+ * commands there are. The frame is parsed where it lies, in the RX ring.
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+
+/* System include statements */
+#include <string.h>
+
+
+/* Silicon Labs include statements */
+
+
+/* The developer's include statements */
+#include "cmd.h"
+
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define CMD_FNV_PRIME		16777619u
+#define CMD_NO_SLOT			0				// Slot holds no command, else table index + 1
+
+//***********************************************************************************
+// private variables
+//***********************************************************************************
+static const CMD *cmd_table;
+static uint8_t cmd_slot[CMD_SLOTS];
+static CMD_STATS cmd_counts;
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+static bool cmd_args(const char *p, const char *end, CMD_ARGS *args);
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Sets up the command table
+ *
+ * @details
+ *	[table] is kept, not copied, and is usually const.
+ *
+ * @param[in] count
+ *	Commands in table, fewer than CMD_SLOTS
+ *
+ * @return
+ *	false if two names hash to the same slot, CMD_HASH_SEED then has to be
+ *	changed. Host_Tools/cmd_bench.cpp finds one that works.
+ *
+ ******************************************************************************/
+bool cmd_open(const CMD *table, uint32_t count){
+	uint32_t slot;
+
+	cmd_table = table;
+	memset(cmd_slot, CMD_NO_SLOT, sizeof(cmd_slot));
+	memset(&cmd_counts, 0, sizeof(cmd_counts));
+	if(count >= CMD_SLOTS){
+		return false;
+	}
+	for(uint32_t i = 0; i < count; i++){
+		slot = cmd_hash(table[i].name, strlen(table[i].name));
+		if(cmd_slot[slot] != CMD_NO_SLOT){
+			return false;
+		}
+		cmd_slot[slot] = i + 1;
+	}
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Slot of a command name
+ *
+ * @param[in] *name
+ *	Need not be null terminated
+ *
+ * @param[in] len
+ *	Characters of name
+ *
+ * @return
+ *	0 to CMD_SLOTS - 1
+ *
+ ******************************************************************************/
+uint32_t cmd_hash(const char *name, uint32_t len){
+	uint32_t h = CMD_HASH_SEED;
+
+	for(uint32_t i = 0; i < len; i++){
+		h = (h ^ (uint8_t)name[i]) * CMD_FNV_PRIME;
+	}
+	return h >> (32 - CMD_SLOT_BITS);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Runs the handler of a received command
+ *
+ * @details
+ *	The handler is called with the arguments parsed, only if they are
+ *	numbers and there are min_args to max_args of them. Handlers run in the
+ *	caller's task: one that has to wait for a bus or a sensor starts the
+ *	work and answers from the event that completes it.
+ *
+ * @param[in] *frame
+ *	The command, '#' and '!' included
+ *
+ * @param[in] len
+ *	Characters of frame
+ *
+ * @param[out] **cmd
+ *	The command the name matched, NULL if none did. Its usage is for the
+ *	reply to CMD_BAD_ARGS.
+ *
+ ******************************************************************************/
+CMD_STATUS cmd_dispatch(const char *frame, uint32_t len, const CMD **cmd){
+	const char *name = frame + 1;
+	const char *end = frame + len - 1;			// The '!'
+	const char *p;
+	const CMD *c;
+	CMD_ARGS args;
+	uint32_t n;
+	uint8_t slot;
+
+	*cmd = NULL;
+	if(len < 3 || frame[0] != '#' || *end != '!'){
+		cmd_counts.unknown++;
+		return CMD_UNKNOWN;
+	}
+	for(p = name; p < end && *p != '='; p++);
+	n = p - name;
+
+	slot = cmd_slot[cmd_hash(name, n)];
+	if(slot == CMD_NO_SLOT){
+		cmd_counts.unknown++;
+		return CMD_UNKNOWN;
+	}
+	c = &cmd_table[slot - 1];
+	if(strncmp(c->name, name, n) || c->name[n]){
+		cmd_counts.unknown++;
+		return CMD_UNKNOWN;
+	}
+	*cmd = c;
+
+	if(!cmd_args(p, end, &args) || args.count < c->min_args || args.count > c->max_args){
+		cmd_counts.bad_args++;
+		return CMD_BAD_ARGS;
+	}
+	cmd_counts.ok++;
+	c->handler(&args);
+	return CMD_OK;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Copies out the counters since cmd_open()
+ *
+ ******************************************************************************/
+void cmd_stats(CMD_STATS *stats){
+	*stats = cmd_counts;
+}
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Parses the arguments from the '=' at [p], if any, to the '!' at [end]
+ *
+ * @return
+ *	false unless each one is an optional '-' and 1 to CMD_ARG_DIGITS digits,
+ *	at most CMD_ARGS_MAX of them
+ *
+ ******************************************************************************/
+static bool cmd_args(const char *p, const char *end, CMD_ARGS *args){
+	args->count = 0;
+	if(p == end){
+		return true;
+	}
+	p++;										// '='
+	for(;;){
+		bool neg = false;
+		uint32_t digits = 0;
+		int32_t value = 0;
+
+		if(args->count == CMD_ARGS_MAX){
+			return false;
+		}
+		if(p < end && *p == '-'){
+			neg = true;
+			p++;
+		}
+		for(; p < end && *p >= '0' && *p <= '9'; p++){
+			if(++digits > CMD_ARG_DIGITS){
+				return false;
+			}
+			value = value * 10 + (*p - '0');
+		}
+		if(!digits){
+			return false;
+		}
+		args->value[args->count++] = neg ? -value : value;
+		if(p == end){
+			return true;
+		}
+		if(*p++ != ','){
+			return false;
+		}
+	}
+}
@@ -0,0 +1,163 @@
+/**
+ * @file energy.c
+ * @author Kay Sho
+ * @date  10/16/2026
+ * @brief Energy mode residency, peripheral busy time and battery life estimate
+ * @note The author's pronouns: (She/They)
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+
+/* System include statements */
+
+
+/* Silicon Labs include statements */
+
+
+/* The developer's include statements */
+#include "energy.h"
+#include "timer_wheel.h"
+
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define TICKS_TO_MS(ticks)		((uint32_t)(((uint64_t)(ticks) * 1000) / LETIMER_HZ))
+
+//***********************************************************************************
+// private variables
+//***********************************************************************************
+static ENERGY_MODEL energy_model = ENERGY_MODEL_DEFAULT;
+static uint32_t open_tick;								// Start of the accounting window
+static uint32_t load_ticks[ENERGY_LOADS];				// Finished busy time
+static uint32_t load_start[ENERGY_LOADS];				// Tick the current busy period began
+static uint8_t load_depth[ENERGY_LOADS];				// Nested busy periods
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Starts a new accounting window
+ *
+ * @note
+ *	Needs the LETIMER0 timebase, call after timer_wheel_open().
+ *
+ ******************************************************************************/
+void energy_open(void){
+	CORE_DECLARE_IRQ_STATE;
+	CORE_ENTER_CRITICAL();
+	sleep_residency_reset();
+	for(int i = 0; i < ENERGY_LOADS; i++){
+		load_ticks[i] = 0;
+		load_depth[i] = 0;
+	}
+	open_tick = timer_now();
+	CORE_EXIT_CRITICAL();
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Replaces the current model used by energy_stats()
+ *
+ * @param[in] *model
+ *	Currents per mode and load, and the battery capacity
+ *
+ ******************************************************************************/
+void energy_set_model(const ENERGY_MODEL *model){
+	energy_model = *model;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Returns the current model
+ *
+ * @note
+ *	The sleep governor reads the mode currents and wakeup times from here.
+ *
+ ******************************************************************************/
+const ENERGY_MODEL *energy_get_model(void){
+	return &energy_model;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Marks a load as busy
+ *
+ * @details
+ *	Safe from interrupt handlers. Nested calls are counted, only the outer
+ *	begin/end pair is timed.
+ *
+ * @param[in] load
+ *	ENERGY_LOAD_x
+ *
+ ******************************************************************************/
+void energy_busy_begin(uint32_t load){
+	EFM_ASSERT(load < ENERGY_LOADS);
+	CORE_DECLARE_IRQ_STATE;
+	CORE_ENTER_CRITICAL();
+	if(load_depth[load]++ == 0){
+		load_start[load] = timer_now();
+	}
+	CORE_EXIT_CRITICAL();
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Marks a load as idle again
+ *
+ * @param[in] load
+ *	ENERGY_LOAD_x
+ *
+ ******************************************************************************/
+void energy_busy_end(uint32_t load){
+	EFM_ASSERT(load < ENERGY_LOADS);
+	CORE_DECLARE_IRQ_STATE;
+	CORE_ENTER_CRITICAL();
+	EFM_ASSERT(load_depth[load] > 0);
+	if(load_depth[load] && --load_depth[load] == 0){
+		load_ticks[load] += timer_now() - load_start[load];
+	}
+	CORE_EXIT_CRITICAL();
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Returns the residency since energy_open() and the estimate it gives
+ *
+ * @details
+ *	EM1 to EM3 times come from sleep_routines, EM0 is whatever is left of the
+ *	window. A busy period still in progress counts up to now.
+ *
+ * @param[out] *stats
+ *	Residency in ms, average current in nA and battery life in hours
+ *
+ ******************************************************************************/
+void energy_stats(ENERGY_STATS *stats){
+	uint32_t slept[MAX_EM];
+	uint32_t now;
+	uint32_t asleep = 0;
+
+	CORE_DECLARE_IRQ_STATE;
+	CORE_ENTER_CRITICAL();
+	now = timer_now();
+	sleep_residency(slept);
+	for(int i = 0; i < ENERGY_LOADS; i++){
+		uint32_t busy = load_ticks[i];
+		if(load_depth[i]) busy += now - load_start[i];
+		stats->residency.load_ms[i] = TICKS_TO_MS(busy);
+	}
+	CORE_EXIT_CRITICAL();
+
+	for(int i = EM1; i < MAX_EM; i++){
+		stats->residency.mode_ms[i] = TICKS_TO_MS(slept[i]);
+		asleep += slept[i];
+	}
+	stats->residency.mode_ms[EM0] = TICKS_TO_MS((now - open_tick) - asleep);
+
+	energy_estimate(&energy_model, &stats->residency, &stats->estimate);
+}
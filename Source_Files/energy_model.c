@@ -0,0 +1,137 @@
+/**
+ * @file energy_model.c
+ * @author Kay Sho
+ * @date  10/16/2026
+ * @brief Average current and battery life from energy mode residency
+ * @note The author's pronouns: (She/They)
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+
+/* System include statements */
+
+
+/* Silicon Labs include statements */
+
+
+/* The developer's include statements */
+#include "energy_model.h"
+
+
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Weights each mode and load current by its share of the window
+ *
+ * @details
+ *	avg = board + sum(mode_na * mode_ms) / total + sum(load_na * load_ms) / total
+ *	where total is the sum of the mode times. Loads overlap the modes they run
+ *	in, so they only add to the total charge, not to the window.
+ *
+ * @param[in] *model
+ *	Currents and battery capacity
+ *
+ * @param[in] *residency
+ *	Measured or simulated times
+ *
+ * @param[out] *estimate
+ *	Average current, and battery life (0xFFFFFFFF if the average is 0)
+ *
+ ******************************************************************************/
+void energy_estimate(const ENERGY_MODEL *model, const ENERGY_RESIDENCY *residency, ENERGY_ESTIMATE *estimate){
+	uint64_t charge = 0;			// nA * ms
+	uint64_t total_ms = 0;
+
+	for(int i = 0; i < ENERGY_MODES; i++){
+		charge += (uint64_t)model->mode_na[i] * residency->mode_ms[i];
+		total_ms += residency->mode_ms[i];
+	}
+	for(int i = 0; i < ENERGY_LOADS; i++){
+		charge += (uint64_t)model->load_na[i] * residency->load_ms[i];
+	}
+
+	estimate->avg_na = model->board_na + (total_ms ? (uint32_t)(charge / total_ms) : 0);
+	if(estimate->avg_na == 0){
+		estimate->life_hours = 0xFFFFFFFF;
+	} else {
+		estimate->life_hours = (uint32_t)((uint64_t)model->battery_mah * 1000000 / estimate->avg_na);
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Picks the energy mode that spends the least charge on one sleep
+ *
+ * @details
+ *	Each mode from EM1 to deepest costs
+ *		mode_na * (sleep_us - wake_us) + EM0 current * wake_us
+ *	so a deep mode only pays off once the sleep is long enough to win back its
+ *	wakeup. A mode that could not be back in EM0 by the end of the sleep is
+ *	skipped, except EM1, which is always allowed. Ties go to the deeper mode.
+ *
+ * @param[in] *model
+ *	Currents per mode
+ *
+ * @param[in] deepest
+ *	Deepest mode the blocked peripherals allow, EM1 to EM3
+ *
+ * @param[in] sleep_us
+ *	Expected time to the next wakeup, 0xFFFFFFFF if none is known
+ *
+ * @param[in] *wake_us
+ *	Wakeup time of each mode, ENERGY_MODES entries
+ *
+ * @return
+ *	The mode to enter
+ *
+ ******************************************************************************/
+uint32_t energy_cheapest_mode(const ENERGY_MODEL *model, uint32_t deepest, uint32_t sleep_us, const uint32_t *wake_us){
+	uint32_t best = 1;
+	uint64_t best_charge = UINT64_MAX;			// nA * us
+
+	for(uint32_t em = 1; em <= deepest; em++){
+		uint32_t wake = wake_us[em] < sleep_us ? wake_us[em] : sleep_us;
+		uint64_t charge;
+
+		if(em > 1 && wake_us[em] > sleep_us) continue;
+		charge = (uint64_t)model->mode_na[em] * (sleep_us - wake) + (uint64_t)model->mode_na[0] * wake;
+		if(charge <= best_charge){
+			best_charge = charge;
+			best = em;
+		}
+	}
+	return best;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Adds the measured restore time of each mode to its datasheet wakeup time
+ *
+ * @details
+ *	The cycles are rounded up to whole microseconds. With core_mhz 0, before
+ *	the core clock is known, the datasheet times are used alone.
+ *
+ * @param[in] *model
+ *	Datasheet wakeup times
+ *
+ * @param[in] *wake_cycles
+ *	Core cycles spent entering and leaving each mode, ENERGY_MODES entries
+ *
+ * @param[in] core_mhz
+ *	Core clock the cycles were counted at
+ *
+ * @param[out] *wake_us
+ *	Wakeup time of each mode for energy_cheapest_mode(), ENERGY_MODES entries
+ *
+ ******************************************************************************/
+void energy_wake_us(const ENERGY_MODEL *model, const uint32_t *wake_cycles, uint32_t core_mhz, uint32_t *wake_us){
+	for(int i = 0; i < ENERGY_MODES; i++){
+		wake_us[i] = model->wake_us[i] + (core_mhz ? (wake_cycles[i] + core_mhz - 1) / core_mhz : 0);
+	}
+}
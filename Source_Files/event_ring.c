@@ -0,0 +1,139 @@
+/**
+ * @file event_ring.c
+ * @author Kay Sho
+ * @date  10/16/2026
+ * @brief Single-producer/single-consumer ring of scheduler events with payloads
+ * @note The author's pronouns: (She/They)
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+
+/* System include statements */
+
+
+/* Silicon Labs include statements */
+
+
+/* The developer's include statements */
+#include "event_ring.h"
+
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+
+//***********************************************************************************
+// private variables
+//***********************************************************************************
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *   Empties a ring and resets its counters.
+ *
+ * @param[in] *ring
+ *	Ring to reset
+ *
+ ******************************************************************************/
+void event_ring_init(EVENT_RING *ring){
+	ring->head = 0;
+	ring->tail = 0;
+	ring->high_water = 0;
+	ring->overflow = 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Posts one record from the producer side.
+ *
+ * @details
+ *	The record is written before head is advanced, so the consumer never sees a
+ *	half written record. No interrupt masking is needed as long as each ring has
+ *	exactly one producer (one interrupt source) and one consumer (the main loop).
+ *
+ *	The last record is kept for an EVENT_RING_LOST marker. The first post that
+ *	finds the other EVENT_RING_SIZE - 1 taken writes the marker instead, so the
+ *	consumer meets the drop in its place among the records, before anything
+ *	posted once there is room again.
+ *
+ * @param[in] *ring
+ *	Ring owned by the calling interrupt source
+ *
+ * @param[in] event
+ *	Scheduler event ID
+ *
+ * @param[in] payload
+ *	Data that travels with this occurrence of the event
+ *
+ * @param[in] stamp
+ *	Cycle count at the post, for the scheduler's latency histograms
+ *
+ * @return
+ *	false if the ring was full and the record was dropped
+ *
+ ******************************************************************************/
+bool event_ring_post(EVENT_RING *ring, uint32_t event, uint32_t payload, uint32_t stamp){
+	uint32_t head = ring->head;
+	uint32_t count = head - ring->tail;
+
+	if(count >= EVENT_RING_SIZE){
+		ring->overflow++;
+		return false;							// The marker is already the newest record
+	}
+	if(count == EVENT_RING_SIZE - 1){
+		ring->overflow++;
+		event = EVENT_RING_LOST;
+		payload = 0;
+	}
+	ring->records[head & EVENT_RING_MASK].event = event;
+	ring->records[head & EVENT_RING_MASK].payload = payload;
+	ring->records[head & EVENT_RING_MASK].stamp = stamp;
+	__DMB();									// Record must land before it is published
+	ring->head = head + 1;
+
+	if(count + 1 > ring->high_water){
+		ring->high_water = count + 1;
+	}
+	return event != EVENT_RING_LOST;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Takes the oldest record from the consumer side.
+ *
+ * @param[in] *ring
+ *	Ring to read
+ *
+ * @param[out] *record
+ *	Filled with the oldest record
+ *
+ * @return
+ *	false if the ring was empty
+ *
+ ******************************************************************************/
+bool event_ring_get(EVENT_RING *ring, EVENT_RECORD *record){
+	uint32_t tail = ring->tail;
+
+	if(tail == ring->head){
+		return false;
+	}
+	__DMB();									// Read the record only after seeing head move
+	*record = ring->records[tail & EVENT_RING_MASK];
+	ring->tail = tail + 1;
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Returns the number of records waiting in the ring.
+ *
+ ******************************************************************************/
+uint32_t event_ring_count(EVENT_RING *ring){
+	return ring->head - ring->tail;
+}
@@ -0,0 +1,156 @@
+/**
+ * @file frame_ring.c
+ * @author Kay Sho
+ * @date  10/16/2026
+ * @brief Ring of received command frames, parsed in place
+ * @note The author's pronouns: (She/They)
+ *
+ * Each frame is stored as a length record, its characters and a null. A frame
+ * never wraps around the end of the buffer: when the end has less room than
+ * the longest frame, it is marked FRAME_RING_WRAP and the frame starts at the
+ * front. The consumer then gets every frame as one null terminated string.
+ * The producer reserves room for the longest frame before the first
+ * character arrives, so the LDMA can write straight into the ring, and
+ * commits the frame once its signal frame is in.
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+
+/* System include statements */
+
+
+/* Silicon Labs include statements */
+
+
+/* The developer's include statements */
+#include "frame_ring.h"
+
+
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Sets up an empty ring over [buf]
+ *
+ * @param[in] size
+ *	Bytes of buf, room for at least two of the longest frames
+ *
+ * @param[in] frame_max
+ *	Longest frame kept, at most FRAME_RING_FRAME_MAX
+ *
+ ******************************************************************************/
+void frame_ring_init(FRAME_RING *ring, char *buf, uint32_t size, uint32_t frame_max){
+	ring->buf = buf;
+	ring->size = size;
+	ring->frame_max = frame_max;
+	ring->head = 0;
+	ring->tail = 0;
+	ring->frames = 0;
+	ring->overflow = 0;
+	ring->full = 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Producer, room for the next frame
+ *
+ * @details
+ *	Calling it again before frame_ring_commit() returns the same room. The
+ *	head never lands on the tail of a non-empty ring, so head == tail always
+ *	means empty.
+ *
+ * @return
+ *	frame_max + 1 bytes to receive the frame into, NULL while the ring is
+ *	full
+ *
+ ******************************************************************************/
+char *frame_ring_reserve(FRAME_RING *ring){
+	uint32_t need = ring->frame_max + FRAME_RING_OVERHEAD;
+	uint32_t head = ring->head;
+	uint32_t tail = ring->tail;
+
+	if(head < tail){
+		return (tail - head > need) ? &ring->buf[head + 1] : NULL;
+	}
+	if(ring->size - head > need){
+		return &ring->buf[head + 1];
+	}
+	if(tail <= need){
+		return NULL;
+	}
+	ring->buf[head] = (char)FRAME_RING_WRAP;
+	ring->head = 0;
+	return &ring->buf[1];
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Producer, the frame written to the reserved room is complete
+ *
+ * @param[in] len
+ *	Characters of the frame, at most frame_max
+ *
+ ******************************************************************************/
+void frame_ring_commit(FRAME_RING *ring, uint32_t len){
+	uint32_t head = ring->head;
+
+	ring->buf[head] = (char)len;
+	ring->buf[head + 1 + len] = 0;
+	ring->frames++;
+	ring->head = head + 1 + len + 1;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Consumer, the oldest frame where it lies
+ *
+ * @param[out] *len
+ *	Characters of the frame
+ *
+ * @return
+ *	The frame, null terminated and valid until frame_ring_release(), or NULL
+ *	if the ring is empty
+ *
+ ******************************************************************************/
+const char *frame_ring_peek(FRAME_RING *ring, uint32_t *len){
+	uint32_t tail = ring->tail;
+
+	if(tail != ring->head && (uint8_t)ring->buf[tail] == FRAME_RING_WRAP){
+		tail = 0;
+		ring->tail = 0;
+	}
+	if(tail == ring->head){
+		return NULL;
+	}
+	*len = (uint8_t)ring->buf[tail];
+	return &ring->buf[tail + 1];
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Consumer, frees the oldest frame
+ *
+ ******************************************************************************/
+void frame_ring_release(FRAME_RING *ring){
+	uint32_t len;
+
+	if(frame_ring_peek(ring, &len) != NULL){
+		ring->tail += 1 + len + 1;
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Copies out the counters
+ *
+ ******************************************************************************/
+void frame_ring_stats(const FRAME_RING *ring, FRAME_RING_STATS *stats){
+	stats->frames = ring->frames;
+	stats->overflow = ring->overflow;
+	stats->full = ring->full;
+}
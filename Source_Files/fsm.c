@@ -0,0 +1,71 @@
+/**
+ * @file fsm.c
+ * @author Kay Sho
+ * @date  10/16/2026
+ * @brief Transition table state machines for the peripheral drivers
+ * @note The author's pronouns: (She/They)
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+
+/* System include statements */
+
+
+/* Silicon Labs include statements */
+
+
+/* The developer's include statements */
+#include "fsm.h"
+
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+
+
+//***********************************************************************************
+// private variables
+//***********************************************************************************
+
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Binds a state machine to its table and enters the first state
+ *
+ * @param[in] *table
+ *	const, so it is placed in flash
+ *
+ * @param[in] state
+ *	Initial state, not traced
+ *
+ ******************************************************************************/
+void fsm_init(FSM *fsm, const FSM_TABLE *table, uint32_t state){
+	EFM_ASSERT(table->states <= FSM_STATES_MAX && table->causes <= FSM_CAUSES_MAX);
+	EFM_ASSERT(state < table->states);
+
+	fsm->table = table;
+	fsm->state = state;
+	fsm->last_illegal = 0;
+	fsm->illegal = 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Action of a transition that only changes state
+ *
+ ******************************************************************************/
+void fsm_nop(void *ctx){
+	(void)ctx;
+}
@@ -25,41 +25,219 @@
 // defined files
 //***********************************************************************************
 #define I2C_FREQ_FAST_MAX   392157 // Because the Si7021 works on 400kHz, we use the FAST
+#define I2C_QUEUE_SLOTS		(I2C_QUEUE_SIZE + 1)		// One for the transfer on the bus
+#define I2C_CURRENT(sm)		(&(sm)->queue[(sm)->tail])
+#define I2C_IEN_BYTES		(I2C_IEN_ACK | I2C_IEN_NACK | I2C_IEN_RXDATAV | I2C_IEN_MSTOP)
+#define I2C_IEN_DMA			(I2C_IEN_NACK | I2C_IEN_MSTOP)	// Per phase TXC and RXDATAV are added
+#define I2C_DMA_RX_MIN		2			// Shorter reads are one RXDATAV interrupt anyway
+#define I2C_IEN_ERRORS		(I2C_IEN_ARBLOST | I2C_IEN_BUSERR)
+#define I2C_RECOVER_STOP	(RESET_TOGGLE_NUMBER + 1)	// Recovery steps after the SCL toggles send the STOP
+#define I2C_TICKS_TO_MS(t)	(((t) * 1000 + LETIMER_HZ - 1) / LETIMER_HZ)
+
+// Context index of each instance enabled in brd_config.h
+enum{
+#ifdef I2C0_ENABLED
+	I2C_SM_I2C0,
+#endif
+#ifdef I2C1_ENABLED
+	I2C_SM_I2C1,
+#endif
+	I2C_INSTANCES
+};
 
 //***********************************************************************************
 // private variables
 //***********************************************************************************
-static void i2c_bus_reset(I2C_TypeDef *i2c);
-
-static void i2c_ack(void); // functions contain states
-static void i2c_nack(void);
-static void i2c_rxdatav(void);
-static void i2c_mstop(void);
-
 typedef enum{
 		IDLE,
-		REQUEST_DEVICE,
-		WRITE_DEVICE,
-		WAIT_CONVERSION,
-		READ_DEVICE,
-		CLOSE
+		REQUEST_DEVICE,		// Write address sent
+		WRITE_DEVICE,		// Sending the tx bytes
+		WAIT_CONVERSION,	// Read address sent, waiting for the device to ACK it
+		READ_DEVICE,		// Receiving the rx bytes
+		CLOSE,				// STOP sent, waiting for MSTOP
+		RESET,				// START and STOP sent by i2c_open(), waiting for MSTOP
+		RECOVER,			// Peripheral aborted, SCL is being clocked by hand
+		BACKOFF,			// Waiting to retry the transfer at the tail
+		I2C_STATES
 }I2C_STATE;
 
+/* Interrupt causes, the columns of i2c_transitions */
+typedef enum{
+		I2C_CAUSE_ACK,
+		I2C_CAUSE_NACK,
+		I2C_CAUSE_RXDATAV,
+		I2C_CAUSE_TXC,		// DMA mode only
+		I2C_CAUSE_MSTOP,
+		I2C_CAUSES
+}I2C_CAUSE;
+
+/* Indexes into i2c_actions */
+enum{
+		I2C_ACT_UNEXPECTED = FSM_ILLEGAL,
+		I2C_ACT_NONE,
+		I2C_ACT_WRITE,
+		I2C_ACT_NACKED,
+		I2C_ACT_READ_NACKED,
+		I2C_ACT_READ,
+		I2C_ACT_TX_DONE,
+		I2C_ACT_TXC_STALE,
+		I2C_ACT_NEXT,
+		I2C_ACT_RESET_DONE
+};
 
+/* What differs between the peripherals, fixed at compile time */
 typedef struct{
+	I2C_TypeDef*			i2c;
+	CMU_Clock_TypeDef		clock;
+	IRQn_Type				irq;
+	uint32_t				dma_ch;				// LDMA_CH_x
+	LDMA_PeripheralSignal_t	dma_tx_signal;
+	LDMA_PeripheralSignal_t	dma_rx_signal;
+	uint32_t				sched_src;			// SCHED_SRC_x ring the completions are posted to
+	uint32_t				trace_irq;			// TRACE_IRQ_x
+	SCHEDULER_HANDLER		watchdog;			// Bound to this instance's context
+}I2C_INSTANCE;
+
+typedef struct{
+	const I2C_INSTANCE*		hw;
 	I2C_TypeDef* 			i2c;				// I2C Peripheral
-	uint8_t 				dev_addr; 			// I2C Device Address (Si7021)
-	uint8_t					reg_addr;			// I2C Requested Register address (also known as command address?)
-	bool					rw_mode;			// Read 1/Write 0
-	uint32_t*				sm_data;			// Pointer to where to store read result / write data
-	uint8_t					sm_data_len;
-	uint8_t					transfer_bytes;		// how many bytes to transfer
-	uint32_t				event;
-	I2C_STATE				state;			// State
+	I2C_TRANSFER			queue[I2C_QUEUE_SLOTS];	// queue[tail] is the one on the bus
+	uint8_t					head;				// Next free slot
+	uint8_t					tail;
+	uint8_t					sent;				// tx bytes written of the current transfer
+	uint8_t					received;			// rx bytes read of the current transfer
+	bool					dma;				// Data bytes move on the LDMA
+	FSM						fsm;				// State, see i2c_transitions
+	uint32_t				ien;				// Interrupts enabled between transfers
+	bool					held;				// EM2 blocked and the I2C load counted
+	bool					active;				// The transfer at the tail has been started
+	bool					unpowered;			// Pull-up supply switched off, see i2c_bus_powered()
+	uint8_t					attempts;			// Failed attempts of the transfer at the tail
+	uint8_t					recover_step;
+	uint32_t				wake_tick;			// Timeout, next recovery step or end of the backoff
+	uint32_t				watchdog_event;
+	uint32_t				timer;				// Timer wheel handle, main loop only
+	uint32_t				timer_due;
+	bool					timer_pending;
+	uint32_t				scl_port;
+	uint32_t				scl_pin;
+	uint32_t				sda_port;
+	uint32_t				sda_pin;
+	I2C_ERROR_STATS			stats;
 
 }I2C_STATE_MACHINE;
 
-static I2C_STATE_MACHINE i2c_sm;
+static void i2c_irq(I2C_STATE_MACHINE *sm);
+static void i2c_bus_reset(I2C_STATE_MACHINE *sm);
+
+static void i2c_act_unexpected(void *ctx); // actions of the transitions
+static void i2c_act_write(void *ctx);
+static void i2c_act_nacked(void *ctx);
+static void i2c_act_read_nacked(void *ctx);
+static void i2c_act_read(void *ctx);
+static void i2c_act_tx_done(void *ctx);
+static void i2c_act_txc_stale(void *ctx);
+static void i2c_act_next(void *ctx);
+static void i2c_act_reset_done(void *ctx);
+static void i2c_dma_rx_done(void *arg);
+
+static void i2c_begin(I2C_STATE_MACHINE *sm);
+static void i2c_write_next(I2C_STATE_MACHINE *sm);
+static void i2c_read_begin(I2C_STATE_MACHINE *sm);
+static void i2c_finish(I2C_STATE_MACHINE *sm, uint32_t status);
+static void i2c_set_state(I2C_STATE_MACHINE *sm, uint32_t state);
+
+static void i2c_watchdog(I2C_STATE_MACHINE *sm);
+static void i2c_fault(I2C_STATE_MACHINE *sm, uint32_t *counter);
+static void i2c_recover_step(I2C_STATE_MACHINE *sm);
+static void i2c_recovered(I2C_STATE_MACHINE *sm);
+static void i2c_complete(I2C_STATE_MACHINE *sm, uint32_t status);
+static void i2c_next(I2C_STATE_MACHINE *sm);
+static void i2c_hold(I2C_STATE_MACHINE *sm, bool hold);
+static inline I2C_STATE_MACHINE *i2c_context(I2C_TypeDef *i2c);
+
+#ifdef I2C0_ENABLED
+static void i2c0_watchdog(uint32_t payload);
+#endif
+#ifdef I2C1_ENABLED
+static void i2c1_watchdog(uint32_t payload);
+#endif
+
+static const I2C_INSTANCE i2c_instances[I2C_INSTANCES] = {
+#ifdef I2C0_ENABLED
+	[I2C_SM_I2C0] = {I2C0, cmuClock_I2C0, I2C0_IRQn, LDMA_CH_I2C0, ldmaPeripheralSignal_I2C0_TXBL,
+			ldmaPeripheralSignal_I2C0_RXDATAV, SCHED_SRC_I2C0, TRACE_IRQ_I2C0, i2c0_watchdog},
+#endif
+#ifdef I2C1_ENABLED
+	[I2C_SM_I2C1] = {I2C1, cmuClock_I2C1, I2C1_IRQn, LDMA_CH_I2C1, ldmaPeripheralSignal_I2C1_TXBL,
+			ldmaPeripheralSignal_I2C1_RXDATAV, SCHED_SRC_I2C1, TRACE_IRQ_I2C1, i2c1_watchdog},
+#endif
+};
+
+static I2C_STATE_MACHINE i2c_sm[I2C_INSTANCES] = {
+#ifdef I2C0_ENABLED
+	[I2C_SM_I2C0] = {.hw = &i2c_instances[I2C_SM_I2C0]},
+#endif
+#ifdef I2C1_ENABLED
+	[I2C_SM_I2C1] = {.hw = &i2c_instances[I2C_SM_I2C1]},
+#endif
+};
+
+static const FSM_ACTION i2c_actions[] = {
+	[I2C_ACT_UNEXPECTED]	= i2c_act_unexpected,
+	[I2C_ACT_NONE]			= fsm_nop,
+	[I2C_ACT_WRITE]			= i2c_act_write,
+	[I2C_ACT_NACKED]		= i2c_act_nacked,
+	[I2C_ACT_READ_NACKED]	= i2c_act_read_nacked,
+	[I2C_ACT_READ]			= i2c_act_read,
+	[I2C_ACT_TX_DONE]		= i2c_act_tx_done,
+	[I2C_ACT_TXC_STALE]		= i2c_act_txc_stale,
+	[I2C_ACT_NEXT]			= i2c_act_next,
+	[I2C_ACT_RESET_DONE]	= i2c_act_reset_done,
+};
+
+/* Every transition not listed is unexpected and aborts the transfer, see i2c_fault() */
+static const FSM_TRANSITION i2c_transitions[I2C_STATES][I2C_CAUSES] = {
+	[IDLE] = {
+		[I2C_CAUSE_TXC]		= {I2C_ACT_TXC_STALE, FSM_STAY},
+	},
+	[REQUEST_DEVICE] = {	// Device answered its write address
+		[I2C_CAUSE_ACK]		= {I2C_ACT_WRITE, WRITE_DEVICE},
+		[I2C_CAUSE_NACK]	= {I2C_ACT_NACKED, FSM_STAY},
+		[I2C_CAUSE_TXC]		= {I2C_ACT_TXC_STALE, FSM_STAY},
+	},
+	[WRITE_DEVICE] = {
+		[I2C_CAUSE_ACK]		= {I2C_ACT_WRITE, FSM_STAY},
+		[I2C_CAUSE_NACK]	= {I2C_ACT_NACKED, FSM_STAY},
+		[I2C_CAUSE_TXC]		= {I2C_ACT_TX_DONE, FSM_STAY},
+	},
+	[WAIT_CONVERSION] = {	// Device answered its read address, RXDATAV follows
+		[I2C_CAUSE_ACK]		= {I2C_ACT_NONE, READ_DEVICE},
+		[I2C_CAUSE_NACK]	= {I2C_ACT_READ_NACKED, FSM_STAY},
+		[I2C_CAUSE_RXDATAV]	= {I2C_ACT_READ, READ_DEVICE},	// ACK and RXDATAV in the same interrupt
+		[I2C_CAUSE_TXC]		= {I2C_ACT_TXC_STALE, FSM_STAY},
+	},
+	[READ_DEVICE] = {
+		[I2C_CAUSE_RXDATAV]	= {I2C_ACT_READ, FSM_STAY},
+		[I2C_CAUSE_TXC]		= {I2C_ACT_TXC_STALE, FSM_STAY},
+	},
+	[CLOSE] = {
+		[I2C_CAUSE_TXC]		= {I2C_ACT_TXC_STALE, FSM_STAY},
+		[I2C_CAUSE_MSTOP]	= {I2C_ACT_NEXT, FSM_STAY},		// Queued behind a NACKed transfer, or IDLE
+	},
+	[RESET] = {
+		[I2C_CAUSE_TXC]		= {I2C_ACT_TXC_STALE, FSM_STAY},
+		[I2C_CAUSE_MSTOP]	= {I2C_ACT_RESET_DONE, FSM_STAY},
+	},
+	[RECOVER] = {
+		[I2C_CAUSE_TXC]		= {I2C_ACT_TXC_STALE, FSM_STAY},
+	},
+	[BACKOFF] = {
+		[I2C_CAUSE_TXC]		= {I2C_ACT_TXC_STALE, FSM_STAY},
+	},
+};
+
+static const FSM_TABLE i2c_table = {&i2c_transitions[0][0], i2c_actions, I2C_STATES, I2C_CAUSES, TRACE_I2C_STATE};
 //***********************************************************************************
 // Global functions
 //***********************************************************************************
@@ -71,6 +249,8 @@ static I2C_STATE_MACHINE i2c_sm;
  * @details
  * recall si7021 calls the i2c_Start function
  * @note
+ * The bus reset at the end does not wait for its STOP. Transfers queued
+ * before it completes start once it has.
  *
  * @param[in] *i2c
  *
@@ -84,10 +264,9 @@ static I2C_STATE_MACHINE i2c_sm;
 void i2c_open(I2C_TypeDef *i2c, I2C_OPEN_STRUCT *i2c_setup)
 
 {
-	if (i2c == I2C0) // Establish what I2C peripheral we're using
-	CMU_ClockEnable(cmuClock_I2C0, true);
-	else if(i2c == I2C1)
-		CMU_ClockEnable(cmuClock_I2C1, true);
+	I2C_STATE_MACHINE *sm = i2c_context(i2c);
+
+	CMU_ClockEnable(sm->hw->clock, true);
 	if ((i2c->IF & 0x01) == 0)
 	{
 	i2c->IFS = 0x01;
@@ -123,7 +302,7 @@ void i2c_open(I2C_TypeDef *i2c, I2C_OPEN_STRUCT *i2c_setup)
 
 	// Setting interrupt flag bits:
 
-	uint32_t i2c_interrupts = I2C_IEN_ACK | I2C_IEN_NACK | I2C_IEN_RXDATAV | I2C_IEN_MSTOP;
+	uint32_t i2c_interrupts = (i2c_setup->dma ? I2C_IEN_DMA : I2C_IEN_BYTES) | I2C_IEN_ERRORS;
 
 	//Interrupts + NVIC
 
@@ -131,329 +310,882 @@ void i2c_open(I2C_TypeDef *i2c, I2C_OPEN_STRUCT *i2c_setup)
 
 	I2C_IntEnable(i2c, i2c_interrupts);
 
-	if(i2c == I2C0){
-		NVIC_EnableIRQ(I2C0_IRQn);
-	} else if (i2c == I2C1){
-		NVIC_EnableIRQ(I2C1_IRQn);
-	} else {
-		EFM_ASSERT(false);
+	NVIC_EnableIRQ(sm->hw->irq);
+	sm->ien = i2c_interrupts;
+	sm->dma = i2c_setup->dma;
+	if(sm->dma){
+		ldma_open();
 	}
-	i2c_bus_reset(i2c);
-	i2c_sm.state = IDLE;
+	sm->i2c = i2c;
+	sm->head = 0;
+	sm->tail = 0;
+	fsm_init(&sm->fsm, &i2c_table, IDLE);
+	sm->held = false;
+	sm->active = false;
+	sm->unpowered = false;
+	sm->attempts = 0;
+	sm->timer_pending = false;
+	sm->scl_port = i2c_setup->scl_port;
+	sm->scl_pin = i2c_setup->scl_pin;
+	sm->sda_port = i2c_setup->sda_port;
+	sm->sda_pin = i2c_setup->sda_pin;
+	sm->watchdog_event = i2c_setup->watchdog_event;
+	scheduler_register(sm->watchdog_event, sm->hw->watchdog, SCHED_PRIO_HIGH);
+
+	CORE_DECLARE_IRQ_STATE;
+	CORE_ENTER_CRITICAL();
+	i2c_bus_reset(sm);
+	CORE_EXIT_CRITICAL();
 }
 
 /***************************************************************************//**
  * @brief
  *
- * Function that starts the I2C bus
+ * Queues an I2C transaction
  *
  * @details
  *
- * recall si7021 calls the i2c_Start function
+ * If the bus is idle the transaction starts right away. Otherwise it waits
+ * in the queue and is started with a repeated start as soon as the one ahead
+ * of it ends, so queued transactions run back to back without the bus going
+ * idle in between. Callable from the scheduler and from interrupt handlers.
+ * Each bus has its own queue and state machine, so transfers on I2C0 and
+ * I2C1 run at the same time.
  *
  * @note
  *
- * All of the parameters can be found in the i2c.h header file, in the state machine struct
+ * EM2 stays blocked from the first start to the last stop.
+ *
+ * A transfer that holds the bus for more than I2C_TIMEOUT_MS, or that ends in
+ * arbitration loss, a bus error or an interrupt the state machine does not
+ * expect, is aborted. The bus is then recovered, see i2c_recover_step(), and
+ * the transfer retried up to I2C_RETRY_MAX times, I2C_BACKOFF_MS apart and
+ * doubling. After that its event is posted with I2C_PAYLOAD_ERROR. A NACK is
+ * the device's answer and is posted as is, not retried.
+ *
+ * When the bus was opened with dma set, the tx bytes are moved by the LDMA
+ * and only the final TXC interrupts, and all but the last rx byte are moved
+ * by the LDMA with AUTOACK, so a read costs the LDMA done interrupt and one
+ * RXDATAV for the last byte, which must be NACKed by the CPU. Address ACKs
+ * are not interrupted on, NACKs still are.
  *
  * @param[in] *i2c
- * built in struct for the i2c
+ * The peripheral passed to i2c_open()
  *
- * @param[in] dev_addr
- * Defined Device address (In this case the Si7021 Temperature Sensor
+ * @param[in] *transfer
+ * Copied into the queue, the buffers it points to are not
+ ******************************************************************************/
+void i2c_transfer(I2C_TypeDef *i2c, const I2C_TRANSFER *transfer)
+
+{
+	I2C_STATE_MACHINE *sm = i2c_context(i2c);
+	uint8_t next;
+
+	EFM_ASSERT(sm->i2c == i2c);						// Not opened
+	EFM_ASSERT(transfer->rx_len == 0 || transfer->rx != NULL);
+	EFM_ASSERT(transfer->tx_len == 0 || transfer->tx != NULL);
+
+	CORE_DECLARE_IRQ_STATE;
+	CORE_ENTER_CRITICAL();
+	if(sm->unpowered){
+		sm->stats.failed++;						// Nothing can answer, see i2c_bus_powered()
+		if(transfer->event != I2C_NO_EVENT){
+			scheduler_post(sm->hw->sched_src, transfer->event, I2C_PAYLOAD_ERROR);
+		}
+		CORE_EXIT_CRITICAL();
+		return;
+	}
+	next = (sm->head + 1) % I2C_QUEUE_SLOTS;
+	EFM_ASSERT(next != sm->tail);				// Queue full
+	sm->queue[sm->head] = *transfer;
+	sm->head = next;
+	if(sm->fsm.state == IDLE){
+		if((i2c->STATE & _I2C_STATE_STATE_MASK) == I2C_STATE_STATE_IDLE){
+			i2c_begin(sm);
+		} else {
+			i2c_fault(sm, &sm->stats.bus_error);
+		}
+	}
+	CORE_EXIT_CRITICAL();
+}
+
+/***************************************************************************//**
+ * @brief
+ * Queues a plain write, see i2c_transfer()
+ ******************************************************************************/
+void i2c_write(I2C_TypeDef *i2c, uint8_t dev_addr, const uint8_t *tx, uint8_t tx_len, uint32_t event){
+	I2C_TRANSFER transfer = {dev_addr, 0, tx, tx_len, NULL, 0, event};
+	i2c_transfer(i2c, &transfer);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Queues a plain read, see i2c_transfer()
+ ******************************************************************************/
+void i2c_read(I2C_TypeDef *i2c, uint8_t dev_addr, uint8_t *rx, uint8_t rx_len, uint32_t event){
+	I2C_TRANSFER transfer = {dev_addr, 0, NULL, 0, rx, rx_len, event};
+	i2c_transfer(i2c, &transfer);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Queues a write followed by a repeated start read, see i2c_transfer()
+ ******************************************************************************/
+void i2c_write_read(I2C_TypeDef *i2c, uint8_t dev_addr, const uint8_t *tx, uint8_t tx_len, uint8_t *rx, uint8_t rx_len, uint32_t event){
+	I2C_TRANSFER transfer = {dev_addr, 0, tx, tx_len, rx, rx_len, event};
+	i2c_transfer(i2c, &transfer);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns a bus's error counters since i2c_open()
  *
- * @param[in] rw_mode
- * input to indicate whether in read or write mode
+ * @param[in] *i2c
+ * The peripheral passed to i2c_open()
  *
- * @param[in] reg_addr
- * Register address (AKA Command address) is the input for the Si7021 command address
+ * @param[out] *stats
+ * Copy of the counters
+ ******************************************************************************/
+void i2c_error_stats(I2C_TypeDef *i2c, I2C_ERROR_STATS *stats){
+	I2C_STATE_MACHINE *sm = i2c_context(i2c);
+
+	CORE_DECLARE_IRQ_STATE;
+	CORE_ENTER_CRITICAL();
+	*stats = sm->stats;
+	CORE_EXIT_CRITICAL();
+}
+
+/***************************************************************************//**
+ * @brief
+ * Tells the driver the supply of the bus pull-ups was switched
+ *
+ * @details
+ *
+ * While the supply is off both lines sit low. The pins are taken from the
+ * peripheral and its interrupts masked, so the lines falling is not taken
+ * for a START or a bus error. Once it is back the peripheral is aborted, so
+ * it takes the bus as idle without having seen a STOP.
  *
- * @param[in] sm_data
- * This is the incoming data from the state machine
+ * @note
  *
- * @param[in] sm_data_len
- * state machine Data array length
+ * The bus must be idle with nothing queued when it is switched off. Until it
+ * is switched on again every transfer fails at once with I2C_PAYLOAD_ERROR,
+ * e.g. one to another device on the same bus.
  *
- * @param[in]  event
- * Scheduled event defined and called in app.c/.h
+ * @param[in] *i2c
+ * The peripheral passed to i2c_open()
  *
- * @param[in] enable
- * Enables i2c start (unnecessary, can remove later)
+ * @param[in] powered
+ * true right after the supply is switched on, false right before it is
+ * switched off
  ******************************************************************************/
-void i2c_start(I2C_TypeDef *i2c, uint8_t dev_addr, bool rw_mode, uint8_t reg_addr, uint32_t* sm_data, uint8_t sm_data_len, uint32_t event, bool enable)
-
-{
-	EFM_ASSERT((i2c->STATE & _I2C_STATE_STATE_MASK) == I2C_STATE_STATE_IDLE);
-
-	sleep_block_mode(I2C_EM_BLOCK);
+void i2c_bus_powered(I2C_TypeDef *i2c, bool powered){
+	I2C_STATE_MACHINE *sm = i2c_context(i2c);
 
-	i2c_sm.i2c = i2c;
-	i2c_sm.dev_addr = dev_addr;
-	i2c_sm.reg_addr = reg_addr;
-	i2c_sm.rw_mode = I2C_READ;
-	i2c_sm.sm_data = sm_data;
-	i2c_sm.sm_data_len = sm_data_len;
-	i2c_sm.transfer_bytes = 0;
-	i2c_sm.state = REQUEST_DEVICE;
-	i2c_sm.event = event;
+	CORE_DECLARE_IRQ_STATE;
+	CORE_ENTER_CRITICAL();
+	sm->unpowered = !powered;
+	if(powered){
+		i2c->ROUTEPEN |= I2C_ROUTEPEN_SCLPEN | I2C_ROUTEPEN_SDAPEN;
+		i2c->CMD = I2C_CMD_ABORT;
+		i2c->IFC = i2c->IF;
+		i2c->IEN = sm->ien;
+	} else {
+		EFM_ASSERT(sm->fsm.state == IDLE && sm->head == sm->tail);
+		i2c->IEN = 0;
+		i2c->ROUTEPEN &= ~(I2C_ROUTEPEN_SCLPEN | I2C_ROUTEPEN_SDAPEN);
+	}
+	CORE_EXIT_CRITICAL();
+}
 
+#ifdef I2C0_ENABLED
+/***************************************************************************//**
+ * @brief
+ *
+ * 		IRQ Handler for I2C0
+ *
+ * @details
+ *
+ * 		Bound to the I2C0 context at compile time, see i2c_irq()
+ *
+ ******************************************************************************/
+void I2C0_IRQHandler(void){
+	i2c_irq(&i2c_sm[I2C_SM_I2C0]);
+}
+#endif
 
-	i2c_sm.i2c->CMD = I2C_CMD_START; // Set start bit (?)
-	i2c_sm.i2c->TXDATA = (i2c_sm.dev_addr << 1) | I2C_WRITE; //(TXData: read/write?)
+#ifdef I2C1_ENABLED
+/***************************************************************************//**
+ * @brief
+ *
+ * 		IRQ Handler for I2C1
+ *
+ * @details
+ *
+ * 		Bound to the I2C1 context at compile time, see i2c_irq()
+ *
+ ******************************************************************************/
+void I2C1_IRQHandler(void){
+	i2c_irq(&i2c_sm[I2C_SM_I2C1]);
 }
+#endif
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
 
 /***************************************************************************//**
  * @brief
  *
- * 		IRQ Handler for I2C0
+ * 		Interrupt Service Routine shared by the I2C instances
  *
  * @details
  *
- * 		This function sets up the Interrupt Service Routine for the I2C
+ * 		Runs the state machine of the bus whose handler called it
  *
  * @note
  *
  *		Just like how the IRQHandler function for the LETIMER has cases for  Comp0, Comp1 and UF,
- *		The I2C0 IRQHandler function will handle it's own cases. These are as determined in the
+ *		The I2C IRQHandler function will handle it's own cases. These are as determined in the
  *		software ladder flowchart:
  *		> ACK
  *		> NACK
  *		> RXDATAV (Received data value)
  *		> MSTOP
  *
+ *		Each is one lookup in i2c_transitions, by state and cause, and one call
+ *		of the action it names. Arbitration loss and bus errors abort the
+ *		transfer in any state, see i2c_fault().
  *
  ******************************************************************************/
-void I2C0_IRQHandler(void){
+static void i2c_irq(I2C_STATE_MACHINE *sm){
 
 	uint32_t int_flag;
-	int_flag = I2C0->IF & I2C0->IEN; 	// We can also use the I2C_IntXYZ functions
-	I2C0->IFC = int_flag;				// I2C_IntGet/Enabled/Clear
+	int_flag = sm->i2c->IF & sm->i2c->IEN; 	// We can also use the I2C_IntXYZ functions
+	sm->i2c->IFC = int_flag;				// I2C_IntGet/Enabled/Clear
+	TRACE(sm->hw->trace_irq, int_flag);
+
+	if(int_flag & (I2C_IF_ARBLOST | I2C_IF_BUSERR))
+	{i2c_fault(sm, &sm->stats.bus_error); return;}
 
 	if(int_flag & I2C_IF_ACK)
-	{i2c_ack();}
+	{fsm_dispatch(&sm->fsm, I2C_CAUSE_ACK, sm);}
 
 	if(int_flag & I2C_IF_NACK)
-	{i2c_nack();}
+	{fsm_dispatch(&sm->fsm, I2C_CAUSE_NACK, sm);}
 
 	if(int_flag & I2C_IF_RXDATAV)
-	{i2c_rxdatav();}
+	{fsm_dispatch(&sm->fsm, I2C_CAUSE_RXDATAV, sm);}
+
+	if(int_flag & I2C_IF_TXC)
+	{fsm_dispatch(&sm->fsm, I2C_CAUSE_TXC, sm);}
 
 	if(int_flag & I2C_IF_MSTOP)
-	{i2c_mstop();}
+	{fsm_dispatch(&sm->fsm, I2C_CAUSE_MSTOP, sm);}
 }
+
 /***************************************************************************//**
  * @brief
- * Sets up the possible cases for the Acknowledge Interrupt
+ * Action of the transitions i2c_transitions does not list
  *
  * @details
  *
- * In the case that an ACK is detected, the different cases of the ACK switch statement are defined
+ * An interrupt the state machine has no transition for aborts the transfer
+ * and recovers the bus. The FSM counts it as well, with its state and cause.
  *
- * @note
+ ******************************************************************************/
+static void i2c_act_unexpected(void *ctx){
+	I2C_STATE_MACHINE *sm = ctx;
+	i2c_fault(sm, &sm->stats.unexpected);
+}
+
+/***************************************************************************//**
+ * @brief
+ * ACK of the write address or of a tx byte
+ *
+ ******************************************************************************/
+static void i2c_act_write(void *ctx){
+	i2c_write_next(ctx);
+}
+
+/***************************************************************************//**
+ * @brief
+ * NACK of the write address or of a tx byte, the transfer ends
+ *
+ ******************************************************************************/
+static void i2c_act_nacked(void *ctx){
+	i2c_finish(ctx, I2C_PAYLOAD_NACK);
+}
+
+/***************************************************************************//**
+ * @brief
+ * NACK of the read address
+ *
+ * @details
+ *
+ * A device that is still converting NACKs its read address. With
+ * I2C_FLAG_POLL_READ the address is sent again, otherwise the transfer ends.
+ *
+ ******************************************************************************/
+static void i2c_act_read_nacked(void *ctx){
+	I2C_STATE_MACHINE *sm = ctx;
+
+	if(I2C_CURRENT(sm)->flags & I2C_FLAG_POLL_READ)
+	{
+		sm->i2c->CMD = I2C_CMD_START;
+		sm->i2c->TXDATA = (I2C_CURRENT(sm)->dev_addr << 1) | I2C_READ;
+	} else {
+		i2c_finish(sm, I2C_PAYLOAD_NACK);
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ * RXDATAV, one rx byte
+ *
+ * @details
  *
- * WAIT_CONVERSION case is equivalent to what others call 'Receive MSB'
- * READ_DEVICE case is equivalent to what others call 'Receive LSB'
- *
- ******************************************************************************/
-static void i2c_ack(){
-
-	switch(i2c_sm.state){
-		case IDLE:
-			EFM_ASSERT(false);
-			break;
-		case REQUEST_DEVICE: // "requesting device" to send measurement
-			i2c_sm.state = WRITE_DEVICE;
-			i2c_sm.i2c->TXDATA = i2c_sm.reg_addr;
-			break;
-		case WRITE_DEVICE:
-			if(i2c_sm.rw_mode)
-			{
-				i2c_sm.state = WAIT_CONVERSION;
-				i2c_sm.i2c->CMD = I2C_CMD_START;
-				i2c_sm.i2c->TXDATA = (i2c_sm.dev_addr << 1) | I2C_READ;
-			}
-			break;
-		case WAIT_CONVERSION:
-			i2c_sm.state = READ_DEVICE;
-			break;
-		case READ_DEVICE:
-			EFM_ASSERT(false);
-			break;
-		case CLOSE:
-			EFM_ASSERT(false);
-			break;
-		default:
-			EFM_ASSERT(false);
-			break;
+ * Every byte but the last is ACKed. The last is NACKed and ends the transfer.
+ *
+ ******************************************************************************/
+static void i2c_act_read(void *ctx){
+	I2C_STATE_MACHINE *sm = ctx;
+	I2C_TRANSFER *transfer = I2C_CURRENT(sm);
+
+	transfer->rx[sm->received++] = sm->i2c->RXDATA; // Read RXDATA register from i2c
+	if(sm->received < transfer->rx_len){
+		sm->i2c->CMD = I2C_CMD_ACK;		// More to come
+	} else {
+		sm->i2c->CMD = I2C_CMD_NACK;		// Last byte
+		i2c_finish(sm, sm->received);
 	}
 }
+
 /***************************************************************************//**
  * @brief
- * NACK case statement
+ * TXC, DMA mode only
  *
  * @details
  *
- * In the case that a NACK is detected, the following states will do as such.
+ * The LDMA has written every tx byte and the last one has been shifted out.
+ * A NACK for it is handled first, by i2c_act_nacked(), and ends the transfer.
+ *
+ ******************************************************************************/
+static void i2c_act_tx_done(void *ctx){
+	I2C_STATE_MACHINE *sm = ctx;
+
+	sm->i2c->IEN &= ~I2C_IEN_TXC;
+	sm->sent = I2C_CURRENT(sm)->tx_len;
+	i2c_write_next(sm);
+}
+
+/***************************************************************************//**
+ * @brief
+ * TXC left over after a NACK ended the DMA write
+ *
+ ******************************************************************************/
+static void i2c_act_txc_stale(void *ctx){
+	I2C_STATE_MACHINE *sm = ctx;
+	sm->i2c->IEN &= ~I2C_IEN_TXC;
+}
+
+/***************************************************************************//**
+ * @brief
+ * MSTOP after a transfer ended
+ *
+ ******************************************************************************/
+static void i2c_act_next(void *ctx){
+	i2c_next(ctx);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	MSTOP of the bus reset from i2c_open()
  *
  * @note
  *
- * Only WAIT_CONVERSION houses actionable code.
- *
- ******************************************************************************/
-
-static void i2c_nack(){
-	uint8_t data;
-	switch(i2c_sm.state){
-		case IDLE:
-			EFM_ASSERT(false);
-			break;
-		case REQUEST_DEVICE:
-			EFM_ASSERT(false);
-			break;
-		case WRITE_DEVICE:
-			EFM_ASSERT(false);
-			break;
-		case WAIT_CONVERSION:
-			if(i2c_sm.rw_mode)
-			{
-				i2c_sm.i2c->CMD = I2C_CMD_START;
-				data =  (i2c_sm.dev_addr << 1) | I2C_READ;
-				i2c_sm.i2c->TXDATA = data;
-			}
-			break;
-		case READ_DEVICE:
-			EFM_ASSERT(false);
-			break;
-		case CLOSE:
-			EFM_ASSERT(false);
-			break;
-		default:
-			EFM_ASSERT(false);
-			break;
-	}
+ * While not standard standard terminology, my code will use Manager/Subscriber terminology in place of Master/Slave
+ *
+ ******************************************************************************/
+static void i2c_act_reset_done(void *ctx){
+	I2C_STATE_MACHINE *sm = ctx;
+
+	sm->i2c->IFC = I2C_IFC_START;
+	sm->i2c->IEN = sm->ien;
+	sm->i2c->CMD = I2C_CMD_ABORT;	// Reset the i2c peripheral state machine
+	i2c_next(sm);
 }
 
 /***************************************************************************//**
  * @brief
  *
- * RXDATAV case statement
+ * Contains the I2C Bus reset function
  *
  * @details
  *
- * Establishes all of the cases for the RXDATAV interrupt.
+ * Resets/clears the states of the I2C Bus, clearing enabled interrupts and interrupt flags.
  *
  * @note
  *
- * Actionable code is located in WAIT_CONVERSION and READ_DEVICE cases.
- *
- ******************************************************************************/
-
-static void i2c_rxdatav(){
-	switch(i2c_sm.state){
-		case IDLE:
-			EFM_ASSERT(false);
-			break;
-
-		case REQUEST_DEVICE:
-			EFM_ASSERT(false);
-			break;
-
-		case WRITE_DEVICE:
-			EFM_ASSERT(false);
-			break;
-		case WAIT_CONVERSION: // "Receive_MSB"
-			i2c_sm.state = READ_DEVICE; //State change
-			i2c_sm.sm_data[i2c_sm.transfer_bytes] = i2c_sm.i2c->RXDATA; // Read RXDATA register from i2c
-			i2c_sm.i2c->CMD = I2C_CMD_ACK;		//Send ACK command to PG12 sensor
-			break;
-
-		case READ_DEVICE: // "Receive_LSB"
-			i2c_sm.state = CLOSE;
-			i2c_sm.sm_data[i2c_sm.transfer_bytes] = i2c_sm.i2c->RXDATA;
-				i2c_sm.i2c->CMD = I2C_CMD_NACK;
-				i2c_sm.i2c->CMD = I2C_CMD_STOP;
-			break;
-		case CLOSE:
-			EFM_ASSERT(false);
-			break;
-		default:
-			EFM_ASSERT(false);
-			break;
+ * Only MSTOP is enabled until the STOP has gone out, i2c_act_reset_done() then restores
+ * the interrupts and aborts the peripheral. It used to spin on MSTOP here,
+ * which never ends if a device holds the bus, now the watchdog times it out
+ * and recovers the bus.
+ *
+ * Called with interrupts masked.
+ *
+ ******************************************************************************/
+static void i2c_bus_reset(I2C_STATE_MACHINE *sm){
+		I2C_TypeDef *i2c = sm->i2c;
+
+		i2c->IEN = 0;									// Disables interrupts
+		i2c->IFC = i2c->IF;								// Clear the interrupt flag register
+		i2c -> CMD = I2C_CMD_CLEARTX; 					// Clear the transmit buffer
+		i2c_set_state(sm, RESET);
+		i2c_hold(sm, true);
+		sm->wake_tick = timer_now() + TIMER_MS_TO_TICKS(I2C_TIMEOUT_MS);
+		i2c->IEN = I2C_IEN_MSTOP;
+		i2c->CMD = I2C_CMD_START | I2C_CMD_STOP; 		// Set the start and stop bits in the CMD register
+}
+/***************************************************************************//**
+ * @brief
+ *
+ * Puts the transfer at the tail of the queue on the bus
+ *
+ * @details
+ *
+ * Sends a start, or a repeated start when chained, and the write address, or
+ * the read address straight away when there is nothing to write. Each
+ * transfer gets its own I2C_TIMEOUT_MS from here.
+ *
+ ******************************************************************************/
+static void i2c_begin(I2C_STATE_MACHINE *sm){
+	I2C_TRANSFER *transfer = I2C_CURRENT(sm);
+
+	i2c_hold(sm, true);
+	sm->active = true;
+	sm->wake_tick = timer_now() + TIMER_MS_TO_TICKS(I2C_TIMEOUT_MS);
+	sm->sent = 0;
+	sm->received = 0;
+	if(transfer->tx_len || !transfer->rx_len){
+		sm->i2c->CMD = I2C_CMD_START;
+		i2c_set_state(sm, REQUEST_DEVICE);
+		sm->i2c->TXDATA = (transfer->dev_addr << 1) | I2C_WRITE;
+		if(sm->dma && transfer->tx_len){
+			// The address ACK is not seen, the LDMA refills TXDATA on TXBL
+			i2c_set_state(sm, WRITE_DEVICE);
+			sm->i2c->IFC = I2C_IFC_TXC;
+			ldma_m2p(sm->hw->dma_ch, sm->hw->dma_tx_signal, transfer->tx, &sm->i2c->TXDATA, transfer->tx_len, NULL, NULL);
+			sm->i2c->IEN |= I2C_IEN_TXC;
+		} else if(sm->dma){
+			sm->i2c->IEN |= I2C_IEN_ACK;		// Address only, the ACK ends it
+		}
+	} else {
+		i2c_read_begin(sm);
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *
+ * Sends the next tx byte, or moves on once they have all been ACKed
+ *
+ ******************************************************************************/
+static void i2c_write_next(I2C_STATE_MACHINE *sm){
+	I2C_TRANSFER *transfer = I2C_CURRENT(sm);
+
+	if(sm->sent < transfer->tx_len){
+		sm->i2c->TXDATA = transfer->tx[sm->sent++];
+	} else if(transfer->rx_len){
+		i2c_read_begin(sm);
+	} else {
+		i2c_finish(sm, sm->sent);
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *
+ * Sends a start, or repeated start, and the read address
+ *
+ * @details
+ *
+ * In DMA mode the LDMA is armed for all but the last byte with AUTOACK set,
+ * and i2c_dma_rx_done() takes over for the last one.
+ *
+ ******************************************************************************/
+static void i2c_read_begin(I2C_STATE_MACHINE *sm){
+	I2C_TRANSFER *transfer = I2C_CURRENT(sm);
+
+	i2c_set_state(sm, WAIT_CONVERSION);
+	sm->i2c->CMD = I2C_CMD_START;
+	sm->i2c->TXDATA = (transfer->dev_addr << 1) | I2C_READ;
+	if(sm->dma){
+		if(transfer->rx_len >= I2C_DMA_RX_MIN){
+			sm->i2c->CTRL |= I2C_CTRL_AUTOACK;
+			ldma_p2m(sm->hw->dma_ch, sm->hw->dma_rx_signal, &sm->i2c->RXDATA, transfer->rx,
+					transfer->rx_len - 1, i2c_dma_rx_done, sm);
+		} else {
+			sm->i2c->IEN |= I2C_IEN_RXDATAV;
+		}
 	}
 }
+
 /***************************************************************************//**
  * @brief
- *	Case for receiving I2C MSTOP Interrupt
+ *
+ * LDMA done for the first rx_len - 1 bytes of a DMA read
  *
  * @details
  *
- * Sets up the state machine for when the case for when the [Manager] STOP condition is set
+ * Called from LDMA_IRQHandler. AUTOACK is cleared before the last byte has
+ * finished shifting in, it takes 9 SCL periods, so the last byte is not
+ * ACKed and its RXDATAV interrupt hands it to i2c_act_read() to NACK. The
+ * RXDATAV flag clears when RXDATA is read, so it is not left over from the
+ * bytes the LDMA took.
+ *
+ ******************************************************************************/
+static void i2c_dma_rx_done(void *arg){
+	I2C_STATE_MACHINE *sm = arg;
+
+	sm->i2c->CTRL &= ~I2C_CTRL_AUTOACK;
+	sm->received = I2C_CURRENT(sm)->rx_len - 1;
+	i2c_set_state(sm, READ_DEVICE);
+	sm->i2c->IEN |= I2C_IEN_RXDATAV;
+}
+
+/***************************************************************************//**
+ * @brief
+ *
+ * Ends the transfer on the bus and posts its completion event, if it has one
+ *
+ * @details
+ *
+ * After a good transfer the next queued one is chained on with a repeated
+ * start. Otherwise a stop is sent, and i2c_act_next() either starts the next
+ * transfer or returns the bus to IDLE.
+ *
+ * @param[in] status
+ * Completion payload, a byte count or'ed with I2C_PAYLOAD_NACK on failure
+ *
+ ******************************************************************************/
+static void i2c_finish(I2C_STATE_MACHINE *sm, uint32_t status){
+	if(sm->dma){
+		if(status & I2C_PAYLOAD_NACK){
+			ldma_stop(sm->hw->dma_ch);
+			sm->i2c->CTRL &= ~I2C_CTRL_AUTOACK;
+			sm->i2c->CMD = I2C_CMD_CLEARTX;
+		}
+		sm->i2c->IEN = sm->ien;
+	}
+	if(status & I2C_PAYLOAD_NACK){
+		sm->stats.nack++;
+	}
+	i2c_complete(sm, status);
+
+	if(!(status & I2C_PAYLOAD_NACK) && sm->head != sm->tail){
+		i2c_begin(sm);
+	} else {
+		i2c_set_state(sm, CLOSE);
+		sm->i2c->CMD = I2C_CMD_STOP;
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *
+ * Moves the state machine and traces the new state
+ *
+ ******************************************************************************/
+static void i2c_set_state(I2C_STATE_MACHINE *sm, uint32_t state){
+	fsm_set(&sm->fsm, state);
+}
+
+/***************************************************************************//**
+ * @brief
+ *
+ * Scheduler handler for the bus timeouts, recovery steps and retry backoff
+ *
+ * @details
+ *
+ * Posted whenever the bus is taken or released, and by its own one-shot timer
+ * wheel timer, which is kept armed for wake_tick while the driver is not
+ * IDLE. Whatever is due is run, so an early or repeated call does nothing.
+ * A transfer still on the bus at its wake_tick has timed out.
  *
  * @note
  *
- * While not standard standard terminology, my code will use Manager/Subscriber terminology in place of Master/Slave
+ * Each call does a bounded amount of work, the main loop never waits on the
+ * bus. The timer is only cancelled while it cannot have fired yet, after
+ * that its handle may belong to someone else.
+ *
+ * @param[in] *sm
+ * Context of the bus, each has its own watchdog event and timer
  *
  ******************************************************************************/
-static void i2c_mstop(){
-	switch(i2c_sm.state){
-		case IDLE:
-			EFM_ASSERT(false);
-			break;
-		case REQUEST_DEVICE: // "requesting device" to send measurement
-			EFM_ASSERT(false);
-			break;
-		case WRITE_DEVICE:
-			EFM_ASSERT(false);
-			break;
-		case WAIT_CONVERSION:
-			EFM_ASSERT(false);
-			break;
-		case READ_DEVICE:
-			EFM_ASSERT(false);
-			break;
-		case CLOSE:
-			i2c_sm.state = IDLE;	//setting I2C State to IDLE
-			sleep_unblock_mode(I2C_EM_BLOCK); //Recall that I2C_EM_BLOCK is EM2
-			add_scheduled_event(i2c_sm.event);// Set event for Si7021 Read
-			break;
-		default:
-			EFM_ASSERT(false);
-			break;
+static void i2c_watchdog(I2C_STATE_MACHINE *sm){
+	uint32_t now;
+	uint32_t ticks = 0;
+	bool cancel = false;
+	bool arm = false;
+
+	CORE_DECLARE_IRQ_STATE;
+	CORE_ENTER_CRITICAL();
+	now = timer_now();
+	if(sm->timer_pending && (int32_t)(now - sm->timer_due) >= 0){
+		sm->timer_pending = false;
+	}
+	while(sm->fsm.state != IDLE && (int32_t)(now - sm->wake_tick) >= 0){
+		switch(sm->fsm.state){
+			case RECOVER:
+				i2c_recover_step(sm);
+				break;
+			case BACKOFF:
+				i2c_begin(sm);
+				break;
+			default:
+				i2c_fault(sm, &sm->stats.timeout);
+				break;
+		}
+		now = timer_now();
+	}
+	if(sm->fsm.state == IDLE){
+		cancel = sm->timer_pending;
+	} else if(!sm->timer_pending || (int32_t)(sm->timer_due - sm->wake_tick) > 0){
+		cancel = sm->timer_pending;
+		arm = true;
+		ticks = sm->wake_tick - now;
+	}
+	CORE_EXIT_CRITICAL();
+
+	if(cancel){
+		timer_cancel(sm->timer);
+		sm->timer_pending = false;
+	}
+	if(arm){
+		sm->timer = timer_arm(I2C_TICKS_TO_MS(ticks), sm->watchdog_event);
+		sm->timer_due = now + ticks;
+		sm->timer_pending = true;
 	}
 }
 
-//***********************************************************************************
-// Private functions
-//***********************************************************************************
+#ifdef I2C0_ENABLED
+/***************************************************************************//**
+ * @brief
+ *
+ * Watchdog event handler of I2C0, see i2c_watchdog()
+ *
+ ******************************************************************************/
+static void i2c0_watchdog(uint32_t payload){
+	(void)payload;
+	i2c_watchdog(&i2c_sm[I2C_SM_I2C0]);
+}
+#endif
 
+#ifdef I2C1_ENABLED
 /***************************************************************************//**
  * @brief
  *
- * Contains the I2C Bus reset function
+ * Watchdog event handler of I2C1, see i2c_watchdog()
+ *
+ ******************************************************************************/
+static void i2c1_watchdog(uint32_t payload){
+	(void)payload;
+	i2c_watchdog(&i2c_sm[I2C_SM_I2C1]);
+}
+#endif
+
+/***************************************************************************//**
+ * @brief
+ *
+ * Aborts whatever is on the bus and starts the recovery
  *
  * @details
  *
- * Resets/clears the states of the I2C Bus, clearing enabled interrupts and interrupt flags.
+ * Called from the I2C interrupt, or with interrupts masked. The transfer at
+ * the tail stays queued, i2c_recovered() decides whether it is retried.
+ *
+ * @param[in] *counter
+ * Error counter in sm->stats to count the fault in
+ *
+ ******************************************************************************/
+static void i2c_fault(I2C_STATE_MACHINE *sm, uint32_t *counter){
+	(*counter)++;
+	sm->i2c->IEN = 0;
+	if(sm->dma){
+		ldma_stop(sm->hw->dma_ch);
+		sm->i2c->CTRL &= ~I2C_CTRL_AUTOACK;
+	}
+	sm->i2c->CMD = I2C_CMD_ABORT | I2C_CMD_CLEARTX;
+	sm->i2c->IFC = sm->i2c->IF;
+	sm->recover_step = 0;
+	i2c_set_state(sm, RECOVER);
+	sm->wake_tick = timer_now();
+	i2c_hold(sm, false);
+}
+
+/***************************************************************************//**
+ * @brief
+ *
+ * One step of the bus recovery, run by i2c_watchdog() every I2C_RECOVER_STEP_MS
+ *
+ * @details
+ *
+ * The pins are taken from the peripheral and driven as GPIO. SCL is toggled,
+ * one edge per step, until a device holding SDA low lets go of it, at most
+ * RESET_TOGGLE_NUMBER edges, nine clocks, which finishes any byte it was
+ * sending. Then a STOP is sent by hand: SCL and SDA low, SCL high, SDA high.
  *
  * @note
  *
+ * The pins are wired-AND, so driving one high releases it to the pull-up.
+ * EM2 is not blocked while the steps wait, the GPIO keep their levels.
  *
- * @param[in] *i2c
+ ******************************************************************************/
+static void i2c_recover_step(I2C_STATE_MACHINE *sm){
+	uint32_t step = sm->recover_step++;
+	bool sda = GPIO_PinInGet(sm->sda_port, sm->sda_pin);
+
+	if(step == 0){
+		sm->stats.recoveries++;
+		GPIO_PinOutSet(sm->scl_port, sm->scl_pin);
+		GPIO_PinOutSet(sm->sda_port, sm->sda_pin);
+		sm->i2c->ROUTEPEN &= ~(I2C_ROUTEPEN_SCLPEN | I2C_ROUTEPEN_SDAPEN);
+	} else if(step < I2C_RECOVER_STOP){
+		if((step & 1) && sda){							// SCL is high and SDA was let go
+			sm->recover_step = I2C_RECOVER_STOP;
+		} else {
+			GPIO_PinOutToggle(sm->scl_port, sm->scl_pin);
+		}
+	} else if(step == I2C_RECOVER_STOP){
+		if(!sda){
+			sm->stats.stuck++;						// Still held after every toggle
+		}
+		GPIO_PinOutClear(sm->scl_port, sm->scl_pin);
+		GPIO_PinOutClear(sm->sda_port, sm->sda_pin);
+	} else if(step == I2C_RECOVER_STOP + 1){
+		GPIO_PinOutSet(sm->scl_port, sm->scl_pin);
+	} else {
+		GPIO_PinOutSet(sm->sda_port, sm->sda_pin);	// STOP
+		i2c_recovered(sm);
+		return;
+	}
+	sm->wake_tick = timer_now() + TIMER_MS_TO_TICKS(I2C_RECOVER_STEP_MS);
+}
+
+/***************************************************************************//**
+ * @brief
+ *
+ * Hands the pins back to the peripheral and retries, fails or moves on
  *
- * Requires values from the I2C library.
+ * @details
+ *
+ * A transfer that was on the bus is retried after I2C_BACKOFF_MS, doubled for
+ * every earlier attempt, up to I2C_RETRY_MAX times. After that its event is
+ * posted with I2C_PAYLOAD_ERROR and the queue carries on.
  *
  ******************************************************************************/
-static void i2c_bus_reset(I2C_TypeDef *i2c){
-		uint32_t int_flag;
-		uint32_t int_en;
+static void i2c_recovered(I2C_STATE_MACHINE *sm){
+	sm->i2c->ROUTEPEN |= I2C_ROUTEPEN_SCLPEN | I2C_ROUTEPEN_SDAPEN;
+	sm->i2c->CMD = I2C_CMD_ABORT;
+	sm->i2c->IFC = sm->i2c->IF;
+	sm->i2c->IEN = sm->ien;
 
-		int_en = i2c->IEN; 								// Check that the IEN register is clear + saving state of IEN
-		int_flag = i2c->IF;								// Check if IF is clear
-		i2c->IEN &= ~int_en;							// Disables interrupts
-		i2c->IFC = int_flag;							// Clear the interrupt flag register
-		i2c -> CMD = I2C_CMD_CLEARTX; 					// Clear the transmit buffer
-		i2c->CMD = I2C_CMD_START | I2C_CMD_STOP; 		// Set the start and stop bits in the CMD register
-		while(!(i2c->IF & I2C_IF_MSTOP));				// Stall until the stop command completes
-		i2c->IFC = I2C_IFC_START | I2C_IFC_MSTOP;		// Clear the interrupt flag register again
-		i2c->IEN = int_en;								// Reloading state of IEN
-		i2c->CMD = I2C_CMD_ABORT;						// Reset the i2c peripheral state machine
+	if(!sm->active){
+		i2c_next(sm);
+	} else if(++sm->attempts <= I2C_RETRY_MAX){
+		sm->stats.retries++;
+		i2c_set_state(sm, BACKOFF);
+		sm->wake_tick = timer_now() + TIMER_MS_TO_TICKS(I2C_BACKOFF_MS << (sm->attempts - 1));
+	} else {
+		sm->stats.failed++;
+		i2c_complete(sm, I2C_PAYLOAD_ERROR | sm->received);
+		i2c_next(sm);
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *
+ * Posts the completion event of the transfer at the tail and drops it
+ *
+ * @note
+ *
+ * Also called from i2c_watchdog() when a transfer is given up. Interrupts are
+ * masked there, so the post cannot interleave with one from the bus's IRQ handler.
+ *
+ ******************************************************************************/
+static void i2c_complete(I2C_STATE_MACHINE *sm, uint32_t status){
+	if(I2C_CURRENT(sm)->event != I2C_NO_EVENT){
+		scheduler_post(sm->hw->sched_src, I2C_CURRENT(sm)->event, status);
+	}
+	sm->tail = (sm->tail + 1) % I2C_QUEUE_SLOTS;
+	sm->active = false;
+	sm->attempts = 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ *
+ * Starts the next queued transfer on a free bus, or returns to IDLE
+ *
+ ******************************************************************************/
+static void i2c_next(I2C_STATE_MACHINE *sm){
+	if(sm->head != sm->tail){
+		i2c_begin(sm);
+	} else {
+		i2c_set_state(sm, IDLE);	//setting I2C State to IDLE
+		i2c_hold(sm, false);
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *
+ * Blocks or unblocks EM2 for the bus, and tells the watchdog
+ *
+ * @details
+ *
+ * EM2 stays blocked from the first start to the last stop, not while the
+ * driver waits out a recovery step or a backoff.
+ *
+ ******************************************************************************/
+static void i2c_hold(I2C_STATE_MACHINE *sm, bool hold){
+	if(hold == sm->held){
+		return;
+	}
+	sm->held = hold;
+	if(hold){
+		sleep_block_mode(I2C_EM_BLOCK);
+		energy_busy_begin(ENERGY_LOAD_I2C);
+	} else {
+		sleep_unblock_mode(I2C_EM_BLOCK); //Recall that I2C_EM_BLOCK is EM2
+		energy_busy_end(ENERGY_LOAD_I2C);
+	}
+	add_scheduled_event(sm->watchdog_event);
+}
+
+/***************************************************************************//**
+ * @brief
+ *
+ * Finds the context of a peripheral for the public functions
+ *
+ * @details
+ *
+ * Only the instances enabled in brd_config.h have a context. The interrupt
+ * and watchdog handlers are bound to theirs at compile time and never look
+ * it up. Here each enabled instance is one compare against its base address,
+ * chosen by the preprocessor, so with one I2C enabled the lookup is a single
+ * compare and folds away when the caller's argument is a constant.
+ *
+ ******************************************************************************/
+static inline I2C_STATE_MACHINE *i2c_context(I2C_TypeDef *i2c){
+#ifdef I2C0_ENABLED
+	if(i2c == I2C0) return &i2c_sm[I2C_SM_I2C0];
+#endif
+#ifdef I2C1_ENABLED
+	if(i2c == I2C1) return &i2c_sm[I2C_SM_I2C1];
+#endif
+	EFM_ASSERT(false);							// Not enabled in brd_config.h
+	return NULL;
 }
@@ -0,0 +1,231 @@
+/**
+ * @file ldma.c
+ * @author Kay Sho
+ * @date  10/16/2026
+ * @brief Byte transfers between peripherals and memory on the LDMA
+ * @note The author's pronouns: (She/They)
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+
+/* System include statements */
+
+
+/* Silicon Labs include statements */
+
+
+/* The developer's include statements */
+#include "ldma.h"
+
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define LDMA_XFER_MAX			2048		// XFERCNT is 11 bits
+
+//***********************************************************************************
+// private variables
+//***********************************************************************************
+static LDMA_Descriptor_t descriptors[LDMA_CHANNELS][LDMA_BLOCKS_MAX];	// Read by the LDMA during the transfer
+static LDMA_DONE_CB done_cb[LDMA_CHANNELS];
+static void *done_arg[LDMA_CHANNELS];						// Handed to done_cb, e.g. the driver instance
+static bool ldma_is_open;
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Clocks and initializes the LDMA
+ *
+ * @note
+ *	Every driver that uses a channel calls this from its open function, only
+ *	the first call does anything.
+ *
+ ******************************************************************************/
+void ldma_open(void){
+	LDMA_Init_t init = LDMA_INIT_DEFAULT;
+
+	if(ldma_is_open) return;
+	CMU_ClockEnable(cmuClock_LDMA, true);
+	LDMA_Init(&init);
+	for(int ch = 0; ch < LDMA_CHANNELS; ch++){
+		done_cb[ch] = NULL;
+	}
+	ldma_is_open = true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Starts a memory to peripheral byte transfer
+ *
+ * @details
+ *	One byte moves each time the peripheral raises [signal], e.g. TXBL.
+ *
+ * @param[in] ch
+ *	LDMA_CH_x of the calling driver
+ *
+ * @param[in] signal
+ *	Peripheral request that paces the transfer
+ *
+ * @param[in] *src
+ *	Bytes to send, must stay valid until [done] runs
+ *
+ * @param[in] *dst
+ *	Peripheral data register
+ *
+ * @param[in] count
+ *	1 to 2048 bytes
+ *
+ * @param[in] done
+ *	Called in interrupt context when the last byte has been moved, or NULL
+ *	for no interrupt at all
+ *
+ * @param[in] *arg
+ *	Passed to [done]
+ *
+ ******************************************************************************/
+void ldma_m2p(uint32_t ch, LDMA_PeripheralSignal_t signal, const void *src, volatile void *dst, uint32_t count, LDMA_DONE_CB done, void *arg){
+	LDMA_BLOCK block = {src, count};
+
+	ldma_m2p_blocks(ch, signal, &block, 1, dst, done, arg);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Starts a memory to peripheral byte transfer from several sources
+ *
+ * @details
+ *	The blocks are linked descriptors, the LDMA moves on to the next one by
+ *	itself, so the CPU is not involved between them.
+ *
+ * @param[in] *block
+ *	Sources in the order they are sent, 1 to 2048 bytes each. The array is
+ *	copied into the descriptors, the bytes must stay valid until [done] runs.
+ *
+ * @param[in] blocks
+ *	1 to LDMA_BLOCKS_MAX
+ *
+ * @param[in] done
+ *	Called in interrupt context when the last byte of the last block has been
+ *	moved, or NULL for no interrupt at all
+ *
+ ******************************************************************************/
+void ldma_m2p_blocks(uint32_t ch, LDMA_PeripheralSignal_t signal, const LDMA_BLOCK *block, uint32_t blocks, volatile void *dst, LDMA_DONE_CB done, void *arg){
+	LDMA_TransferCfg_t cfg = LDMA_TRANSFER_CFG_PERIPHERAL(signal);
+
+	EFM_ASSERT(ch < LDMA_CHANNELS && blocks > 0 && blocks <= LDMA_BLOCKS_MAX);
+	for(uint32_t i = 0; i < blocks; i++){
+		LDMA_Descriptor_t link = LDMA_DESCRIPTOR_LINKREL_M2P_BYTE(block[i].src, dst, block[i].count, 1);
+		LDMA_Descriptor_t last = LDMA_DESCRIPTOR_SINGLE_M2P_BYTE(block[i].src, dst, block[i].count);
+
+		EFM_ASSERT(block[i].count > 0 && block[i].count <= LDMA_XFER_MAX);
+		descriptors[ch][i] = (i + 1 < blocks) ? link : last;
+	}
+	descriptors[ch][blocks - 1].xfer.doneIfs = (done != NULL);
+	done_cb[ch] = done;
+	done_arg[ch] = arg;
+	LDMA_StartTransfer(ch, &cfg, &descriptors[ch][0]);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Starts a peripheral to memory byte transfer
+ *
+ * @details
+ *	One byte moves each time the peripheral raises [signal], e.g. RXDATAV.
+ *
+ * @param[in] ch
+ *	LDMA_CH_x of the calling driver
+ *
+ * @param[in] signal
+ *	Peripheral request that paces the transfer
+ *
+ * @param[in] *src
+ *	Peripheral data register
+ *
+ * @param[in] *dst
+ *	Buffer for [count] bytes
+ *
+ * @param[in] count
+ *	1 to 2048 bytes
+ *
+ * @param[in] done
+ *	Called in interrupt context when the last byte has been moved, or NULL
+ *	for no interrupt at all
+ *
+ * @param[in] *arg
+ *	Passed to [done]
+ *
+ ******************************************************************************/
+void ldma_p2m(uint32_t ch, LDMA_PeripheralSignal_t signal, const volatile void *src, void *dst, uint32_t count, LDMA_DONE_CB done, void *arg){
+	LDMA_TransferCfg_t cfg = LDMA_TRANSFER_CFG_PERIPHERAL(signal);
+	LDMA_Descriptor_t desc = LDMA_DESCRIPTOR_SINGLE_P2M_BYTE(src, dst, count);
+
+	EFM_ASSERT(ch < LDMA_CHANNELS && count > 0 && count <= LDMA_XFER_MAX);
+	descriptors[ch][0] = desc;
+	descriptors[ch][0].xfer.doneIfs = (done != NULL);
+	done_cb[ch] = done;
+	done_arg[ch] = arg;
+	LDMA_StartTransfer(ch, &cfg, &descriptors[ch][0]);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Aborts a channel's transfer, its done callback is not called
+ *
+ ******************************************************************************/
+void ldma_stop(uint32_t ch){
+	EFM_ASSERT(ch < LDMA_CHANNELS);
+	LDMA_StopTransfer(ch);
+	done_cb[ch] = NULL;
+	LDMA_IntClear(1 << ch);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Bytes a channel has still to move
+ *
+ * @details
+ *	e.g. how much of a receive buffer a peripheral to memory transfer has
+ *	filled when the peripheral signals the end of a frame.
+ *
+ ******************************************************************************/
+uint32_t ldma_remaining(uint32_t ch){
+	EFM_ASSERT(ch < LDMA_CHANNELS);
+	return LDMA_TransferRemainingCount(ch);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	LDMA interrupt, one done flag per channel
+ *
+ * @details
+ *	Hands each finished channel to the callback its transfer was started with.
+ *	This handler replaces the default one in the Silicon Labs LDMA library.
+ *
+ * @note
+ *	A bus error on any channel is a driver bug, the descriptors only point at
+ *	RAM and peripheral data registers.
+ *
+ ******************************************************************************/
+void LDMA_IRQHandler(void){
+	uint32_t int_flag = LDMA_IntGetEnabled();
+	LDMA_DONE_CB cb;
+
+	LDMA_IntClear(int_flag);
+	TRACE(TRACE_IRQ_LDMA, int_flag);
+	EFM_ASSERT(!(int_flag & LDMA_IF_ERROR));
+
+	for(uint32_t ch = 0; ch < LDMA_CHANNELS; ch++){
+		if((int_flag & (1 << ch)) && done_cb[ch]){
+			cb = done_cb[ch];
+			done_cb[ch] = NULL;
+			cb(done_arg[ch]);
+		}
+	}
+}
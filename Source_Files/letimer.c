@@ -29,10 +29,11 @@
 static uint32_t scheduled_comp0_cb;
 static uint32_t scheduled_comp1_cb;
 static uint32_t scheduled_uf_cb;
+static volatile uint32_t uf_count;			// Underflows since open, posted as the UF payload and used as the epoch
 //***********************************************************************************
 // Private functions
 //***********************************************************************************
-
+static uint32_t letimer_cnt_read(LETIMER_TypeDef *letimer);
 
 //***********************************************************************************
 // Global functions
@@ -116,6 +117,7 @@ void letimer_pwm_open(LETIMER_TypeDef *letimer, APP_LETIMER_PWM_TypeDef *app_let
 	scheduled_comp0_cb = app_letimer_pwm_struct->comp0_cb;
 	scheduled_comp1_cb = app_letimer_pwm_struct->comp1_cb;
 	scheduled_uf_cb = app_letimer_pwm_struct->uf_cb;
+	uf_count = 0;
 
 	letimer->IFC = LETIMER_CLEAR;
 
@@ -167,6 +169,9 @@ void letimer_start(LETIMER_TypeDef *letimer, bool enable){
  * 		Clears interrupt flag, and then checks each callback mode so that it may
  * 		activate checked callback mode
  * @note
+ * 		Events go through the LETIMER0 event ring so back-to-back interrupts are
+ * 		not merged. COMP0/COMP1 carry the counter value, UF carries the running
+ * 		underflow count.
  *
  * @param[in]
  *
@@ -177,20 +182,181 @@ void LETIMER0_IRQHandler(void){
 	uint32_t int_flag;
 	int_flag = LETIMER0->IF & LETIMER0->IEN; 	// Reads
 	LETIMER0->IFC = int_flag;					// Clear
+	TRACE(TRACE_IRQ_LETIMER0, int_flag);
 
 	if(int_flag & LETIMER_IF_COMP0)
 	{
 		EFM_ASSERT(!(LETIMER0->IF & LETIMER_IF_COMP0));
-		add_scheduled_event(scheduled_comp0_cb);
+		scheduler_post(SCHED_SRC_LETIMER0, scheduled_comp0_cb, LETIMER0->CNT);
 	}
 	if(int_flag & LETIMER_IF_COMP1)
 	{
 		EFM_ASSERT(!(LETIMER0->IF & LETIMER_IF_COMP1));
-		add_scheduled_event(scheduled_comp1_cb);
+		scheduler_post(SCHED_SRC_LETIMER0, scheduled_comp1_cb, LETIMER0->CNT);
 	}
 	if(int_flag & LETIMER_IF_UF)				// Just check the underflow flag and bit
 	{
 		EFM_ASSERT(!(LETIMER0->IF & LETIMER_IF_UF));
-		add_scheduled_event(scheduled_uf_cb);
+		uf_count++;
+		scheduler_post(SCHED_SRC_LETIMER0, scheduled_uf_cb, uf_count);
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Opens an LETIMER as a free-running tickless timebase
+ *
+ * @details
+ * 	 The counter runs down from LETIMER_TOP at LETIMER_HZ and never stops. The
+ * 	 underflow interrupt only marks the start of a new epoch (every ~65.5 s
+ * 	 at 1 kHz, ~55 an hour) and COMP1 is moved around by letimer_comp1_arm()
+ * 	 to wake the core at the next software timer deadline, instead of waking
+ * 	 on a fixed heartbeat.
+ *
+ * @note
+ *   The LETIMER is started here and blocks EM4 for as long as it runs.
+ *
+ * @param[in] letimer
+ *   Pointer to the base peripheral address of the LETIMER peripheral being opened
+ *
+ * @param[in] app_letimer_timebase_struct
+ *   Debug behaviour and the COMP1/UF scheduler events
+ *
+ ******************************************************************************/
+void letimer_timebase_open(LETIMER_TypeDef *letimer, APP_LETIMER_TIMEBASE_TypeDef *app_letimer_timebase_struct){
+	LETIMER_Init_TypeDef letimer_timebase_values;
+
+	EFM_ASSERT(LETIMER_TOP + 1 == 1UL << LETIMER_EPOCH_SHIFT);
+
+	if (letimer == LETIMER0)
+	CMU_ClockEnable(cmuClock_LETIMER0, true);
+
+	letimer->CMD = LETIMER_CMD_STOP;
+	while(letimer->SYNCBUSY);
+
+	letimer_timebase_values.bufTop 		= false;							// COMP1 is the deadline, never reload COMP0 from it
+	letimer_timebase_values.comp0Top 	= true;								// Reload LETIMER_TOP on underflow
+	letimer_timebase_values.debugRun 	= app_letimer_timebase_struct->debugRun;
+	letimer_timebase_values.enable 		= false;
+	letimer_timebase_values.out0Pol 	= 0;
+	letimer_timebase_values.out1Pol 	= 0;
+	letimer_timebase_values.repMode 	= letimerRepeatFree;
+	letimer_timebase_values.ufoa0 		= letimerUFOANone;					// No outputs, counter only
+	letimer_timebase_values.ufoa1 		= letimerUFOANone;
+
+	LETIMER_Init(letimer, &letimer_timebase_values);
+	while(letimer->SYNCBUSY);
+
+	letimer->COMP0 = LETIMER_TOP;
+	letimer->CNT = LETIMER_TOP;
+	while(letimer->SYNCBUSY);
+
+	scheduled_comp0_cb = 0;
+	scheduled_comp1_cb = app_letimer_timebase_struct->comp1_cb;
+	scheduled_uf_cb = app_letimer_timebase_struct->uf_cb;
+	uf_count = 0;
+
+	letimer->IFC = LETIMER_CLEAR;
+	LETIMER_IntEnable(letimer, LETIMER_IEN_UF);
+	NVIC_EnableIRQ(LETIMER0_IRQn);
+
+	letimer_start(letimer, true);
+}
+
+/***************************************************************************//**
+ * @brief
+ * 		Returns the monotonic tick count of a timebase LETIMER
+ * @details
+ * 		Ticks are the epoch (underflow count) in the upper bits and the elapsed
+ * 		count of the current epoch in the lower LETIMER_EPOCH_SHIFT bits, so the
+ * 		value wraps cleanly at 2^32.
+ * @note
+ * 		If the counter underflowed but the interrupt has not run yet, the pending
+ * 		UF flag is counted here so time never goes backwards.
+ * @param[in] letimer
+ * 		Timebase LETIMER
+ ******************************************************************************/
+uint32_t letimer_ticks(LETIMER_TypeDef *letimer){
+	uint32_t epoch, cnt;
+
+	CORE_DECLARE_IRQ_STATE;
+	CORE_ENTER_CRITICAL();
+	epoch = uf_count;
+	cnt = letimer_cnt_read(letimer);
+	if(letimer->IF & LETIMER_IF_UF){
+		cnt = letimer_cnt_read(letimer);
+		epoch++;
+	}
+	CORE_EXIT_CRITICAL();
+
+	return (epoch << LETIMER_EPOCH_SHIFT) + (LETIMER_TOP - cnt);
+}
+
+/***************************************************************************//**
+ * @brief
+ * 		Programs COMP1 to interrupt at an absolute tick
+ * @details
+ * 		Deadlines closer than LETIMER_MIN_DELTA are pushed out to it. Deadlines
+ * 		past the end of the current epoch leave COMP1 off, the underflow wakes
+ * 		the core first and the caller programs again from there.
+ * @param[in] letimer
+ * 		Timebase LETIMER
+ * @param[in] tick
+ * 		Absolute deadline in letimer_ticks() units
+ * @return
+ * 		false if the deadline passed before COMP1 could catch it, the caller
+ * 		must service the deadline itself
+ ******************************************************************************/
+bool letimer_comp1_arm(LETIMER_TypeDef *letimer, uint32_t tick){
+	uint32_t now = letimer_ticks(letimer);
+
+	if((int32_t)(tick - now) <= 0){
+		return false;
+	}
+	if((int32_t)(tick - now) < LETIMER_MIN_DELTA){
+		tick = now + LETIMER_MIN_DELTA;
+	}
+	if((tick >> LETIMER_EPOCH_SHIFT) != (now >> LETIMER_EPOCH_SHIFT)){
+		letimer_comp1_disable(letimer);
+		return true;
+	}
+
+	letimer->COMP1 = LETIMER_TOP - (tick & LETIMER_TOP);
+	while(letimer->SYNCBUSY);
+	letimer->IFC = LETIMER_IF_COMP1;
+	LETIMER_IntEnable(letimer, LETIMER_IEN_COMP1);
+
+	if((int32_t)(tick - letimer_ticks(letimer)) <= 0 && !(letimer->IF & LETIMER_IF_COMP1)){
+		return false;
 	}
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ * 		Stops COMP1 from interrupting
+ * @param[in] letimer
+ * 		Timebase LETIMER
+ ******************************************************************************/
+void letimer_comp1_disable(LETIMER_TypeDef *letimer){
+	LETIMER_IntDisable(letimer, LETIMER_IEN_COMP1);
+	letimer->IFC = LETIMER_IF_COMP1;
+}
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ * 		Reads CNT until two reads agree
+ * @note
+ * 		CNT lives in the low frequency domain and can be caught mid-update.
+ ******************************************************************************/
+static uint32_t letimer_cnt_read(LETIMER_TypeDef *letimer){
+	uint32_t cnt;
+	do{
+		cnt = letimer->CNT;
+	} while(cnt != letimer->CNT);
+	return cnt;
 }
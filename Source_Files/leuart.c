@@ -18,41 +18,141 @@
 // defined files
 //***********************************************************************************
 
+// Context index of each instance enabled in brd_config.h
+enum{
+#ifdef LEUART0_ENABLED
+	LEUART_SM_LEUART0,
+#endif
+#ifdef LEUART1_ENABLED
+	LEUART_SM_LEUART1,
+#endif
+	LEUART_INSTANCES
+};
+
+#define LEUART_RX_RING_SIZE		256			// About 25 short commands, or 4 of the longest
+#define LEUART_RX_FRAME_MAX		49
 
 //***********************************************************************************
 // private variables
 //***********************************************************************************
-uint32_t	rx_done_evt;
-uint32_t	tx_done_evt;
 
 typedef enum {
 		START,
 		TRANSMIT,
 		IDLE,
-		CLOSE
+		CLOSE,
+		LEUART_TX_STATES
 }LEUART_TX_STATE;
 
 typedef enum {
 	STARTFRAME,
 	RECEIVE,
-	SIGFRAME
+	SIGFRAME,
+	RAW,
+	LEUART_RX_STATES
 }LEUART_RX_STATE;
 
+/* Interrupt causes, the columns of the TX and RX tables */
+typedef enum {
+	LEUART_CAUSE_TXBL,
+	LEUART_CAUSE_TXC,
+	LEUART_TX_CAUSES
+}LEUART_TX_CAUSE;
+
+typedef enum {
+	LEUART_CAUSE_STARTF,
+	LEUART_CAUSE_RXDATAV,
+	LEUART_CAUSE_SIGF,
+	LEUART_CAUSE_RX_DMA,				// The LDMA filled the receive buffer
+	LEUART_RX_CAUSES
+}LEUART_RX_CAUSE;
+
+/* Indexes into leuart_actions, shared by both tables */
+enum {
+	LEUART_ACT_ILLEGAL = FSM_ILLEGAL,
+	LEUART_ACT_TX_BYTE,
+	LEUART_ACT_TX_DONE,
+	LEUART_ACT_FRAME_BEGIN,
+	LEUART_ACT_FRAME_BYTE,
+	LEUART_ACT_RAW_BYTE,
+	LEUART_ACT_FRAME_END,
+	LEUART_ACT_DMA_FRAME_END,
+	LEUART_ACT_DMA_OVERFLOW,
+	LEUART_ACT_DMA_RAW_DONE
+};
+
+/* What differs between the peripherals, fixed at compile time */
+typedef struct{
+	LEUART_TypeDef*				leuart;
+	CMU_Clock_TypeDef			clock;
+	IRQn_Type					irq;
+	uint32_t					sched_src;				// SCHED_SRC_x ring the events are posted to
+	uint32_t					trace_irq;				// TRACE_IRQ_x
+	uint32_t					dma_tx_ch;				// LDMA_CH_x
+	uint32_t					dma_rx_ch;
+	LDMA_PeripheralSignal_t		dma_tx_signal;			// ldmaPeripheralSignal_NONE if it has no LDMA requests
+	LDMA_PeripheralSignal_t		dma_rx_signal;
+}LEUART_INSTANCE;
+
 typedef struct{
+	const LEUART_INSTANCE*		hw;
 	LEUART_TypeDef* 			leuart;				// LEUART Peripheral
-	char						tx_out[50];				// Pointer to string data
-	char						TXbuf[50];
-	char						RXbuf[50];
+	LEUART_SEGMENT				tx_seg[LEUART_SEGMENTS_MAX];	// Message being sent, in the caller's memory
+	uint8_t						tx_seg_count;
+	uint8_t						tx_seg_cur;				// Segment TXBL takes the next character from
+	FRAME_RING					rx_ring;				// Framed commands, read in place by the owner
+	char						rx_ring_buf[LEUART_RX_RING_SIZE];
+	char						*rx_frame;				// Room of the frame being received
+	char						rx_discard[LEUART_RX_FRAME_MAX + 1];	// Used instead while rx_ring is full
+	bool						rx_long;				// The frame outgrew LEUART_RX_FRAME_MAX
 	volatile bool				tx_busy;
 	volatile bool				rx_busy;
-	uint8_t						tx_len;
+	uint32_t					tx_len;					// Characters in every segment
 	uint8_t						rx_len;
-	uint8_t						char_index;				// count
-	LEUART_TX_STATE				tx_state;				// State
-	LEUART_RX_STATE				rx_state;
+	uint32_t					char_index;				// Next character of tx_seg[tx_seg_cur]
+	FSM							tx_fsm;					// State, see leuart_tx_transitions
+	FSM							rx_fsm;					// See leuart_rx_transitions
+	uint32_t					tx_evt;					// Posted at TXC of the current string
+	char						*rx_raw;				// Unframed receive buffer
+	uint8_t						rx_raw_len;				// Bytes to collect into rx_raw
+	uint32_t					rx_raw_evt;				// Posted when rx_raw is full
+	uint32_t					rx_done_evt;			// Posted for each framed command
+	uint32_t					tx_done_evt;			// Posted by leuart_start()
+	bool						dma;					// Characters move on the LDMA
 }LEUART_COMMS_STRUCT;
 
-static LEUART_COMMS_STRUCT leuart_sm;
+static const LEUART_INSTANCE leuart_instances[LEUART_INSTANCES] = {
+#ifdef LEUART0_ENABLED
+	[LEUART_SM_LEUART0] = {LEUART0, cmuClock_LEUART0, LEUART0_IRQn, SCHED_SRC_LEUART0, TRACE_IRQ_LEUART0,
+			LDMA_CH_LEUART0_TX, LDMA_CH_LEUART0_RX, ldmaPeripheralSignal_LEUART0_TXBL, ldmaPeripheralSignal_LEUART0_RXDATAV},
+#endif
+#ifdef LEUART1_ENABLED
+	[LEUART_SM_LEUART1] = {LEUART1, cmuClock_LEUART1, LEUART1_IRQn, SCHED_SRC_LEUART1, TRACE_IRQ_LEUART1,
+			0, 0, ldmaPeripheralSignal_NONE, ldmaPeripheralSignal_NONE},
+#endif
+};
+
+static LEUART_COMMS_STRUCT leuart_sm[LEUART_INSTANCES] = {
+#ifdef LEUART0_ENABLED
+	[LEUART_SM_LEUART0] = {.hw = &leuart_instances[LEUART_SM_LEUART0], .leuart = LEUART0},
+#endif
+#ifdef LEUART1_ENABLED
+	[LEUART_SM_LEUART1] = {.hw = &leuart_instances[LEUART_SM_LEUART1], .leuart = LEUART1},
+#endif
+};
+
+typedef struct{
+	CR_STATE					cr;
+	LEUART_TypeDef				*leuart;
+	uint32_t					task_evt;				// Resumes the test
+	uint32_t					done_evt;				// Posted when the test has passed
+	uint32_t					rx_done_evt;			// Owner's RX event, restored after test five
+	uint32_t					int_flag;				// IEN saved while polling the flags
+}LEUART_LOOPBK_TASK;
+
+static LEUART_LOOPBK_TASK loopbk;
+static char loopbk_tx5[] = "Bad#Good!Bad";
+static char loopbk_good[] = "#Good!";
 /***************************************************************************//**
  * @brief LEUART driver
  * @details
@@ -70,12 +170,79 @@ static LEUART_COMMS_STRUCT leuart_sm;
 // Private function prototypes
 //***********************************************************************************
 
-static void leuart_txbl(void);
-static void leuart_txc(void);
-
-static void leuart_startf(void);
-static void leuart_rxdata(void);
-static void leuart_sigf(void);
+static void leuart_irq(LEUART_COMMS_STRUCT *sm);
+static void leuart_act_illegal(void *ctx);
+static void leuart_act_tx_byte(void *ctx);
+static void leuart_act_tx_done(void *ctx);
+
+static void leuart_act_frame_begin(void *ctx);
+static void leuart_act_frame_byte(void *ctx);
+static void leuart_act_raw_byte(void *ctx);
+static void leuart_act_frame_end(void *ctx);
+static void leuart_act_dma_frame_end(void *ctx);
+static void leuart_act_dma_overflow(void *ctx);
+static void leuart_act_dma_raw_done(void *ctx);
+static void leuart_rx_dma_arm(LEUART_COMMS_STRUCT *sm);
+static void leuart_rx_slot(LEUART_COMMS_STRUCT *sm);
+static void leuart_rx_frame_done(LEUART_COMMS_STRUCT *sm);
+static void leuart_rx_dma_done(void *arg);
+static inline LEUART_COMMS_STRUCT *leuart_context(LEUART_TypeDef *leuart);
+
+static const FSM_ACTION leuart_actions[] = {
+	[LEUART_ACT_ILLEGAL]		= leuart_act_illegal,
+	[LEUART_ACT_TX_BYTE]		= leuart_act_tx_byte,
+	[LEUART_ACT_TX_DONE]		= leuart_act_tx_done,
+	[LEUART_ACT_FRAME_BEGIN]	= leuart_act_frame_begin,
+	[LEUART_ACT_FRAME_BYTE]		= leuart_act_frame_byte,
+	[LEUART_ACT_RAW_BYTE]		= leuart_act_raw_byte,
+	[LEUART_ACT_FRAME_END]		= leuart_act_frame_end,
+	[LEUART_ACT_DMA_FRAME_END]	= leuart_act_dma_frame_end,
+	[LEUART_ACT_DMA_OVERFLOW]	= leuart_act_dma_overflow,
+	[LEUART_ACT_DMA_RAW_DONE]	= leuart_act_dma_raw_done,
+};
+
+/* START and SIGFRAME have no transitions, every cause in them is illegal. With
+ * the LDMA, TX goes straight to CLOSE and the characters raise no interrupt. */
+static const FSM_TRANSITION leuart_tx_transitions[LEUART_TX_STATES][LEUART_TX_CAUSES] = {
+	[TRANSMIT] = {
+		[LEUART_CAUSE_TXBL]		= {LEUART_ACT_TX_BYTE, FSM_STAY},		// CLOSE after the last character
+	},
+	[CLOSE] = {
+		[LEUART_CAUSE_TXC]		= {LEUART_ACT_TX_DONE, IDLE},
+	},
+};
+
+static const FSM_TRANSITION leuart_rx_transitions[LEUART_RX_STATES][LEUART_RX_CAUSES] = {
+	[STARTFRAME] = {
+		[LEUART_CAUSE_STARTF]	= {LEUART_ACT_FRAME_BEGIN, RECEIVE},
+	},
+	[RECEIVE] = {
+		[LEUART_CAUSE_RXDATAV]	= {LEUART_ACT_FRAME_BYTE, FSM_STAY},
+		[LEUART_CAUSE_SIGF]		= {LEUART_ACT_FRAME_END, STARTFRAME},
+	},
+	[RAW] = {
+		[LEUART_CAUSE_RXDATAV]	= {LEUART_ACT_RAW_BYTE, FSM_STAY},		// STARTFRAME once rx_raw is full
+	},
+};
+
+/* With the LDMA, RECEIVE lasts from leuart_open() on: RX stays blocked until
+ * STARTF and the LDMA collects the frame, so only its SIGF wakes the core */
+static const FSM_TRANSITION leuart_rx_dma_transitions[LEUART_RX_STATES][LEUART_RX_CAUSES] = {
+	[RECEIVE] = {
+		[LEUART_CAUSE_SIGF]		= {LEUART_ACT_DMA_FRAME_END, FSM_STAY},
+		[LEUART_CAUSE_RX_DMA]	= {LEUART_ACT_DMA_OVERFLOW, FSM_STAY},
+	},
+	[RAW] = {
+		[LEUART_CAUSE_RX_DMA]	= {LEUART_ACT_DMA_RAW_DONE, RECEIVE},
+	},
+};
+
+static const FSM_TABLE leuart_tx_table = {&leuart_tx_transitions[0][0], leuart_actions,
+		LEUART_TX_STATES, LEUART_TX_CAUSES, TRACE_LEUART_TX_STATE};
+static const FSM_TABLE leuart_rx_table = {&leuart_rx_transitions[0][0], leuart_actions,
+		LEUART_RX_STATES, LEUART_RX_CAUSES, TRACE_LEUART_RX_STATE};
+static const FSM_TABLE leuart_rx_dma_table = {&leuart_rx_dma_transitions[0][0], leuart_actions,
+		LEUART_RX_STATES, LEUART_RX_CAUSES, TRACE_LEUART_RX_STATE};
 
 
 //***********************************************************************************
@@ -96,12 +263,9 @@ static void leuart_sigf(void);
 
 void leuart_open(LEUART_TypeDef *leuart, LEUART_OPEN_STRUCT *leuart_settings){
 	LEUART_Init_TypeDef leuart_init;
+	LEUART_COMMS_STRUCT *sm = leuart_context(leuart);
 	// 1) Enable LEUART peripheral clock
-	if (leuart == LEUART0) { // Establish which LEUARTn peripheral we're using
-		CMU_ClockEnable(cmuClock_LEUART0, true);
-		} else {
-			EFM_ASSERT(false);
-		}
+		CMU_ClockEnable(sm->hw->clock, true);
 		// We should confirm clock enable is successful`
 		leuart->STARTFRAME = 0x01;
 		while(leuart->SYNCBUSY);
@@ -150,12 +314,10 @@ void leuart_open(LEUART_TypeDef *leuart, LEUART_OPEN_STRUCT *leuart_settings){
 		}
 		while(leuart->SYNCBUSY);
 
-		if(leuart == LEUART0){
-			NVIC_EnableIRQ(LEUART0_IRQn);
-		} else {EFM_ASSERT(false);}
+		NVIC_EnableIRQ(sm->hw->irq);
 
-		rx_done_evt = leuart_settings->rx_done_evt;
-		tx_done_evt = leuart_settings->tx_done_evt;
+		sm->rx_done_evt = leuart_settings->rx_done_evt;
+		sm->tx_done_evt = leuart_settings->tx_done_evt;
 
 		// Lab 7 LEUART development additions below:
 			leuart->CTRL |= LEUART_CTRL_SFUBRX;
@@ -169,8 +331,19 @@ void leuart_open(LEUART_TypeDef *leuart, LEUART_OPEN_STRUCT *leuart_settings){
 			leuart->SIGFRAME = '!';
 				while(leuart->SYNCBUSY);
 
-			leuart_sm.rx_busy = false;
-			leuart_sm.rx_state = START;
+			sm->rx_busy = false;
+			frame_ring_init(&sm->rx_ring, sm->rx_ring_buf, LEUART_RX_RING_SIZE, LEUART_RX_FRAME_MAX);
+			sm->dma = leuart_settings->dma;
+			if(sm->dma){
+				EFM_ASSERT(sm->hw->dma_rx_signal != ldmaPeripheralSignal_NONE);
+				ldma_open();
+				// TXBL and RXDATAV wake the LDMA in EM2, not the core
+				leuart->CTRL |= LEUART_CTRL_TXDMAWU | LEUART_CTRL_RXDMAWU;
+				while(leuart->SYNCBUSY);
+				fsm_init(&sm->rx_fsm, &leuart_rx_dma_table, RECEIVE);
+			} else {
+				fsm_init(&sm->rx_fsm, &leuart_rx_table, STARTFRAME);
+			}
 
 			sleep_block_mode(LEUART_EM);
 
@@ -178,50 +351,77 @@ void leuart_open(LEUART_TypeDef *leuart, LEUART_OPEN_STRUCT *leuart_settings){
 		leuart->IFC = leuart->IF; // This line already clears RXDATAV and SIGF Interrupts
 
 		// Initialize the interrupts
-		leuart->IEN |= LEUART_IEN_STARTF;
-		leuart->IEN &= ~LEUART_IEN_RXDATAV;
-		leuart->IEN &= ~LEUART_IEN_SIGF;
-		leuart_sm.tx_state = IDLE;
+		if(sm->dma){
+			leuart_rx_dma_arm(sm);
+		} else {
+			leuart->IEN |= LEUART_IEN_STARTF;
+			leuart->IEN &= ~LEUART_IEN_RXDATAV;
+			leuart->IEN &= ~LEUART_IEN_SIGF;
+		}
+		fsm_init(&sm->tx_fsm, &leuart_tx_table, IDLE);
+}
 
-		leuart_loopbk_test(LEUART0);
+/***************************************************************************//**
+ * @brief
+ *		Stops the LEUART and hands its pins back
+ * @details
+ *		e.g. to a USART on the same pins. leuart_open() starts it again.
+ * @param[in]  *leuart
+ * 		Defined LEUART struct
+ * @note
+ * 		Nothing may be in flight, the owner waits for its TX event first. A
+ * 		frame that has started is dropped.
+ ******************************************************************************/
 
+void leuart_close(LEUART_TypeDef *leuart){
+	LEUART_COMMS_STRUCT *sm = leuart_context(leuart);
+
+	EFM_ASSERT(!sm->tx_busy);
+	NVIC_DisableIRQ(sm->hw->irq);
+	leuart->IEN = 0;
+	if(sm->dma){
+		ldma_stop(sm->hw->dma_rx_ch);
+	}
+	LEUART_Enable(leuart, leuartDisable);
+	leuart->ROUTEPEN = 0;
+	while(leuart->SYNCBUSY);
+	leuart->IFC = leuart->IF;
+	sm->rx_busy = false;
+	sleep_unblock_mode(LEUART_EM);
 }
 
+#ifdef LEUART0_ENABLED
 /***************************************************************************//**
  * @brief
  * 		IRQ Handler for LEUART0
  * @details
- * 		Only Interrupts are TXBL and TXC
- * @note
- * 		For more information, see the leuart_txbl()
- * 		and leuart_txc()
+ * 		Bound to the LEUART0 context at compile time, see leuart_irq()
  ******************************************************************************/
 
 void LEUART0_IRQHandler(void){
-	uint32_t int_flag = LEUART0->IF & LEUART0->IEN;
-	LEUART0->IFC = int_flag;
-	if(int_flag & LEUART_IF_TXBL){
-		leuart_txbl();
-	}
-	if(int_flag & LEUART_IF_TXC){
-		leuart_txc();
-	}
-	if(int_flag & LEUART_IF_STARTF){
-		leuart_startf();
-	}
-	if(int_flag & LEUART_IF_RXDATAV){
-		leuart_rxdata();
-	}
-	if(int_flag & LEUART_IF_SIGF){
-		leuart_sigf();
-	}
+	leuart_irq(&leuart_sm[LEUART_SM_LEUART0]);
+}
+#endif
+
+#ifdef LEUART1_ENABLED
+/***************************************************************************//**
+ * @brief
+ * 		IRQ Handler for LEUART1
+ * @details
+ * 		Bound to the LEUART1 context at compile time, see leuart_irq()
+ ******************************************************************************/
+
+void LEUART1_IRQHandler(void){
+	leuart_irq(&leuart_sm[LEUART_SM_LEUART1]);
 }
+#endif
 
 /***************************************************************************//**
  * @brief
  * 		Initializes the LEUART function for use.
  * @details
- *		The initialization function for the LEUART once the LEUART is configured
+ *		The initialization function for the LEUART once the LEUART is configured.
+ *		Completion posts the tx_done_evt given to leuart_open().
  * @param[in]  *leuart
  * 		Defined leuart struct
  * @param[in]  *string
@@ -229,6 +429,69 @@ void LEUART0_IRQHandler(void){
  * @param[in]  string_len
  * 		Length of the indicated input string being pointed to
  * @note
+ * 		The string is sent in place, see leuart_send_segments().
+ ******************************************************************************/
+
+void leuart_start(LEUART_TypeDef *leuart, char *string, uint32_t string_len){
+	leuart_send(leuart, string, string_len, leuart_context(leuart)->tx_done_evt);
+}
+
+/***************************************************************************//**
+ * @brief
+ * 		Transmits a message in parts, posting the tx_done_evt given to
+ * 		leuart_open()
+ * @details
+ *		See leuart_send_segments()
+ ******************************************************************************/
+
+void leuart_start_segments(LEUART_TypeDef *leuart, const LEUART_SEGMENT *seg, uint32_t count){
+	leuart_send_segments(leuart, seg, count, leuart_context(leuart)->tx_done_evt);
+}
+
+/***************************************************************************//**
+ * @brief
+ * 		Transmits a string and posts [event] once it has left the shift register
+ * @details
+ *		Same state machine as leuart_start(), for sequences such as the TDD
+ *		tasks that resume on their own event instead of the owner's TX event.
+ * @param[in]  *leuart
+ * 		Defined leuart struct
+ * @param[in]  *string
+ * 		Input string
+ * @param[in]  string_len
+ * 		Length of the indicated input string being pointed to
+ * @param[in]  event
+ * 		Scheduler event posted at TXC, payload is string_len
+ * @note
+ * 		The string is not copied, it must stay unchanged until [event].
+ ******************************************************************************/
+
+void leuart_send(LEUART_TypeDef *leuart, char *string, uint32_t string_len, uint32_t event){
+	LEUART_SEGMENT seg = {string, string_len};
+
+	leuart_send_segments(leuart, &seg, 1, event);
+}
+
+/***************************************************************************//**
+ * @brief
+ * 		Transmits the segments of one message back to back
+ * @details
+ *		The TX state machine takes each character straight from the caller's
+ *		memory, so a message that wraps around the end of a ring buffer goes
+ *		out as two segments, with no copy and no length limit of its own.
+ *		Empty segments are skipped. When the LEUART was opened with dma set,
+ *		the segments are linked LDMA blocks paced by TXBL and the core only
+ *		wakes for TXC.
+ * @param[in]  *leuart
+ * 		Defined leuart struct
+ * @param[in]  *seg
+ * 		At most LEUART_SEGMENTS_MAX segments. The array is copied, the
+ * 		characters it points to are not and must stay unchanged until [event].
+ * @param[in]  count
+ * 		Number of segments
+ * @param[in]  event
+ * 		Scheduler event posted at TXC, payload is the total length
+ * @note
  * 		The atomic operations MUST BE below the while loop above. This is because
  * 		we will be preventing IRQ that is currently running from completing.
  *
@@ -236,23 +499,96 @@ void LEUART0_IRQHandler(void){
  * 		so that in -O2 optimization, that sandwiched code will run linearly.
  ******************************************************************************/
 
-void leuart_start(LEUART_TypeDef *leuart, char *string, uint32_t string_len){
-	while(leuart_tx_busy());
+void leuart_send_segments(LEUART_TypeDef *leuart, const LEUART_SEGMENT *seg, uint32_t count, uint32_t event){
+	LEUART_COMMS_STRUCT *sm = leuart_context(leuart);
+
+	EFM_ASSERT(count <= LEUART_SEGMENTS_MAX);
+
+	while(sm->tx_busy);
 
 	EFM_ASSERT(leuart->STATUS & LEUART_STATUS_TXIDLE);
-	EFM_ASSERT(string_len > 0); // Check if the string has text
 
 	CORE_DECLARE_IRQ_STATE; // Checking to see if global interrupts are enabled
 	CORE_ENTER_CRITICAL(); // Make the operation atomic
 
-	leuart_sm.tx_len = string_len;
-	leuart_sm.char_index = 0;
-	leuart_sm.leuart = leuart;
-	strcpy(leuart_sm.tx_out, string);
-	leuart_sm.tx_busy = true;
+	sm->tx_seg_count = 0;
+	sm->tx_len = 0;
+	for(uint32_t i = 0; i < count; i++){
+		if(seg[i].len == 0) continue;
+		sm->tx_seg[sm->tx_seg_count++] = seg[i];
+		sm->tx_len += seg[i].len;
+	}
+	EFM_ASSERT(sm->tx_len > 0); // Check if the string has text
+	sm->tx_seg_cur = 0;
+	sm->char_index = 0;
+	sm->tx_evt = event;
+	sm->tx_busy = true;
 	sleep_block_mode(LEUART_EM);
-	leuart_sm.tx_state = TRANSMIT;
-	leuart->IEN |= LEUART_IEN_TXBL;
+	energy_busy_begin(ENERGY_LOAD_LEUART_TX);
+	if(sm->dma){
+		LDMA_BLOCK block[LEUART_SEGMENTS_MAX];
+
+		for(uint32_t i = 0; i < sm->tx_seg_count; i++){
+			block[i].src = sm->tx_seg[i].data;
+			block[i].count = sm->tx_seg[i].len;
+		}
+		fsm_set(&sm->tx_fsm, CLOSE);
+		leuart->IFC = LEUART_IEN_TXC;
+		leuart->IEN |= LEUART_IEN_TXC;
+		ldma_m2p_blocks(sm->hw->dma_tx_ch, sm->hw->dma_tx_signal, block, sm->tx_seg_count,
+				&leuart->TXDATA, NULL, NULL);
+	} else {
+		fsm_set(&sm->tx_fsm, TRANSMIT);
+		leuart->IEN |= LEUART_IEN_TXBL;
+	}
+
+	CORE_EXIT_CRITICAL();
+}
+
+/***************************************************************************//**
+ * @brief
+ * 		Collects the next [len] bytes without start or signal frame detection
+ * @details
+ *		Used to read the HM-10's bare AT responses through RXDATAV interrupts
+ *		instead of polling. STARTF is masked until the buffer is full. With
+ *		the LDMA the frame transfer is set aside for one into [buf] instead,
+ *		and the core wakes once when it is full.
+ * @param[in]  *leuart
+ * 		Defined leuart struct
+ * @param[out] *buf
+ * 		Receives the bytes, not null terminated
+ * @param[in]  len
+ * 		Number of bytes to collect
+ * @param[in]  event
+ * 		Scheduler event posted when [len] bytes arrived, payload is len
+ * @note
+ * 		The caller must have RX unblocked. Arm the receive before sending the
+ * 		command it answers so the first byte cannot be missed.
+ ******************************************************************************/
+void leuart_receive(LEUART_TypeDef *leuart, char *buf, uint32_t len, uint32_t event){
+	LEUART_COMMS_STRUCT *sm = leuart_context(leuart);
+
+	EFM_ASSERT(len > 0 && len < 256);
+	EFM_ASSERT(!sm->rx_busy);
+
+	CORE_DECLARE_IRQ_STATE;
+	CORE_ENTER_CRITICAL();
+
+	sm->rx_raw = buf;
+	sm->rx_raw_len = len;
+	sm->rx_raw_evt = event;
+	sm->rx_len = 0;
+	sm->rx_busy = true;
+	fsm_set(&sm->rx_fsm, RAW);
+	if(sm->dma){
+		ldma_stop(sm->hw->dma_rx_ch);
+		leuart->IEN &= ~LEUART_IEN_SIGF;
+		ldma_p2m(sm->hw->dma_rx_ch, sm->hw->dma_rx_signal, &leuart->RXDATA, buf, len,
+				leuart_rx_dma_done, sm);
+	} else {
+		leuart->IEN &= ~LEUART_IEN_STARTF;
+		leuart->IEN |= LEUART_IEN_RXDATAV;
+	}
 
 	CORE_EXIT_CRITICAL();
 }
@@ -262,162 +598,307 @@ void leuart_start(LEUART_TypeDef *leuart, char *string, uint32_t string_len){
  * 		Handles the case when tx is busy.
  * @details
  *		Returns the state of the leuart_tx_busy bit.
+ * @param[in]  *leuart
+ * 		Defined leuart struct
  ******************************************************************************/
-bool leuart_tx_busy(void){
-		return leuart_sm.tx_busy;
+bool leuart_tx_busy(LEUART_TypeDef *leuart){
+		return leuart_context(leuart)->tx_busy;
 }
 /***************************************************************************//**
  * @brief
  * 		Handles the case when rx is busy.
  * @details
  *		Checks the state of the rx_busy bit of the LEUART
+ * @param[in]  *leuart
+ * 		Defined leuart struct
+ * @note
+ * 		With the LDMA there is no STARTF interrupt, a frame is under way once
+ * 		the LDMA has taken its first character.
  ******************************************************************************/
-bool leuart_rx_busy(void){
-		return leuart_sm.rx_busy;
+bool leuart_rx_busy(LEUART_TypeDef *leuart){
+	LEUART_COMMS_STRUCT *sm = leuart_context(leuart);
+
+	if(sm->dma && sm->rx_fsm.state == RECEIVE){
+		return ldma_remaining(sm->hw->dma_rx_ch) < LEUART_RX_FRAME_MAX;
+	}
+	return sm->rx_busy;
 }
 /***************************************************************************//**
  * @brief
- *		Handles the TXBL for LEUART
+ * 		Interrupt Service Routine shared by the LEUART instances
  * @details
- *		Switch statement for State Machine when the TXBL Interrupt is handled
- *		for data transmission.
+ * 		Runs the TX and RX state machines of the LEUART whose handler called it
  * @note
- * 		Please note that we don't actually use two of the defined states.
- * 		Could we possibly rid of them for simplicity?
- ******************************************************************************/
-void leuart_txbl(void){
-	switch(leuart_sm.tx_state){
-		case IDLE:
-			EFM_ASSERT(false);
-			break;
-		case START:
-			EFM_ASSERT(false);
-			break;
-		case TRANSMIT:
-			leuart_sm.leuart->TXDATA = leuart_sm.tx_out[leuart_sm.char_index];
-			leuart_sm.char_index++;
-			if(leuart_sm.char_index >= leuart_sm.tx_len){
-				leuart_sm.leuart->IEN &= ~LEUART_IEN_TXBL;
-				leuart_sm.leuart->IEN |= LEUART_IEN_TXC;
-				leuart_sm.tx_state = CLOSE;
-			}
-			break;
-		case CLOSE:
-			EFM_ASSERT(false);
-			break;
+ * 		Each cause is one lookup in the TX or RX table and one call of the
+ * 		action it names, e.g. leuart_act_tx_byte() for TXBL while transmitting.
+ ******************************************************************************/
+static void leuart_irq(LEUART_COMMS_STRUCT *sm){
+	uint32_t int_flag = sm->leuart->IF & sm->leuart->IEN;
+	sm->leuart->IFC = int_flag;
+	TRACE(sm->hw->trace_irq, int_flag);
+	if(int_flag & LEUART_IF_TXBL){
+		fsm_dispatch(&sm->tx_fsm, LEUART_CAUSE_TXBL, sm);
+	}
+	if(int_flag & LEUART_IF_TXC){
+		fsm_dispatch(&sm->tx_fsm, LEUART_CAUSE_TXC, sm);
+	}
+	if(int_flag & LEUART_IF_STARTF){
+		fsm_dispatch(&sm->rx_fsm, LEUART_CAUSE_STARTF, sm);
+	}
+	if(int_flag & LEUART_IF_RXDATAV){
+		fsm_dispatch(&sm->rx_fsm, LEUART_CAUSE_RXDATAV, sm);
+	}
+	if(int_flag & LEUART_IF_SIGF){
+		fsm_dispatch(&sm->rx_fsm, LEUART_CAUSE_SIGF, sm);
 	}
 }
+
 /***************************************************************************//**
  * @brief
- *		Handles the TXC for leuart.
+ *		Action of the transitions the TX and RX tables do not list
  * @details
- *		Switch statement for State Machine when the TXC interrupt is run
+ *		Counted by the FSM with its state and cause, and caught here in
+ *		debug builds.
+ ******************************************************************************/
+static void leuart_act_illegal(void *ctx){
+	(void)ctx;
+	EFM_ASSERT(false);
+}
+
+/***************************************************************************//**
+ * @brief
+ *		TXBL while transmitting, the next character
+ * @details
+ *		At the end of a segment it moves on to the next one. After the last
+ *		character of the last one TXBL is swapped for TXC and the TX state
+ *		machine moves on to CLOSE.
+ ******************************************************************************/
+static void leuart_act_tx_byte(void *ctx){
+	LEUART_COMMS_STRUCT *sm = ctx;
+	const LEUART_SEGMENT *seg = &sm->tx_seg[sm->tx_seg_cur];
+
+	sm->leuart->TXDATA = seg->data[sm->char_index];
+	sm->char_index++;
+	if(sm->char_index >= seg->len){
+		sm->char_index = 0;
+		if(++sm->tx_seg_cur >= sm->tx_seg_count){
+			sm->leuart->IEN &= ~LEUART_IEN_TXBL;
+			sm->leuart->IEN |= LEUART_IEN_TXC;
+			fsm_set(&sm->tx_fsm, CLOSE);
+		}
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *		TXC, the string has left the shift register
  * @note
  * 		Because we have finished transmitting, we must set the tx_busy bit to false
  ******************************************************************************/
-void leuart_txc(void){
-	switch(leuart_sm.tx_state){
-		case IDLE:
-			EFM_ASSERT(false);
-			break;
-		case START:
-			EFM_ASSERT(false);
-			break;
-		case TRANSMIT:
-			EFM_ASSERT(false);
-			break;
-		case CLOSE:
-
-			leuart_sm.tx_busy = false;
-			leuart_sm.leuart->IEN &= ~LEUART_IEN_TXC;
-			leuart_sm.tx_state = IDLE;
-			add_scheduled_event(tx_done_evt);
-			sleep_unblock_mode(LEUART_EM);
-			break;
-	}
+static void leuart_act_tx_done(void *ctx){
+	LEUART_COMMS_STRUCT *sm = ctx;
+
+	sm->tx_busy = false;
+	sm->leuart->IEN &= ~LEUART_IEN_TXC;
+	scheduler_post(sm->hw->sched_src, sm->tx_evt, sm->tx_len);
+	sleep_unblock_mode(LEUART_EM);
+	energy_busy_end(ENERGY_LOAD_LEUART_TX);
 }
 
 /***************************************************************************//**
  * @brief
- *		Handles the STARTF interrupt for leuart.
- * @details
- *		Switch statement RX State machine that handles the case for when the
- *		Start Frame is detected
+ *		STARTF, a framed command begins
  * @note
  * 		It is important to set the RX busy bit to true so that
  * 		the interrupt may proceed.
  ******************************************************************************/
-void leuart_startf(void){
-	switch(leuart_sm.rx_state){
-		case STARTFRAME:
-					leuart_sm.rx_busy = true;
-					leuart_sm.rx_len = 0;
-					LEUART0->IFC = LEUART_IEN_RXDATAV;
-					LEUART0->IFC = LEUART_IEN_SIGF;
-					LEUART0->IEN |= LEUART_IEN_RXDATAV;
-					LEUART0->IEN |= LEUART_IEN_SIGF;
-					leuart_sm.rx_state = RECEIVE;
-			break;
-		case RECEIVE:
-			EFM_ASSERT(false);
-			break;
-		case SIGFRAME:
-			EFM_ASSERT(false);
-			break;
-	}
+static void leuart_act_frame_begin(void *ctx){
+	LEUART_COMMS_STRUCT *sm = ctx;
+
+	sm->rx_busy = true;
+	sm->rx_len = 0;
+	sm->rx_long = false;
+	leuart_rx_slot(sm);
+	sm->leuart->IFC = LEUART_IEN_RXDATAV;
+	sm->leuart->IFC = LEUART_IEN_SIGF;
+	sm->leuart->IEN |= LEUART_IEN_RXDATAV;
+	sm->leuart->IEN |= LEUART_IEN_SIGF;
 }
 
 /***************************************************************************//**
  * @brief
- *		Handles the RXDATA interrupt for leuart.
+ *		RXDATAV inside a frame
  * @details
- *		Switch statement RX State machine that handles the case for when the
- *		Start Frame is detected
- ******************************************************************************/
-void leuart_rxdata(void){
-	switch(leuart_sm.rx_state){
-		case STARTFRAME:
-			EFM_ASSERT(false);
-			break;
-		case RECEIVE:
-			leuart_sm.RXbuf[leuart_sm.rx_len] = leuart_sm.leuart->RXDATA;
-			leuart_sm.rx_len++;
-			break;
-		case SIGFRAME:
-			EFM_ASSERT(false);
-			break;
+ *		Characters past LEUART_RX_FRAME_MAX are read and dropped, the frame
+ *		is counted as an overflow at its SIGF.
+ ******************************************************************************/
+static void leuart_act_frame_byte(void *ctx){
+	LEUART_COMMS_STRUCT *sm = ctx;
+	char c = sm->leuart->RXDATA;
+
+	if(sm->rx_len >= LEUART_RX_FRAME_MAX){
+		sm->rx_long = true;
+		return;
 	}
+	sm->rx_frame[sm->rx_len] = c;
+	sm->rx_len++;
 }
 
 /***************************************************************************//**
  * @brief
- *		Handles the STARTF interrupt for leuart.
- * @details
- *		Switch statement RX State machine that handles the case for when the
- *		Start Frame is detected
+ *		RXDATAV of a leuart_receive(), framing goes back on once it is full
+ ******************************************************************************/
+static void leuart_act_raw_byte(void *ctx){
+	LEUART_COMMS_STRUCT *sm = ctx;
+
+	sm->rx_raw[sm->rx_len] = sm->leuart->RXDATA;
+	sm->rx_len++;
+	if(sm->rx_len >= sm->rx_raw_len){
+		sm->leuart->IEN &= ~LEUART_IEN_RXDATAV;
+		sm->leuart->IEN |= LEUART_IEN_STARTF;
+		fsm_set(&sm->rx_fsm, STARTFRAME);
+		sm->rx_busy = false;
+		scheduler_post(sm->hw->sched_src, sm->rx_raw_evt, sm->rx_len);
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *		SIGF, the frame is complete
  * @note
  * 		We must set the leuart0_rx_busy to false so that the RX action can be done
  ******************************************************************************/
-void leuart_sigf(void){
-	switch(leuart_sm.rx_state){
-		case STARTFRAME:
-			EFM_ASSERT(false);
-			break;
-		case RECEIVE:
-			leuart_sm.rx_busy = false;
-			add_scheduled_event(rx_done_evt);
-			leuart_sm.rx_state = STARTFRAME;
-			leuart_sm.leuart->CMD = LEUART_CMD_RXBLOCKEN;
-			while(LEUART0->SYNCBUSY);
-			leuart_sm.leuart->IEN |= LEUART_IEN_STARTF;
-			leuart_sm.RXbuf[leuart_sm.rx_len] = 0;
-			leuart_sm.leuart->IEN &= ~LEUART_IEN_SIGF;
-			leuart_sm.leuart->IEN &= ~LEUART_IEN_RXDATAV;
-			break;
-		case SIGFRAME:
-			EFM_ASSERT(false);
-			break;
+static void leuart_act_frame_end(void *ctx){
+	LEUART_COMMS_STRUCT *sm = ctx;
+
+	sm->rx_busy = false;
+	if(sm->rx_long){
+		sm->rx_ring.overflow++;
+	} else {
+		leuart_rx_frame_done(sm);
 	}
+	sm->leuart->CMD = LEUART_CMD_RXBLOCKEN;
+	while(sm->leuart->SYNCBUSY);
+	sm->leuart->IEN |= LEUART_IEN_STARTF;
+	sm->leuart->IEN &= ~LEUART_IEN_SIGF;
+	sm->leuart->IEN &= ~LEUART_IEN_RXDATAV;
+}
+
+/***************************************************************************//**
+ * @brief
+ *		SIGF with the LDMA, the frame is complete
+ * @details
+ *		Its length is what the LDMA has moved into its room. It is committed
+ *		and posted, RX is blocked again and the next frame's transfer is
+ *		started in the room that follows.
+ * @note
+ * 		SIGF is raised as the signal frame lands in RXDATA, and nothing bounds
+ * 		when the LDMA gets to it. The channel is stopped first, so the count
+ * 		cannot move, and a signal frame still in RXDATA is moved by hand.
+ * 		The frame keeps its '!' and the next frame's transfer never starts
+ * 		on a stale byte.
+ ******************************************************************************/
+static void leuart_act_dma_frame_end(void *ctx){
+	LEUART_COMMS_STRUCT *sm = ctx;
+	uint8_t sig;
+
+	ldma_stop(sm->hw->dma_rx_ch);
+	sm->rx_len = LEUART_RX_FRAME_MAX - ldma_remaining(sm->hw->dma_rx_ch);
+	if(sm->leuart->STATUS & LEUART_STATUS_RXDATAV){
+		sig = sm->leuart->RXDATA;			// The LDMA had not taken it yet
+		if(sm->rx_len < LEUART_RX_FRAME_MAX){
+			sm->rx_frame[sm->rx_len++] = sig;
+		}
+	}
+	leuart_rx_frame_done(sm);
+	sm->leuart->CMD = LEUART_CMD_RXBLOCKEN;
+	while(sm->leuart->SYNCBUSY);
+	leuart_rx_dma_arm(sm);
+}
+
+/***************************************************************************//**
+ * @brief
+ *		The LDMA filled the frame's room before a signal frame arrived
+ * @details
+ *		The frame is too long for any command, or its SIGF was lost. It is
+ *		dropped and counted, and RX waits for the next STARTF in the same
+ *		room.
+ ******************************************************************************/
+static void leuart_act_dma_overflow(void *ctx){
+	LEUART_COMMS_STRUCT *sm = ctx;
+
+	sm->rx_ring.overflow++;
+	sm->leuart->CMD = LEUART_CMD_RXBLOCKEN;
+	while(sm->leuart->SYNCBUSY);
+	leuart_rx_dma_arm(sm);
+}
+
+/***************************************************************************//**
+ * @brief
+ *		The LDMA filled the buffer of a leuart_receive()
+ ******************************************************************************/
+static void leuart_act_dma_raw_done(void *ctx){
+	LEUART_COMMS_STRUCT *sm = ctx;
+
+	sm->rx_len = sm->rx_raw_len;
+	sm->rx_busy = false;
+	leuart_rx_dma_arm(sm);
+	scheduler_post(sm->hw->sched_src, sm->rx_raw_evt, sm->rx_len);
+}
+
+/***************************************************************************//**
+ * @brief
+ *		Starts the LDMA transfer that collects the next frame into the ring
+ * @details
+ *		LEUART_RX_FRAME_MAX characters, the ring keeps room for the null.
+ *		Only SIGF, or the transfer filling up, wakes the core.
+ ******************************************************************************/
+static void leuart_rx_dma_arm(LEUART_COMMS_STRUCT *sm){
+	leuart_rx_slot(sm);
+	sm->leuart->IFC = LEUART_IEN_SIGF;
+	sm->leuart->IEN |= LEUART_IEN_SIGF;
+	ldma_p2m(sm->hw->dma_rx_ch, sm->hw->dma_rx_signal, &sm->leuart->RXDATA, sm->rx_frame,
+			LEUART_RX_FRAME_MAX, leuart_rx_dma_done, sm);
+}
+
+/***************************************************************************//**
+ * @brief
+ *		Picks the room of the next frame
+ * @details
+ *		The next free room in rx_ring, or rx_discard while the owner has not
+ *		caught up and the ring is full. A frame received there is counted
+ *		and dropped.
+ ******************************************************************************/
+static void leuart_rx_slot(LEUART_COMMS_STRUCT *sm){
+	sm->rx_frame = frame_ring_reserve(&sm->rx_ring);
+	if(sm->rx_frame == NULL){
+		sm->rx_frame = sm->rx_discard;
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *		The rx_len characters at rx_frame are a complete frame
+ ******************************************************************************/
+static void leuart_rx_frame_done(LEUART_COMMS_STRUCT *sm){
+	if(sm->rx_frame == sm->rx_discard){
+		sm->rx_ring.full++;
+		return;
+	}
+	frame_ring_commit(&sm->rx_ring, sm->rx_len);
+	scheduler_post(sm->hw->sched_src, sm->rx_done_evt, sm->rx_len);
+}
+
+/***************************************************************************//**
+ * @brief
+ *		LDMA done callback of the receive channel
+ * @details
+ *		Runs in the LDMA interrupt, it is one more cause of the RX table.
+ ******************************************************************************/
+static void leuart_rx_dma_done(void *arg){
+	LEUART_COMMS_STRUCT *sm = arg;
+
+	fsm_dispatch(&sm->rx_fsm, LEUART_CAUSE_RX_DMA, sm);
 }
 
 /***************************************************************************//**
@@ -550,38 +1031,92 @@ uint8_t leuart_app_receive_byte(LEUART_TypeDef *leuart){
 
 /***************************************************************************//**
  * @brief
- *   	Exports the received data.
+ *   	The oldest framed command received, where it lies
  * @details
- * 		Exports the RXdata saved in the RX buffer for external use.
- * @param [in] *string
- *		This string is the data retrieved from the RXData buffer to be exported.
+ * 		Start and signal frame included and null terminated, so it can be
+ * 		parsed as a string. Frames stay in order in the RX ring until they are
+ * 		released, a new one does not overwrite them.
+ * @param [in] *leuart
+ * 		Defined leuart struct
+ * @param [out] *len
+ *		Characters of the frame
+ * @return
+ * 		The frame, valid until leuart_rx_release(), or NULL if none is waiting
+ ******************************************************************************/
+const char *leuart_rx_frame(LEUART_TypeDef *leuart, uint32_t *len){
+	return frame_ring_peek(&leuart_context(leuart)->rx_ring, len);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   	Frees the frame leuart_rx_frame() returned
+ ******************************************************************************/
+void leuart_rx_release(LEUART_TypeDef *leuart){
+	frame_ring_release(&leuart_context(leuart)->rx_ring);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   	Frames received, and dropped for being too long or for a full ring,
+ *   	since leuart_open()
  ******************************************************************************/
-void received_data(char*string){
-	strcpy(string,leuart_sm.RXbuf);
+void leuart_rx_stats(LEUART_TypeDef *leuart, FRAME_RING_STATS *stats){
+	frame_ring_stats(&leuart_context(leuart)->rx_ring, stats);
 }
 /****************************************************************************//**
  * @brief
- *		LEUART TX/RX functionality test
+ *		Starts the LEUART TX/RX functionality test
  * @details
- *		Test the LEUART's TX/RX line by using Loopback to talk to itself. This test
- *		checks the interrupts and acts as prototyping for the project.
+ *		Test the LEUART's TX/RX line by using Loopback to talk to itself. The test
+ *		runs as a coroutine task, see leuart_loopbk_task().
  * @param[in] *leuart
  * 		Basic LEUART struct.
+ * @param[in] task_event
+ * 		Scheduler event registered to leuart_loopbk_task()
+ * @param[in] done_event
+ * 		Scheduler event posted once every test has passed
+ * @note
+ * 		Must run after leuart_open() and before anything else uses the LEUART.
+ ******************************************************************************/
+void leuart_loopbk_test(LEUART_TypeDef *leuart, uint32_t task_event, uint32_t done_event){
+	EFM_ASSERT(!CR_RUNNING(&loopbk.cr));
+	loopbk.leuart = leuart;
+	loopbk.task_evt = task_event;
+	loopbk.done_evt = done_event;
+	CR_RESET(&loopbk.cr);
+	add_scheduled_event(task_event);
+}
+
+/****************************************************************************//**
+ * @brief
+ *		LEUART TX/RX functionality test task
+ * @details
+ *		Test the LEUART's TX/RX line by using Loopback to talk to itself. This test
+ *		checks the interrupts and acts as prototyping for the project. Every wait
+ *		yields back to the scheduler, so other events keep running while the
+ *		characters are on the wire.
+ * @param[in] payload
+ * 		Unused
  * @note
  *		LEUn_TX pin must be enabled as an output in the GPIO
  *		LEUART0_CTRL -> LOOPBK enable -> disable
  * @note
- * 		It is important to clear the buffers before exiting the TDD so that the
- * 		transmitted strings aren't treated as a command being fed into the RX
-
+ * 		Test five receives into the task instead of the owner's RX event, so the
+ * 		transmitted strings are never treated as a command being fed into the RX
  ******************************************************************************/
-void leuart_loopbk_test(LEUART_TypeDef *leuart){
-	uint32_t int_flag;
-	int_flag = leuart->IEN;
-	leuart->IEN = 0; // Clear Interrupt Enable
+void leuart_loopbk_task(uint32_t payload){
+	(void)payload;
+	LEUART_TypeDef *leuart = loopbk.leuart;
+	const char *frame;
+	uint32_t len;
 
-	CORE_DECLARE_IRQ_STATE;
-	CORE_ENTER_CRITICAL();
+	CR_BEGIN(&loopbk.cr);
+
+	loopbk.int_flag = leuart->IEN;
+	leuart->IEN = 0; // Clear Interrupt Enable
+	if(leuart_context(leuart)->dma){
+		ldma_stop(leuart_context(leuart)->hw->dma_rx_ch); // Tests one to four read RXDATA themselves
+	}
 
 	leuart->CTRL |= LEUART_CTRL_LOOPBK;
 	while(leuart->SYNCBUSY);
@@ -604,14 +1139,16 @@ void leuart_loopbk_test(LEUART_TypeDef *leuart){
 
 	// Test one checks sending garbage before sending Start Frame.
 	leuart->TXDATA = '1';
-	timer_delay(4); 		// We include this to make sure the transmission went.
+	timer_delay_async(4, loopbk.task_evt); 		// We include this to make sure the transmission went.
+	CR_YIELD(&loopbk.cr);
 	EFM_ASSERT(!(leuart->IF & LEUART_IF_STARTF));
 	EFM_ASSERT(!(LEUART_IF_RXDATAV & leuart->IF));
 	leuart->IFC |= leuart->IF; // Clear all flags
 
 	// Test two checks the StartFrame incrementally.
 	leuart->TXDATA = '#';
-	timer_delay(4);
+	timer_delay_async(4, loopbk.task_evt);
+	CR_YIELD(&loopbk.cr);
 	EFM_ASSERT(leuart->RXDATA == '#');
 	EFM_ASSERT(leuart->IF & LEUART_IF_STARTF); // Check if the StartFrame interrupt flag was set.
 	EFM_ASSERT(!(leuart->STATUS & LEUART_STATUS_RXBLOCK)); // Check if RX is still blocked
@@ -619,7 +1156,8 @@ void leuart_loopbk_test(LEUART_TypeDef *leuart){
 
 	// Test three sends a string, with the StartFrame still active from test two.
 	leuart->TXDATA = 'A';
-	timer_delay(4);
+	timer_delay_async(4, loopbk.task_evt);
+	CR_YIELD(&loopbk.cr);
 	EFM_ASSERT(LEUART_IF_RXDATAV & leuart->IF); // Check if data is being received in the RX.
 	EFM_ASSERT(leuart->RXDATA == 'A');
 	EFM_ASSERT(!(leuart->STATUS & LEUART_STATUS_RXBLOCK));
@@ -628,36 +1166,62 @@ void leuart_loopbk_test(LEUART_TypeDef *leuart){
 
 	// Test four sends the defined SigFrame to finish the transmission process.
 	leuart->TXDATA = '!';
-	timer_delay(4);
+	timer_delay_async(4, loopbk.task_evt);
+	CR_YIELD(&loopbk.cr);
 	EFM_ASSERT(leuart->RXDATA == '!');
 	EFM_ASSERT(leuart->IF & LEUART_IF_SIGF); // Same as test two, but checking SIGF, not STARTF
 	EFM_ASSERT(!(leuart->STATUS & LEUART_STATUS_RXBLOCK));
 	leuart->IFC = leuart->IF;
 
-	CORE_EXIT_CRITICAL();
 	leuart->IFC = leuart->IF; // It is best practice to first clear interrupts
-	leuart->IEN = int_flag; //Turns on interrupts again
+	leuart->IEN = loopbk.int_flag; //Turns on interrupts again
 
 	leuart->CMD = LEUART_CMD_RXBLOCKEN;
 	while(leuart->SYNCBUSY);
-
-	//Test five
-	char tx5[50] = "Bad#Good!Bad";
-	char good_str[50] = "#Good!";
-	char res_str[50];
-	uint8_t str_len = strlen(tx5);
-	leuart_start(leuart, tx5, str_len);
-	while(leuart_tx_busy());
-	while(leuart_rx_busy());
-	strcpy(res_str, leuart_sm.RXbuf); // copying buffer into result
-	for(int i =0; i < strlen(good_str); i++){
-		EFM_ASSERT(res_str[i] == good_str[i]);
+	if(leuart_context(leuart)->dma){
+		leuart_rx_dma_arm(leuart_context(leuart));
 	}
 
-	remove_scheduled_event(tx_done_evt);// We now must clear the buffer via clearing the event
-	remove_scheduled_event(rx_done_evt);// These two lines of code are for the express purpose of clearing the buffer
+	//Test five, both the frame and the TXC come back to this task
+	loopbk.rx_done_evt = leuart_context(leuart)->rx_done_evt;
+	leuart_context(leuart)->rx_done_evt = loopbk.task_evt;
+	leuart_send(leuart, loopbk_tx5, strlen(loopbk_tx5), loopbk.task_evt);
+	CR_WAIT_UNTIL(&loopbk.cr, !leuart_tx_busy(leuart) && !leuart_rx_busy(leuart));
+	leuart_context(leuart)->rx_done_evt = loopbk.rx_done_evt;
+
+	frame = leuart_rx_frame(leuart, &len);
+	EFM_ASSERT(frame != NULL && len == strlen(loopbk_good));
+	for(uint32_t i = 0; i < len; i++){
+		EFM_ASSERT(frame[i] == loopbk_good[i]);
+	}
+	leuart_rx_release(leuart);
 	EFM_ASSERT((leuart->STATUS & LEUART_STATUS_RXBLOCK)); // Check if RX is blocked
 
 	leuart->CTRL &= ~LEUART_CTRL_LOOPBK;
 	while(leuart->SYNCBUSY);
+
+	add_scheduled_event(loopbk.done_evt);
+
+	CR_END(&loopbk.cr);
+}
+
+/***************************************************************************//**
+ * @brief
+ *		Finds the context of a peripheral for the public functions
+ * @details
+ *		Only the instances enabled in brd_config.h have a context. The
+ *		interrupt handlers are bound to theirs at compile time and never look
+ *		it up. Each enabled instance is one compare, chosen by the
+ *		preprocessor, so on the PG12 with LEUART0 alone it is a single
+ *		compare.
+ ******************************************************************************/
+static inline LEUART_COMMS_STRUCT *leuart_context(LEUART_TypeDef *leuart){
+#ifdef LEUART0_ENABLED
+	if(leuart == LEUART0) return &leuart_sm[LEUART_SM_LEUART0];
+#endif
+#ifdef LEUART1_ENABLED
+	if(leuart == LEUART1) return &leuart_sm[LEUART_SM_LEUART1];
+#endif
+	EFM_ASSERT(false);			// Not enabled in brd_config.h
+	return NULL;
 }
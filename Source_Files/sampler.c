@@ -0,0 +1,666 @@
+/**
+ * @file sampler.c
+ * @author Kay Sho
+ * @date  10/16/2026
+ * @brief Samples several I2C sensors on one bus, each at its own rate
+ * @note The author's pronouns: (She/They)
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+
+/* System include statements */
+
+
+/* Silicon Labs include statements */
+
+
+/* The developer's include statements */
+#include "sampler.h"
+
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define SAMPLER_BATCH_MAX		(SAMPLER_SENSORS_MAX * SENSOR_XFERS_MAX)
+
+//***********************************************************************************
+// private variables
+//***********************************************************************************
+typedef struct{
+	const SENSOR_DRIVER*	driver;
+	void*					ctx;
+	uint32_t				period;				// Ticks between samples
+	uint32_t				next_due;			// Tick the next sample starts
+	uint32_t				ready;				// Tick the result of the current sample can be read
+	uint32_t				warm;				// Tick the sensor can be started once powered
+	uint32_t				status;				// I2C_PAYLOAD_FAILED bits of the current phase
+	uint32_t				samples;
+	uint32_t				failed;
+	uint8_t					polls;				// Result reads retried after a NACK
+	bool					busy;				// Sample in progress
+	bool					powered;
+	bool					grouped;			// Result read in the current batch
+	SENSOR_READING			reading;			// Last finished sample
+}SAMPLER_SENSOR;
+
+typedef struct{
+	I2C_TRANSFER			xfer;
+	uint8_t					sensor;
+}SAMPLER_XFER;
+
+typedef struct{
+	CR_STATE				cr;
+	I2C_TypeDef*			i2c;
+	uint32_t				task_evt;			// I2C completions and the sampler's timers
+	uint32_t				done_evt;			// Posted when a reading is fresh
+	bool					started;
+	bool					idle;				// Waiting at the end of the loop for the next sensor due
+	uint32_t				idle_timer;
+	uint32_t				count;
+	SAMPLER_SENSOR			sensor[SAMPLER_SENSORS_MAX];
+	SAMPLER_XFER			batch[SAMPLER_BATCH_MAX];	// Transfers of the current phase, in queue order
+	uint8_t					batch_len;
+	uint8_t					issued;
+	uint8_t					completed;
+	uint32_t				fresh;				// One bit per sensor with a reading not yet taken
+}SAMPLER;
+
+static SAMPLER sampler;
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+static void sampler_batch_add(uint32_t id, const I2C_TRANSFER *xfer, uint32_t count);
+static void sampler_issue(void);
+static void sampler_collect(uint32_t payload);
+static void sampler_power_up(uint32_t now);
+static void sampler_begin(uint32_t now);
+static bool sampler_group(uint32_t *deadline);
+static void sampler_finish(uint32_t id, bool ok);
+static uint32_t sampler_next_wake(void);
+static void sampler_wake(void);
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Sets up the sampler for the sensors on one I2C bus
+ *
+ * @note
+ *	[task_event] must be registered to sampler_task(). The bus must have been
+ *	opened already.
+ *
+ * @param[in] *i2c
+ *	Bus every sensor added is on
+ *
+ * @param[in] task_event
+ *	Scheduler event that resumes the sampler task
+ *
+ * @param[in] done_event
+ *	Scheduler event posted when a sensor has a fresh reading, see
+ *	sampler_next_fresh()
+ *
+ ******************************************************************************/
+void sampler_open(I2C_TypeDef *i2c, uint32_t task_event, uint32_t done_event){
+	sampler.i2c = i2c;
+	sampler.task_evt = task_event;
+	sampler.done_evt = done_event;
+	sampler.started = false;
+	sampler.idle = false;
+	sampler.count = 0;
+	sampler.fresh = 0;
+	CR_RESET(&sampler.cr);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Adds a sensor
+ *
+ * @note
+ *	Sensors are added before sampler_start(). The first sample of each is
+ *	taken as soon as sampling starts, or once a power gated sensor has
+ *	powered up.
+ *
+ * @param[in] *driver
+ *	Driver of the sensor, e.g. si7021_sensor
+ *
+ * @param[in] *ctx
+ *	Handed to every driver function, the driver's state for this sensor
+ *
+ * @param[in] period_ms
+ *	Time between the starts of two samples
+ *
+ * @return
+ *	Sensor ID for sampler_reading()
+ *
+ ******************************************************************************/
+uint32_t sampler_add(const SENSOR_DRIVER *driver, void *ctx, uint32_t period_ms){
+	SAMPLER_SENSOR *s;
+
+	EFM_ASSERT(!sampler.started);
+	EFM_ASSERT(sampler.count < SAMPLER_SENSORS_MAX);
+	EFM_ASSERT(period_ms > 0);
+
+	s = &sampler.sensor[sampler.count];
+	s->driver = driver;
+	s->ctx = ctx;
+	s->period = TIMER_MS_TO_TICKS(period_ms);
+	s->busy = false;
+	s->powered = false;
+	s->grouped = false;
+	s->reading.ok = false;
+	s->reading.count = 0;
+	s->samples = 0;
+	s->failed = 0;
+	return sampler.count++;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Starts sampling every sensor added
+ *
+ ******************************************************************************/
+void sampler_start(void){
+	uint32_t now = timer_now();
+
+	EFM_ASSERT(!sampler.started && sampler.count > 0);
+	for(uint32_t i = 0; i < sampler.count; i++){
+		SAMPLER_SENSOR *s = &sampler.sensor[i];
+		s->next_due = now + TIMER_MS_TO_TICKS(s->driver->power_up_ms);
+		if(!s->driver->power){
+			s->powered = true;
+			s->warm = now;
+			energy_busy_begin(ENERGY_LOAD_SENSOR);		// For good
+		}
+	}
+	sampler.started = true;
+	add_scheduled_event(sampler.task_evt);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Reports whether sampler_start() has been called
+ *
+ ******************************************************************************/
+bool sampler_started(void){
+	return sampler.started;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Takes the next sensor with a reading that has not been taken yet
+ *
+ * @details
+ *	done_event coalesces, so its handler loops until this returns
+ *	SAMPLER_NO_SENSOR.
+ *
+ * @return
+ *	Sensor ID, lowest first, or SAMPLER_NO_SENSOR
+ *
+ ******************************************************************************/
+uint32_t sampler_next_fresh(void){
+	for(uint32_t i = 0; i < sampler.count; i++){
+		if(sampler.fresh & (1 << i)){
+			sampler.fresh &= ~(1 << i);
+			return i;
+		}
+	}
+	return SAMPLER_NO_SENSOR;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Copies a sensor's last reading
+ *
+ * @param[in] id
+ *	Returned by sampler_add()
+ *
+ * @param[out] *reading
+ *	reading->ok is false if the last sample failed
+ *
+ ******************************************************************************/
+void sampler_reading(uint32_t id, SENSOR_READING *reading){
+	EFM_ASSERT(id < sampler.count);
+	*reading = sampler.sensor[id].reading;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Returns the driver name of a sensor
+ *
+ ******************************************************************************/
+const char *sampler_name(uint32_t id){
+	EFM_ASSERT(id < sampler.count);
+	return sampler.sensor[id].driver->name;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Returns how many sensors were added, their IDs are 0 to count - 1
+ *
+ ******************************************************************************/
+uint32_t sampler_count(void){
+	return sampler.count;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Changes the time between the starts of a sensor's samples
+ *
+ * @details
+ *	The next sample is due period_ms after the start of the last one. If
+ *	that is already past it starts right away. The task is woken if it is
+ *	sleeping until the old due time. A sample in progress finishes first.
+ *
+ * @param[in] id
+ *	Returned by sampler_add()
+ *
+ ******************************************************************************/
+void sampler_set_period(uint32_t id, uint32_t period_ms){
+	SAMPLER_SENSOR *s;
+	uint32_t period = TIMER_MS_TO_TICKS(period_ms);
+
+	EFM_ASSERT(id < sampler.count);
+	EFM_ASSERT(period > 0);
+
+	s = &sampler.sensor[id];
+	if(sampler.started){
+		s->next_due = s->next_due - s->period + period;
+	}
+	s->period = period;
+	sampler_wake();
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Takes a sample of a sensor now, out of its schedule
+ *
+ * @details
+ *	The reading is reported through done_event like any other. The sensor's
+ *	schedule starts again from this sample. A power gated sensor is
+ *	switched on first.
+ *
+ * @param[in] id
+ *	Returned by sampler_add()
+ *
+ * @return
+ *	false if sampling has not started yet
+ *
+ ******************************************************************************/
+bool sampler_sample_now(uint32_t id){
+	SAMPLER_SENSOR *s;
+
+	EFM_ASSERT(id < sampler.count);
+
+	if(!sampler.started){
+		return false;
+	}
+	s = &sampler.sensor[id];
+	if(!s->busy){								// Else the sample in progress answers
+		s->next_due = timer_now();
+		sampler_wake();
+	}
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Copies out a sensor's period and sample counts
+ *
+ ******************************************************************************/
+void sampler_stats(uint32_t id, SAMPLER_STATS *stats){
+	SAMPLER_SENSOR *s;
+
+	EFM_ASSERT(id < sampler.count);
+
+	s = &sampler.sensor[id];
+	stats->period_ms = (uint32_t)(((uint64_t)s->period * 1000) / LETIMER_HZ);
+	stats->samples = s->samples;
+	stats->failed = s->failed;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Coroutine body of the sampler
+ *
+ * @details
+ *	Every sensor that is due, or due within SAMPLER_PACK_MS, is started
+ *	together: their start transfers are queued back to back, so the I2C
+ *	driver chains them with repeated starts in one wake window. The result
+ *	reads are packed the same way. The sensor whose result is ready first
+ *	is read together with every other one ready within SAMPLER_PACK_MS of
+ *	it, once the last of them is ready. In between the core sleeps on a
+ *	one-shot timer.
+ *
+ *	A result read that is NACKed is retried SAMPLER_POLL_TRIES times,
+ *	SAMPLER_POLL_MS apart. A transfer the I2C driver gave up on fails the
+ *	sample.
+ *
+ *	A sensor with a power switch is switched on by a one-shot timer
+ *	power_up_ms before it is due, and the core sleeps through its power up
+ *	like through a conversion. It is switched off as soon as its result is
+ *	read, unless it is due again before it would have powered up.
+ *
+ * @note
+ *	At most SAMPLER_INFLIGHT transfers are queued at once. The I2C queue
+ *	completes them in order, so the n-th resume with a completion belongs
+ *	to batch[n].
+ *
+ *	A sensor that comes due while a batch is on the bus is started after
+ *	the batch, its next due time still follows its own period.
+ *
+ * @param[in] payload
+ *	Completion payload of an I2C transfer, or unused after a timer
+ *
+ ******************************************************************************/
+void sampler_task(uint32_t payload){
+	uint32_t now;
+	uint32_t deadline;
+
+	CR_BEGIN(&sampler.cr);
+
+	for(;;){
+		now = timer_now();
+		sampler_power_up(now);
+		sampler_begin(now);
+
+		if(sampler.batch_len){
+			energy_busy_begin(ENERGY_LOAD_I2C);			// The sensors draw while they convert
+			while(sampler.completed < sampler.batch_len){
+				sampler_issue();
+				CR_YIELD(&sampler.cr);
+				sampler_collect(payload);
+			}
+			now = timer_now();
+			for(uint32_t i = 0; i < sampler.count; i++){
+				SAMPLER_SENSOR *s = &sampler.sensor[i];
+				if(!s->busy) continue;
+				if(s->status & I2C_PAYLOAD_FAILED){
+					sampler_finish(i, false);
+				} else {
+					s->ready = now + TIMER_MS_TO_TICKS(s->driver->conv_ms(s->ctx) + SAMPLER_CONV_MARGIN_MS);
+				}
+			}
+
+			while(sampler_group(&deadline)){
+				now = timer_now();
+				if((int32_t)(deadline - now) > 0){
+					timer_delay_async(deadline - now, sampler.task_evt);
+					CR_YIELD(&sampler.cr);
+				}
+
+				sampler.batch_len = sampler.issued = sampler.completed = 0;
+				for(uint32_t i = 0; i < sampler.count; i++){
+					SAMPLER_SENSOR *s = &sampler.sensor[i];
+					I2C_TRANSFER xfer[SENSOR_XFERS_MAX];
+					if(!s->grouped) continue;
+					s->status = 0;
+					sampler_batch_add(i, xfer, s->driver->complete(s->ctx, xfer));
+				}
+				while(sampler.completed < sampler.batch_len){
+					sampler_issue();
+					CR_YIELD(&sampler.cr);
+					sampler_collect(payload);
+				}
+
+				for(uint32_t i = 0; i < sampler.count; i++){
+					SAMPLER_SENSOR *s = &sampler.sensor[i];
+					if(!s->grouped) continue;
+					s->grouped = false;
+					if(s->status == I2C_PAYLOAD_NACK && s->polls < SAMPLER_POLL_TRIES){
+						s->polls++;									// Not converted yet
+						s->ready = timer_now() + TIMER_MS_TO_TICKS(SAMPLER_POLL_MS);
+					} else {
+						sampler_finish(i, !(s->status & I2C_PAYLOAD_FAILED));
+					}
+				}
+			}
+			energy_busy_end(ENERGY_LOAD_I2C);
+		}
+
+		now = timer_now();
+		deadline = sampler_next_wake();
+		if((int32_t)(deadline - now) > 0){
+			sampler.idle_timer = timer_delay_async(deadline - now, sampler.task_evt);
+		} else {
+			sampler.idle_timer = TIMER_WHEEL_INVALID;
+			add_scheduled_event(sampler.task_evt);
+		}
+		sampler.idle = true;
+		CR_YIELD(&sampler.cr);
+		sampler.idle = false;
+	}
+
+	CR_END(&sampler.cr);
+}
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Appends a sensor's transfers to the batch, they post the task event
+ *
+ ******************************************************************************/
+static void sampler_batch_add(uint32_t id, const I2C_TRANSFER *xfer, uint32_t count){
+	EFM_ASSERT(count <= SENSOR_XFERS_MAX);
+
+	for(uint32_t i = 0; i < count; i++){
+		sampler.batch[sampler.batch_len].xfer = xfer[i];
+		sampler.batch[sampler.batch_len].xfer.event = sampler.task_evt;
+		sampler.batch[sampler.batch_len].sensor = id;
+		sampler.batch_len++;
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Queues batch transfers until SAMPLER_INFLIGHT are on the I2C queue
+ *
+ ******************************************************************************/
+static void sampler_issue(void){
+	while(sampler.issued < sampler.batch_len && sampler.issued - sampler.completed < SAMPLER_INFLIGHT){
+		i2c_transfer(sampler.i2c, &sampler.batch[sampler.issued++].xfer);
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Books the completion of the oldest transfer on the I2C queue
+ *
+ * @details
+ *	SCHEDULER_PAYLOAD_LOST stands for completions the I2C source ring had no
+ *	room for, how many is not known. Every transfer still outstanding is
+ *	failed, so the task does not wait for callbacks that will not come.
+ *
+ * @note
+ *	The ring holds the completions of I2C_QUEUE_SIZE + 1 transfers several
+ *	times over, so this takes a ring that is corrupt or far too small.
+ *
+ ******************************************************************************/
+static void sampler_collect(uint32_t payload){
+	EFM_ASSERT(sampler.completed < sampler.issued);
+	if(payload == SCHEDULER_PAYLOAD_LOST){
+		while(sampler.completed < sampler.issued){
+			sampler.sensor[sampler.batch[sampler.completed++].sensor].status |= I2C_PAYLOAD_ERROR;
+		}
+		return;
+	}
+	sampler.sensor[sampler.batch[sampler.completed++].sensor].status |= payload & I2C_PAYLOAD_FAILED;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Switches on every sensor that is due within its power up time
+ *
+ * @details
+ *	Those within SAMPLER_PACK_MS of it are switched on early rather than
+ *	waking the core again for them.
+ *
+ ******************************************************************************/
+static void sampler_power_up(uint32_t now){
+	for(uint32_t i = 0; i < sampler.count; i++){
+		SAMPLER_SENSOR *s = &sampler.sensor[i];
+		uint32_t power_up = TIMER_MS_TO_TICKS(s->driver->power_up_ms);
+
+		if(s->powered || (int32_t)(now + TIMER_MS_TO_TICKS(SAMPLER_PACK_MS) - (s->next_due - power_up)) < 0) continue;
+		s->driver->power(s->ctx, true);
+		s->powered = true;
+		s->warm = now + power_up;
+		energy_busy_begin(ENERGY_LOAD_SENSOR);
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Builds the batch of start transfers of every sensor that is due
+ *
+ * @details
+ *	Sensors due within SAMPLER_PACK_MS are started early rather than waking
+ *	the core again for them, once they have powered up. A sensor that fell
+ *	a whole period behind starts its schedule again from now instead of
+ *	catching up.
+ *
+ ******************************************************************************/
+static void sampler_begin(uint32_t now){
+	sampler.batch_len = sampler.issued = sampler.completed = 0;
+
+	for(uint32_t i = 0; i < sampler.count; i++){
+		SAMPLER_SENSOR *s = &sampler.sensor[i];
+		I2C_TRANSFER xfer[SENSOR_XFERS_MAX];
+
+		if((int32_t)(now + TIMER_MS_TO_TICKS(SAMPLER_PACK_MS) - s->next_due) < 0) continue;
+		if(!s->powered || (int32_t)(now - s->warm) < 0) continue;
+		s->next_due += s->period;
+		if((int32_t)(s->next_due - now) <= 0){
+			s->next_due = now + s->period;
+		}
+		s->busy = true;
+		s->polls = 0;
+		s->status = 0;
+		sampler_batch_add(i, xfer, s->driver->start(s->ctx, xfer));
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Picks the sensors whose results are read next
+ *
+ * @details
+ *	The busy sensor that is ready first, and every other one ready within
+ *	SAMPLER_PACK_MS of it, are marked grouped.
+ *
+ * @param[out] *deadline
+ *	Tick the last of the group is ready
+ *
+ * @return
+ *	false if no sensor is waiting for its result
+ *
+ ******************************************************************************/
+static bool sampler_group(uint32_t *deadline){
+	bool any = false;
+	uint32_t first = 0;
+
+	for(uint32_t i = 0; i < sampler.count; i++){
+		SAMPLER_SENSOR *s = &sampler.sensor[i];
+		if(s->busy && (!any || (int32_t)(s->ready - first) < 0)){
+			first = s->ready;
+			any = true;
+		}
+	}
+	if(!any){
+		return false;
+	}
+
+	*deadline = first;
+	for(uint32_t i = 0; i < sampler.count; i++){
+		SAMPLER_SENSOR *s = &sampler.sensor[i];
+		if(s->busy && (int32_t)(s->ready - first) <= (int32_t)TIMER_MS_TO_TICKS(SAMPLER_PACK_MS)){
+			s->grouped = true;
+			if((int32_t)(s->ready - *deadline) > 0){
+				*deadline = s->ready;
+			}
+		}
+	}
+	return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Ends a sensor's sample and posts done_event
+ *
+ * @details
+ *	A power gated sensor is switched off here, before its bytes are
+ *	converted, unless it would have to be switched on again within
+ *	SAMPLER_PACK_MS.
+ *
+ ******************************************************************************/
+static void sampler_finish(uint32_t id, bool ok){
+	SAMPLER_SENSOR *s = &sampler.sensor[id];
+	uint32_t power_on = s->next_due - TIMER_MS_TO_TICKS(s->driver->power_up_ms + SAMPLER_PACK_MS);
+
+	s->busy = false;
+	s->samples++;
+	s->failed += !ok;
+	if(s->driver->power && (int32_t)(power_on - timer_now()) > 0){
+		s->driver->power(s->ctx, false);
+		s->powered = false;
+		energy_busy_end(ENERGY_LOAD_SENSOR);
+	}
+	s->reading.count = 0;
+	s->reading.ok = ok;
+	if(ok){
+		s->driver->convert(s->ctx, &s->reading);
+	}
+	sampler.fresh |= 1 << id;
+	add_scheduled_event(sampler.done_evt);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Returns the tick the task next has a sensor to switch on or start
+ *
+ ******************************************************************************/
+static uint32_t sampler_next_wake(void){
+	uint32_t wake = 0;
+
+	for(uint32_t i = 0; i < sampler.count; i++){
+		SAMPLER_SENSOR *s = &sampler.sensor[i];
+		uint32_t t = s->next_due;
+
+		if(!s->powered){
+			t -= TIMER_MS_TO_TICKS(s->driver->power_up_ms);
+		} else if((int32_t)(s->warm - t) > 0){
+			t = s->warm;
+		}
+		if(i == 0 || (int32_t)(t - wake) < 0){
+			wake = t;
+		}
+	}
+	return wake;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Resumes the task early if it is sleeping until the next sensor is due
+ *
+ * @details
+ *	While the task is idle the only thing that posts task_event is its
+ *	timer, so if the event is not pending the timer has not fired and is
+ *	still the sampler's to cancel. A task in the middle of a batch picks up
+ *	the new due times when the batch is done.
+ *
+ ******************************************************************************/
+static void sampler_wake(void){
+	if(!sampler.idle || scheduled_event_pending(sampler.task_evt)){
+		return;
+	}
+	timer_cancel(sampler.idle_timer);
+	add_scheduled_event(sampler.task_evt);
+}
@@ -11,7 +11,8 @@
 //***********************************************************************************
 
 /* System include statements */
-
+#include <stdio.h>
+#include <string.h>
 
 /* Silicon Labs include statements */
 
@@ -28,9 +29,32 @@
 //***********************************************************************************
 // private variables
 //***********************************************************************************
-static unsigned int event_scheduled;
+static ATOMIC_U32 event_scheduled[SCHEDULER_PRIORITIES][SCHEDULER_WORDS];
+static SCHEDULER_ENTRY event_table[SCHEDULER_MAX_EVENTS];
+static uint32_t rr_next[SCHEDULER_PRIORITIES];		// Round-robin start point per priority level
+static EVENT_RING event_rings[SCHEDULER_SOURCES];	// One ISR-to-main ring per interrupt source
+static ATOMIC_U32 event_lost[SCHEDULER_SOURCES][SCHEDULER_WORDS];	// Events each ring dropped a post of
+#ifdef SCHEDULER_STATS_ENABLED
+static SCHEDULER_STATS event_stats[SCHED_STATS_EVENTS];
+static uint32_t post_stamp[SCHED_STATS_EVENTS];		// Cycle count of the post that set the pending bit
+#endif
+#ifndef CYCLE_USE_DWT
+volatile uint32_t cycle_virtual_clock;
+#endif
+
+#define SCHEDULE_CLR 		0 // Fixing magic number
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+static void scheduler_run_level(uint32_t priority, uint32_t *snapshot);
+static void scheduler_run_ring(uint32_t source, uint32_t count);
+static void scheduler_run_lost(uint32_t source, uint32_t stamp);
+static void scheduler_run(uint32_t event, uint32_t payload, uint32_t stamp);
+#ifdef SCHEDULER_STATS_ENABLED
+static void scheduler_hist_add(uint16_t *hist, uint32_t cycles);
+#endif
 
-#define SCHEDULE_CLR 		0; // Fixing magic number
 //***********************************************************************************
 // Global functions
 //***********************************************************************************
@@ -40,81 +64,517 @@ static unsigned int event_scheduled;
  *   resets static event variable
  *
  * @details
- *	Sets up event scheduler for usage by resetting to 0
+ *	Sets up event scheduler for usage by resetting every pending word to 0,
+ *	emptying the handler table and the interrupt source rings.
  *
  * @note
- *
- * @param[in]
- *
- * @param[in]
+ *	Unregistered events default to the lowest priority.
  *
  ******************************************************************************/
 void scheduler_open(void){
 	CORE_DECLARE_IRQ_STATE;
 	CORE_ENTER_CRITICAL();
-	event_scheduled = SCHEDULE_CLR;
+	for(int p = 0; p < SCHEDULER_PRIORITIES; p++){
+		for(int w = 0; w < SCHEDULER_WORDS; w++){
+			atomic_store_u32(&event_scheduled[p][w], SCHEDULE_CLR);
+		}
+		rr_next[p] = 0;
+	}
+	for(int i = 0; i < SCHEDULER_MAX_EVENTS; i++){
+		event_table[i].handler = NULL;
+		event_table[i].priority = SCHED_PRIO_LOW;
+	}
+	for(int i = 0; i < SCHEDULER_SOURCES; i++){
+		event_ring_init(&event_rings[i]);
+		for(int w = 0; w < SCHEDULER_WORDS; w++){
+			atomic_store_u32(&event_lost[i][w], SCHEDULE_CLR);
+		}
+	}
 	CORE_EXIT_CRITICAL();
+
+	cycle_counter_open();
+	scheduler_stats_reset();
 }
+
 /***************************************************************************//**
  * @brief
- *   Adds scheduled event.
+ *   Registers the callback for an event.
  *
  * @details
- *	Alters the static variable s.t. [event] is played and filled into the static.
+ *	Fills the event's slot in the handler table so that scheduler_dispatch()
+ *	can find it by index instead of a hard-coded if-chain in main.
  *
  * @note
+ *	Register events before they can be posted; the priority decides which
+ *	pending word the event is recorded in.
  *
  * @param[in] event
+ *	Event ID, 0 to SCHEDULER_MAX_EVENTS - 1
+ *
+ * @param[in] handler
+ *	Function run from the main loop when the event is dispatched
+ *
+ * @param[in] priority
+ *	SCHED_PRIO_x level, lower numbers are serviced first
+ *
+ ******************************************************************************/
+void scheduler_register(uint32_t event, SCHEDULER_HANDLER handler, uint32_t priority){
+	EFM_ASSERT(event < SCHEDULER_MAX_EVENTS);
+	EFM_ASSERT(priority < SCHEDULER_PRIORITIES);
+	EFM_ASSERT(!scheduled_event_pending(event));
+	event_table[event].handler = handler;
+	event_table[event].priority = priority;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Runs every pending event once.
+ *
+ * @details
+ *	First drains the interrupt source rings in the order the records were
+ *	posted, so every occurrence runs with its own payload. Then takes one
+ *	snapshot of the pending words with an atomic fetch-and-clear per word, so
+ *	the main loop owns every event it read without masking interrupts, and
+ *	walks it from the highest priority level to the lowest, finding each event
+ *	with __CLZ instead of testing every ID.
+ *
+ * @note
+ *	Events posted while the handlers run are picked up by the next call.
+ *
+ ******************************************************************************/
+void scheduler_dispatch(void){
+	uint32_t snapshot[SCHEDULER_PRIORITIES][SCHEDULER_WORDS];
+	uint32_t ring_count[SCHEDULER_SOURCES];
+
+	for(int i = 0; i < SCHEDULER_SOURCES; i++){
+		ring_count[i] = event_ring_count(&event_rings[i]);
+	}
+	for(int i = 0; i < SCHEDULER_SOURCES; i++){
+		scheduler_run_ring(i, ring_count[i]);
+	}
+
+	for(int p = 0; p < SCHEDULER_PRIORITIES; p++){
+		for(int w = 0; w < SCHEDULER_WORDS; w++){
+			snapshot[p][w] = atomic_exchange_u32(&event_scheduled[p][w], SCHEDULE_CLR);
+		}
+	}
+
+	for(int p = 0; p < SCHEDULER_PRIORITIES; p++){
+		scheduler_run_level(p, snapshot[p]);
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Posts an event with a payload from an interrupt handler.
+ *
+ * @details
+ *	Unlike add_scheduled_event(), two posts of the same event before the main
+ *	loop runs are delivered as two callbacks, each with its own payload.
+ *
+ * @note
+ *	Only the interrupt handler that owns [source] may call this. If the ring is
+ *	full the overflow is counted and the event is marked lost: where the drop
+ *	sits among the ring's records, the callback runs once with
+ *	SCHEDULER_PAYLOAD_LOST, however many posts were dropped. A handler that
+ *	counts its callbacks has to resynchronise on it.
+ *
+ * @param[in] source
+ *	SCHED_SRC_x ring of the calling interrupt handler
+ *
+ * @param[in] event
+ *	Event ID
+ *
+ * @param[in] payload
+ *	Timestamp, byte count or status for this occurrence
+ *
+ ******************************************************************************/
+void scheduler_post(uint32_t source, uint32_t event, uint32_t payload){
+	EFM_ASSERT(source < SCHEDULER_SOURCES);
+	EFM_ASSERT(event < SCHEDULER_MAX_EVENTS);
+	TRACE(TRACE_SCHED_POST, event);
+	if(!event_ring_post(&event_rings[source], event, payload, cycle_counter_now())){
+		atomic_fetch_or_u32(&event_lost[source][event / SCHEDULER_WORD_BITS], SCHEDULER_MSB >> (event % SCHEDULER_WORD_BITS));
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Throws away every record waiting in a source ring.
+ *
+ * @note
+ *	Main loop only, for drivers that generate events during a self test.
+ *
+ * @param[in] source
+ *	SCHED_SRC_x ring to empty
+ *
+ ******************************************************************************/
+void scheduler_flush(uint32_t source){
+	EFM_ASSERT(source < SCHEDULER_SOURCES);
+	EVENT_RECORD discard;
+	while(event_ring_get(&event_rings[source], &discard));
+	for(int w = 0; w < SCHEDULER_WORDS; w++){
+		atomic_store_u32(&event_lost[source][w], SCHEDULE_CLR);
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Returns the health counters of a source ring.
  *
- * Parameter is the desired event.
+ * @param[in] source
+ *	SCHED_SRC_x ring to query
  *
- * @param[in]
+ * @param[out] *high_water
+ *	Most records that were ever waiting in the ring at once
+ *
+ * @param[out] *overflow
+ *	Posts that found the ring full
+ *
+ ******************************************************************************/
+void scheduler_ring_stats(uint32_t source, uint32_t *high_water, uint32_t *overflow){
+	EFM_ASSERT(source < SCHEDULER_SOURCES);
+	*high_water = event_rings[source].high_water;
+	*overflow = event_rings[source].overflow;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Adds scheduled event.
+ *
+ * @details
+ *	Sets the event's bit in the pending word of its priority level.
+ *
+ * @note
+ *	Uses an LDREX/STREX loop instead of a critical section, so posting from
+ *	main or from an interrupt never masks the LEUART RX interrupt.
+ *	The post time is only recorded when the bit was clear, so latency is
+ *	measured from the first of a run of coalesced posts.
+ *
+ * @param[in] event
+ *
+ * Parameter is the desired event ID.
  *
  ******************************************************************************/
 
 void add_scheduled_event(uint32_t event){
-	CORE_DECLARE_IRQ_STATE;
-	CORE_ENTER_CRITICAL();
-	event_scheduled |= event;
-	CORE_EXIT_CRITICAL();
+	EFM_ASSERT(event < SCHEDULER_MAX_EVENTS);
+	uint32_t priority = event_table[event].priority;
+	ATOMIC_U32 *word = &event_scheduled[priority][event / SCHEDULER_WORD_BITS];
+	uint32_t bit = SCHEDULER_MSB >> (event % SCHEDULER_WORD_BITS);
+	TRACE(TRACE_SCHED_POST, event);
+#ifdef SCHEDULER_STATS_ENABLED
+	if(event < SCHED_STATS_EVENTS && !(atomic_load_u32(word) & bit)){
+		post_stamp[event] = cycle_counter_now();		// Repeat posts coalesce, latency counts from the first
+	}
+#endif
+	atomic_fetch_or_u32(word, bit);
 }
 /***************************************************************************//**
  * @brief
  *   Removes scheduled event.
  *
  * @details
- *	Alters the static variable s.t. [event] is removed once it is finished.
+ *	Clears the event's pending bit so it will not be dispatched.
  *
  * @note
+ *	Dispatched events are cleared by scheduler_dispatch(), handlers do not
+ *	need to call this.
  *
  * @param[in] event
  *
- * Parameter is the desired event.
- *
- * @param[in]
+ * Parameter is the desired event ID.
  *
  ******************************************************************************/
 
 void remove_scheduled_event(uint32_t event){
-	CORE_DECLARE_IRQ_STATE;
-	CORE_ENTER_CRITICAL();
-	event_scheduled &= ~event;
-	CORE_EXIT_CRITICAL();
+	EFM_ASSERT(event < SCHEDULER_MAX_EVENTS);
+	uint32_t priority = event_table[event].priority;
+	atomic_fetch_and_u32(&event_scheduled[priority][event / SCHEDULER_WORD_BITS], ~(SCHEDULER_MSB >> (event % SCHEDULER_WORD_BITS)));
 }
 /***************************************************************************//**
  * @brief
- *   Returns scheduled event.
+ *   Returns whether a single event is pending.
+ *
+ * @param[in] event
+ *	Event ID to check
+ *
+ ******************************************************************************/
+
+bool scheduled_event_pending(uint32_t event){
+	EFM_ASSERT(event < SCHEDULER_MAX_EVENTS);
+	uint32_t priority = event_table[event].priority;
+	return atomic_load_u32(&event_scheduled[priority][event / SCHEDULER_WORD_BITS]) & (SCHEDULER_MSB >> (event % SCHEDULER_WORD_BITS));
+}
+/***************************************************************************//**
+ * @brief
+ *   Returns whether any event is pending.
  *
  * @details
- * Does what it says.
- * @note
+ * Used by the main loop to decide whether it may go to sleep.
+ *
+ ******************************************************************************/
+
+bool scheduler_events_pending(void){
+	uint32_t pending = 0;
+	for(int i = 0; i < SCHEDULER_SOURCES; i++){
+		pending |= event_ring_count(&event_rings[i]);
+	}
+	for(int p = 0; p < SCHEDULER_PRIORITIES; p++){
+		for(int w = 0; w < SCHEDULER_WORDS; w++){
+			pending |= atomic_load_u32(&event_scheduled[p][w]);
+		}
+	}
+	return pending != 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Returns the latency and execution time histograms of an event.
+ *
+ * @details
+ *	Debug hook, the structure can be read directly from a watch window.
+ *
+ * @param[in] event
+ *	Event ID
+ *
+ * @return
+ *	NULL if the event has no histograms
+ *
+ ******************************************************************************/
+
+const SCHEDULER_STATS *scheduler_stats(uint32_t event){
+#ifdef SCHEDULER_STATS_ENABLED
+	if(event < SCHED_STATS_EVENTS){
+		return &event_stats[event];
+	}
+#endif
+	return NULL;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Clears every histogram.
+ *
+ ******************************************************************************/
+
+void scheduler_stats_reset(void){
+#ifdef SCHEDULER_STATS_ENABLED
+	memset(event_stats, 0, sizeof(event_stats));
+#endif
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Formats the next histogram line for a text dump.
+ *
+ * @details
+ *	Lines read "E<id> l|x <bucket>:<count> ...", l for latency and x for
+ *	execution time, listing only the buckets that are not empty. A histogram
+ *	that does not fit in [size] carries on in the next line, so the dump can
+ *	be sent one short BLE string at a time.
+ *
+ * @param[in,out] *cursor
+ *	Set to 0 before the first call, advanced on each call
+ *
+ * @param[out] *line
+ *	Null terminated, newline ended line
+ *
+ * @param[in] size
+ *	Size of [line], at least 24
+ *
+ * @return
+ *	false once every histogram has been written
+ *
+ ******************************************************************************/
+
+bool scheduler_stats_line(uint32_t *cursor, char *line, uint32_t size){
+#ifdef SCHEDULER_STATS_ENABLED
+	EFM_ASSERT(size >= 24);
+	while(*cursor < SCHED_STATS_EVENTS * 2 * SCHED_HIST_BUCKETS){
+		uint32_t row = *cursor / SCHED_HIST_BUCKETS;
+		uint32_t bucket = *cursor % SCHED_HIST_BUCKETS;
+		uint32_t event = row / 2;
+		bool exec = row % 2;
+		const uint16_t *hist = exec ? event_stats[event].exec : event_stats[event].latency;
+		uint32_t len = snprintf(line, size, "E%u %c", (unsigned)event, exec ? 'x' : 'l');
+		bool any = false;
+
+		for(; bucket < SCHED_HIST_BUCKETS; bucket++){
+			char pair[16];
+			uint32_t n;
+			if(!hist[bucket]) continue;
+			n = snprintf(pair, sizeof(pair), " %u:%u", (unsigned)bucket, (unsigned)hist[bucket]);
+			if(len + n + 2 > size) break;		// Keep room for the newline and terminator
+			memcpy(&line[len], pair, n);
+			len += n;
+			any = true;
+		}
+		*cursor = (bucket < SCHED_HIST_BUCKETS) ? row * SCHED_HIST_BUCKETS + bucket : (row + 1) * SCHED_HIST_BUCKETS;
+		if(any){
+			line[len++] = '\n';
+			line[len] = 0;
+			return true;
+		}
+	}
+#endif
+	return false;
+}
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *   Runs the snapshotted events of one priority level.
+ *
+ * @details
+ *	Starts the search at rr_next[priority], the ID after the last event served
+ *	at this level, and wraps around. The start word is visited twice: first for
+ *	the IDs at or after the start point, last for the IDs before it. Each event
+ *	costs one __CLZ and one table lookup.
+ *
+ * @param[in] priority
+ *	Level being serviced
+ *
+ * @param[in] *snapshot
+ *	Pending words of this level taken by scheduler_dispatch()
+ *
+ ******************************************************************************/
+static void scheduler_run_level(uint32_t priority, uint32_t *snapshot){
+	uint32_t start = rr_next[priority];
+	uint32_t start_word = start / SCHEDULER_WORD_BITS;
+	uint32_t head_mask = 0xFFFFFFFF >> (start % SCHEDULER_WORD_BITS);
+
+	for(int i = 0; i <= SCHEDULER_WORDS; i++){
+		uint32_t word = (start_word + i) % SCHEDULER_WORDS;
+		uint32_t bits = snapshot[word];
+		if(i == 0) bits &= head_mask;
+		else if(i == SCHEDULER_WORDS) bits &= ~head_mask;
+
+		while(bits){
+			uint32_t bit = __CLZ(bits);
+			uint32_t event = word * SCHEDULER_WORD_BITS + bit;
+			bits &= ~(SCHEDULER_MSB >> bit);
+			rr_next[priority] = (event + 1) % SCHEDULER_MAX_EVENTS;
+
+#ifdef SCHEDULER_STATS_ENABLED
+			scheduler_run(event, SCHEDULER_NO_PAYLOAD, event < SCHED_STATS_EVENTS ? post_stamp[event] : 0);
+#else
+			scheduler_run(event, SCHEDULER_NO_PAYLOAD, 0);
+#endif
+		}
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Runs the records that were waiting in one source ring.
+ *
+ * @details
+ *	Only the [count] records seen when dispatch started are run, oldest first,
+ *	so an interrupt source that keeps posting cannot starve the rest.
  *
- * @param[in]
+ * @param[in] source
+ *	SCHED_SRC_x ring to drain
+ *
+ * @param[in] count
+ *	Records to run
+ *
+ ******************************************************************************/
+static void scheduler_run_ring(uint32_t source, uint32_t count){
+	EVENT_RECORD record;
+
+	while(count-- && event_ring_get(&event_rings[source], &record)){
+		if(record.event == EVENT_RING_LOST){
+			scheduler_run_lost(source, record.stamp);
+		} else {
+			scheduler_run(record.event, record.payload, record.stamp);
+		}
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Runs every event a source ring dropped a post of, at its lost marker.
  *
- * @param[in]
+ * @details
+ *	The lost words are taken with an atomic fetch-and-clear, like the pending
+ *	words. Posts dropped while the marker waited are all behind it, so each
+ *	event runs once with SCHEDULER_PAYLOAD_LOST before any later record.
+ *
+ * @param[in] source
+ *	SCHED_SRC_x ring the marker came from
+ *
+ * @param[in] stamp
+ *	Cycle count of the first drop
+ *
+ ******************************************************************************/
+static void scheduler_run_lost(uint32_t source, uint32_t stamp){
+	for(int w = 0; w < SCHEDULER_WORDS; w++){
+		uint32_t bits = atomic_exchange_u32(&event_lost[source][w], SCHEDULE_CLR);
+		while(bits){
+			uint32_t bit = __CLZ(bits);
+			bits &= ~(SCHEDULER_MSB >> bit);
+			scheduler_run(w * SCHEDULER_WORD_BITS + bit, SCHEDULER_PAYLOAD_LOST, stamp);
+		}
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Calls one event's handler and records how long it waited and ran.
+ *
+ * @param[in] event
+ *	Event ID being dispatched
+ *
+ * @param[in] payload
+ *	Handed to the handler
+ *
+ * @param[in] stamp
+ *	Cycle count when the event was posted
+ *
+ ******************************************************************************/
+static void scheduler_run(uint32_t event, uint32_t payload, uint32_t stamp){
+	EFM_ASSERT(event_table[event].handler != NULL);	// Posted an event nobody registered
+	if(event_table[event].handler == NULL){
+		return;
+	}
+	TRACE(TRACE_SCHED_BEGIN, event);
+#ifdef SCHEDULER_STATS_ENABLED
+	uint32_t start = cycle_counter_now();
+	event_table[event].handler(payload);
+	TRACE(TRACE_SCHED_END, event);
+	if(event < SCHED_STATS_EVENTS){
+		uint32_t latency = start - stamp;
+		uint32_t exec = cycle_counter_now() - start;
+		scheduler_hist_add(event_stats[event].latency, latency);
+		scheduler_hist_add(event_stats[event].exec, exec);
+		if(latency > event_stats[event].latency_max) event_stats[event].latency_max = latency;
+		if(exec > event_stats[event].exec_max) event_stats[event].exec_max = exec;
+	}
+#else
+	event_table[event].handler(payload);
+	TRACE(TRACE_SCHED_END, event);
+#endif
+}
+
+#ifdef SCHEDULER_STATS_ENABLED
+/***************************************************************************//**
+ * @brief
+ *   Counts one sample in its log2 bucket.
+ *
+ * @details
+ *	The bucket is the position of the sample's highest set bit, found with
+ *	__CLZ, less SCHED_HIST_SHIFT. Buckets saturate at SCHED_HIST_MAX.
  *
  ******************************************************************************/
+static void scheduler_hist_add(uint16_t *hist, uint32_t cycles){
+	uint32_t bucket = 31 - __CLZ(cycles | 1);
 
-uint32_t get_scheduled_events(void){
-	return event_scheduled;
+	bucket = bucket > SCHED_HIST_SHIFT ? bucket - SCHED_HIST_SHIFT : 0;
+	if(bucket >= SCHED_HIST_BUCKETS) bucket = SCHED_HIST_BUCKETS - 1;
+	if(hist[bucket] < SCHED_HIST_MAX) hist[bucket]++;
 }
+#endif
@@ -25,11 +25,72 @@
 //***********************************************************************************
 // defined files
 //***********************************************************************************
+#define SI7021_REQ_SAMPLE		0x01
+#define SI7021_REQ_RESOLUTION	0x02
 
 //***********************************************************************************
 // private variables
 //***********************************************************************************
-static uint32_t sidata[SI7021_NUM_BYTES_TEMP_CHECKSUM]; //Created mem location
+static uint8_t sidata[SI7021_NUM_BYTES_TEMP_CHECKSUM]; //Created mem location
+static uint8_t sirh[SI7021_NUM_BYTES_RH_CHECKSUM];		// RH MSB, LSB, checksum
+static const uint8_t si7021_temp_cmd = SI7021_TEMP_NO_HOLD;
+static const uint8_t si7021_rh_cmd = SI7021_RH_NO_HOLD;
+static const uint8_t si7021_temp_from_rh_cmd = SI7021_TEMP_FROM_RH;
+static const uint8_t si7021_read_user_cmd = SI7021_READ_USER_REG;
+
+// Per resolution setting: bits, datasheet maximum conversion time in whole ms, and the code bits that are valid
+static const uint8_t si7021_temp_bits[SI7021_RES_SETTINGS] = {14, 12, 13, 11};
+static const uint8_t si7021_temp_conv_ms[SI7021_RES_SETTINGS] = {11, 4, 7, 3};		// 10.8, 3.8, 6.2, 2.4
+static const uint8_t si7021_rh_conv_ms[SI7021_RES_SETTINGS] = {12, 4, 5, 7};		// 12, 3.1, 4.5, 7
+static const uint16_t si7021_temp_mask[SI7021_RES_SETTINGS] = {0xFFFC, 0xFFF0, 0xFFF8, 0xFFE0};
+static const uint16_t si7021_rh_mask[SI7021_RES_SETTINGS] = {0xFFF0, 0xFF00, 0xFFC0, 0xFFE0};
+
+static uint32_t si7021_res = SI7021_RES_RH12_T14;		// Setting in the user register
+static uint32_t si7021_sample_res = SI7021_RES_RH12_T14;	// Setting the last sample was taken with
+static uint8_t si7021_wake_reg[2];						// User register write that restores si7021_res
+
+typedef struct{
+	CR_STATE	cr;
+	uint32_t	task_evt;
+	uint32_t	pending;			// SI7021_REQ_x waiting for the task
+	uint32_t	done_evt;			// Sample request
+	bool		rh;					// Humidity and temperature, else temperature only
+	uint32_t	res_evt;			// Resolution request
+	uint32_t	next_res;
+	uint8_t		user_reg[2];		// Write command and register value
+	uint8_t		polls;				// Reads retried after a NACK
+	uint32_t	status;				// Payload of the last I2C transfer
+}SI7021_TASK;
+
+static SI7021_TASK si7021_ctx;
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+static void si7021_read_result(void);
+static void si7021_request(uint32_t request);
+static uint32_t si7021_sensor_start(void *ctx, I2C_TRANSFER *xfer);
+static uint32_t si7021_sensor_conv_ms(void *ctx);
+static uint32_t si7021_sensor_complete(void *ctx, I2C_TRANSFER *xfer);
+static void si7021_sensor_convert(void *ctx, SENSOR_READING *reading);
+#ifdef SI7021_POWER_GATED
+static void si7021_sensor_power(void *ctx, bool on);
+#endif
+
+const SENSOR_DRIVER si7021_sensor = {
+	"Si7021",
+	si7021_sensor_start,
+	si7021_sensor_conv_ms,
+	si7021_sensor_complete,
+	si7021_sensor_convert,
+#ifdef SI7021_POWER_GATED
+	si7021_sensor_power,
+	SI7021_POWER_UP_MS
+#else
+	NULL,
+	0
+#endif
+};
 //***********************************************************************************
 // Global functions
 //***********************************************************************************
@@ -45,9 +106,16 @@ static uint32_t sidata[SI7021_NUM_BYTES_TEMP_CHECKSUM]; //Created mem location
  *
  * @note
  *
+ * [task_event] must be registered to si7021_task().
+ *
+ * @param[in] task_event
+ * Scheduler event that resumes the read task
+ *
+ * @param[in] bus_event
+ * Scheduler event the I2C driver registers for its timeouts and recovery
  *
  ******************************************************************************/
-void si7021_i2c_open(void){
+void si7021_i2c_open(uint32_t task_event, uint32_t bus_event){
 
 	I2C_OPEN_STRUCT Si7021_I2C_val;
 
@@ -64,9 +132,23 @@ void si7021_i2c_open(void){
 	Si7021_I2C_val.scl_pin_route	= I2C_SCL_ROUTE;
 	Si7021_I2C_val.sda_pin_en		= true;
 	Si7021_I2C_val.sda_pin_route	= I2C_SDA_ROUTE;
+	Si7021_I2C_val.scl_port			= SI7021_SCL_PORT;
+	Si7021_I2C_val.scl_pin			= SI7021_SCL_PIN;
+	Si7021_I2C_val.sda_port			= SI7021_SDA_PORT;
+	Si7021_I2C_val.sda_pin			= SI7021_SDA_PIN;
+
+	//	RH and checksum reads move on the LDMA
+	Si7021_I2C_val.dma				= true;
+	Si7021_I2C_val.watchdog_event	= bus_event;
 
 
 	i2c_open(I2C0, &Si7021_I2C_val); // Must fix for modularity & encapsulation
+
+	si7021_ctx.task_evt = task_event;
+	si7021_ctx.pending = 0;
+	si7021_res = SI7021_RES_RH12_T14;
+	si7021_sample_res = SI7021_RES_RH12_T14;
+	CR_RESET(&si7021_ctx.cr);
 }
 /***************************************************************************//**
  * @brief
@@ -76,6 +158,7 @@ void si7021_i2c_open(void){
  *	Runs the Si7021 temperature read function. This is done in No Hold [Manager] Mode
  *
  * @note
+ *	See si7021_task() for how the conversion is waited out.
  *
  * @param[in] event
  *	Scheduler event associated with the Si7021 Temperature measurement
@@ -83,7 +166,12 @@ void si7021_i2c_open(void){
  *
  ******************************************************************************/
 void si7021_read(uint32_t event){
-	i2c_start(SI7021_I2C, SI7021_ADDR, I2C_READ, SI7021_TEMP_NO_HOLD, sidata, SI7021_NUM_BYTES_TEMP_CHECKSUM, event, true);}
+	EFM_ASSERT(!(si7021_ctx.pending & SI7021_REQ_SAMPLE));
+
+	si7021_ctx.rh = false;
+	si7021_ctx.done_evt = event;
+	si7021_request(SI7021_REQ_SAMPLE);
+}
 
 /***************************************************************************//**
  * @brief
@@ -94,11 +182,17 @@ void si7021_read(uint32_t event){
  * Takes detected temperature from the sidata array, originally in Centigrade, and keeps it as
  * is.
  *
+ * @note
+ *
+ * The code is left justified at every resolution, so the formula does not
+ * change. The bits below the resolution the sample was taken with are masked
+ * off, at 14 bits those are the two status bits.
+ *
 
  ******************************************************************************/
 
 float si7021_temp_met(){
-	uint16_t temp_dat = (sidata[0] << 8) | sidata[1];
+	uint16_t temp_dat = ((sidata[0] << 8) | sidata[1]) & si7021_temp_mask[si7021_sample_res];
 	float temp_c = ((float)175.72*(float)temp_dat / (float)65536) - (float)46.85;
 	return temp_c;
 }
@@ -116,12 +210,350 @@ float si7021_temp_met(){
  *
  * Fact: Metric will always be superior to Imperial. (this is the author's very serious opinion)
  *
- * The resolution is x bits
+ * The resolution is set by si7021_set_resolution(), 14 bits by default
  *
  ******************************************************************************/
 
 float si7021_temp_imp(){
-	uint16_t temp_dat = (sidata[0] << 8) | sidata[1];
+	uint16_t temp_dat = ((sidata[0] << 8) | sidata[1]) & si7021_temp_mask[si7021_sample_res];
 	float temp_c = ((float)175.72*(float)temp_dat / (float)65536) - (float)46.85;
 	return (temp_c * (float)1.8 + (float)32);
 }
+
+/***************************************************************************//**
+ * @brief
+ *	Reads humidity and temperature from one conversion
+ *
+ * @details
+ *	A humidity measurement also converts the temperature, which the Si7021
+ *	keeps for command 0xE0. So one RH conversion is followed by a plain 2
+ *	byte read instead of a second conversion. After [event],
+ *	si7021_temp_met(), si7021_temp_imp() and si7021_humidity() return the
+ *	new sample.
+ *
+ * @note
+ *	The RH conversion is about as long as a temperature conversion plus a
+ *	humidity conversion. It replaces two conversions, where the temperature
+ *	one was converted twice.
+ *
+ * @param[in] event
+ *	Scheduler event posted once both values are in
+ *
+ ******************************************************************************/
+void si7021_read_rh_temp(uint32_t event){
+	EFM_ASSERT(!(si7021_ctx.pending & SI7021_REQ_SAMPLE));
+
+	si7021_ctx.rh = true;
+	si7021_ctx.done_evt = event;
+	si7021_request(SI7021_REQ_SAMPLE);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Changes the measurement resolution
+ *
+ * @details
+ *	The user register is read, its RES1 and RES0 bits replaced and written
+ *	back, so the heater and VDD bits keep their values. The conversion waits
+ *	and the code masks follow from the next sample on. If a sample is in
+ *	progress the change runs after it.
+ *
+ * @note
+ *	With SI7021_POWER_GATED the register is lost every time the sampler
+ *	switches the Si7021 off, so the setting is only kept here and written
+ *	again before each sample, see si7021_sensor_start().
+ *
+ * @param[in] temp_bits
+ *	14, 13, 12 or 11 bit temperature. The RH resolution is set with it,
+ *	12, 10, 8 and 11 bits respectively.
+ *
+ * @param[in] event
+ *	Scheduler event posted once the register has been written, or the
+ *	write failed, see si7021_resolution()
+ *
+ ******************************************************************************/
+void si7021_set_resolution(uint32_t temp_bits, uint32_t event){
+	uint32_t res;
+
+	for(res = 0; res < SI7021_RES_SETTINGS; res++){
+		if(si7021_temp_bits[res] == temp_bits) break;
+	}
+	EFM_ASSERT(res < SI7021_RES_SETTINGS);
+
+#ifdef SI7021_POWER_GATED
+	si7021_res = res;
+	add_scheduled_event(event);
+#else
+	si7021_ctx.next_res = res;
+	si7021_ctx.res_evt = event;
+	si7021_request(SI7021_REQ_RESOLUTION);
+#endif
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Returns the temperature resolution in bits
+ *
+ ******************************************************************************/
+uint32_t si7021_resolution(void){
+	return si7021_temp_bits[si7021_res];
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Coroutine body of si7021_read(), si7021_read_rh_temp() and
+ *	si7021_set_resolution()
+ *
+ * @details
+ *	A sample writes the measure command on its own and releases the bus. The
+ *	conversion is waited out on a one-shot timer sized to the maximum
+ *	conversion time of the current resolution, so the core sleeps in EM2
+ *	instead of staying in EM1 while the driver re-sends the read address.
+ *	Then one read collects the result. Only if the Si7021 still NACKs it is
+ *	the read retried, SI7021_POLL_TRIES times, SI7021_POLL_MS apart.
+ *
+ *	A resolution change waits for the sample in progress, so the conversion
+ *	time always matches the register.
+ *
+ * @param[in] payload
+ *	Completion payload of the I2C transfer that resumed the task
+ *
+ ******************************************************************************/
+void si7021_task(uint32_t payload){
+	CR_BEGIN(&si7021_ctx.cr);
+
+	while(si7021_ctx.pending){
+		if(si7021_ctx.pending & SI7021_REQ_RESOLUTION){
+			i2c_write_read(SI7021_I2C, SI7021_ADDR, &si7021_read_user_cmd, 1,
+					&si7021_ctx.user_reg[1], 1, si7021_ctx.task_evt);
+			CR_YIELD(&si7021_ctx.cr);
+			if(!(payload & I2C_PAYLOAD_FAILED)){
+				si7021_ctx.user_reg[0] = SI7021_WRITE_USER_REG;
+				si7021_ctx.user_reg[1] &= ~SI7021_USER_REG_RES_MASK;
+				si7021_ctx.user_reg[1] |= SI7021_USER_REG_RES(si7021_ctx.next_res);
+				i2c_write(SI7021_I2C, SI7021_ADDR, si7021_ctx.user_reg, 2, si7021_ctx.task_evt);
+				CR_YIELD(&si7021_ctx.cr);
+				if(!(payload & I2C_PAYLOAD_FAILED)){
+					si7021_res = si7021_ctx.next_res;
+				}
+			}
+			si7021_ctx.pending &= ~SI7021_REQ_RESOLUTION;
+			add_scheduled_event(si7021_ctx.res_evt);
+			continue;
+		}
+
+		energy_busy_begin(ENERGY_LOAD_I2C);			// The Si7021 draws while it converts
+		si7021_sample_res = si7021_res;
+		i2c_write(SI7021_I2C, SI7021_ADDR, si7021_ctx.rh ? &si7021_rh_cmd : &si7021_temp_cmd, 1, si7021_ctx.task_evt);
+		CR_YIELD(&si7021_ctx.cr);
+
+		timer_delay_async((si7021_ctx.rh ? si7021_rh_conv_ms[si7021_res] : 0) + si7021_temp_conv_ms[si7021_res]
+				+ SI7021_CONV_MARGIN_MS, si7021_ctx.task_evt);
+		CR_YIELD(&si7021_ctx.cr);
+
+		si7021_ctx.polls = 0;
+		si7021_read_result();
+		CR_YIELD(&si7021_ctx.cr);
+		si7021_ctx.status = payload;
+		while((si7021_ctx.status & I2C_PAYLOAD_NACK) && si7021_ctx.polls < SI7021_POLL_TRIES){
+			si7021_ctx.polls++;
+			timer_delay_async(SI7021_POLL_MS, si7021_ctx.task_evt);
+			CR_YIELD(&si7021_ctx.cr);
+			si7021_read_result();
+			CR_YIELD(&si7021_ctx.cr);
+			si7021_ctx.status = payload;
+		}
+
+		if(si7021_ctx.rh && !(si7021_ctx.status & I2C_PAYLOAD_FAILED)){
+			i2c_write_read(SI7021_I2C, SI7021_ADDR, &si7021_temp_from_rh_cmd, 1,
+					sidata, SI7021_NUM_BYTES_TEMP_NOCHECKSUM, si7021_ctx.task_evt);
+			CR_YIELD(&si7021_ctx.cr);
+			si7021_ctx.status = payload;
+		}
+		energy_busy_end(ENERGY_LOAD_I2C);
+
+		si7021_ctx.pending &= ~SI7021_REQ_SAMPLE;
+		add_scheduled_event(si7021_ctx.done_evt);
+	}
+
+	CR_END(&si7021_ctx.cr);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Reports whether the last read completed
+ *
+ * @return
+ *	false if the Si7021 was still NACKing after every retry, or the bus
+ *	failed, the sample values are then left over from the previous read
+ *
+ ******************************************************************************/
+bool si7021_read_ok(void){
+	return !(si7021_ctx.status & I2C_PAYLOAD_FAILED);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Checks the humidity bytes against their checksum
+ *
+ * @return
+ *	true if the CRC-8 of the RH MSB and LSB matches the Si7021 checksum byte
+ *
+ ******************************************************************************/
+bool si7021_rh_valid(void){
+	return crc8(sirh, 2) == sirh[2];
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Contains si7021 relative humidity conversion function
+ *
+ * @details
+ *	RH = 125 * code / 65536 - 6, clamped to 0 to 100 %. The Si7021 can report
+ *	slightly outside that range.
+ *
+ * @return
+ *	Relative humidity in % from the last si7021_read_rh_temp()
+ *
+ ******************************************************************************/
+float si7021_humidity(void){
+	uint16_t rh_dat = ((sirh[0] << 8) | sirh[1]) & si7021_rh_mask[si7021_sample_res];
+	float rh = ((float)125*(float)rh_dat / (float)65536) - (float)6;
+
+	if(rh < 0){
+		rh = 0;
+	} else if(rh > 100){
+		rh = 100;
+	}
+	return rh;
+}
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Reads the result of the measure command the task sent
+ *
+ ******************************************************************************/
+static void si7021_read_result(void){
+	if(si7021_ctx.rh){
+		i2c_read(SI7021_I2C, SI7021_ADDR, sirh, SI7021_NUM_BYTES_RH_CHECKSUM, si7021_ctx.task_evt);
+	} else {
+		i2c_read(SI7021_I2C, SI7021_ADDR, sidata, SI7021_NUM_BYTES_TEMP_NOCHECKSUM, si7021_ctx.task_evt);
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Hands a request to the task, starting it if it is idle
+ *
+ ******************************************************************************/
+static void si7021_request(uint32_t request){
+	si7021_ctx.pending |= request;
+	if(!CR_RUNNING(&si7021_ctx.cr)){
+		add_scheduled_event(si7021_ctx.task_evt);
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Sampler start phase, an RH measure command
+ *
+ * @details
+ *	Same sample as si7021_read_rh_temp(). The resolution is latched here,
+ *	so the conversion time and the code masks match the register.
+ *
+ *	With SI7021_POWER_GATED the Si7021 has just been powered up with its
+ *	default resolution, any other one is written ahead of the command.
+ *
+ ******************************************************************************/
+static uint32_t si7021_sensor_start(void *ctx, I2C_TRANSFER *xfer){
+	(void)ctx;
+	I2C_TRANSFER measure = {SI7021_ADDR, 0, &si7021_rh_cmd, 1, NULL, 0, I2C_NO_EVENT};
+	I2C_TRANSFER restore = {SI7021_ADDR, 0, si7021_wake_reg, 2, NULL, 0, I2C_NO_EVENT};
+	uint32_t count = 0;
+
+	si7021_sample_res = si7021_res;
+#ifdef SI7021_POWER_GATED
+	if(si7021_res != SI7021_RES_RH12_T14){
+		si7021_wake_reg[0] = SI7021_WRITE_USER_REG;
+		si7021_wake_reg[1] = (SI7021_USER_REG_DEFAULT & ~SI7021_USER_REG_RES_MASK) | SI7021_USER_REG_RES(si7021_res);
+		xfer[count++] = restore;
+	}
+#endif
+	xfer[count++] = measure;
+	return count;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Sampler conversion time hint, the RH conversion includes a temperature one
+ *
+ ******************************************************************************/
+static uint32_t si7021_sensor_conv_ms(void *ctx){
+	(void)ctx;
+	return si7021_rh_conv_ms[si7021_sample_res] + si7021_temp_conv_ms[si7021_sample_res];
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Sampler complete phase, the RH result and the temperature it measured
+ *
+ * @details
+ *	While the Si7021 is still converting it NACKs both, and the sampler
+ *	polls them again.
+ *
+ ******************************************************************************/
+static uint32_t si7021_sensor_complete(void *ctx, I2C_TRANSFER *xfer){
+	(void)ctx;
+	I2C_TRANSFER rh = {SI7021_ADDR, 0, NULL, 0, sirh, SI7021_NUM_BYTES_RH_CHECKSUM, I2C_NO_EVENT};
+	I2C_TRANSFER temp = {SI7021_ADDR, 0, &si7021_temp_from_rh_cmd, 1,
+			sidata, SI7021_NUM_BYTES_TEMP_NOCHECKSUM, I2C_NO_EVENT};
+
+	xfer[0] = rh;
+	xfer[1] = temp;
+	return 2;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Sampler conversion, temperature and humidity in that order
+ *
+ * @details
+ *	The humidity is flagged invalid if its checksum does not match.
+ *
+ ******************************************************************************/
+static void si7021_sensor_convert(void *ctx, SENSOR_READING *reading){
+	(void)ctx;
+	reading->count = 2;
+	reading->quantity[0] = SENSOR_TEMP;
+	reading->valid[0] = true;
+	reading->value[0] = si7021_temp_met();
+	reading->quantity[1] = SENSOR_RH;
+	reading->valid[1] = si7021_rh_valid();
+	reading->value[1] = si7021_humidity();
+}
+
+#ifdef SI7021_POWER_GATED
+/***************************************************************************//**
+ * @brief
+ *	Sampler power switch, SI7021_SENSOR_EN
+ *
+ * @details
+ *	The pin also supplies the SCL and SDA pull-ups, so the I2C driver is told
+ *	before the bus goes down and after it comes back.
+ *
+ ******************************************************************************/
+static void si7021_sensor_power(void *ctx, bool on){
+	(void)ctx;
+	if(on){
+		GPIO_PinOutSet(SI7021_SENSOR_EN_PORT, SI7021_SENSOR_EN_PIN);
+		i2c_bus_powered(SI7021_I2C, true);
+	} else {
+		i2c_bus_powered(SI7021_I2C, false);
+		GPIO_PinOutClear(SI7021_SENSOR_EN_PORT, SI7021_SENSOR_EN_PIN);
+	}
+}
+#endif
@@ -0,0 +1,133 @@
+/**
+ * @file sim_sensor.c
+ * @author Kay Sho
+ * @date  10/16/2026
+ * @brief Simulated I2C temperature sensor for the sampler
+ * @note The author's pronouns: (She/They)
+ *
+ * A second sensor driver, so the sampler can be tried with two sensors on
+ * one bus before a second part is fitted. The protocol is that of a simple
+ * one-shot temperature sensor: a measure command, then a 2 byte read of a
+ * left justified 12 bit code. On the host the bus model answers for it, on
+ * the board it NACKs and its samples are reported as failed.
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+
+/* System include statements */
+
+
+/* Silicon Labs include statements */
+
+
+/* The developer's include statements */
+#include "sim_sensor.h"
+
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+
+
+//***********************************************************************************
+// private variables
+//***********************************************************************************
+
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+static uint32_t sim_sensor_start(void *ctx, I2C_TRANSFER *xfer);
+static uint32_t sim_sensor_conv_ms(void *ctx);
+static uint32_t sim_sensor_complete(void *ctx, I2C_TRANSFER *xfer);
+static void sim_sensor_convert(void *ctx, SENSOR_READING *reading);
+
+const SENSOR_DRIVER sim_sensor = {
+	"Sim",
+	sim_sensor_start,
+	sim_sensor_conv_ms,
+	sim_sensor_complete,
+	sim_sensor_convert,
+	NULL,
+	0
+};
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Sets up the context of one simulated device
+ *
+ * @param[out] *sensor
+ *	Context handed to sampler_add() with &sim_sensor
+ *
+ * @param[in] addr
+ *	7 bit address, SIM_SENSOR_ADDR
+ *
+ ******************************************************************************/
+void sim_sensor_init(SIM_SENSOR *sensor, uint8_t addr){
+	sensor->addr = addr;
+	sensor->cmd = SIM_SENSOR_MEASURE;
+	sensor->raw[0] = 0;
+	sensor->raw[1] = 0;
+}
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Sampler start phase, the measure command
+ *
+ ******************************************************************************/
+static uint32_t sim_sensor_start(void *ctx, I2C_TRANSFER *xfer){
+	SIM_SENSOR *sensor = ctx;
+	I2C_TRANSFER measure = {sensor->addr, 0, &sensor->cmd, 1, NULL, 0, I2C_NO_EVENT};
+
+	xfer[0] = measure;
+	return 1;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Sampler conversion time hint
+ *
+ ******************************************************************************/
+static uint32_t sim_sensor_conv_ms(void *ctx){
+	(void)ctx;
+	return SIM_SENSOR_CONV_MS;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Sampler complete phase, the result read
+ *
+ ******************************************************************************/
+static uint32_t sim_sensor_complete(void *ctx, I2C_TRANSFER *xfer){
+	SIM_SENSOR *sensor = ctx;
+	I2C_TRANSFER result = {sensor->addr, 0, NULL, 0, sensor->raw, SIM_SENSOR_RESULT_BYTES, I2C_NO_EVENT};
+
+	xfer[0] = result;
+	return 1;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Sampler conversion, one temperature
+ *
+ ******************************************************************************/
+static void sim_sensor_convert(void *ctx, SENSOR_READING *reading){
+	SIM_SENSOR *sensor = ctx;
+	int16_t code = (int16_t)((sensor->raw[0] << 8) | sensor->raw[1]) >> 4;
+
+	reading->count = 1;
+	reading->quantity[0] = SENSOR_TEMP;
+	reading->valid[0] = true;
+	reading->value[0] = code * SIM_SENSOR_LSB_C;
+}
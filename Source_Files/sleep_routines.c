@@ -10,21 +10,32 @@
 //***********************************************************************************
 
 #include "sleep_routines.h"
+#include "timer_wheel.h"
+#include "energy.h"
+#include "cycle_counter.h"
+#include "em_cmu.h"
 
 //***********************************************************************************
 // defined files
 //***********************************************************************************
-
+#define TICK_US				(1000000 / LETIMER_HZ)
+#define WAKE_CYCLES_SHIFT	3				// Restore time average weights a new sample 1/8
 
 //***********************************************************************************
 // Static / Private Variables
 //***********************************************************************************
-static int lowest_energy_mode[MAX_EM];
+static ATOMIC_U32 lowest_energy_mode[MAX_EM];
+static uint32_t em_residency[MAX_EM];			// LETIMER ticks spent in each sleep mode
+static uint32_t wake_cycles[MAX_EM];			// Average core cycles spent entering and leaving each mode
+static uint32_t core_mhz;					// Converts wake_cycles to us, the core clock is fixed by cmu_open()
+static uint32_t governor_picked[MAX_EM];
+static uint32_t governor_shallower;
 
 //***********************************************************************************
 // Private functions
 //***********************************************************************************
-
+static void sleep_enter(uint32_t EM);
+static uint32_t sleep_governor(uint32_t deepest);
 
 //***********************************************************************************
 // Global functions
@@ -41,15 +52,17 @@ static int lowest_energy_mode[MAX_EM];
  * This depends on what conditions lowest_energy_mode finds.
  *
  * @note
- *
+ *	Call after cmu_open() so the core clock is final. The governor turns the
+ *	measured wakeup cycles into time with it.
  *
  ******************************************************************************/
 void sleep_open(void){
 	int i;
+	core_mhz = CMU_ClockFreqGet(cmuClock_CORE) / 1000000;
 	for (i=0;i< MAX_EM; i++){
 		CORE_DECLARE_IRQ_STATE;
 		CORE_ENTER_CRITICAL();
-		lowest_energy_mode[i] = 0;
+		atomic_store_u32(&lowest_energy_mode[i], 0);
 		CORE_EXIT_CRITICAL();
 	}
 }
@@ -59,6 +72,8 @@ void sleep_open(void){
  * @details
  * Checks if EM is less than 5, then increments to Max energy mode
  * @note
+ * The count is updated with an LDREX/STREX add, so peripherals can block a
+ * mode from interrupt context without masking interrupts.
  *
  * @param[in] EM
  * Energy Mode
@@ -67,14 +82,9 @@ void sleep_open(void){
  ******************************************************************************/
 
 void sleep_block_mode(uint32_t EM){
-	CORE_DECLARE_IRQ_STATE;
-	CORE_ENTER_CRITICAL();
-
-	EFM_ASSERT(lowest_energy_mode[EM] < 5);
+	uint32_t old = atomic_fetch_add_u32(&lowest_energy_mode[EM], 1);
 
-		lowest_energy_mode[EM]++;
-
-	CORE_EXIT_CRITICAL();
+	EFM_ASSERT(old < 5);
 }
 /***************************************************************************//**
  * @brief sleep_unblock_mode(uint32_t EM)
@@ -82,6 +92,7 @@ void sleep_block_mode(uint32_t EM){
  * @details
  * Lowers energy mode array to lowest of 0, so that all peripherals can activate
  * @note
+ * Lock-free, see sleep_block_mode()
  *
  * @param[in] EM
  * Energy Mode
@@ -90,20 +101,17 @@ void sleep_block_mode(uint32_t EM){
  ******************************************************************************/
 
 void sleep_unblock_mode(uint32_t EM){
-	CORE_DECLARE_IRQ_STATE;
-	CORE_ENTER_CRITICAL();
-
-	EFM_ASSERT(lowest_energy_mode[EM] >= 0);
-
-		lowest_energy_mode[EM]--;
+	uint32_t old = atomic_fetch_add_u32(&lowest_energy_mode[EM], (uint32_t)-1);
 
-	CORE_EXIT_CRITICAL();
+	EFM_ASSERT(old > 0);
 }
 /***************************************************************************//**
  * @brief (void)enter_sleep(void)
  * Enters Energy mode from EM0-EM3
  * @details
- * Checks lowest energy mode array and sets the energy mode.
+ * Checks lowest energy mode array for the deepest mode the peripherals allow,
+ * then lets the governor pick the mode that is cheapest for the time left
+ * until the next timer deadline.
  * @note
  *
  * @param[in] void function - no input
@@ -113,6 +121,8 @@ void sleep_unblock_mode(uint32_t EM){
  ******************************************************************************/
 
 void enter_sleep(void){
+	uint32_t deepest;
+
 	CORE_DECLARE_IRQ_STATE;
 	CORE_ENTER_CRITICAL();
 	if(lowest_energy_mode[EM0]>0){
@@ -124,20 +134,16 @@ void enter_sleep(void){
 		return;
 	}
 	else if(lowest_energy_mode[EM2]>0){
-		EMU_EnterEM1();
-		CORE_EXIT_CRITICAL();
-		return;
+		deepest = EM1;
 	}
 	else if(lowest_energy_mode[EM3]>0){
-		EMU_EnterEM2(true);
-		CORE_EXIT_CRITICAL();
-		return;
+		deepest = EM2;
 	}
 	else{
-		EMU_EnterEM3(true);
-		CORE_EXIT_CRITICAL();
-		return;
+		deepest = EM3;
 	}
+	sleep_enter(sleep_governor(deepest));
+	CORE_EXIT_CRITICAL();
 }
 /***************************************************************************//**
  * @brief
@@ -158,6 +164,148 @@ uint32_t current_block_energy_mode(void){
 	return MAX_EM -1;
 
 }
+/***************************************************************************//**
+ * @brief
+ * Returns the time spent in each sleep mode
+ *
+ * @details
+ * Counted in LETIMER0 ticks from the last sleep_residency_reset(). EM0 is
+ * not counted here, it is the rest of the caller's window.
+ *
+ * @param[out] *ticks
+ * Array of MAX_EM entries
+ *
+ ******************************************************************************/
+void sleep_residency(uint32_t *ticks){
+	CORE_DECLARE_IRQ_STATE;
+	CORE_ENTER_CRITICAL();
+	for(int i = 0; i < MAX_EM; i++){
+		ticks[i] = em_residency[i];
+	}
+	CORE_EXIT_CRITICAL();
+}
+/***************************************************************************//**
+ * @brief
+ * Clears the sleep residency counters
+ *
+ ******************************************************************************/
+void sleep_residency_reset(void){
+	CORE_DECLARE_IRQ_STATE;
+	CORE_ENTER_CRITICAL();
+	for(int i = 0; i < MAX_EM; i++){
+		em_residency[i] = 0;
+	}
+	CORE_EXIT_CRITICAL();
+}
+/***************************************************************************//**
+ * @brief
+ * Returns the governor's decision counters and wakeup costs
+ *
+ * @param[out] *stats
+ * Counters since sleep_open()
+ *
+ ******************************************************************************/
+void sleep_governor_stats(SLEEP_GOVERNOR_STATS *stats){
+	const ENERGY_MODEL *model = energy_get_model();
+
+	CORE_DECLARE_IRQ_STATE;
+	CORE_ENTER_CRITICAL();
+	for(int i = 0; i < MAX_EM; i++){
+		stats->picked[i] = governor_picked[i];
+	}
+	energy_wake_us(model, wake_cycles, core_mhz, stats->wake_us);
+	stats->shallower = governor_shallower;
+	CORE_EXIT_CRITICAL();
+}
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ * Picks the energy mode for one sleep
+ *
+ * @details
+ * The time to the next timer wheel deadline is the expected sleep. Inside the
+ * current LETIMER tick the exact time is unknown, so half a tick is assumed.
+ * With no deadline armed only an interrupt can wake the core, and the deepest
+ * allowed mode is used. Otherwise energy_cheapest_mode() weighs each mode's
+ * current against its wakeup time, the datasheet figure plus the restore time
+ * measured by sleep_enter().
+ *
+ * @param[in] deepest
+ * EM1, EM2 or EM3
+ *
+ * @return
+ * The mode to enter, never deeper than [deepest]
+ *
+ ******************************************************************************/
+static uint32_t sleep_governor(uint32_t deepest){
+	uint32_t picked = deepest;
+#ifdef SLEEP_GOVERNOR_ENABLED
+	const ENERGY_MODEL *model = energy_get_model();
+	uint32_t wake_us[MAX_EM];
+	uint32_t sleep_us = SLEEP_NO_DEADLINE;
+	uint32_t deadline;
+	int32_t ticks;
+
+	if(deepest > EM1 && timer_next_deadline(&deadline)){
+		ticks = (int32_t)(deadline - timer_now());
+		sleep_us = ticks > 0 ? (uint32_t)(ticks - 1) * TICK_US + TICK_US / 2 : 0;
+		energy_wake_us(model, wake_cycles, core_mhz, wake_us);
+		picked = energy_cheapest_mode(model, deepest, sleep_us, wake_us);
+	}
+	if(picked != deepest){
+		governor_shallower++;
+	}
+#endif
+	governor_picked[picked]++;
+	TRACE(TRACE_SLEEP_GOVERNOR, (deepest << 8) | picked);
+	return picked;
+}
+/***************************************************************************//**
+ * @brief
+ * Enters one energy mode and traces the sleep
+ *
+ * @details
+ * The LETIMER0 timebase keeps counting in EM1 to EM3, so the ticks between
+ * entry and wakeup are added to the mode's residency. The cycle counter stops
+ * while the core sleeps, so the trace exit record carries them as well.
+ *
+ * The cycles that do pass between entry and wakeup are the core's own cost of
+ * entering the mode and restoring the clocks afterwards. Interrupts are masked
+ * here, so no handler runs inside the window. They are averaged per mode for
+ * the governor.
+ *
+ * @param[in] EM
+ * EM1, EM2 or EM3
+ *
+ ******************************************************************************/
+static void sleep_enter(uint32_t EM){
+	uint32_t start = timer_now();
+	uint32_t slept;
+	uint32_t cycles;
+
+	TRACE(TRACE_EM_ENTER, EM);
+	cycles = cycle_counter_now();
+	if(EM == EM1){
+		EMU_EnterEM1();
+	} else if(EM == EM2){
+		EMU_EnterEM2(true);
+	} else {
+		EMU_EnterEM3(true);
+	}
+	cycles = cycle_counter_now() - cycles;
+	if(wake_cycles[EM] == 0){
+		wake_cycles[EM] = cycles;
+	} else {
+		wake_cycles[EM] += (int32_t)(cycles - wake_cycles[EM]) >> WAKE_CYCLES_SHIFT;
+	}
+	slept = timer_now() - start;
+	em_residency[EM] += slept;
+	TRACE(TRACE_EM_EXIT, slept);
+}
 /**************************************************************************
 * @file sleep_routines.c
 ***************************************************************************
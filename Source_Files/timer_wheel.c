@@ -0,0 +1,523 @@
+/**
+ * @file timer_wheel.c
+ * @author Kay Sho
+ * @date  10/16/2026
+ * @brief Hierarchical wheel of virtual one-shot and periodic timers on LETIMER0
+ * @note The author's pronouns: (She/They)
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+
+/* System include statements */
+
+
+/* Silicon Labs include statements */
+
+
+/* The developer's include statements */
+#include "timer_wheel.h"
+
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define TIMER_WHEEL_SLOT_MASK	(TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_REACH		(1u << (TIMER_WHEEL_SLOT_BITS * TIMER_WHEEL_LEVELS))	// Ticks the top level can see ahead
+
+//***********************************************************************************
+// private variables
+//***********************************************************************************
+typedef struct{
+	uint32_t				expires;			// Absolute tick the timer fires at
+	uint32_t				period;				// Ticks between firings, 0 for one-shot
+	uint32_t				event;				// Scheduler event posted when it fires
+	uint8_t					next;				// Next timer in the same slot
+	uint8_t					level;
+	uint8_t					slot;
+	bool					active;
+}TIMER_WHEEL_TIMER;
+
+static TIMER_WHEEL_TIMER timers[TIMER_WHEEL_TIMERS];
+static uint8_t slot_head[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+static uint32_t slot_used[TIMER_WHEEL_LEVELS];		// Bit n set when slot n holds a timer
+static uint32_t wheel_now;							// Tick the wheel has been advanced to
+static uint32_t wake_count;							// COMP1/UF wakeups serviced
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+static void timer_wheel_service(uint32_t payload);
+static uint32_t timer_start(uint32_t ms, uint32_t event, bool periodic);
+static void timer_insert(uint32_t handle);
+static void timer_unlink(uint32_t handle);
+static void timer_fire(uint32_t handle);
+static uint32_t timer_wheel_first_slot(uint32_t level, uint32_t *boundary);
+static bool timer_wheel_next(uint32_t *tick);
+static bool timer_wheel_deadline(uint32_t *tick);
+static void timer_wheel_advance(uint32_t now);
+static void timer_wheel_process(uint32_t tick);
+static void timer_wheel_program(void);
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Opens the timer wheel and its LETIMER0 timebase
+ *
+ * @details
+ *	LETIMER0 free-runs as a 1 kHz timebase and only COMP1 (moved to the next
+ *	deadline) or the once-per-epoch underflow wake the core. Both post
+ *	[wake_event], whose handler advances the wheel and programs COMP1 again.
+ *
+ * @note
+ *	The wheel is only touched from the main loop, no locking is needed.
+ *
+ * @param[in] wake_event
+ *	Scheduler event ID the wheel may use for its own wakeups
+ *
+ ******************************************************************************/
+void timer_wheel_open(uint32_t wake_event){
+	APP_LETIMER_TIMEBASE_TypeDef timebase;
+
+	for(int i = 0; i < TIMER_WHEEL_TIMERS; i++){
+		timers[i].active = false;
+	}
+	for(int l = 0; l < TIMER_WHEEL_LEVELS; l++){
+		for(int s = 0; s < TIMER_WHEEL_SLOTS; s++){
+			slot_head[l][s] = TIMER_WHEEL_INVALID;
+		}
+		slot_used[l] = 0;
+	}
+	wake_count = 0;
+
+	scheduler_register(wake_event, timer_wheel_service, SCHED_PRIO_CRITICAL);
+
+	timebase.debugRun = false;
+	timebase.comp1_cb = wake_event;
+	timebase.uf_cb = wake_event;
+	letimer_timebase_open(TIMER_WHEEL_LETIMER, &timebase);
+
+	wheel_now = timer_now();
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Arms a one-shot timer
+ *
+ * @param[in] ms
+ *	Milliseconds from now, rounded to the next tick
+ *
+ * @param[in] event
+ *	Scheduler event posted when the timer expires, TIMER_WHEEL_NO_EVENT to
+ *	only wake the core
+ *
+ * @return
+ *	Handle for timer_cancel(), TIMER_WHEEL_INVALID if every timer is in use
+ *
+ ******************************************************************************/
+uint32_t timer_arm(uint32_t ms, uint32_t event){
+	return timer_start(ms, event, false);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Arms a periodic timer
+ *
+ * @details
+ *	Each period is added to the previous deadline, not to the time the event
+ *	was handled, so the rate does not drift.
+ *
+ * @param[in] ms
+ *	Period in milliseconds
+ *
+ * @param[in] event
+ *	Scheduler event posted every period
+ *
+ * @return
+ *	Handle for timer_cancel(), TIMER_WHEEL_INVALID if every timer is in use
+ *
+ ******************************************************************************/
+uint32_t timer_arm_periodic(uint32_t ms, uint32_t event){
+	return timer_start(ms, event, true);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Stops an armed timer
+ *
+ * @note
+ *	Cancelling a timer that already fired is harmless.
+ *
+ * @param[in] handle
+ *	Value returned by timer_arm() or timer_arm_periodic()
+ *
+ ******************************************************************************/
+void timer_cancel(uint32_t handle){
+	if(handle >= TIMER_WHEEL_TIMERS || !timers[handle].active){
+		return;
+	}
+	timer_unlink(handle);
+	timers[handle].active = false;
+	timer_wheel_program();
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Returns whether a timer is still waiting to fire
+ *
+ ******************************************************************************/
+bool timer_armed(uint32_t handle){
+	return handle < TIMER_WHEEL_TIMERS && timers[handle].active;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Returns the current tick of the LETIMER0 timebase
+ *
+ ******************************************************************************/
+uint32_t timer_now(void){
+	return letimer_ticks(TIMER_WHEEL_LETIMER);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Returns the next tick at which the wheel needs the core
+ *
+ * @details
+ *	This is the earliest timer expiry, the value COMP1 is programmed to.
+ *	Higher level slots are cascaded lazily on that wakeup, so crossing a slot
+ *	boundary never costs a wakeup of its own.
+ *
+ * @param[out] *deadline
+ *	Absolute tick
+ *
+ * @return
+ *	false if no timer is armed
+ *
+ ******************************************************************************/
+bool timer_next_deadline(uint32_t *deadline){
+	return timer_wheel_deadline(deadline);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Returns the number of COMP1/underflow wakeups serviced since open
+ *
+ * @note
+ *	Compare with the 3600 / PWM period wakeups per hour of a fixed heartbeat.
+ *
+ ******************************************************************************/
+uint32_t timer_wheel_wakeups(void){
+	return wake_count;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Catches the wheel up and programs COMP1 from outside the scheduler
+ *
+ * @details
+ *	For code that waits on a timer without returning to the main loop. Timers
+ *	that expire here still post their events, which run once the main loop
+ *	dispatches again.
+ *
+ ******************************************************************************/
+void timer_wheel_poll(void){
+	timer_wheel_program();
+}
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Scheduler handler for the COMP1 and underflow wakeups
+ *
+ * @param[in] payload
+ *	LETIMER0 count or underflow count, unused
+ *
+ ******************************************************************************/
+static void timer_wheel_service(uint32_t payload){
+	(void)payload;
+	wake_count++;
+	timer_wheel_program();
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Claims a free timer and puts it on the wheel
+ *
+ ******************************************************************************/
+static uint32_t timer_start(uint32_t ms, uint32_t event, bool periodic){
+	uint32_t handle;
+	uint32_t ticks = TIMER_MS_TO_TICKS(ms);
+
+	for(handle = 0; handle < TIMER_WHEEL_TIMERS; handle++){
+		if(!timers[handle].active) break;
+	}
+	if(handle == TIMER_WHEEL_TIMERS){
+		EFM_ASSERT(false);
+		return TIMER_WHEEL_INVALID;
+	}
+	if(ticks == 0) ticks = 1;
+
+	timer_wheel_advance(timer_now());
+
+	timers[handle].expires = wheel_now + ticks;
+	timers[handle].period = periodic ? ticks : 0;
+	timers[handle].event = event;
+	timers[handle].active = true;
+	timer_insert(handle);
+
+	timer_wheel_program();
+	return handle;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Links a timer into the slot that matches its distance from wheel_now
+ *
+ * @details
+ *	Level n holds timers 32^n to 32^(n+1) ticks away, in the slot given by bits
+ *	5n to 5n+4 of the expiry. Timers beyond the top level are parked in the
+ *	furthest top level slot and re-inserted when it is reached.
+ *
+ ******************************************************************************/
+static void timer_insert(uint32_t handle){
+	TIMER_WHEEL_TIMER *t = &timers[handle];
+	uint32_t delta = t->expires - wheel_now;
+	uint32_t position = t->expires;
+	uint32_t level;
+
+	if(delta == 0 || delta > (uint32_t)INT32_MAX){
+		timer_fire(handle);
+		return;
+	}
+	if(delta >= TIMER_WHEEL_REACH){
+		position = wheel_now + TIMER_WHEEL_REACH - 1;
+		delta = TIMER_WHEEL_REACH - 1;
+	}
+	for(level = 0; level < TIMER_WHEEL_LEVELS - 1; level++){
+		if(delta < (1u << (TIMER_WHEEL_SLOT_BITS * (level + 1)))) break;
+	}
+
+	t->level = level;
+	t->slot = (position >> (TIMER_WHEEL_SLOT_BITS * level)) & TIMER_WHEEL_SLOT_MASK;
+	t->next = slot_head[level][t->slot];
+	slot_head[level][t->slot] = handle;
+	slot_used[level] |= 1u << t->slot;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Removes a timer from its slot list
+ *
+ ******************************************************************************/
+static void timer_unlink(uint32_t handle){
+	TIMER_WHEEL_TIMER *t = &timers[handle];
+	uint8_t *link = &slot_head[t->level][t->slot];
+
+	while(*link != TIMER_WHEEL_INVALID){
+		if(*link == handle){
+			*link = t->next;
+			break;
+		}
+		link = &timers[*link].next;
+	}
+	if(slot_head[t->level][t->slot] == TIMER_WHEEL_INVALID){
+		slot_used[t->level] &= ~(1u << t->slot);
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Posts a timer's event and re-arms it if it is periodic
+ *
+ ******************************************************************************/
+static void timer_fire(uint32_t handle){
+	TIMER_WHEEL_TIMER *t = &timers[handle];
+
+	if(t->event != TIMER_WHEEL_NO_EVENT){
+		add_scheduled_event(t->event);
+	}
+	if(t->period){
+		t->expires += t->period;
+		if((int32_t)(t->expires - wheel_now) <= 0){
+			t->expires = wheel_now + t->period;		// Fell more than a period behind, skip ahead
+		}
+		timer_insert(handle);
+	} else {
+		t->active = false;
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Finds the first occupied slot of a level after wheel_now
+ *
+ * @details
+ *	The occupied slots are rotated so the slot after the current one sits in
+ *	bit 0, and the first one is found with __CLZ(__RBIT()). No slot is ever
+ *	visited tick by tick.
+ *
+ * @param[in] level
+ *	Level to search, must have at least one occupied slot
+ *
+ * @param[out] *boundary
+ *	Absolute tick at which that slot starts
+ *
+ * @return
+ *	Slot index
+ *
+ ******************************************************************************/
+static uint32_t timer_wheel_first_slot(uint32_t level, uint32_t *boundary){
+	uint32_t used = slot_used[level];
+	uint32_t shift = TIMER_WHEEL_SLOT_BITS * level;
+	uint32_t base = wheel_now >> shift;
+	uint32_t rot = ((base & TIMER_WHEEL_SLOT_MASK) + 1) & TIMER_WHEEL_SLOT_MASK;
+	uint32_t rotated = rot ? (used >> rot) | (used << (TIMER_WHEEL_SLOTS - rot)) : used;
+	uint32_t steps = __CLZ(__RBIT(rotated)) + 1;
+
+	*boundary = (base + steps) << shift;
+	return (base + steps) & TIMER_WHEEL_SLOT_MASK;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Finds the next slot boundary that holds a timer
+ *
+ * @param[out] *tick
+ *	Absolute tick of the earliest boundary
+ *
+ * @return
+ *	false if the wheel is empty
+ *
+ ******************************************************************************/
+static bool timer_wheel_next(uint32_t *tick){
+	bool found = false;
+	uint32_t best = 0;
+	uint32_t boundary;
+
+	for(uint32_t level = 0; level < TIMER_WHEEL_LEVELS; level++){
+		if(!slot_used[level]) continue;
+		timer_wheel_first_slot(level, &boundary);
+		if(!found || (boundary - wheel_now) < (best - wheel_now)){
+			best = boundary;
+			found = true;
+		}
+	}
+	*tick = best;
+	return found;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Finds the earliest timer expiry
+ *
+ * @details
+ *	Slots of one level hold consecutive blocks of time, so the earliest timer
+ *	of a level is always in its first occupied slot. Only that slot's short
+ *	list is scanned per level.
+ *
+ * @param[out] *tick
+ *	Absolute tick of the earliest expiry
+ *
+ * @return
+ *	false if the wheel is empty
+ *
+ ******************************************************************************/
+static bool timer_wheel_deadline(uint32_t *tick){
+	bool found = false;
+	uint32_t best = 0;
+	uint32_t boundary;
+
+	for(uint32_t level = 0; level < TIMER_WHEEL_LEVELS; level++){
+		if(!slot_used[level]) continue;
+		uint32_t slot = timer_wheel_first_slot(level, &boundary);
+		for(uint8_t handle = slot_head[level][slot]; handle != TIMER_WHEEL_INVALID; handle = timers[handle].next){
+			if(!found || (timers[handle].expires - wheel_now) < (best - wheel_now)){
+				best = timers[handle].expires;
+				found = true;
+			}
+		}
+	}
+	*tick = best;
+	return found;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Processes every boundary up to [now], then moves wheel_now to [now]
+ *
+ ******************************************************************************/
+static void timer_wheel_advance(uint32_t now){
+	uint32_t tick;
+
+	while(timer_wheel_next(&tick) && (int32_t)(tick - now) <= 0){
+		wheel_now = tick;
+		timer_wheel_process(tick);
+	}
+	if((int32_t)(now - wheel_now) > 0){
+		wheel_now = now;
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Handles the slots that start at [tick]
+ *
+ * @details
+ *	Higher level slots are cascaded first, so a timer that lands exactly on
+ *	this tick fires in the same pass as the level 0 timers.
+ *
+ ******************************************************************************/
+static void timer_wheel_process(uint32_t tick){
+	for(int level = TIMER_WHEEL_LEVELS - 1; level >= 0; level--){
+		uint32_t shift = TIMER_WHEEL_SLOT_BITS * level;
+		if(tick & ((1u << shift) - 1)) continue;
+
+		uint32_t slot = (tick >> shift) & TIMER_WHEEL_SLOT_MASK;
+		uint8_t handle = slot_head[level][slot];
+		slot_head[level][slot] = TIMER_WHEEL_INVALID;
+		slot_used[level] &= ~(1u << slot);
+
+		while(handle != TIMER_WHEEL_INVALID){
+			uint8_t next = timers[handle].next;
+			if(level == 0){
+				timer_fire(handle);
+			} else {
+				timer_insert(handle);
+			}
+			handle = next;
+		}
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Catches the wheel up and points COMP1 at the next expiry
+ *
+ * @details
+ *	If the expiry slips past while COMP1 is being written, the wheel is
+ *	serviced again here instead of waiting a whole LETIMER epoch.
+ *
+ ******************************************************************************/
+static void timer_wheel_program(void){
+	uint32_t next;
+
+	for(;;){
+		timer_wheel_advance(timer_now());
+		if(!timer_wheel_deadline(&next)){
+			letimer_comp1_disable(TIMER_WHEEL_LETIMER);
+			return;
+		}
+		if(letimer_comp1_arm(TIMER_WHEEL_LETIMER, next)){
+			return;
+		}
+	}
+}
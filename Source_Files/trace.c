@@ -0,0 +1,55 @@
+/**
+ * @file trace.c
+ * @author Kay Sho
+ * @date  10/16/2026
+ * @brief Always-on binary trace ring
+ * @note The author's pronouns: (She/They)
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+
+/* System include statements */
+
+
+/* Silicon Labs include statements */
+#include "em_cmu.h"
+
+/* The developer's include statements */
+#include "trace.h"
+
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+
+//***********************************************************************************
+// private variables
+//***********************************************************************************
+TRACE_LOG trace_log;
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Empties the trace and starts its cycle counter
+ *
+ * @details
+ *	The header fields let the host decoder check the dump and turn the cycle
+ *	stamps into time. Records written before this call are thrown away.
+ *
+ * @note
+ *	Call after cmu_open() so the core clock is final.
+ *
+ ******************************************************************************/
+void trace_open(void){
+	cycle_counter_open();
+	trace_log.core_hz = CMU_ClockFreqGet(cmuClock_CORE);
+	trace_log.size = TRACE_RECORDS;
+	atomic_store_u32(&trace_log.head, 0);
+	trace_log.magic = TRACE_MAGIC;
+}
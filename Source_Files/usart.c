@@ -0,0 +1,616 @@
+/**
+ * @file usart.c
+ * @author Kay Sho
+ * @date  10/16/2026
+ * @brief Asynchronous USART link, the high speed transport to the HM-10
+ * @note The author's pronouns: (She/They)
+ *
+ * Same model as the LEUART driver: messages go out in place on the LDMA and
+ * the core wakes once, at TXC. The USART has no start and signal frame
+ * detection, so framed commands are picked out of the RXDATAV interrupts in
+ * software. Commands are short and rare, so that costs a few wakeups per
+ * command, against one per character of every message sent.
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+
+/* System include statements */
+
+
+/* Silicon Labs include statements */
+
+
+/* The developer's include statements */
+#include "usart.h"
+
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+
+// Context index of each instance enabled in brd_config.h
+enum{
+#ifdef USART0_ENABLED
+	USART_SM_USART0,
+#endif
+	USART_INSTANCES
+};
+
+typedef enum {
+	USART_TX_IDLE,
+	USART_TX_CLOSE,					// The LDMA is feeding TXDATA, waiting for TXC
+	USART_TX_STATES
+}USART_TX_STATE;
+
+typedef enum {
+	USART_RX_STARTFRAME,			// Characters are dropped until USART_STARTF_CHAR
+	USART_RX_RECEIVE,
+	USART_RX_RAW,					// usart_receive()
+	USART_RX_STATES
+}USART_RX_STATE;
+
+/* Interrupt causes, the columns of the TX and RX tables */
+typedef enum {
+	USART_CAUSE_TXC,
+	USART_TX_CAUSES
+}USART_TX_CAUSE;
+
+typedef enum {
+	USART_CAUSE_RXDATAV,
+	USART_RX_CAUSES
+}USART_RX_CAUSE;
+
+/* Indexes into usart_actions, shared by both tables */
+enum {
+	USART_ACT_ILLEGAL = FSM_ILLEGAL,
+	USART_ACT_TX_DONE,
+	USART_ACT_FRAME_HUNT,
+	USART_ACT_FRAME_BYTE,
+	USART_ACT_RAW_BYTE
+};
+
+//***********************************************************************************
+// private variables
+//***********************************************************************************
+
+/* What differs between the peripherals, fixed at compile time */
+typedef struct{
+	USART_TypeDef*				usart;
+	CMU_Clock_TypeDef			clock;
+	IRQn_Type					rx_irq;
+	IRQn_Type					tx_irq;
+	uint32_t					dma_tx_ch;				// LDMA_CH_x
+	LDMA_PeripheralSignal_t		dma_tx_signal;
+	uint32_t					sched_rx_src;			// SCHED_SRC_x rings the events are posted to
+	uint32_t					sched_tx_src;
+	uint32_t					trace_irq;				// TRACE_IRQ_x
+}USART_INSTANCE;
+
+typedef struct{
+	const USART_INSTANCE*		hw;
+	USART_TypeDef*				usart;
+	FSM							tx_fsm;					// See usart_tx_transitions
+	FSM							rx_fsm;					// See usart_rx_transitions
+	volatile bool				tx_busy;
+	volatile bool				rx_busy;
+	bool						open;
+	uint32_t					tx_len;
+	uint32_t					tx_evt;					// Posted at TXC of the current message
+	FRAME_RING					rx_ring;				// Framed commands, read in place by the owner
+	char						rx_ring_buf[USART_RX_RING_SIZE];
+	char						*rx_frame;				// Room of the frame being received, NULL while the ring is full
+	uint32_t					rx_len;
+	char						*rx_raw;				// Unframed receive buffer
+	uint32_t					rx_raw_len;				// Bytes to collect into rx_raw
+	uint32_t					rx_raw_evt;				// Posted when rx_raw is full
+	uint32_t					rx_done_evt;			// Posted for each framed command
+	uint32_t					tx_done_evt;			// Posted by usart_start_blocks()
+}USART_COMMS_STRUCT;
+
+static const USART_INSTANCE usart_instances[USART_INSTANCES] = {
+#ifdef USART0_ENABLED
+	[USART_SM_USART0] = {USART0, cmuClock_USART0, USART0_RX_IRQn, USART0_TX_IRQn,
+			LDMA_CH_USART0_TX, ldmaPeripheralSignal_USART0_TXBL, SCHED_SRC_USART0_RX, SCHED_SRC_USART0_TX,
+			TRACE_IRQ_USART0},
+#endif
+};
+
+static USART_COMMS_STRUCT usart_sm[USART_INSTANCES] = {
+#ifdef USART0_ENABLED
+	[USART_SM_USART0] = {.hw = &usart_instances[USART_SM_USART0], .usart = USART0},
+#endif
+};
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+static void usart_rx_irq(USART_COMMS_STRUCT *sm);
+static void usart_tx_irq(USART_COMMS_STRUCT *sm);
+static void usart_act_illegal(void *ctx);
+static void usart_act_tx_done(void *ctx);
+static void usart_act_frame_hunt(void *ctx);
+static void usart_act_frame_byte(void *ctx);
+static void usart_act_raw_byte(void *ctx);
+static inline USART_COMMS_STRUCT *usart_context(USART_TypeDef *usart);
+
+static const FSM_ACTION usart_actions[] = {
+	[USART_ACT_ILLEGAL]			= usart_act_illegal,
+	[USART_ACT_TX_DONE]			= usart_act_tx_done,
+	[USART_ACT_FRAME_HUNT]		= usart_act_frame_hunt,
+	[USART_ACT_FRAME_BYTE]		= usart_act_frame_byte,
+	[USART_ACT_RAW_BYTE]		= usart_act_raw_byte,
+};
+
+static const FSM_TRANSITION usart_tx_transitions[USART_TX_STATES][USART_TX_CAUSES] = {
+	[USART_TX_CLOSE] = {
+		[USART_CAUSE_TXC]		= {USART_ACT_TX_DONE, USART_TX_IDLE},
+	},
+};
+
+static const FSM_TRANSITION usart_rx_transitions[USART_RX_STATES][USART_RX_CAUSES] = {
+	[USART_RX_STARTFRAME] = {
+		[USART_CAUSE_RXDATAV]	= {USART_ACT_FRAME_HUNT, FSM_STAY},		// RECEIVE at the start frame
+	},
+	[USART_RX_RECEIVE] = {
+		[USART_CAUSE_RXDATAV]	= {USART_ACT_FRAME_BYTE, FSM_STAY},		// STARTFRAME at the signal frame
+	},
+	[USART_RX_RAW] = {
+		[USART_CAUSE_RXDATAV]	= {USART_ACT_RAW_BYTE, FSM_STAY},		// STARTFRAME once rx_raw is full
+	},
+};
+
+static const FSM_TABLE usart_tx_table = {&usart_tx_transitions[0][0], usart_actions,
+		USART_TX_STATES, USART_TX_CAUSES, TRACE_USART_TX_STATE};
+static const FSM_TABLE usart_rx_table = {&usart_rx_transitions[0][0], usart_actions,
+		USART_RX_STATES, USART_RX_CAUSES, TRACE_USART_RX_STATE};
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Sets up a USART as an 8N1 style asynchronous link with framed receive
+ *
+ * @details
+ *	RX and TX are enabled and routed, and the receiver starts looking for a
+ *	start frame. EM2 is blocked until usart_close(), the USART stops with
+ *	the HF clock.
+ *
+ * @param[in] *usart_settings
+ *	Baud rate, frame format, pin locations and the owner's events
+ *
+ ******************************************************************************/
+void usart_open(USART_TypeDef *usart, USART_OPEN_STRUCT *usart_settings){
+	USART_COMMS_STRUCT *sm = usart_context(usart);
+	USART_InitAsync_TypeDef init = USART_INITASYNC_DEFAULT;
+
+	EFM_ASSERT(!sm->open);
+	CMU_ClockEnable(cmuClock_HFPER, true);
+	CMU_ClockEnable(sm->hw->clock, true);
+	ldma_open();
+
+	init.enable = usartDisable;
+	init.baudrate = usart_settings->baudrate;
+	init.databits = usart_settings->databits;
+	init.parity = usart_settings->parity;
+	init.stopbits = usart_settings->stopbits;
+	USART_InitAsync(usart, &init);
+
+	usart->ROUTELOC0 = usart_settings->rx_loc | usart_settings->tx_loc;
+	usart->ROUTEPEN = USART_ROUTEPEN_RXPEN | USART_ROUTEPEN_TXPEN;
+	usart->CMD = USART_CMD_CLEARRX | USART_CMD_CLEARTX;
+
+	sm->rx_done_evt = usart_settings->rx_done_evt;
+	sm->tx_done_evt = usart_settings->tx_done_evt;
+	sm->tx_busy = false;
+	sm->rx_busy = false;
+	frame_ring_init(&sm->rx_ring, sm->rx_ring_buf, USART_RX_RING_SIZE, USART_RX_FRAME_MAX);
+	fsm_init(&sm->tx_fsm, &usart_tx_table, USART_TX_IDLE);
+	fsm_init(&sm->rx_fsm, &usart_rx_table, USART_RX_STARTFRAME);
+
+	usart->IFC = usart->IF;
+	usart->IEN = USART_IEN_RXDATAV;
+	NVIC_ClearPendingIRQ(sm->hw->rx_irq);
+	NVIC_ClearPendingIRQ(sm->hw->tx_irq);
+	NVIC_EnableIRQ(sm->hw->rx_irq);
+	NVIC_EnableIRQ(sm->hw->tx_irq);
+
+	sleep_block_mode(USART_EM);
+	sm->open = true;
+	USART_Enable(usart, usartEnable);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Stops a USART and releases its pins and the EM2 block
+ *
+ * @note
+ *	Nothing may be in flight, e.g. the owner waits for its TX event first.
+ *	A framed command that has started is dropped.
+ *
+ ******************************************************************************/
+void usart_close(USART_TypeDef *usart){
+	USART_COMMS_STRUCT *sm = usart_context(usart);
+
+	EFM_ASSERT(sm->open && !sm->tx_busy);
+	USART_Enable(usart, usartDisable);
+	NVIC_DisableIRQ(sm->hw->rx_irq);
+	NVIC_DisableIRQ(sm->hw->tx_irq);
+	usart->IEN = 0;
+	usart->IFC = usart->IF;
+	usart->ROUTEPEN = 0;
+	CMU_ClockEnable(sm->hw->clock, false);
+	sm->rx_busy = false;
+	sm->open = false;
+	sleep_unblock_mode(USART_EM);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Changes the baud rate of an open USART
+ *
+ * @details
+ *	e.g. once the far end has been told to switch. The receiver is cleared
+ *	and looks for a start frame again, anything half received at the old
+ *	rate is garbage.
+ *
+ ******************************************************************************/
+void usart_set_baud(USART_TypeDef *usart, uint32_t baudrate){
+	USART_COMMS_STRUCT *sm = usart_context(usart);
+
+	EFM_ASSERT(sm->open && !sm->tx_busy);
+	EFM_ASSERT(sm->rx_fsm.state != USART_RX_RAW);
+
+	CORE_DECLARE_IRQ_STATE;
+	CORE_ENTER_CRITICAL();
+
+	USART_BaudrateAsyncSet(usart, 0, baudrate, usartOVS16);
+	usart->CMD = USART_CMD_CLEARRX;
+	sm->rx_busy = false;
+	fsm_set(&sm->rx_fsm, USART_RX_STARTFRAME);
+
+	CORE_EXIT_CRITICAL();
+}
+
+#ifdef USART0_ENABLED
+/***************************************************************************//**
+ * @brief
+ *	USART0 receive interrupt, bound to the USART0 context at compile time
+ *
+ ******************************************************************************/
+void USART0_RX_IRQHandler(void){
+	usart_rx_irq(&usart_sm[USART_SM_USART0]);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	USART0 transmit interrupt, bound to the USART0 context at compile time
+ *
+ ******************************************************************************/
+void USART0_TX_IRQHandler(void){
+	usart_tx_irq(&usart_sm[USART_SM_USART0]);
+}
+#endif
+
+/***************************************************************************//**
+ * @brief
+ *	Transmits a message in parts, posting the tx_done_evt given to
+ *	usart_open()
+ *
+ ******************************************************************************/
+void usart_start_blocks(USART_TypeDef *usart, const LDMA_BLOCK *block, uint32_t count){
+	usart_send_blocks(usart, block, count, usart_context(usart)->tx_done_evt);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Transmits the blocks of one message back to back on the LDMA
+ *
+ * @details
+ *	TXBL paces the transfer and the core only wakes for TXC. Empty blocks
+ *	are skipped.
+ *
+ * @param[in] *block
+ *	At most LDMA_BLOCKS_MAX blocks. The bytes are sent in place and must stay
+ *	unchanged until [event].
+ *
+ * @param[in] event
+ *	Scheduler event posted at TXC, payload is the total length
+ *
+ ******************************************************************************/
+void usart_send_blocks(USART_TypeDef *usart, const LDMA_BLOCK *block, uint32_t count, uint32_t event){
+	USART_COMMS_STRUCT *sm = usart_context(usart);
+	LDMA_BLOCK sent[LDMA_BLOCKS_MAX];
+	uint32_t blocks = 0;
+
+	EFM_ASSERT(sm->open && count <= LDMA_BLOCKS_MAX);
+
+	while(sm->tx_busy);
+
+	CORE_DECLARE_IRQ_STATE;
+	CORE_ENTER_CRITICAL();
+
+	sm->tx_len = 0;
+	for(uint32_t i = 0; i < count; i++){
+		if(block[i].count == 0) continue;
+		sent[blocks++] = block[i];
+		sm->tx_len += block[i].count;
+	}
+	EFM_ASSERT(sm->tx_len > 0);
+	sm->tx_evt = event;
+	sm->tx_busy = true;
+	fsm_set(&sm->tx_fsm, USART_TX_CLOSE);
+	usart->IFC = USART_IEN_TXC;
+	usart->IEN |= USART_IEN_TXC;
+	ldma_m2p_blocks(sm->hw->dma_tx_ch, sm->hw->dma_tx_signal, sent, blocks, &usart->TXDATA, NULL, NULL);
+
+	CORE_EXIT_CRITICAL();
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Collects the next [len] bytes without looking for frames
+ *
+ * @details
+ *	For the HM-10's bare AT responses, see leuart_receive().
+ *
+ * @param[out] *buf
+ *	Receives the bytes, not null terminated
+ *
+ * @param[in] event
+ *	Scheduler event posted when [len] bytes arrived, payload is len
+ *
+ * @note
+ *	Arm the receive before sending the command it answers. A framed command
+ *	being collected is dropped, e.g. line noise that looked like a start
+ *	frame at the wrong baud rate.
+ *
+ ******************************************************************************/
+void usart_receive(USART_TypeDef *usart, char *buf, uint32_t len, uint32_t event){
+	USART_COMMS_STRUCT *sm = usart_context(usart);
+
+	EFM_ASSERT(sm->open && len > 0);
+	EFM_ASSERT(sm->rx_fsm.state != USART_RX_RAW);
+
+	CORE_DECLARE_IRQ_STATE;
+	CORE_ENTER_CRITICAL();
+
+	sm->rx_raw = buf;
+	sm->rx_raw_len = len;
+	sm->rx_raw_evt = event;
+	sm->rx_len = 0;
+	sm->rx_busy = true;
+	fsm_set(&sm->rx_fsm, USART_RX_RAW);
+
+	CORE_EXIT_CRITICAL();
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Gives up on a usart_receive(), e.g. when the far end did not answer in
+ *	time. Its event is not posted.
+ *
+ ******************************************************************************/
+void usart_receive_cancel(USART_TypeDef *usart){
+	USART_COMMS_STRUCT *sm = usart_context(usart);
+
+	CORE_DECLARE_IRQ_STATE;
+	CORE_ENTER_CRITICAL();
+
+	if(sm->rx_fsm.state == USART_RX_RAW){
+		fsm_set(&sm->rx_fsm, USART_RX_STARTFRAME);
+		sm->rx_busy = false;
+	}
+
+	CORE_EXIT_CRITICAL();
+}
+
+/***************************************************************************//**
+ * @brief
+ *	True from usart_send_blocks() until TXC
+ *
+ ******************************************************************************/
+bool usart_tx_busy(USART_TypeDef *usart){
+	return usart_context(usart)->tx_busy;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	True while a framed command or a usart_receive() is being collected
+ *
+ ******************************************************************************/
+bool usart_rx_busy(USART_TypeDef *usart){
+	return usart_context(usart)->rx_busy;
+}
+
+/***************************************************************************//**
+ * @brief
+ *	The oldest framed command received, where it lies
+ *
+ * @details
+ *	Start and signal frame included and null terminated, see
+ *	leuart_rx_frame().
+ *
+ * @return
+ *	The frame, valid until usart_rx_release(), or NULL if none is waiting
+ *
+ ******************************************************************************/
+const char *usart_rx_frame(USART_TypeDef *usart, uint32_t *len){
+	return frame_ring_peek(&usart_context(usart)->rx_ring, len);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Frees the frame usart_rx_frame() returned
+ *
+ ******************************************************************************/
+void usart_rx_release(USART_TypeDef *usart){
+	frame_ring_release(&usart_context(usart)->rx_ring);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Frames received, and dropped for being too long or for a full ring,
+ *	since usart_open()
+ *
+ ******************************************************************************/
+void usart_rx_stats(USART_TypeDef *usart, FRAME_RING_STATS *stats){
+	frame_ring_stats(&usart_context(usart)->rx_ring, stats);
+}
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *	Receive interrupt shared by the USART instances, one RX table lookup
+ *
+ ******************************************************************************/
+static void usart_rx_irq(USART_COMMS_STRUCT *sm){
+	uint32_t int_flag = sm->usart->IF & sm->usart->IEN & USART_IF_RXDATAV;
+
+	TRACE(sm->hw->trace_irq, int_flag);
+	if(int_flag & USART_IF_RXDATAV){
+		fsm_dispatch(&sm->rx_fsm, USART_CAUSE_RXDATAV, sm);
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Transmit interrupt shared by the USART instances, one TX table lookup
+ *
+ ******************************************************************************/
+static void usart_tx_irq(USART_COMMS_STRUCT *sm){
+	uint32_t int_flag = sm->usart->IF & sm->usart->IEN & USART_IF_TXC;
+
+	sm->usart->IFC = int_flag;
+	TRACE(sm->hw->trace_irq, int_flag);
+	if(int_flag & USART_IF_TXC){
+		fsm_dispatch(&sm->tx_fsm, USART_CAUSE_TXC, sm);
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Action of the transitions the TX and RX tables do not list
+ *
+ ******************************************************************************/
+static void usart_act_illegal(void *ctx){
+	(void)ctx;
+	EFM_ASSERT(false);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	TXC, the message has left the shift register
+ *
+ ******************************************************************************/
+static void usart_act_tx_done(void *ctx){
+	USART_COMMS_STRUCT *sm = ctx;
+
+	sm->tx_busy = false;
+	sm->usart->IEN &= ~USART_IEN_TXC;
+	scheduler_post(sm->hw->sched_tx_src, sm->tx_evt, sm->tx_len);
+}
+
+/***************************************************************************//**
+ * @brief
+ *	RXDATAV between frames, only the start frame is kept
+ *
+ * @details
+ *	The frame gets its room in the RX ring here. While the owner has not
+ *	caught up and the ring is full, the frame is only counted.
+ *
+ * @note
+ *	Reading RXDATA clears RXDATAV, so every character is read.
+ *
+ ******************************************************************************/
+static void usart_act_frame_hunt(void *ctx){
+	USART_COMMS_STRUCT *sm = ctx;
+	char c = sm->usart->RXDATA;
+
+	if(c == USART_STARTF_CHAR){
+		sm->rx_frame = frame_ring_reserve(&sm->rx_ring);
+		if(sm->rx_frame != NULL){
+			sm->rx_frame[0] = c;
+		}
+		sm->rx_len = 1;
+		sm->rx_busy = true;
+		fsm_set(&sm->rx_fsm, USART_RX_RECEIVE);
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *	RXDATAV inside a frame
+ *
+ * @details
+ *	The signal frame completes it and commits it to the RX ring. A frame
+ *	longer than USART_RX_FRAME_MAX is dropped and counted, and the receiver
+ *	waits for the next start frame.
+ *
+ ******************************************************************************/
+static void usart_act_frame_byte(void *ctx){
+	USART_COMMS_STRUCT *sm = ctx;
+	char c = sm->usart->RXDATA;
+
+	if(sm->rx_len >= USART_RX_FRAME_MAX){
+		sm->rx_ring.overflow++;
+		sm->rx_busy = false;
+		fsm_set(&sm->rx_fsm, USART_RX_STARTFRAME);
+		return;
+	}
+	if(sm->rx_frame != NULL){
+		sm->rx_frame[sm->rx_len] = c;
+	}
+	sm->rx_len++;
+	if(c == USART_SIGF_CHAR){
+		sm->rx_busy = false;
+		fsm_set(&sm->rx_fsm, USART_RX_STARTFRAME);
+		if(sm->rx_frame == NULL){
+			sm->rx_ring.full++;
+			return;
+		}
+		frame_ring_commit(&sm->rx_ring, sm->rx_len);
+		scheduler_post(sm->hw->sched_rx_src, sm->rx_done_evt, sm->rx_len);
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *	RXDATAV of a usart_receive(), framing goes back on once it is full
+ *
+ ******************************************************************************/
+static void usart_act_raw_byte(void *ctx){
+	USART_COMMS_STRUCT *sm = ctx;
+
+	sm->rx_raw[sm->rx_len++] = sm->usart->RXDATA;
+	if(sm->rx_len >= sm->rx_raw_len){
+		sm->rx_busy = false;
+		fsm_set(&sm->rx_fsm, USART_RX_STARTFRAME);
+		scheduler_post(sm->hw->sched_rx_src, sm->rx_raw_evt, sm->rx_len);
+	}
+}
+
+/***************************************************************************//**
+ * @brief
+ *	Finds the context of a peripheral for the public functions
+ *
+ * @details
+ *	One compare per instance enabled in brd_config.h, chosen by the
+ *	preprocessor. The interrupt handlers are bound to their context at
+ *	compile time and never look it up.
+ *
+ ******************************************************************************/
+static inline USART_COMMS_STRUCT *usart_context(USART_TypeDef *usart){
+#ifdef USART0_ENABLED
+	if(usart == USART0) return &usart_sm[USART_SM_USART0];
+#endif
+	EFM_ASSERT(false);			// Not enabled in brd_config.h
+	return NULL;
+}
@@ -30,28 +30,9 @@ int main(void){
   while (1) {
 	  	  CORE_DECLARE_IRQ_STATE;
 	  	  CORE_ENTER_CRITICAL();
-	  if (!get_scheduled_events()) enter_sleep();
+	  if (!scheduler_events_pending()) enter_sleep();
 	  	  CORE_EXIT_CRITICAL();
 
-	  if(get_scheduled_events() & LETIMER0_COMP0_CB)
-	  {scheduled_letimer0_comp0_cb();}
-
-	  if(get_scheduled_events() & LETIMER0_COMP1_CB)
-	  {scheduled_letimer0_comp1_cb();}
-
-	  if(get_scheduled_events() & LETIMER0_UF_CB)
-	  {scheduled_letimer0_uf_cb();}
-
-	  if(get_scheduled_events() & SI7021_READ_DONE_CB)
-	  {scheduled_si7021_read_done_cb();}
-
-	  if(get_scheduled_events() & BOOT_UP_CB)
-	  {scheduled_boot_up_cb();}
-
-	  if(get_scheduled_events() & BLE_TX_DONE_CB)
-	  {scheduled_tx_done_cb();}
-
-	  if(get_scheduled_events() & BLE_RX_DONE_CB)
-	  {scheduled_rx_done_cb();}
+	  scheduler_dispatch();	// Runs every pending callback registered in app_peripheral_setup()
   }
 }